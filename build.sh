@@ -12,7 +12,7 @@ LOG_FILE="$LOG_DIR/build_$(date +%Y%m%d_%H%M%S).log"
 exec > >(tee -a "$LOG_FILE") 2>&1
 
 FW_TARGET="${1:-${FW_TARGET:-titan}}"
-FW_TARGETS=(titan test_pwm test_spi test_usart test_oscilloscope test_errc)
+FW_TARGETS=(titan test_pwm test_spi test_usart test_oscilloscope test_errc test_mmio_bench test_spi_bench)
 MAX_ATTEMPTS=3
 UPDATE_DEBUG_TARGET=false
 
@@ -24,11 +24,11 @@ done
 
 # ── Target validation ──────────────────────────────────────────────────────────
 case "$FW_TARGET" in
-  titan|test_pwm|test_spi|test_usart|test_oscilloscope|test_errc|commit_check|all|clean|docs)
+  titan|test_pwm|test_spi|test_usart|test_oscilloscope|test_errc|test_mmio_bench|test_spi_bench|commit_check|all|clean|docs)
     ;;
   *)
     echo "Unknown target: $FW_TARGET"
-    echo "Valid targets: titan, test_pwm, test_spi, test_usart, test_oscilloscope, test_errc, commit_check, all, clean, docs"
+    echo "Valid targets: titan, test_pwm, test_spi, test_usart, test_oscilloscope, test_errc, test_mmio_bench, test_spi_bench, commit_check, all, clean, docs"
     exit 4
     ;;
 esac
@@ -142,6 +142,42 @@ if [ "$FW_TARGET" = "commit_check" ]; then
   fi
   make test_alloc_target || { echo "make test_alloc failed"; exit 21; }
   echo "Built target test_alloc"
+  make test_alloc_mt_target || { echo "make test_alloc_mt failed"; exit 21; }
+  echo "Built target test_alloc_mt"
+  make test_alloc_regions_target || { echo "make test_alloc_regions failed"; exit 21; }
+  echo "Built target test_alloc_regions"
+  make test_arena_target || { echo "make test_arena failed"; exit 21; }
+  echo "Built target test_arena"
+  make test_state_machine_target || { echo "make test_state_machine failed"; exit 21; }
+  echo "Built target test_state_machine"
+  make test_spi_async_target || { echo "make test_spi_async failed"; exit 21; }
+  echo "Built target test_spi_async"
+  make test_dma_target || { echo "make test_dma failed"; exit 21; }
+  echo "Built target test_dma"
+  make test_spi_sched_target || { echo "make test_spi_sched failed"; exit 21; }
+  echo "Built target test_spi_sched"
+  make test_spi_profile_target || { echo "make test_spi_profile failed"; exit 21; }
+  echo "Built target test_spi_profile"
+  make test_spi_sync_target || { echo "make test_spi_sync failed"; exit 21; }
+  echo "Built target test_spi_sync"
+  make test_spi_packed_target || { echo "make test_spi_packed failed"; exit 21; }
+  echo "Built target test_spi_packed"
+  make test_spi_stats_target || { echo "make test_spi_stats failed"; exit 21; }
+  echo "Built target test_spi_stats"
+  make test_device_sim_target || { echo "make test_device_sim failed"; exit 21; }
+  echo "Built target test_device_sim"
+  make test_uart_rx_target || { echo "make test_uart_rx failed"; exit 21; }
+  echo "Built target test_uart_rx"
+  make test_uart_tx_target || { echo "make test_uart_tx failed"; exit 21; }
+  echo "Built target test_uart_tx"
+  make test_uart_rs485_target || { echo "make test_uart_rs485 failed"; exit 21; }
+  echo "Built target test_uart_rs485"
+  make test_deadline_target || { echo "make test_deadline failed"; exit 21; }
+  echo "Built target test_deadline"
+  make test_extern_flash_target || { echo "make test_extern_flash failed"; exit 21; }
+  echo "Built target test_extern_flash"
+  make test_qspi_target || { echo "make test_qspi failed"; exit 21; }
+  echo "Built target test_qspi"
   ctest --output-on-failure || { echo "Unit tests failed"; exit 21; }
   echo "Local CMake check passed. Good to go for committing! :D"
   exit 0
@@ -5,10 +5,11 @@
 #pragma once
 #include <stdbool.h>
 
+// A state in the state machine. on_enter/on_exit only fire when the machine actually changes
+// state, so device bring-up belongs there; run is called once per control tick and returns the
+// index of the next state (its own index to stay put, -1 to stop the machine).
 typedef struct {
-    bool (*init)(void); 
+    bool (*on_enter)(void);
     int (*run)(void);
-    bool (*destroy)(void); 
+    bool (*on_exit)(void);
 } state;
-
-
@@ -3,6 +3,10 @@
 //
 
 #include "state.h"
+#include "internal/arena.h"
+#include "state_machine.h"
+#include "app/utils/extern_flash.h"
+#include "peripheral/qspi.h"
 #include "states/init_state.h"
 #include "states/standby_state.h"
 #include "states/fill_state.h"
@@ -14,6 +18,10 @@
 #define NUM_STATES 7
 static state states[NUM_STATES];
 
+// Index of the state currently running, and whether its on_enter hook has fired yet.
+static int curr_state = 0;
+static bool curr_entered = false;
+
 void setup_states() {
     states[0] = build_init_state();
     states[1] = build_standby_state();
@@ -22,6 +30,42 @@ void setup_states() {
     states[4] = build_armed_state();
     states[5] = build_fire_state();
     states[6] = build_safe_state();
+
+    curr_state = 0;
+    curr_entered = false;
+}
+
+int step_state_machine() {
+    // scratch buffers from the previous tick are dead now
+    arena_reset();
+
+    if (!curr_entered) {
+        states[curr_state].on_enter();
+        curr_entered = true;
+    }
+
+    const int next_state = states[curr_state].run();
+
+    // Keep complete log pages moving to flash between log_data calls; failures are logged
+    // inside. Nothing can reach the flash while it is mapped for reading.
+    if (!qspi_memory_mapped()) {
+        enum ti_errc_t errc;
+        log_service(&errc);
+    }
+    if (next_state == curr_state) {
+        return next_state;
+    }
+
+    // Real transition (or halt): tear the current state down, the next one is entered lazily
+    // at the start of the next tick.
+    states[curr_state].on_exit();
+    curr_entered = false;
+
+    if (next_state < 0 || next_state >= NUM_STATES) {
+        return -1;
+    }
+    curr_state = next_state;
+    return next_state;
 }
 
 void run_state_machine() {
@@ -29,16 +73,7 @@ void run_state_machine() {
     // looks in our flash memory to see if we are recovering from a crash,
     // and if so it returns the state to go to (this would be sick)
 
-    state curr = states[0];
-
-    while (1) {
-        curr.init();
-        const int next_state = curr.run();
-        curr.destroy();
-
-        if (next_state == -1) {
-            break;
-        }
-        curr = states[next_state];
+    while (step_state_machine() != -1) {
+        // on_enter/on_exit only run on transitions, so devices are brought up once per state
     }
 }
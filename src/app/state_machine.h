@@ -7,3 +7,7 @@
 // Program entry is handled by running these two functions.
 void setup_states();
 void run_state_machine();
+
+// Runs a single control tick of the state machine (entering/exiting states as needed).
+// Returns the index of the state that will run next tick, or -1 if the machine has stopped.
+int step_state_machine();
@@ -24,10 +24,7 @@
 bool armed_state_init(){
     enum ti_errc_t errc;
 
-    tal_set_mode((int)RS485_DE, 1);
-    tal_set_mode((int)RS485_RE, 1);
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
+    rs485_pins_init();
 
     state_comm_shared.last_command_status = COMMAND_STATUS_WAITING;
 
@@ -51,9 +48,6 @@ int armed_state_run(){
     uint8_t comm_tags[1] = {ARMED_MSG_TAG_NONE};
     uint8_t requested_state = ARMED_STATE_IDX;
 
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
-
     // TODO: Switch power from umbilical to battery
     comm_tags[0] = ARMED_MSG_TAG_POWER_SWITCHED;
 
@@ -92,6 +86,11 @@ int armed_state_run(){
         TI_SET_ERRC(&errc, errc, "Failed to build armed comm packet");
     }
 
+    attach_heap_stats(&comm_packet_len, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to attach heap stats");
+    }
+
     send_packet_radio_flash(&radio_dev, state_comm_shared.comm_packet, comm_packet_len, &errc);
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to send armed comm packet");
@@ -133,9 +132,9 @@ bool armed_state_destroy(){
 
 state build_armed_state() {
     const state armed_state = {
-        .init = &armed_state_init,
+        .on_enter = &armed_state_init,
         .run = &armed_state_run,
-        .destroy = &armed_state_destroy
+        .on_exit = &armed_state_destroy
     };
     return armed_state;
 }
\ No newline at end of file
@@ -23,9 +23,9 @@ bool fill_state_destroy(){
 
 state build_fill_state() {
     const state fill_state = {
-        .init = &fill_state_init,
+        .on_enter = &fill_state_init,
         .run = &fill_state_run,
-        .destroy = &fill_state_destroy
+        .on_exit = &fill_state_destroy
     };
     return fill_state;
 }
\ No newline at end of file
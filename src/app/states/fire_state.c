@@ -36,6 +36,14 @@ bool fire_state_init(){
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to initialize radio");
     }
+    spi_set_profile(imu_dev1.inst, imu_dev1.ss_pin, &imu_spi_profile, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to set IMU 1 SPI profile");
+    }
+    spi_set_profile(imu_dev2.inst, imu_dev2.ss_pin, &imu_spi_profile, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to set IMU 2 SPI profile");
+    }
     errc = imu_init(&imu_dev1);
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to initialize IMU 1");
@@ -237,11 +245,27 @@ int fire_state_run(){
             TI_SET_ERRC(&errc, errc, "Failed to build comm packet");
         }
 
+        attach_heap_stats(&comm_packet_len, &errc);
+        if (errc && errc != TI_ERRC_NONE) {
+            TI_SET_ERRC(&errc, errc, "Failed to attach heap stats");
+        }
+
         send_packet_radio_flash(&radio_dev, state_comm_shared.comm_packet, comm_packet_len, &errc);
         if (errc && errc != TI_ERRC_NONE) {
             TI_SET_ERRC(&errc, errc, "Failed to transmit comm packet");
         }
 
+        // SPI bus usage of one device per comm cycle
+        if (build_next_spi_stats_packet(&errc)) {
+            send_packet_radio_flash(&radio_dev,
+                                    state_comm_shared.spi_stats_packet,
+                                    sizeof(state_comm_shared.spi_stats_packet),
+                                    &errc);
+            if (errc && errc != TI_ERRC_NONE) {
+                TI_SET_ERRC(&errc, errc, "Failed to transmit SPI stats packet");
+            }
+        }
+
         receive_uplink_comm_packet(&radio_dev,
                                    state_comm_shared.rx_packet,
                                    sizeof(state_comm_shared.rx_packet),
@@ -268,9 +292,9 @@ bool fire_state_destroy(){
 
 state build_fire_state() {
     const state fire_state = {
-        .init = &fire_state_init,
+        .on_enter = &fire_state_init,
         .run = &fire_state_run,
-        .destroy = &fire_state_destroy
+        .on_exit = &fire_state_destroy
     };
     return fire_state;
 }
@@ -92,10 +92,7 @@ static uint8_t update_hold_pressure_and_vent(enum ti_errc_t *errc) {
 bool hold_state_init(){
     enum ti_errc_t errc;
 
-    tal_set_mode((int)RS485_DE, 1);
-    tal_set_mode((int)RS485_RE, 1);
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
+    rs485_pins_init();
 
     state_comm_shared.last_command_status = COMMAND_STATUS_WAITING;
 
@@ -139,9 +136,6 @@ int hold_state_run(){
     uint8_t comm_tags[1] = {HOLD_MSG_TAG_NONE};
     uint8_t requested_state = HOLD_STATE_IDX;
 
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
-
     comm_tags[0] = update_hold_pressure_and_vent(&errc);
 
     build_adc_packet(adc_channels,
@@ -192,6 +186,11 @@ int hold_state_run(){
         TI_SET_ERRC(&errc, errc, "Failed to build hold comm packet");
     }
 
+    attach_heap_stats(&comm_packet_len, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to attach heap stats");
+    }
+
     send_packet_radio_flash(&radio_dev, state_comm_shared.comm_packet, comm_packet_len, &errc);
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to send hold comm packet");
@@ -233,9 +232,9 @@ bool hold_state_destroy(){
 
 state build_hold_state() {
     const state hold_state = {
-        .init = &hold_state_init,
+        .on_enter = &hold_state_init,
         .run = &hold_state_run,
-        .destroy = &hold_state_destroy
+        .on_exit = &hold_state_destroy
     };
     return hold_state;
 }
@@ -7,6 +7,7 @@
 #include "init_state.h"
 #include "app/utils/extern_flash.h"
 
+#include "peripheral/dma.h"
 #include "peripheral/gpio.h"
 #include "peripheral/qspi.h"
 #include "peripheral/errc.h"
@@ -24,9 +25,23 @@ static bool has_recovered_state = false;
 bool init_state_init() {
     enum ti_errc_t errc;
 
+    dma_init(&errc); // before any driver claims a stream
+    if (errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to initialize DMA");
+    }
     qspi_init(); // probably should return a ti_errc_t
+    qspi_enable_quad(&errc); // quad reads and programs; single line still works without it
+    if (errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to enable quad flash mode");
+    }
     ti_log_init(); /* Scan flash log region; safe to ignore return — logger degrades gracefully */
 
+    // Rebuild the flash pointers from flash if backup SRAM lost them
+    extern_flash_recover(&errc);
+    if (errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to recover flash pointers");
+    }
+
     // Check if we're recovering from a crash
     if (check_saved_state()) {
         enum states_t prev_state = get_prev_state(&errc);
@@ -78,9 +93,9 @@ enum states_t init_state_get_recovered_state() {
 
 state build_init_state() {
     const state init_state = {
-        .init = &init_state_init,
+        .on_enter = &init_state_init,
         .run = &init_state_run,
-        .destroy = &init_state_destroy
+        .on_exit = &init_state_destroy
     };
     return init_state;
 }
@@ -23,10 +23,7 @@
 bool safe_state_init(){
     enum ti_errc_t errc;
 
-    tal_set_mode((int)RS485_DE, 1);
-    tal_set_mode((int)RS485_RE, 1);
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
+    rs485_pins_init();
 
     state_comm_shared.last_command_status = COMMAND_STATUS_WAITING;
 
@@ -61,9 +58,6 @@ int safe_state_run(){
     uint8_t requested_state = SAFE_STATE_IDX;
     sensor_status_t sensor_status;
 
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
-
     // Open all vent valves
     for (uint8_t i = 0; i < VALVE_COUNT; i++) {
         valve_states[i] = 1U; // Open all valves
@@ -131,6 +125,11 @@ int safe_state_run(){
         TI_SET_ERRC(&errc, errc, "Failed to build safe comm packet");
     }
 
+    attach_heap_stats(&comm_packet_len, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to attach heap stats");
+    }
+
     send_packet_radio_flash(&radio_dev, state_comm_shared.comm_packet, comm_packet_len, &errc);
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to send safe comm packet");
@@ -173,9 +172,9 @@ bool safe_state_destroy(){
 
 state build_safe_state() {
     const state safe_state = {
-        .init = &safe_state_init,
+        .on_enter = &safe_state_init,
         .run = &safe_state_run,
-        .destroy = &safe_state_destroy
+        .on_exit = &safe_state_destroy
     };
     return safe_state;
 }
\ No newline at end of file
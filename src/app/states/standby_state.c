@@ -26,10 +26,7 @@ bool standby_state_init(){
     memset(valve_states, 0, sizeof(valve_states));
     memset(servo_states, 0, sizeof(servo_states));
 
-    tal_set_mode((int)RS485_DE, 1);
-    tal_set_mode((int)RS485_RE, 1);
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
+    rs485_pins_init();
 
     state_comm_shared.last_command_status = COMMAND_STATUS_WAITING;
 
@@ -53,9 +50,6 @@ int standby_state_run(){
     size_t comm_packet_len;
     uint8_t requested_state = STANDBY_STATE_IDX;
 
-    tal_set_pin((int)RS485_DE, 1);
-    tal_set_pin((int)RS485_RE, 0);
-
     build_state_packet(valve_states,
                        VALVE_COUNT,
                        servo_states,
@@ -88,6 +82,11 @@ int standby_state_run(){
         TI_SET_ERRC(&errc, errc, "Failed to build standby comm packet");
     }
 
+    attach_heap_stats(&comm_packet_len, &errc);
+    if (errc && errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(&errc, errc, "Failed to attach heap stats");
+    }
+
     send_packet_radio_flash(&radio_dev, state_comm_shared.comm_packet, comm_packet_len, &errc);
     if (errc && errc != TI_ERRC_NONE) {
         TI_SET_ERRC(&errc, errc, "Failed to send standby comm packet");
@@ -129,9 +128,9 @@ bool standby_state_destroy(){
 
 state build_standby_state() {
     const state standby_state = {
-        .init = &standby_state_init,
+        .on_enter = &standby_state_init,
         .run = &standby_state_run,
-        .destroy = &standby_state_destroy
+        .on_exit = &standby_state_destroy
     };
     return standby_state;
 }
\ No newline at end of file
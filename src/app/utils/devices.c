@@ -0,0 +1,120 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file app/utils/devices.c
+ * @authors Joshua Beard
+ * @brief The flight computer's device instances, shared by every state
+ */
+#include "devices.h"
+
+radio_t radio_dev;
+
+radio_spi_dev radio_spi_config = {
+	.spi_inst = (uint8_t)RADIO_SPI_INST,
+	.ss_pin = (uint8_t)RADIO_SPI_CS
+};
+
+radio_config_t radio_config = {
+	.reset_pin = (uint8_t)RADIO_SHDN,
+	.nirq_pin = (uint8_t)RADIO_IRQ,
+	.reset_active_high = 0,
+	.channel = 0
+};
+
+gnss_t gnss_dev = {
+	.spi_config = {
+		.spi_inst = (uint8_t)GNSS_SPI_INST,
+		.ss_pin = (uint8_t)GNSS_SPI_CS
+	},
+	.config = {
+		.meas_rate_ms = 200,
+		.constellation_mask = GNSS_CONSTELLATION_GPS | GNSS_CONSTELLATION_GLONASS | GNSS_CONSTELLATION_BEIDOU,
+		.dyn_model = GNSS_DYN_AIRBORNE_4G,
+		.power_mode = GNSS_POWER_CONTINUOUS
+	},
+	.initialized = 0
+};
+
+struct imu_spi_dev imu_dev1 = {
+	.inst = (uint8_t)SENSOR_SPI_INST,
+	.ss_pin = (uint8_t)IMU_1_CS
+};
+
+struct imu_spi_dev imu_dev2 = {
+	.inst = (uint8_t)SENSOR_SPI_INST,
+	.ss_pin = (uint8_t)IMU_2_CS
+};
+
+barometer_t barometer_dev1 = {
+	.spi_dev = {
+		.inst = (uint8_t)SENSOR_SPI_INST,
+		.ss_pin = (uint8_t)BARO_1_CS
+	},
+	.osr = OSR_4096,
+	.calibration_data = {0},
+	.result = {0}
+};
+
+barometer_t barometer_dev2 = {
+	.spi_dev = {
+		.inst = (uint8_t)SENSOR_SPI_INST,
+		.ss_pin = (uint8_t)BARO_2_CS
+	},
+	.osr = OSR_4096,
+	.calibration_data = {0},
+	.result = {0}
+};
+
+struct magnetometer_spi_dev magnetometer_dev1 = {
+	.inst = (uint8_t)SENSOR_SPI_INST,
+	.ss_pin = (uint8_t)MAGNOTOMETER_CS
+};
+
+struct magnetometer_spi_dev magnetometer_dev2 = {
+	.inst = (uint8_t)SENSOR_SPI_INST,
+	.ss_pin = (uint8_t)MAGNOTOMETER_CS
+};
+
+temperature_t temperature_dev1 = {
+	.spi_config = {
+		.spi_inst = (uint8_t)SENSOR_SPI_INST,
+		.ss_pin = (uint8_t)POWER_TMP_CS
+	},
+	.config = {
+		.mode = temperature_MODE_CONTINUOUS,
+		.resolution = temperature_RES_16_BIT
+	}
+};
+
+temperature_t temperature_dev2 = {
+	.spi_config = {
+		.spi_inst = (uint8_t)SENSOR_SPI_INST,
+		.ss_pin = (uint8_t)ANALOG_TMP_CS
+	},
+	.config = {
+		.mode = temperature_MODE_CONTINUOUS,
+		.resolution = temperature_RES_16_BIT
+	}
+};
+
+struct adc_spi_dev adc_dev = {
+	.inst = (uint8_t)SENSOR_SPI_INST,
+	.ss_pin = (uint8_t)SENSOR_CS_1
+};
+
+uint8_t valve_states[VALVE_COUNT];
+
+uint16_t servo_states[SERVO_COUNT];
@@ -1,35 +1,164 @@
 #include <stdint.h>
+#include <string.h>
 #include "peripheral/qspi.h"
 #include "peripheral/errc.h"
 #include "extern_flash.h"
 
-volatile uint32_t* const state_addr_ptr = (volatile uint32_t*)0x38800000; // Address of current state
-volatile uint32_t* const data_addr_ptr = (volatile uint32_t*)0x38800004; // Address of current data log
-volatile uint32_t* const curr_page_space_ptr = (volatile uint32_t*)0x38800008; // Remaining space in current page
+// Both live in backup SRAM (.bkup_ram_vars in linker.ld), so they survive a reset
+extern uint32_t __flash_state_addr;
+extern uint32_t __flash_data_addr;
 
-// ONLY INITIALIZE ONCE AT THE START OF THE PROGRAM. 
+volatile uint32_t* const state_addr_ptr = &__flash_state_addr; // Address of current state
+volatile uint32_t* const data_addr_ptr = &__flash_data_addr;   // End of the programmed data log
+
+// S25FL064L commands, all single line with 24-bit addresses. Reads and page programs go through
+// qspi_read and qspi_program, which use four lines once qspi_enable_quad has run.
+#define FLASH_CMD_WREN  0x06 // Write enable
+#define FLASH_CMD_RDSR1 0x05 // Read status register 1
+#define FLASH_CMD_SE    0x20 // 4KB sector erase
+
+#define FLASH_SR1_WIP 0x01        // Write in progress
+#define FLASH_ADDRESS_24BIT 2     // ADSIZE of three address bytes
+
+// Worst case busy times from the datasheet, with margin
+#define FLASH_PROGRAM_TIMEOUT_US 3000U
+#define FLASH_ERASE_TIMEOUT_US   500000U
+
+#define LOG_BUFFER_SIZE (EXTERN_FLASH_LOG_PAGES * EXTERN_FLASH_PAGE_SIZE)
+
+// Data log bytes for flash addresses [*data_addr_ptr, log_end) wait in log_buffer at
+// (address % LOG_BUFFER_SIZE). The buffer holds whole pages, so every page is contiguous in it
+// and is programmed straight from it.
+static uint8_t log_buffer[LOG_BUFFER_SIZE];
+static bool log_started = false;
+static uint32_t log_end;           // Flash address the next record goes to
+static uint32_t erased_end;        // Sectors from the log's write position up to here are erased
+static bool flash_busy = false;    // A program or erase was started and not yet seen to finish
+static uint32_t busy_timeout_us;   // Worst case of the one in progress
+
+static void flash_cmd(uint8_t instruction, uint32_t address, bool has_address, uint8_t* data,
+                      uint32_t length, bool is_read, enum ti_errc_t* errc) {
+    qspi_cmd_t cmd = {
+        .instruction = instruction,
+        .instruction_mode = QSPI_MODE_SINGLE,
+        .address = address,
+        .address_mode = has_address ? QSPI_MODE_SINGLE : QSPI_MODE_NONE,
+        .address_size = has_address ? FLASH_ADDRESS_24BIT : 0,
+        .dummy_cycles = 0,
+        .data_mode = length > 0 ? QSPI_MODE_SINGLE : QSPI_MODE_NONE,
+        .data_size = length
+    };
+    qspi_send_cmd(&cmd, data, is_read, errc);
+}
+
+// Starts a sector erase behind a write enable, without waiting for it
+static void flash_erase(uint32_t address, enum ti_errc_t* errc) {
+    flash_cmd(FLASH_CMD_WREN, 0, false, NULL, 0, false, errc);
+    if (*errc != TI_ERRC_NONE) return;
+    flash_cmd(FLASH_CMD_SE, address, true, NULL, 0, false, errc);
+    if (*errc != TI_ERRC_NONE) return;
+    flash_busy = true;
+    busy_timeout_us = FLASH_ERASE_TIMEOUT_US;
+}
+
+// Starts a page program, without waiting for it
+static void flash_program(uint32_t address, const uint8_t* data, uint32_t length, enum ti_errc_t* errc) {
+    qspi_program(address, data, length, errc);
+    if (*errc != TI_ERRC_NONE) return;
+    flash_busy = true;
+    busy_timeout_us = FLASH_PROGRAM_TIMEOUT_US;
+}
+
+// True while the last program or erase is running. Reads the status register only if one was started.
+static bool flash_check_busy(enum ti_errc_t* errc) {
+    *errc = TI_ERRC_NONE;
+    if (!flash_busy) return false;
+    uint8_t status;
+    flash_cmd(FLASH_CMD_RDSR1, 0, false, &status, 1, true, errc);
+    if (*errc != TI_ERRC_NONE) return true;
+    flash_busy = (status & FLASH_SR1_WIP) != 0;
+    return flash_busy;
+}
+
+// Blocks until the last program or erase is done
+static void flash_wait_idle(enum ti_errc_t* errc) {
+    *errc = TI_ERRC_NONE;
+    if (!flash_busy) return;
+    qspi_poll_status_blk(busy_timeout_us, errc);
+    if (*errc == TI_ERRC_NONE) flash_busy = false;
+}
+
+// Picks the data log up from the backup SRAM pointer after a reset
+static void log_start() {
+    if (log_started) return;
+    log_end = *data_addr_ptr;
+    // Sectors are erased before their first page, so one the log is part way into is erased to
+    // its end; one it is about to start may not be
+    erased_end = (log_end % EXTERN_FLASH_SECTOR_SIZE == 0) ? log_end :
+                 (log_end / EXTERN_FLASH_SECTOR_SIZE + 1) * EXTERN_FLASH_SECTOR_SIZE;
+    // An erase from before the reset may still be running
+    flash_busy = true;
+    busy_timeout_us = FLASH_ERASE_TIMEOUT_US;
+    log_started = true;
+}
+
+// Starts the next piece of flash work for the data log, with the flash idle: the page at the
+// front of the buffer once it is complete (or once it has anything in it, with flush), the erase
+// of the sector that page needs, or else the erase of the sector after the one being written.
+// False if there was nothing to do.
+static bool log_step(bool flush, enum ti_errc_t* errc) {
+    *errc = TI_ERRC_NONE;
+    const uint32_t start = *data_addr_ptr;
+    const uint32_t page_end = (start / EXTERN_FLASH_PAGE_SIZE + 1) * EXTERN_FLASH_PAGE_SIZE;
+    const bool page_ready = log_end >= page_end || (flush && log_end > start);
+
+    if (page_ready && start < erased_end) {
+        const uint32_t end = log_end < page_end ? log_end : page_end;
+        flash_program(start, &log_buffer[start % LOG_BUFFER_SIZE], end - start, errc);
+        if (*errc == TI_ERRC_NONE) *data_addr_ptr = end;
+        return true;
+    }
+
+    const uint32_t erase_target = (log_end / EXTERN_FLASH_SECTOR_SIZE + 2) * EXTERN_FLASH_SECTOR_SIZE;
+    if (erased_end < erase_target && erased_end < EXTERN_FLASH_SIZE) {
+        flash_erase(erased_end, errc);
+        if (*errc == TI_ERRC_NONE) erased_end += EXTERN_FLASH_SECTOR_SIZE;
+        return true;
+    }
+    return false;
+}
+
+// ONLY INITIALIZE ONCE AT THE START OF THE PROGRAM.
 // DO NOT CALL MORE THAN ONCE OR YOU WILL LOSE ALL DATA IN EXTERNAL FLASH MEMORY
 void init_extern_flash() {
     *state_addr_ptr = STATE_POOL_BASE_ADDR;
-    *curr_page_space_ptr = 0; 
+    *data_addr_ptr = DATA_POOL_BASE_ADDR;
+    log_started = false;
 }
 
 void log_state(enum states_t state, enum ti_errc_t* errc) {
-    qspi_cmd_t cmd = {
-        .instruction = 0x02, // Page Program command
-        .instruction_mode = QSPI_MODE_SINGLE,
-        .address = *state_addr_ptr,
-        .address_mode = QSPI_MODE_SINGLE,
-        .address_size = 3, // 24-bit address
-        .dummy_cycles = 0,
-        .data_mode = QSPI_MODE_SINGLE,
-        .data_size = 1
-    };
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+
+    // The state byte goes out even if the data log could not be flushed
+    enum ti_errc_t sync_err;
+    log_sync(&sync_err);
+
+    if (*state_addr_ptr >= DATA_POOL_BASE_ADDR) {
+        TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "State pool full");
+        return;
+    }
 
-    uint8_t data = (uint8_t) state; 
-    qspi_send_cmd(&cmd, &data, false, errc); 
+    uint8_t data = (uint8_t) state;
+    flash_program(*state_addr_ptr, &data, 1, &err);
+    if (err == TI_ERRC_NONE) flash_wait_idle(&err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to program state");
+        return;
+    }
 
     *state_addr_ptr += 1;
+    if (errc) *errc = sync_err;
 }
 
 bool check_saved_state() {
@@ -37,57 +166,158 @@ bool check_saved_state() {
 }
 
 enum states_t get_prev_state(enum ti_errc_t* errc) {
-    qspi_cmd_t cmd = {
-        .instruction = 0x03, // Read Data command
-        .instruction_mode = QSPI_MODE_SINGLE,
-        .address = *state_addr_ptr - 1,
-        .address_mode = QSPI_MODE_SINGLE,
-        .address_size = 3, // 24-bit address
-        .dummy_cycles = 0,
-        .data_mode = QSPI_MODE_SINGLE,
-        .data_size = 1
-    };
-
     uint8_t data;
-    qspi_send_cmd(&cmd, &data, true, errc); 
+    qspi_read(*state_addr_ptr - 1, &data, 1, qspi_quad_enabled() ? QSPI_READ_QUAD_IO : QSPI_READ_SINGLE, errc);
 
-    if (errc != TI_ERRC_NONE) {
+    if (*errc != TI_ERRC_NONE) {
         return -1;
     }
 
-    return (enum states_t) data; 
+    return (enum states_t) data;
 }
 
-// Data logged can be no larger than 256 bytes at a time. 
 void log_data(uint8_t* data, uint16_t length, enum ti_errc_t* errc) {
-    qspi_cmd_t cmd = {
-            .instruction = 0x02, // Page Program command
-            .instruction_mode = QSPI_MODE_SINGLE,
-            .address = *data_addr_ptr,
-            .address_mode = QSPI_MODE_SINGLE,
-            .address_size = 3, // 24-bit address
-            .dummy_cycles = 0,
-            .data_mode = QSPI_MODE_SINGLE,
-            .data_size = length
-        };
-
-    // If the current page space exceeds 256 bytes, we need to move to the next page
-    if ((*curr_page_space_ptr  + length) > 256) {
-        uint8_t diff = 256 - (*curr_page_space_ptr); 
-        *curr_page_space_ptr = length - diff;
-
-        cmd.data_size = diff;
-        qspi_send_cmd(&cmd, data, false, errc);
-
-        cmd.data_size = length - diff;
-        cmd.address += diff; 
-        data += diff; 
-        qspi_send_cmd(&cmd, data, false, errc);
-    } 
-    else {
-        *curr_page_space_ptr += length;
-        qspi_send_cmd(&cmd, data, false, errc);
-    }
-
-    *data_addr_ptr += length;
+    if (errc) *errc = TI_ERRC_NONE;
+    if (length == 0) return;
+    log_start();
+
+    if (length > LOG_BUFFER_SIZE || data == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Record longer than the log buffer");
+        return;
+    }
+    if (log_end + length > EXTERN_FLASH_SIZE) {
+        TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Data log full");
+        return;
+    }
+    if (log_end + length - *data_addr_ptr > LOG_BUFFER_SIZE) {
+        // Room only comes from starting a page program
+        enum ti_errc_t err;
+        log_service(&err);
+        if (err != TI_ERRC_NONE) {
+            if (errc) *errc = err;
+            return;
+        }
+        if (log_end + length - *data_addr_ptr > LOG_BUFFER_SIZE) {
+            TI_SET_ERRC(errc, TI_ERRC_BUSY, "Log buffer full while flash busy");
+            return;
+        }
+    }
+
+    const uint32_t offset = log_end % LOG_BUFFER_SIZE;
+    const uint32_t first = (LOG_BUFFER_SIZE - offset < length) ? LOG_BUFFER_SIZE - offset : length;
+    memcpy(&log_buffer[offset], data, first);
+    memcpy(log_buffer, data + first, length - first);
+    log_end += length;
+
+    log_service(errc);
+}
+
+void log_service(enum ti_errc_t* errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+    log_start();
+
+    if (flash_check_busy(&err)) {
+        if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Failed to read flash status");
+        return;
+    }
+    log_step(false, &err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Failed to start log flash operation");
+}
+
+void log_sync(enum ti_errc_t* errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+    log_start();
+
+    // Every step programs the front page or erases the sector it needs, so this ends
+    while (*data_addr_ptr < log_end) {
+        flash_wait_idle(&err);
+        if (err != TI_ERRC_NONE) {
+            TI_SET_ERRC(errc, err, "Flash stayed busy");
+            return;
+        }
+        log_step(true, &err);
+        if (err != TI_ERRC_NONE) {
+            TI_SET_ERRC(errc, err, "Failed to start log flash operation");
+            return;
+        }
+    }
+
+    flash_wait_idle(&err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Flash stayed busy");
+}
+
+const uint8_t* extern_flash_map(enum ti_errc_t* errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+
+    // Pages still in RAM would be missing from the mapping, and nothing may be programming
+    log_sync(&err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to sync data log");
+        return NULL;
+    }
+
+    const uint8_t* flash = qspi_enter_memory_mapped(qspi_quad_enabled() ? QSPI_READ_QUAD_IO : QSPI_READ_SINGLE, &err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to map flash");
+        return NULL;
+    }
+    return flash;
+}
+
+void extern_flash_unmap(enum ti_errc_t* errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+    qspi_exit_memory_mapped(&err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Failed to unmap flash");
+}
+
+// True if the page at @p page reads erased. Word loads, as the mapping is word aligned.
+static bool page_erased(const uint8_t* page) {
+    const uint32_t* words = (const uint32_t*)page;
+    for (uint32_t i = 0; i < EXTERN_FLASH_PAGE_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != 0xFFFFFFFFU) return false;
+    }
+    return true;
+}
+
+bool extern_flash_recover(enum ti_errc_t* errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (*state_addr_ptr <= DATA_POOL_BASE_ADDR &&
+        *data_addr_ptr >= DATA_POOL_BASE_ADDR && *data_addr_ptr <= EXTERN_FLASH_SIZE) {
+        return false;
+    }
+
+    // An erase from before the reset may still be running, which the mapping would read through
+    enum ti_errc_t err;
+    qspi_poll_status_blk(FLASH_ERASE_TIMEOUT_US, &err);
+    const uint8_t* flash = NULL;
+    if (err == TI_ERRC_NONE) {
+        flash = qspi_enter_memory_mapped(qspi_quad_enabled() ? QSPI_READ_QUAD_IO : QSPI_READ_SINGLE, &err);
+    }
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to map flash for recovery");
+        return false;
+    }
+
+    uint32_t state_end = STATE_POOL_BASE_ADDR;
+    while (state_end < DATA_POOL_BASE_ADDR && flash[state_end] != 0xFF) state_end++;
+
+    // Sectors are erased ahead of the log, so the page after its last one reads erased
+    uint32_t data_end = DATA_POOL_BASE_ADDR;
+    while (data_end < EXTERN_FLASH_SIZE && !page_erased(&flash[data_end])) data_end += EXTERN_FLASH_PAGE_SIZE;
+    while (data_end > DATA_POOL_BASE_ADDR && flash[data_end - 1] == 0xFF) data_end--;
+
+    qspi_exit_memory_mapped(&err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to unmap flash after recovery");
+        return false;
+    }
+
+    *state_addr_ptr = state_end;
+    *data_addr_ptr = data_end;
+    log_started = false;
+    return true;
 }
@@ -4,12 +4,19 @@
 
 #pragma once
 
+#define EXTERN_FLASH_SIZE        0x00800000 // S25FL064L, 64 Mbit
+#define EXTERN_FLASH_PAGE_SIZE   256        // Largest unit of one page program
+#define EXTERN_FLASH_SECTOR_SIZE 4096       // Smallest unit of one erase
+
+// Pages of data log held in RAM while the flash is busy. They have to cover a sector erase
+// (~50ms typical), so 8 pages keep up with ~40 KB/s of records. A record can be at most this long.
+#define EXTERN_FLASH_LOG_PAGES 8
+
 #define STATE_POOL_BASE_ADDR 0x00000000
 extern volatile uint32_t* const state_addr_ptr; // Address of current state
 
-#define DATA_POOL_BASE_ADDR 0x00000200
-extern volatile uint32_t* const data_addr_ptr; // Address of current data log
-extern volatile uint32_t* const curr_page_space_ptr; // Remaining space in current page
+#define DATA_POOL_BASE_ADDR 0x00001000 // First sector after the state pool, so log erases never reach it
+extern volatile uint32_t* const data_addr_ptr; // End of the data log that has been programmed
 
 enum states_t {
     ARMED_STATE = 0x01,
@@ -23,10 +30,63 @@ enum states_t {
 
 void init_extern_flash();
 
+/**
+ * @brief Records a state transition. Flushes the data log first (see log_sync), so everything
+ * logged before the transition is in flash once this returns; blocks for up to a sector erase.
+ */
 void log_state(enum states_t state, enum ti_errc_t* errc);
 
 enum states_t get_prev_state(enum ti_errc_t* errc);
 
 bool check_saved_state();
 
+/**
+ * @brief Appends a record to the data log. Records are combined in RAM and go out a whole page
+ * at a time once the flash is free; the sector after the one being written is erased ahead of
+ * time between pages. Never waits for the flash.
+ *
+ * @param errc TI_ERRC_BUSY if the RAM pages are full while the flash is still busy (the record
+ * is dropped, try again after log_service), TI_ERRC_OVERFLOW once the flash is full,
+ * TI_ERRC_INVALID_ARG for a record longer than EXTERN_FLASH_LOG_PAGES pages.
+ */
 void log_data(uint8_t* data, uint16_t length, enum ti_errc_t* errc);
+
+/**
+ * @brief Starts the next page program or erase the data log is waiting on, if the flash is
+ * free. Call it periodically so complete pages don't wait for the next log_data. Never blocks.
+ */
+void log_service(enum ti_errc_t* errc);
+
+/**
+ * @brief Programs everything logged so far, including a partly filled page, and waits for the
+ * flash to finish. The rest of a partly programmed page is filled by later records.
+ *
+ * @param errc TI_ERRC_TIMEOUT if the flash stays busy past its worst case.
+ */
+void log_sync(enum ti_errc_t* errc);
+
+/**
+ * @brief Puts the whole flash in the memory map so it can be read with plain loads, for log
+ * scanning and ground download. Syncs the data log first, so everything logged so far is there.
+ * Until extern_flash_unmap the log can't reach flash: log_data buffers what fits and then
+ * returns TI_ERRC_BUSY, and log_state fails.
+ *
+ * @return Flash address 0 as a pointer (EXTERN_FLASH_SIZE bytes), NULL on error.
+ */
+const uint8_t* extern_flash_map(enum ti_errc_t* errc);
+
+/**
+ * @brief Takes the flash back out of the memory map. Pointers from extern_flash_map go stale.
+ */
+void extern_flash_unmap(enum ti_errc_t* errc);
+
+/**
+ * @brief Checks the state and data log pointers kept in backup SRAM and, if they can't be right
+ * (the backup domain lost power), rebuilds them by scanning the flash through the memory map.
+ * The state pool is programmed a byte at a time from erased, so it ends at its first 0xFF; the
+ * data log ends after its last programmed byte before the first erased page. A record's trailing
+ * 0xFF bytes look erased and are cut off.
+ *
+ * @return True if the pointers were rebuilt.
+ */
+bool extern_flash_recover(enum ti_errc_t* errc);
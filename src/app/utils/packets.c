@@ -1,4 +1,5 @@
 #include "app/utils/packets.h"
+#include "internal/deadline.h"
 
 static bool has_valid_magic_header(const uint8_t *buffer, size_t buffer_len) {
     if (!buffer || buffer_len < 8U) {
@@ -242,6 +243,81 @@ void build_comm_packet(uint16_t ping_id,
     *packet_len = idx;
 }
 
+void append_comm_heap_stats(const alloc_stats_t *stats,
+                            enum heap_region_t region,
+                            uint8_t *buffer,
+                            size_t buffer_len,
+                            size_t *packet_len,
+                            enum ti_errc_t *errc) {
+    size_t packed_len = 0;
+
+    if (errc) *errc = TI_ERRC_NONE;
+    if (!stats || !buffer || !packet_len || *packet_len < 20U
+        || buffer_len <= *packet_len || buffer[19] == 0xFFU) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid comm heap stats args");
+        return;
+    }
+
+    size_t idx = *packet_len;
+    buffer[idx++] = (uint8_t)(COMM_MESSAGE_HEAP_STATS + (uint8_t)region);
+    alloc_pack_stats(stats, region, &buffer[idx], buffer_len - idx, &packed_len, errc);
+    if (errc && *errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, *errc, "Failed to pack heap stats");
+        return;
+    }
+
+    buffer[19]++;
+    *packet_len = idx + packed_len;
+}
+
+static size_t put_u32(uint8_t *buffer, size_t idx, uint32_t value) {
+    buffer[idx++] = (uint8_t)(value >> 24);
+    buffer[idx++] = (uint8_t)(value >> 16);
+    buffer[idx++] = (uint8_t)(value >> 8);
+    buffer[idx++] = (uint8_t)value;
+    return idx;
+}
+
+static size_t put_u16_sat(uint8_t *buffer, size_t idx, uint32_t value) {
+    if (value > 0xFFFFU) value = 0xFFFFU;
+    buffer[idx++] = (uint8_t)(value >> 8);
+    buffer[idx++] = (uint8_t)value;
+    return idx;
+}
+
+void build_spi_stats_packet(const spi_dev_stats_t *stats,
+                            uint8_t device_count,
+                            uint32_t processor_time_ms,
+                            uint8_t *buffer,
+                            size_t buffer_len,
+                            enum ti_errc_t *errc) {
+    size_t idx = 9;
+
+    if (errc) *errc = TI_ERRC_NONE;
+    if (!stats || !buffer || buffer_len < PACKET_SPI_STATS_SIZE) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid SPI stats packet args");
+        return;
+    }
+
+    uint64_t busy_us = stats->busy_cycles / DEADLINE_TICKS_PER_US;
+    if (busy_us > 0xFFFFFFFFULL) busy_us = 0xFFFFFFFFULL;
+
+    write_magic_header(buffer);
+    buffer[8] = PACKET_SPI_STATS_TYPE;
+    buffer[idx++] = device_count;
+    buffer[idx++] = stats->inst;
+    buffer[idx++] = stats->ss_pin;
+    idx = put_u32(buffer, idx, processor_time_ms);
+    idx = put_u32(buffer, idx, stats->transactions);
+    idx = put_u16_sat(buffer, idx, stats->errors);
+    idx = put_u32(buffer, idx, stats->bytes);
+    idx = put_u32(buffer, idx, (uint32_t)busy_us);
+    idx = put_u32(buffer, idx, stats->max_cycles / DEADLINE_TICKS_PER_US);
+    for (uint32_t i = 0; i < SPI_STATS_HIST_BINS; i++) {
+        idx = put_u16_sat(buffer, idx, stats->hist[i]);
+    }
+}
+
 void send_packet_radio_flash(radio_t *radio,
                              const uint8_t *packet,
                              size_t packet_len,
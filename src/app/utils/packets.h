@@ -11,6 +11,8 @@
 #include "devices/magnetometer.h"
 #include "devices/radio.h"
 #include "devices/temperature.h"
+#include "internal/alloc.h"
+#include "peripheral/spi.h"
 #include "peripheral/errc.h"
 
 #define PACKET_MAGIC_HEADER 5350924267264234322ULL
@@ -19,6 +21,7 @@
 #define PACKET_ADC_TYPE 0x03U
 #define PACKET_STATE_TYPE 0x04U
 #define PACKET_COMM_TYPE 0x05U
+#define PACKET_SPI_STATS_TYPE 0x06U
 
 #define PACKET_GNSS_SIZE 31U
 #define PACKET_SENSOR_SIZE 61U
@@ -26,6 +29,11 @@
 #define PACKET_STATE_MAX_SIZE 64U
 #define PACKET_COMM_MAX_SIZE 64U
 #define PACKET_RX_MAX_SIZE 64U
+#define PACKET_SPI_STATS_SIZE 62U
+
+// Heap stats messages are tagged COMM_MESSAGE_HEAP_STATS + heap region id.
+#define COMM_MESSAGE_HEAP_STATS 0x10U
+#define COMM_MESSAGE_HEAP_STATS_MAX_SIZE (1U + ALLOC_PACKED_STATS_MAX_SIZE)
 
 typedef struct {
     bool packet_present;
@@ -80,6 +88,20 @@ void build_comm_packet(uint16_t ping_id,
                        size_t *packet_len,
                        enum ti_errc_t *errc);
 
+void append_comm_heap_stats(const alloc_stats_t *stats,
+                            enum heap_region_t region,
+                            uint8_t *buffer,
+                            size_t buffer_len,
+                            size_t *packet_len,
+                            enum ti_errc_t *errc);
+
+void build_spi_stats_packet(const spi_dev_stats_t *stats,
+                            uint8_t device_count,
+                            uint32_t processor_time_ms,
+                            uint8_t *buffer,
+                            size_t buffer_len,
+                            enum ti_errc_t *errc);
+
 void send_packet_radio_flash(radio_t *radio,
                              const uint8_t *packet,
                              size_t packet_len,
@@ -19,11 +19,72 @@
  * @brief Utility functions to send packets
  */
 #include "app/utils/state_comm.h"
+#include "app/utils/pinout.h"
+#include "peripheral/gpio.h"
 
 state_comm_shared_t state_comm_shared = {
     .last_command_status = COMMAND_STATUS_NULL
 };
 
+void attach_heap_stats(size_t *comm_packet_len, enum ti_errc_t *errc) {
+    alloc_stats_t stats;
+
+    if (errc) *errc = TI_ERRC_NONE;
+    if ((state_comm_shared.ping_id % HEAP_STATS_PING_PERIOD) != 0U) {
+        return;
+    }
+
+    alloc_get_stats(&stats);
+    append_comm_heap_stats(&stats,
+                           (enum heap_region_t)((state_comm_shared.ping_id / HEAP_STATS_PING_PERIOD) % HEAP_REGION_COUNT),
+                           state_comm_shared.comm_packet,
+                           sizeof(state_comm_shared.comm_packet),
+                           comm_packet_len,
+                           errc);
+    if (errc && *errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, *errc, "Failed to attach heap stats");
+    }
+}
+
+bool build_next_spi_stats_packet(enum ti_errc_t *errc) {
+    static spi_dev_stats_t stats[SPI_STATS_MAX_DEVICES];
+
+    if (errc) *errc = TI_ERRC_NONE;
+    const uint8_t count = spi_get_stats(stats, SPI_STATS_MAX_DEVICES);
+    if (count == 0U) {
+        return false;
+    }
+
+    const uint8_t device = (uint8_t)(state_comm_shared.spi_stats_device % count);
+    state_comm_shared.spi_stats_device = (uint8_t)(device + 1U);
+    build_spi_stats_packet(&stats[device],
+                           count,
+                           state_comm_shared.processor_time_ms,
+                           state_comm_shared.spi_stats_packet,
+                           sizeof(state_comm_shared.spi_stats_packet),
+                           errc);
+    if (errc && *errc != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, *errc, "Failed to build SPI stats packet");
+        return false;
+    }
+    return true;
+}
+
+void rs485_pins_init(void) {
+    static bool configured = false;
+
+    // RS485_DE is PA4, which carries USART2_CK rather than USART2_DE, so the USART's hardware
+    // driver enable (uart_rs485_config_t) cannot reach it on this board and DE stays a GPIO.
+    if (configured) {
+        return;
+    }
+    tal_set_mode((int)RS485_DE, 1);
+    tal_set_mode((int)RS485_RE, 1);
+    tal_set_pin((int)RS485_DE, 1);
+    tal_set_pin((int)RS485_RE, 0);
+    configured = true;
+}
+
 bool decode_set_mode_command(const comm_packet_t *packet,
                              uint8_t *requested_mode,
                              uint16_t *last_command_id,
@@ -35,6 +35,10 @@
 #define COMMAND_STATUS_INVALID_STATE 0x08U
 #define COMMAND_STATUS_NULL 0xFFU
 
+// Heap stats ride along on every HEAP_STATS_PING_PERIOD-th comm packet (once a second at 100 ms),
+// one heap region per report in turn.
+#define HEAP_STATS_PING_PERIOD 10U
+
 typedef struct {
     uint8_t gnss_packet[PACKET_GNSS_SIZE];
     uint8_t sensor_packet[PACKET_SENSOR_SIZE];
@@ -42,16 +46,28 @@ typedef struct {
     uint8_t state_packet[PACKET_STATE_MAX_SIZE];
     uint8_t comm_packet[PACKET_COMM_MAX_SIZE];
     uint8_t rx_packet[PACKET_RX_MAX_SIZE];
+    uint8_t spi_stats_packet[PACKET_SPI_STATS_SIZE];
     comm_packet_t uplink_comm;
 
     uint16_t ping_id;
     uint16_t last_command_id;
     uint8_t last_command_status;
     uint32_t processor_time_ms;
+    uint8_t spi_stats_device; // next entry of spi_get_stats to report
 } state_comm_shared_t;
 
 extern state_comm_shared_t state_comm_shared;
 
+void attach_heap_stats(size_t *comm_packet_len, enum ti_errc_t *errc);
+
+// Builds the SPI stats packet of the next chip select in turn into spi_stats_packet. False if no
+// SPI transfers have been recorded yet, leaving nothing to send.
+bool build_next_spi_stats_packet(enum ti_errc_t *errc);
+
+// Puts the RS485 transceiver in its operating state: driver and receiver both enabled. Only the
+// first call touches the pins, which hold their level across state changes.
+void rs485_pins_init(void);
+
 bool decode_set_mode_command(const comm_packet_t *packet,
                              uint8_t *requested_mode,
                              uint16_t *last_command_id,
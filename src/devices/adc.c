@@ -24,6 +24,7 @@
 #include "peripheral/spi.h"
 #include "peripheral/systick.h"
 #include "internal/mmio.h"
+#include "internal/deadline.h"
 #include "peripheral/errc.h"
 
 #define RESET 0x06
@@ -43,6 +44,14 @@
 #define WRITE_BIT 0x40
 #define MAX_RREG_SIZE 6
 
+// Waits in microseconds: settling after RESET, the ready flag after START, and data ready before a read
+#define RESET_DELAY_US 5000U
+#define READY_TIMEOUT_US 100000U
+#define DRDY_TIMEOUT_US 10000U
+
+// ADS124S08 bus settings: SCLK up to 10 MHz, data clocked out on the rising edge (CPHA = 1)
+static const spi_profile_t adc_spi_profile = { .max_clock_hz = 10000000, .mode = MODE_1, .word_bits = 8 };
+
 static struct adc_spi_dev dev;
 
 static int spi_rreg(uint8_t reg_addr, uint8_t data_size, enum ti_errc_t* errc) {
@@ -128,6 +137,11 @@ void adc_init(struct adc_spi_dev *device, enum ti_errc_t* errc) {
     *errc = TI_ERRC_NONE;
     dev  = *device;
 
+    spi_set_profile(dev.inst, dev.ss_pin, &adc_spi_profile, errc);
+    if (*errc != TI_ERRC_NONE) {
+        return;
+    }
+
     // Reset ADC
     uint8_t err = spi_single_command(RESET, 1, errc);
     if (err == -1 || *errc != TI_ERRC_NONE) {
@@ -135,27 +149,22 @@ void adc_init(struct adc_spi_dev *device, enum ti_errc_t* errc) {
     }
 
     // Delay recommended by datasheet after RESET
-    //systick_delay(5); // TODO: Why is this getting stuck?
-    for (int i = 0; i < 100000; i++) {
-        asm("NOP");
-    }
+    deadline_wait(deadline_in_us(RESET_DELAY_US));
 
      spi_single_command(START, 1, errc);
 
     // Wait until ADC is ready for communication
     bool is_ready = false;
-    int timeout = 100000; 
+    const deadline_t deadline = deadline_in_us(READY_TIMEOUT_US);
     while (!is_ready) {
         uint8_t status_reg = spi_rreg(STATUS_REG, 1, errc);
         
         if ((status_reg & RDY_FLAG) == 0 && *errc == TI_ERRC_NONE) {
             is_ready = true;
-        } else if (timeout == 0) {
+        } else if (deadline_expired(deadline)) {
             *errc = TI_ERRC_TIMEOUT;
             return; 
         }
-
-        timeout--;
     }
 
     // Enable internal reference 
@@ -187,9 +196,17 @@ int adc_read_voltage(const struct adc_channel* channel, enum ti_errc_t* errc) {
     }
 
     // Wait for device ready flag
-    int timeout = 100;
-    while ((spi_rreg(STATUS_REG, 1, errc) & RDY_FLAG) != 0 && timeout > 0) {
-        timeout--;
+    bool is_ready = false;
+    const deadline_t deadline = deadline_in_us(DRDY_TIMEOUT_US);
+    while (!is_ready) {
+        uint8_t status_reg = spi_rreg(STATUS_REG, 1, errc);
+
+        if ((status_reg & RDY_FLAG) == 0 && *errc == TI_ERRC_NONE) {
+            is_ready = true;
+        } else if (deadline_expired(deadline)) {
+            *errc = TI_ERRC_TIMEOUT;
+            return -1;
+        }
     }
 
     // Request data
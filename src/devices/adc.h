@@ -113,6 +113,7 @@ struct adc_channel {
 
 /**
  * @brief Initializes the ADC hardware. Exits the function early if an error occurs.
+ *        Gives the chip select its SPI profile (mode 1, 10 MHz) first.
  * 
  * @param dev SPI specifications
  * @param errc TI_ERRC_NONE if no errors occur, otherwise an error code
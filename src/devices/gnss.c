@@ -9,6 +9,7 @@
 
 #include "devices/gnss.h"
 #include "peripheral/errc.h"
+#include "internal/deadline.h"
 #include <stddef.h>
 
 /* UBX Protocol Synchronization and Class IDs */
@@ -28,13 +29,12 @@
 #define UBX_ACK_NAK   0x00
 #define UBX_ACK_ACK   0x01
 
+/* Longest wait for an ACK/NAK or a polled message, in microseconds */
+#define UBX_RESPONSE_TIMEOUT_US 250000U
+
+/* u-blox M8 SPI: mode 0, at most 5.5 MHz */
+static const spi_profile_t gnss_spi_profile = { .max_clock_hz = 5500000, .mode = MODE_0, .word_bits = 8 };
 
-/* 
- * Assuming standard SPI transmit/receive function signatures from peripheral/spi.h.
- * Adjust these externs if your spi.h uses slightly different naming conventions. 
- */
-extern void spi_tx(uint8_t spi_inst, uint8_t ss_pin, const uint8_t *tx_data, uint32_t len, enum ti_errc_t *errc);
-extern void spi_rx(uint8_t spi_inst, uint8_t ss_pin, uint8_t *rx_data, uint32_t len, enum ti_errc_t *errc);
 
 /**************************************************************************************************
  * @section UBX Payload Structures
@@ -162,14 +162,13 @@ static void ubx_send_msg(gnss_t *dev, uint8_t class_id, uint8_t msg_id, const vo
     uint8_t checksum[2] = {ck_a, ck_b};
     if (errc) *errc = TI_ERRC_NONE;
 
-    spi_tx(dev->spi_config.spi_inst, dev->spi_config.ss_pin, header, 6, errc);
-    if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; }
-    if (len > 0) {
-        spi_tx(dev->spi_config.spi_inst, dev->spi_config.ss_pin, (const uint8_t*)payload, len, errc);
-        if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; }
-    }
-    
-    spi_tx(dev->spi_config.spi_inst, dev->spi_config.ss_pin, checksum, 2, errc);
+    // Header, payload and checksum go out as one frame under a single chip select
+    const spi_iov_t frame[3] = {
+        { .tx = header, .len = sizeof(header) },
+        { .tx = payload, .len = len },
+        { .tx = checksum, .len = sizeof(checksum) },
+    };
+    spi_transfer_iov(dev->spi_config.spi_inst, dev->spi_config.ss_pin, frame, 3, 0xFF, errc);
 }
 
 /**
@@ -183,10 +182,10 @@ static void ubx_configure(gnss_t *dev, uint8_t class_id, uint8_t msg_id, const v
     uint8_t rx;
     uint8_t state = 0;
     uint8_t ack_id = 0;
-    uint32_t attempts = 15000; // Safeguard against infinite loops
-    
-    while (attempts--) {
-        spi_rx(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &rx, 1, errc);
+    const deadline_t deadline = deadline_in_us(UBX_RESPONSE_TIMEOUT_US);
+
+    while (!deadline_expired(deadline)) {
+        spi_read(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &rx, 1, 0xFF, errc);
         if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; }
         if (rx == 0xFF) continue; // Idle byte from u-blox M8 
         
@@ -232,6 +231,9 @@ void gnss_init(gnss_t *dev, enum ti_errc_t *errc) {
         TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "dev pointer is NULL"); return;
     }
 
+    spi_set_profile(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &gnss_spi_profile, errc);
+    if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; }
+
     /* 1. Configure Navigation/Measurement Rate (UBX-CFG-RATE) */
     ubx_cfg_rate_t rate_cfg = {0};
     rate_cfg.measRate = dev->config.meas_rate_ms;
@@ -324,10 +326,10 @@ void gnss_get_pvt(gnss_t *dev, gnss_pvt_t *pvt, enum ti_errc_t *errc) {
     ubx_nav_pvt_t pvt_raw;
     uint8_t *pvt_ptr = (uint8_t *)&pvt_raw;
     
-    uint32_t attempts = 15000;
-    
-    while (attempts--) {
-        spi_rx(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &rx, 1, errc);
+    const deadline_t deadline = deadline_in_us(UBX_RESPONSE_TIMEOUT_US);
+
+    while (!deadline_expired(deadline)) {
+        spi_read(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &rx, 1, 0xFF, errc);
         if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; }
         
         if (state == 0 && rx == 0xFF) continue; 
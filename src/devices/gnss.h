@@ -137,6 +137,7 @@ typedef struct {
  *
  * Applies the constellations, nav rate, dynamic model, and power mode defined 
  * in dev->config. Blocks until initialization sequence is acknowledged by the module.
+ * The chip select gets its SPI profile (mode 0, 5.5 MHz at most) before anything is sent.
  *
  * @param dev  Pointer to the gnss_t device structure.
  * @param errc Pointer to error status output.
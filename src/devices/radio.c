@@ -20,6 +20,7 @@
  */
 
 #include "radio.h"
+#include "internal/deadline.h"
 #include "peripheral/errc.h"
 #include "peripheral/spi.h"
 #include "peripheral/gpio.h"
@@ -29,14 +30,17 @@
  * @section Macros
  **************************************************************************************************/
 
-/** @brief Default timeout iteration count for CTS polling. */
-#define RADIO_DEFAULT_CTS_TIMEOUT  1000000U
+/** @brief Longest CTS wait after a command, in microseconds. POWER_UP is the slowest at ~15 ms. */
+#define RADIO_CTS_TIMEOUT_US       100000U
 
-/** @brief Default timeout iteration count for SPI transfers. */
-#define RADIO_DEFAULT_SPI_TIMEOUT  1000000U
+/** @brief How long SDN is held asserted, in microseconds. The Si4468 needs more than 10 us. */
+#define RADIO_SDN_ASSERT_US        20U
 
-/** @brief Blocking delay loop count after reset assertion/de-assertion. */
-#define RADIO_DEFAULT_RESET_DELAY  100000U
+/** @brief Wait after SDN is released before the first command, in microseconds (boot is ~6 ms). */
+#define RADIO_BOOT_US              6000U
+
+/** @brief Si4468 bus settings: mode 0, SCLK up to 10 MHz. */
+static const spi_profile_t radio_spi_profile = { .max_clock_hz = 10000000, .mode = MODE_0, .word_bits = 8 };
 
 /** @brief Maximum packet payload size in bytes. */
 #define RADIO_MAX_PACKET_SIZE      64U
@@ -88,10 +92,6 @@
 static const uint8_t radio_power_up_cmd[] = { 0x02, 0x01, 0x00, 0x01, 0xC9, 0xC3, 0x80 };
 static const size_t  radio_power_up_len = sizeof(radio_power_up_cmd);
 
-/** @brief Firmware patch data (populate from WDS export if needed). */
-static const uint8_t radio_patch_data[] = { /* Add your patch array here */ };
-static const size_t  radio_patch_len = 0;
-
 /** @brief GPIO pin configuration command (WDS-generated). */
 static const uint8_t radio_gpio_cfg_cmd[] = { 0x13, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 static const size_t  radio_gpio_cfg_len = sizeof(radio_gpio_cfg_cmd);
@@ -134,10 +134,10 @@ static void radio_wait_cts(radio_t *dev, enum ti_errc_t *errc) {
     // you MUST wait for CTS (Clear-To-Send) before sending another.
     // We poll by sending READ_CMD_BUFF (0x44) and checking if byte[1] == 0xFF.
     //
-    // Why 1,000,000 iterations? This is a worst-case spin-wait. At ~168MHz (STM32H7),
-    // each iteration is a few SPI transactions (~microseconds), so this is roughly
-    // a multi-second timeout. If we hit it, the radio is dead or unpowered.
-    for (uint32_t i = 0; i < RADIO_DEFAULT_CTS_TIMEOUT; i++) { // 1,000,000
+    // Each poll is one short SPI transaction, so the deadline is overrun by at most one of them.
+    // If we hit it, the radio is dead or unpowered.
+    const deadline_t deadline = deadline_in_us(RADIO_CTS_TIMEOUT_US);
+    for (;;) {
         uint8_t tx[2] = { SI446X_CMD_READ_CMD_BUFF, 0x00 };
         uint8_t rx[2] = { 0x00, 0x00 };
         // Send the CTS check over SPI
@@ -148,6 +148,9 @@ static void radio_wait_cts(radio_t *dev, enum ti_errc_t *errc) {
         if (rx[1] == SI446X_CTS_READY_VALUE) {
             return;
         }
+        if (deadline_expired(deadline)) {
+            break;
+        }
     }
     // If we get here, the radio never became ready — likely a hardware fault
     TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "Si446x CTS timeout"); //
@@ -163,17 +166,12 @@ static void radio_wait_cts(radio_t *dev, enum ti_errc_t *errc) {
  */
 static void radio_send_cmd(radio_t *dev, const uint8_t *cmd, size_t len, enum ti_errc_t *errc) {
     if (errc) *errc = TI_ERRC_NONE;
-    if (!dev || !cmd || len == 0) { TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Params invalid"); return; } //
-    // Copy the command into a fixed-size buffer (max 16 bytes for Si446x commands).
-    // We can't send the caller's buffer directly because spi_transfer_sync
-    // needs matching tx/rx buffers of the same size.
-    uint8_t tx[SI446X_CMD_BUFFER_SIZE] = {0};
-    uint8_t rx[SI446X_CMD_BUFFER_SIZE] = {0};
-    memcpy(tx, cmd, len);
+    // Si446x commands are at most 16 bytes; anything longer would overrun its command buffer.
+    if (!dev || !cmd || len == 0 || len > SI446X_CMD_BUFFER_SIZE) { TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Params invalid"); return; } //
     
     // Send the command bytes over SPI. The Si446x clocks in command bytes
     // on the MOSI line. We don't care about the MISO response here.
-    spi_transfer_sync(dev->spi_config.spi_inst, dev->spi_config.ss_pin, tx, rx, len, errc); //
+    spi_write(dev->spi_config.spi_inst, dev->spi_config.ss_pin, cmd, (uint16_t)len, errc); //
     if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; } //
     // After every command, we MUST wait for CTS before doing anything else.
     // The Si446x will ignore/corrupt further SPI traffic until it's ready.
@@ -237,6 +235,9 @@ void radio_init(radio_t *dev, const radio_spi_dev *spi_config, const radio_confi
     // PLL lock failures. The workaround is safe to apply unconditionally.
     dev->apply_errata_12 = true;
 
+    spi_set_profile(dev->spi_config.spi_inst, dev->spi_config.ss_pin, &radio_spi_profile, errc);
+    if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; } //
+
     // Configure reset pin as GPIO output (drives the Si4468 SDN/shutdown pin)
     if (dev->config.reset_pin) {
         tal_enable_clock(dev->config.reset_pin);  // Enable GPIO port clock
@@ -292,12 +293,11 @@ void radio_reset(radio_t *dev, enum ti_errc_t *errc) {
         
         // Assert reset — the Si4468 enters full shutdown, all state is lost
         tal_set_pin(dev->config.reset_pin, active);
-        // Blocking delay (~few ms at 168MHz) — Si4468 datasheet requires >10μs SDN assertion
-        for(volatile int i=0; i<10000; i++);
+        deadline_wait(deadline_in_us(RADIO_SDN_ASSERT_US));
         // De-assert reset — the Si4468 begins its internal boot sequence (~6ms)
         tal_set_pin(dev->config.reset_pin, inactive);
         // Wait for boot to complete before sending any SPI commands
-        for(volatile int i=0; i<10000; i++);
+        deadline_wait(deadline_in_us(RADIO_BOOT_US));
     }
 }
 
@@ -405,12 +405,13 @@ static void radio_change_state(radio_t *dev, uint8_t next_state, enum ti_errc_t
 static void radio_write_tx_fifo(radio_t *dev, const uint8_t *data, size_t len, enum ti_errc_t *errc) {
     // Write payload into the Si446x's 64-byte TX FIFO.
     // SPI frame: [WRITE_TX_FIFO command byte (0x66)] [payload byte 0] [payload byte 1] ...
-    // Total transfer = len + 1 bytes (1 for the command, rest is data).
-    uint8_t tx[RADIO_MAX_PACKET_SIZE + 1];
-    uint8_t rx[RADIO_MAX_PACKET_SIZE + 1] = {0};
-    tx[0] = SI446X_CMD_WRITE_TX_FIFO; //
-    memcpy(&tx[1], data, len); //
-    spi_transfer_sync(dev->spi_config.spi_inst, dev->spi_config.ss_pin, tx, rx, len + 1, errc); //
+    // The command byte and the caller's payload go out back to back under one chip select.
+    const uint8_t cmd = SI446X_CMD_WRITE_TX_FIFO; //
+    const spi_iov_t frame[2] = {
+        { .tx = &cmd, .len = 1 },
+        { .tx = data, .len = (uint16_t)len },
+    };
+    spi_transfer_iov(dev->spi_config.spi_inst, dev->spi_config.ss_pin, frame, 2, 0x00, errc); //
 }
 
 /**
@@ -425,13 +426,14 @@ static void radio_read_rx_fifo(radio_t *dev, uint8_t *data, size_t len, enum ti_
     // Read received data from the Si446x's RX FIFO.
     // SPI frame: [READ_RX_FIFO command byte (0x77)] [dummy bytes...]
     // The Si446x clocks out the FIFO data on MISO while we send dummy bytes on MOSI.
-    // rx[0] = echo of our command (discard), rx[1..N] = actual payload data.
-    uint8_t tx[RADIO_MAX_PACKET_SIZE + 1] = { SI446X_CMD_READ_RX_FIFO };
-    uint8_t rx[RADIO_MAX_PACKET_SIZE + 1] = {0};
-    spi_transfer_sync(dev->spi_config.spi_inst, dev->spi_config.ss_pin, tx, rx, len + 1, errc); //
-    if (errc && *errc == TI_ERRC_NONE) {
-        memcpy(data, &rx[1], len);  // Skip byte 0 (command echo), copy payload
-    }
+    // The byte clocked in under the command is its echo and is dropped; the payload lands
+    // straight in the caller's buffer.
+    const uint8_t cmd = SI446X_CMD_READ_RX_FIFO;
+    const spi_iov_t frame[2] = {
+        { .tx = &cmd, .len = 1 },
+        { .rx = data, .len = (uint16_t)len },
+    };
+    spi_transfer_iov(dev->spi_config.spi_inst, dev->spi_config.ss_pin, frame, 2, 0x00, errc); //
 }
 
 /**
@@ -62,7 +62,8 @@ typedef struct {
  * @brief Initializes the Si4468 radio and applies power-up configuration.
  *
  * Configures SPI and GPIO pins, performs a hardware reset, sends the power-up
- * command sequence, and optionally applies the errata 12 workaround. 
+ * command sequence, and optionally applies the errata 12 workaround. The chip
+ * select gets its SPI profile (mode 0, 10 MHz) so the bus can be shared.
  *
  * @param dev        Pointer to the radio device handle.
  * @param spi_config Pointer to the SPI configuration (instance + SS pin).
@@ -19,181 +19,301 @@
  * @brief Internal memory allocator implementation.
  */
 #include "alloc.h"
+#if defined(__arm__)
+#include "mmio.h"
+#endif
 // #include "peripheral/gpio.h" // FOR TESTING < REMOVE
 
-void* HEAP_START = (void*)0x0;
+#if defined(__arm__)
+#define HEAP_LINKER_SYMBOLS_(name, start, end) extern uint8_t start[]; extern uint8_t end[];
+HEAP_REGIONS(HEAP_LINKER_SYMBOLS_)
+#define HEAP_LINKER_START_(name, start, end) start,
+#define HEAP_LINKER_END_(name, start, end) end,
+void* HEAP_REGION_STARTS[HEAP_REGION_COUNT] = { HEAP_REGIONS(HEAP_LINKER_START_) };
+void* HEAP_REGION_ENDS[HEAP_REGION_COUNT] = { HEAP_REGIONS(HEAP_LINKER_END_) };
+#else
+void* HEAP_REGION_STARTS[HEAP_REGION_COUNT];
+void* HEAP_REGION_ENDS[HEAP_REGION_COUNT];
+#endif
+
+/**
+ * Free lists are lock-free stacks so alloc/ti_free can be called from interrupt handlers and from
+ * both cores without masking interrupts. Every update is a single compare-and-swap on a 32-bit
+ * head, which GCC lowers to an LDREX/STREX retry loop on the Cortex-M7/M4. A head packs a link
+ * (block index within the pool + 1, 0 for empty) in the low half and a tag in the high half; the
+ * tag changes on every update so a stale compare-and-swap can't succeed (the ABA problem). Free
+ * blocks store the link of the next free block in their first word.
+ */
+#define LINK_MASK 0x0000FFFFU
+#define LINK_NONE 0U
+#define TAG_STEP  0x00010000U
 
 struct block_t{
-    struct block_t* next_block;
+    uint32_t next_link;
 };
 
+// Pool heads in the shared free lists, indexed by pool id across all regions.
+static uint32_t pool_heads[TOTAL_POOL_COUNT];
 
-static uint8_t is_free[IS_FREE_SIZE];
-static struct block_t* pool_heads[NUMBER_OF_POOLS];
-
+#if ALLOC_CORE_CACHE_SIZE > 0
+// Per-core block caches: small free lists only touched by their own core (and its interrupt
+// handlers), so the common alloc/free pair doesn't contend with the other core.
+static uint32_t core_cache_heads[ALLOC_CORE_COUNT][TOTAL_POOL_COUNT];
+static uint32_t core_cache_count[ALLOC_CORE_COUNT][TOTAL_POOL_COUNT];
+#endif
 
-/**
- * Internal function.  Builds the linked-list associated with each pool
- * @param curr initial head of the pool
- * @param pool_size size of blocks in this pool
- * @param pool_count number of blocks in this pool
- * @param i zero :)
- * @return
- */
-static struct block_t* build_pool(void* curr, uint32_t pool_size, uint32_t pool_count, uint32_t i) // NOLINT(misc-no-recursion)
-{
-    struct block_t* s = (struct block_t*)curr;
-
-    if(i >= pool_count - 1){
-        struct block_t n = {(void*)0}; // null terminator
-        *s = n;
-        return s;
-    }
+static uint8_t is_free[IS_FREE_SIZE];
 
-    struct block_t t = (struct block_t)
-    {
-        build_pool((uint8_t*)curr + pool_size, pool_size, pool_count, i + 1)
-    };
-    *s = t;
+// Address range [pool_base[i], pool_end[i]) of each pool. Filled in by init_heap so block
+// lookups take a few compares and one shift. NULL for the pools of a region that isn't set up.
+static uint8_t* pool_base[TOTAL_POOL_COUNT];
+static uint8_t* pool_end[TOTAL_POOL_COUNT];
 
-    return s;
-}
+// Instrumentation, see alloc_get_stats. Every update is a relaxed atomic so the counters stay
+// exact with both cores and interrupt handlers allocating.
+static alloc_pool_stats_t pool_stats[TOTAL_POOL_COUNT];
+static uint32_t invalid_requests;
 
 
 /**
  * Internal function.
  *
- * Gets the number of blocks before the given block (its index in is_free)
+ * Gets the id of the pool that a given block of memory is in.
+ * For example, if you passed in HEAP_START as block, this function would return
+ * 0; since the block at HEAP_START is always in the first pool
+ *
  */
-static void get_index(void* block, uint32_t* ret_index, enum ti_errc_t *errc){
+static void get_pool(void* block, uint32_t* res, enum ti_errc_t *errc){
     if (errc) *errc = TI_ERRC_NONE;
-    /**
-     * This function really annoyed me.  Basically we need the amount of total blocks before this pointer
-     * (which is its index ofc), but I can not think of a way to do this in constant time.  Maybe some sort
-     * of hash function would do.  For now I am writing this in linear time to just work for testing,
-     * and maybe sometime in the future we can optimize it (I can think of a way to get it to logorithmic time).
-     * Reguardless, I feel like it should be possible in constant time so if you're reading this and are
-     * bored then I would be forever grateful if you could make this fast.
-     */
-
-     // updated condition to >= because:
-     // HEAP_START + TOTAL_HEAP_SIZE will be 1 out of range, so if block equals that, that's 1 OOB
-    if((uint8_t*)block < (uint8_t*)HEAP_START || (uint8_t*)block >= ((uint8_t*)HEAP_START) + TOTAL_HEAP_SIZE){ // out of range //
-        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Block pointer is outside the heap address range"); return; //
-    }
+    *res = -1U;
 
+    // a region's start + its size will be 1 out of range, so if block equals that, that's 1 OOB
     uint8_t* blk = (uint8_t*) block;
-
-    uint32_t i = 0;
-    uint32_t pool_left = POOL_SIZES[i];
-
-    uint32_t index = -1;
-
-    while(blk >= (uint8_t*)HEAP_START){
-        if(pool_left <= 0){
-            pool_left = POOL_SIZES[++i];
+    for(uint32_t r = 0; r < HEAP_REGION_COUNT; r++){
+        uint32_t first = HEAP_REGION_FIRST_POOLS[r];
+        uint32_t last = first + HEAP_REGION_POOL_COUNTS[r] - 1;
+        if(pool_base[first] == (void*)0 || blk < pool_base[first] || blk >= pool_end[last]){
+            continue;
         }
 
-        blk -= POOL_BLOCK_SIZES[i];
-        pool_left -= 1;
-        index++;
+        // pools are laid out back to back, so the first pool whose end is past the block owns it
+        uint32_t i = first;
+        while(blk >= pool_end[i]){
+            i++;
+        }
+        *res = i;
+        return;
     }
 
-    *ret_index = index;
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Block pointer is outside the heap address range"); //
 }
 
 /**
- * Internal function
- *
- * Gets the index of the pool that a given block of memory is in.
- * For example, if you passed in HEAP_START as block, this function would return
- * 0; since the block at HEAP_START is always in the first pool
+ * Internal function.
  *
+ * Gets the number of blocks before the given block (its index in is_free)
  */
-static void get_pool(void* block, uint32_t* res, enum ti_errc_t *errc){
-    if (errc) *errc = TI_ERRC_NONE;
-    *res = -1U;
-    if((uint8_t*)block < (uint8_t*)HEAP_START || (uint8_t*)block > ((uint8_t*)HEAP_START) + TOTAL_HEAP_SIZE){ // out of range //
-        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "OOB pointer"); return; //
-    }
-
-    uint8_t* blk = (uint8_t*) block;
+static void get_index(void* block, uint32_t* ret_index, enum ti_errc_t *errc){
+    *ret_index = -1U;
+    uint32_t i;
+    get_pool(block, &i, errc); //
+    if (errc && *errc != TI_ERRC_NONE) return; //
+    if (i == -1U) return;
 
-    uint32_t i = 0;
-    uint32_t pool_left = POOL_SIZES[i];
+    uint32_t offset = (uint32_t)((uint8_t*)block - pool_base[i]);
+    *ret_index = POOL_FIRST_BLOCKS[i] + (offset >> POOL_BLOCK_SHIFTS[i]);
+}
 
-    while(blk >= (uint8_t*)HEAP_START){
-        if(pool_left <= 0){
-            pool_left = POOL_SIZES[++i];
+/**
+ * Internal function.
+ *
+ * Pops a block off a free list, or returns NULL if the list is empty.
+ */
+static struct block_t* list_pop(uint32_t* head, uint32_t pool){
+    uint32_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+    for(;;){
+        uint32_t link = old & LINK_MASK;
+        if(link == LINK_NONE){
+            return (void*)0;
+        }
+        struct block_t* blk = (struct block_t*)(pool_base[pool] + ((link - 1) << POOL_BLOCK_SHIFTS[pool]));
+        // may read a block another context just took; the tag check below then fails and we retry
+        uint32_t next = __atomic_load_n(&blk->next_link, __ATOMIC_RELAXED);
+        uint32_t new_head = ((old & ~LINK_MASK) + TAG_STEP) | next;
+        if(__atomic_compare_exchange_n(head, &old, new_head, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)){
+            return blk;
         }
-        blk -= POOL_BLOCK_SIZES[i];
-        pool_left -= 1;
     }
-
-    *res = i;
 }
 
+/**
+ * Internal function.
+ *
+ * Pushes a block onto a free list.
+ */
+static void list_push(uint32_t* head, uint32_t pool, struct block_t* blk){
+    uint32_t link = (uint32_t)(((uint8_t*)blk - pool_base[pool]) >> POOL_BLOCK_SHIFTS[pool]) + 1;
+    uint32_t old = __atomic_load_n(head, __ATOMIC_RELAXED);
+    uint32_t new_head;
+    do{
+        __atomic_store_n(&blk->next_link, old & LINK_MASK, __ATOMIC_RELAXED);
+        new_head = ((old & ~LINK_MASK) + TAG_STEP) | link;
+    }while(!__atomic_compare_exchange_n(head, &old, new_head, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
 
+/**
+ * Returns the index of the core making the call: 0 for the CM7, 1 for the CM4. Weak so host
+ * tests can substitute their own.
+ */
+__attribute__((weak)) uint32_t alloc_core_id(void){
+#if defined(__arm__)
+    return (READ_FIELD(SCB_CPUID, SCB_CPUID_PARTNO) == CORTEX_M4_PARTNO) ? 1U : 0U;
+#else
+    return 0U;
+#endif
+}
 
 /**
- * Usage: Check for success or failure when used to make sure it was
- * configured correctly
+ * Internal function.
  *
- * @return 1 for success, -1 for failure
+ * Makes a region writable before its free lists are built. Only backup RAM needs it: its clock is
+ * off and the backup domain is write protected out of reset.
  */
+static void enable_region(uint32_t region){
+#if defined(__arm__)
+    if(region == HEAP_REGION_BKUP_RAM){
+        SET_FIELD(RCC_AHB4ENR, RCC_AHB4ENR_BKPRAMEN);
+        SET_FIELD(PWR_CR1, PWR_CR1_DBP);
+    }
+#else
+    (void)region;
+#endif
+}
 
+/**
+ * Builds every pool's free list in a single pass over each region. The pool layout is fixed at
+ * compile time (see HEAP_REGIONS in alloc.h), so the only run time checks are that each region
+ * start is cache-line aligned, which alloc_dma relies on, and that the linker reserved enough room.
+ */
 void init_heap(enum ti_errc_t *errc) {
     if (errc) *errc = TI_ERRC_NONE;
-    uint32_t s = 0;
-    for(int i = 0; i < NUMBER_OF_POOLS; i++){
-        s += POOL_BLOCK_SIZES[i] * POOL_SIZES[i];
+    for(uint32_t r = 0; r < HEAP_REGION_COUNT; r++){
+        uint8_t* start = (uint8_t*)HEAP_REGION_STARTS[r];
+        uint8_t* end = (uint8_t*)HEAP_REGION_ENDS[r];
+        if (start != (void*)0 && ((uintptr_t)start & (CACHE_LINE_SIZE - 1)) != 0) {
+            TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Heap start must be cache-line aligned"); return; //
+        }
+        if (start != (void*)0 && end != (void*)0 && (uint32_t)(end - start) < HEAP_REGION_SIZES[r]) {
+            TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Heap region smaller than its pools"); return; //
+        }
     }
 
-    if (s != TOTAL_HEAP_SIZE) {
-        TI_SET_ERRC(errc, TI_ERRC_INTERNAL, "Heap configuration error"); return; //
-    }
+    for(int i = 0; i < TOTAL_POOL_COUNT; i++){
+        uint8_t* start = (uint8_t*)HEAP_REGION_STARTS[POOL_REGIONS[i]];
+        if(start == (void*)0){
+            pool_base[i] = (void*)0;
+            pool_end[i] = (void*)0;
+            pool_heads[i] = LINK_NONE;
+            continue;
+        }
+        if(i == (int)HEAP_REGION_FIRST_POOLS[POOL_REGIONS[i]]){
+            enable_region(POOL_REGIONS[i]);
+        }
 
-    void* start = HEAP_START;
-    for(int i = 0; i < NUMBER_OF_POOLS; i++){
-        // build linked list for each pool
-        pool_heads[i] = build_pool(
-            start,
-            POOL_BLOCK_SIZES[i],
-            POOL_SIZES[i],
-            0
-            );
-
-        start += POOL_BLOCK_SIZES[i] * POOL_SIZES[i]; // block size (bytes) * amount of blocks
+        uint8_t* base = start + POOL_OFFSETS[i];
+        pool_base[i] = base;
+        pool_end[i] = base + POOL_BLOCK_SIZES[i] * POOL_SIZES[i];
+
+        // link each block to the next one up, last block terminates the list
+        uint8_t* blk = base;
+        for(uint32_t j = 0; j + 1 < POOL_SIZES[i]; j++){
+            ((struct block_t*)blk)->next_link = j + 2;
+            blk += POOL_BLOCK_SIZES[i];
+        }
+        ((struct block_t*)blk)->next_link = LINK_NONE; // null terminator
+
+        pool_heads[i] = 1; // first block, tag 0
+#if ALLOC_CORE_CACHE_SIZE > 0
+        for(int c = 0; c < ALLOC_CORE_COUNT; c++){
+            core_cache_heads[c][i] = LINK_NONE;
+            core_cache_count[c][i] = 0;
+        }
+#endif
     }
 
     for(int i = 0; i < IS_FREE_SIZE; i++){
         is_free[i] = 255;
     }
 
+    for(int i = 0; i < TOTAL_POOL_COUNT; i++){
+        pool_stats[i] = (alloc_pool_stats_t){0};
+    }
+    invalid_requests = 0;
 }
 
 /**
- * @param size
- * @param errc Output error code.
- * @return Pointer to allocated block, or NULL on failure.
+ * Internal function.
+ *
+ * Counts a block leaving pool @p pool and raises the pool's peak if needed.
  */
-void* alloc(uint32_t size, enum ti_errc_t *errc) {
+static void note_alloc(uint32_t pool){
+    alloc_pool_stats_t* st = &pool_stats[pool];
+    __atomic_fetch_add(&st->allocs, 1U, __ATOMIC_RELAXED);
+    uint32_t in_use = __atomic_add_fetch(&st->in_use, 1U, __ATOMIC_RELAXED);
+    uint32_t peak = __atomic_load_n(&st->peak_in_use, __ATOMIC_RELAXED);
+    while(in_use > peak &&
+          !__atomic_compare_exchange_n(&st->peak_in_use, &peak, in_use, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/**
+ * Internal function.
+ *
+ * Pops a block from the first non-empty pool of @p region at or above the smallest pool that fits
+ * @p size.
+ * @param pool_out id of the pool the block came from
+ * @return Pointer to the (not zeroed) block, or NULL on failure.
+ */
+static void* take_block(uint32_t region, uint32_t size, uint32_t* pool_out, enum ti_errc_t *errc) {
     if (errc) *errc = TI_ERRC_NONE;
-    if (size == 0 || size > POOL_BLOCK_SIZES[NUMBER_OF_POOLS - 1]) {
+    if (region >= HEAP_REGION_COUNT || pool_base[HEAP_REGION_FIRST_POOLS[region]] == (void*)0) {
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Heap region not initialized"); return NULL; //
+    }
+    if (region == HEAP_REGION_DTCM && alloc_core_id() != 0) {
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "DTCM is only reachable from the CM7"); return NULL; //
+    }
+    const uint32_t first = HEAP_REGION_FIRST_POOLS[region];
+    const uint32_t stop = first + HEAP_REGION_POOL_COUNTS[region];
+    if (size == 0 || size > POOL_BLOCK_SIZES[stop - 1]) {
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
         TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid alloc size"); return NULL; //
     }
     // find ideal i
-    uint32_t i = 0;
-    // i < NUMBER_OF_POOLS comes first so that it can terminate condition early
-    for(; i < NUMBER_OF_POOLS && size > POOL_BLOCK_SIZES[i]; i++);
-    if (i >= NUMBER_OF_POOLS) { TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "No pool fits size"); return NULL; } //
+    uint32_t i = first;
+    // i < stop comes first so that it can terminate condition early
+    for(; i < stop && size > POOL_BLOCK_SIZES[i]; i++);
+    if (i >= stop) { TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "No pool fits size"); return NULL; } //
+    const uint32_t ideal = i;
     // if the pool for ideal i is already full (null head), keep going to next block until we find a free one
-    struct block_t* block = pool_heads[i];
-    while(block == ((void*)0) && i < NUMBER_OF_POOLS-1){ // subtracting 1 here because of ++i
-        block = pool_heads[++i];
+#if ALLOC_CORE_CACHE_SIZE > 0
+    uint32_t core = alloc_core_id();
+#endif
+    struct block_t* block = (void*)0;
+    for(; i < stop; i++){
+#if ALLOC_CORE_CACHE_SIZE > 0
+        block = list_pop(&core_cache_heads[core][i], i);
+        if(block != ((void*)0)){
+            __atomic_fetch_sub(&core_cache_count[core][i], 1U, __ATOMIC_RELAXED);
+            break;
+        }
+#endif
+        block = list_pop(&pool_heads[i], i);
+        if(block != ((void*)0)) break;
     }
 
     if(block == ((void*)0)){
+        __atomic_fetch_add(&pool_stats[ideal].failures, 1U, __ATOMIC_RELAXED);
         TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Heap full"); return NULL; //
     }
 
@@ -205,18 +325,69 @@ void* alloc(uint32_t size, enum ti_errc_t *errc) {
     uint32_t big_index = index / 8;
     uint32_t small_index = index % 8;
 
-    // update linked list
-    pool_heads[i] = block->next_block;
+    __atomic_fetch_and(&is_free[big_index], (uint8_t)~((uint8_t)1 << small_index), __ATOMIC_RELAXED);
+
+    if(i != ideal){
+        __atomic_fetch_add(&pool_stats[ideal].promotions, 1U, __ATOMIC_RELAXED);
+    }
+    note_alloc(i);
+
+    *pool_out = i;
+    return block;
+}
 
-    is_free[big_index] &= ~((uint8_t)1 << small_index);
+/**
+ * @param size
+ * @param errc Output error code.
+ * @return Pointer to allocated, zeroed block, or NULL on failure.
+ */
+void* alloc(uint32_t size, enum ti_errc_t *errc) {
+    return alloc_in(HEAP_REGION_DEFAULT, size, errc);
+}
 
-    for(uint32_t j = 0; j < POOL_BLOCK_SIZES[i]; j++){ // zero this block before returning
-        *(((uint8_t*)block) + j) = 0; // changed this to j? not sure why this was i before.
+/**
+ * @param region
+ * @param size
+ * @param errc Output error code.
+ * @return Pointer to allocated, zeroed block, or NULL on failure.
+ */
+void* alloc_in(enum heap_region_t region, uint32_t size, enum ti_errc_t *errc) {
+    uint32_t i;
+    void* block = take_block((uint32_t)region, size, &i, errc);
+    if (block == NULL) return NULL;
+
+    // zero this block before returning. Blocks are power-of-two sized and at least word aligned,
+    // so this can go a word at a time.
+    uint32_t* word = (uint32_t*)block;
+    for(uint32_t j = 0; j < (POOL_BLOCK_SIZES[i] >> 2); j++){
+        word[j] = 0;
     }
 
     return block;
 }
 
+/**
+ * @param size
+ * @param errc Output error code.
+ * @return Pointer to allocated block with undefined contents, or NULL on failure.
+ */
+void* alloc_uninit(uint32_t size, enum ti_errc_t *errc) {
+    uint32_t i;
+    return take_block(HEAP_REGION_DEFAULT, size, &i, errc);
+}
+
+/**
+ * @param size
+ * @param errc Output error code.
+ * @return Pointer to allocated, zeroed, cache-line aligned block, or NULL on failure.
+ */
+void* alloc_dma(uint32_t size, enum ti_errc_t *errc) {
+    // rounding up to a whole cache line keeps the request out of the pools whose blocks share
+    // lines with their neighbours
+    if (size != 0 && size < CACHE_LINE_SIZE) size = CACHE_LINE_SIZE;
+    return alloc(size, errc);
+}
+
 /**
  * @param mem
  * @param errc Output error code.
@@ -226,16 +397,15 @@ void ti_free(void* mem, enum ti_errc_t *errc) {
     uint32_t i;
     get_pool(mem, &i, errc); //
     if ((errc && *errc != TI_ERRC_NONE) || i == -1U){ //
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
         TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Memory block not in heap"); return; //
     }
 
-    struct block_t new_head = (struct block_t){
-        pool_heads[i]
-    };
-
-    *((struct block_t*)mem) = new_head;
+    if((((uint8_t*)mem - pool_base[i]) & (POOL_BLOCK_SIZES[i] - 1)) != 0){
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Pointer is not the start of a block"); return; //
+    }
 
-    pool_heads[i] = (struct block_t*)mem;
     uint32_t index;
     get_index(mem, &index, errc); //
     if (errc && *errc != TI_ERRC_NONE) { TI_SET_ERRC(errc, *errc, "Propagated"); return; } //
@@ -243,7 +413,24 @@ void ti_free(void* mem, enum ti_errc_t *errc) {
     uint32_t big_index = index / 8;
     uint32_t small_index = index % 8;
 
-    is_free[big_index] |= (uint8_t)1 << small_index;
+    // claiming the free bit first makes a double free a harmless no-op, even if it races
+    uint8_t bit = (uint8_t)1 << small_index;
+    if((__atomic_fetch_or(&is_free[big_index], bit, __ATOMIC_RELAXED) & bit) != 0){
+        __atomic_fetch_add(&invalid_requests, 1U, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_fetch_add(&pool_stats[i].frees, 1U, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pool_stats[i].in_use, 1U, __ATOMIC_RELAXED);
+
+#if ALLOC_CORE_CACHE_SIZE > 0
+    uint32_t core = alloc_core_id();
+    if(__atomic_load_n(&core_cache_count[core][i], __ATOMIC_RELAXED) < ALLOC_CORE_CACHE_SIZE){
+        __atomic_fetch_add(&core_cache_count[core][i], 1U, __ATOMIC_RELAXED);
+        list_push(&core_cache_heads[core][i], i, (struct block_t*)mem);
+        return;
+    }
+#endif
+    list_push(&pool_heads[i], i, (struct block_t*)mem);
 }
 
 /**
@@ -262,5 +449,76 @@ bool isFree(void* mem) {
     uint32_t big_index = index / 8;
     uint32_t small_index = index % 8;
 
-    return (is_free[big_index] & (1 << small_index)) != 0;
-}
\ No newline at end of file
+    return (__atomic_load_n(&is_free[big_index], __ATOMIC_RELAXED) & (1 << small_index)) != 0;
+}
+
+/**
+ * @param stats
+ */
+void alloc_get_stats(alloc_stats_t *stats) {
+    if (!stats) return;
+    for(int i = 0; i < TOTAL_POOL_COUNT; i++){
+        alloc_pool_stats_t* st = &pool_stats[i];
+        stats->pools[i].allocs = __atomic_load_n(&st->allocs, __ATOMIC_RELAXED);
+        stats->pools[i].frees = __atomic_load_n(&st->frees, __ATOMIC_RELAXED);
+        stats->pools[i].promotions = __atomic_load_n(&st->promotions, __ATOMIC_RELAXED);
+        stats->pools[i].failures = __atomic_load_n(&st->failures, __ATOMIC_RELAXED);
+        stats->pools[i].in_use = __atomic_load_n(&st->in_use, __ATOMIC_RELAXED);
+        stats->pools[i].peak_in_use = __atomic_load_n(&st->peak_in_use, __ATOMIC_RELAXED);
+    }
+    stats->invalid_requests = __atomic_load_n(&invalid_requests, __ATOMIC_RELAXED);
+}
+
+void alloc_clear_stats(void) {
+    for(int i = 0; i < TOTAL_POOL_COUNT; i++){
+        alloc_pool_stats_t* st = &pool_stats[i];
+        __atomic_store_n(&st->allocs, 0U, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->frees, 0U, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->promotions, 0U, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->failures, 0U, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->peak_in_use, __atomic_load_n(&st->in_use, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&invalid_requests, 0U, __ATOMIC_RELAXED);
+}
+
+/**
+ * Internal function.
+ *
+ * Writes @p value big-endian as a u16, saturating at 0xFFFF.
+ */
+static uint8_t* put_u16_sat(uint8_t* out, uint32_t value){
+    if(value > 0xFFFFU) value = 0xFFFFU;
+    out[0] = (uint8_t)(value >> 8);
+    out[1] = (uint8_t)value;
+    return out + 2;
+}
+
+/**
+ * @param stats
+ * @param region
+ * @param buffer
+ * @param buffer_len
+ * @param packed_len
+ * @param errc Output error code.
+ */
+void alloc_pack_stats(const alloc_stats_t *stats,
+                      enum heap_region_t region,
+                      uint8_t *buffer,
+                      size_t buffer_len,
+                      size_t *packed_len,
+                      enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (!stats || !buffer || !packed_len || (uint32_t)region >= HEAP_REGION_COUNT
+        || buffer_len < HEAP_REGION_POOL_COUNTS[region] * ALLOC_PACKED_POOL_SIZE) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid alloc stats pack args"); return;
+    }
+
+    uint8_t* out = buffer;
+    const uint32_t first = HEAP_REGION_FIRST_POOLS[region];
+    for(uint32_t i = first; i < first + HEAP_REGION_POOL_COUNTS[region]; i++){
+        out = put_u16_sat(out, stats->pools[i].peak_in_use);
+        out = put_u16_sat(out, stats->pools[i].promotions);
+        out = put_u16_sat(out, stats->pools[i].failures);
+    }
+    *packed_len = (size_t)(out - buffer);
+}
@@ -3,66 +3,301 @@
 #pragma once
 #include "stdbool.h"
 #include "stdint.h"
+#include "stddef.h"
 #include "../peripheral/errc.h"
 
-// POINTER TO START OF HEAP
-extern void* HEAP_START;
-
 //----------------------------------------------------------------------------------
 // BEGIN CONFIGURATION SECTION
-// IF YOU CHANGE ANY OF THESE VALUES, IT IS HIGHLY LIKELY OTHERS WILL NEED TO CHANGE IN RESPONSE
+// ONLY EDIT HEAP_REGIONS AND THE HEAP_POOLS_<region> TABLES, EVERY OTHER HEAP CONSTANT IS DERIVED
+// FROM THEM
 //----------------------------------------------------------------------------------
 
-#define NUMBER_OF_POOLS 7
-// Must have POOL_BLOCK_SIZES[n + 1] > POOL_BLOCK_SIZES[n] && POOL_BLOCK_SIZES[0] >= sizeof(void*)
-// The first rule is because of how the algorithm works
-// The second is because all blocks need to be large enough to store a pointer (8 bytes for my system)
-static uint32_t POOL_BLOCK_SIZES[NUMBER_OF_POOLS] = {16, 32, 64, 128, 256, 512, 1024}; // note these do not need to be powers of two
-static uint32_t POOL_SIZES[NUMBER_OF_POOLS] = {118, 100, 200, 100, 100, 5, 5};
+// Blocks each core keeps in a private cache per pool before returning frees to the shared lists.
+// 0 disables the caches. Cached blocks can only be reused by the core that freed them.
+#ifndef ALLOC_CORE_CACHE_SIZE
+#define ALLOC_CORE_CACHE_SIZE 0
+#endif
+
+// Cortex-M7 L1 data cache line size. Every region start must be aligned to this (init_heap checks).
+#define CACHE_LINE_SIZE 32
+
+// One X(name, start_symbol, end_symbol) entry per memory region with its own set of pools. The
+// linker script reserves each region's heap between the two symbols. The first region is the
+// default heap used by alloc, alloc_uninit and alloc_dma.
+// - SRAM123:  D2 SRAM, reachable by both cores and by DMA1/DMA2. General purpose.
+// - DTCM:     zero-wait-state CM7 data memory for hot control-loop state. CM7 only, and NOT
+//             reachable by DMA1/DMA2.
+// - AXI_SRAM: D1 SRAM, reachable by DMA1/DMA2 and MDMA. Large DMA buffers.
+// - SRAM4:    D3 SRAM, reachable by both cores and BDMA. Buffers shared between the CM7 and CM4.
+// - BKUP_RAM: battery-backed SRAM. init_heap enables write access to it. The free lists are rebuilt
+//             on every boot, so blocks do not survive a reset through the allocator. The heap
+//             starts after the flash logger's pointers (.bkup_ram_vars), which do survive one.
+#define HEAP_REGIONS(X) \
+    X(SRAM123,  __heap_start,          __heap_end)          \
+    X(DTCM,     __heap_dtcm_start,     __heap_dtcm_end)     \
+    X(AXI_SRAM, __heap_axi_sram_start, __heap_axi_sram_end) \
+    X(SRAM4,    __heap_sram4_start,    __heap_sram4_end)    \
+    X(BKUP_RAM, __heap_bkup_ram_start, __heap_bkup_ram_end)
 
-// POOL_BLOCK_SIZES ⋅ POOL_SIZES, it would be nice to generate this line
-// (16 * 2) + (32 * 2) + (64 * 3) + (128 * 3) = 672
-#define TOTAL_HEAP_SIZE 63968
+// One X(region, block_size, block_count) entry per pool, smallest blocks first. Everything below
+// (pool counts, heap sizes, bitmap size, offsets, shifts) is derived from these tables at compile
+// time. Rules, all checked by _Static_assert:
+// - block sizes must be strictly increasing, because alloc falls through to the next bigger pool
+// - block sizes must be powers of two, so block indices are found with a shift
+// - block sizes must be at least sizeof(void*), since free blocks store the free-list pointer
+// - pools of CACHE_LINE_SIZE blocks or bigger must start on a cache line, so alloc_dma blocks
+//   never share a line with anything else
+// - at most ALLOC_MAX_REGION_POOLS pools per region, so a region's stats fit one comm packet
+// Each table must fit in the size the linker script reserves for its region (init_heap checks).
+#define HEAP_POOLS_SRAM123(X, r) \
+    X(r, 16,   118) \
+    X(r, 32,   100) \
+    X(r, 64,   200) \
+    X(r, 128,  100) \
+    X(r, 256,  100) \
+    X(r, 512,  5)   \
+    X(r, 1024, 5)
 
+#define HEAP_POOLS_DTCM(X, r) \
+    X(r, 16,  64) \
+    X(r, 32,  64) \
+    X(r, 64,  64) \
+    X(r, 128, 32) \
+    X(r, 256, 16)
 
-// STEPS TO FIND IS_FREE_SIZE
-// 1: SUM POOL SIZES (number of blocks total between all pools)
-// 2: DIVIDE BY 8 (since is_free is an array of uint8_t's and each bit in the uint_8 represents if a
-// block is free).
-// 3.a: IF THIS IS AN INTEGER, THIS IS THE SIZE
-// 3.b: IF THIS IS NOT AN INTEGER, ROUND UP
+#define HEAP_POOLS_AXI_SRAM(X, r) \
+    X(r, 32,   64) \
+    X(r, 64,   64) \
+    X(r, 128,  64) \
+    X(r, 256,  32) \
+    X(r, 512,  16) \
+    X(r, 1024, 8)  \
+    X(r, 2048, 4)
 
-// Example:
-// ceil [ sum(POOL_SIZES) / 8 ] => ceil[ (2 + 2 + 3 + 3) / 8 ] => 2
-#define IS_FREE_SIZE 79
+#define HEAP_POOLS_SRAM4(X, r) \
+    X(r, 16,  32) \
+    X(r, 32,  32) \
+    X(r, 64,  32) \
+    X(r, 128, 16) \
+    X(r, 256, 8)
+
+#define HEAP_POOLS_BKUP_RAM(X, r) \
+    X(r, 32,  32) \
+    X(r, 64,  16) \
+    X(r, 128, 8)  \
+    X(r, 256, 2)
+
+#define ALLOC_MAX_REGION_POOLS 7
 
 //----------------------------------------------------------------------------------
 // END CONFIGURATION SECTION
 //----------------------------------------------------------------------------------
 
+// Region ids (HEAP_REGION_SRAM123, ...) and the number of regions.
+#define HEAP_REGION_ID_(name, start, end) HEAP_REGION_##name,
+enum heap_region_t { HEAP_REGIONS(HEAP_REGION_ID_) HEAP_REGION_COUNT };
+
+// Per region: pool count, byte offset of each pool from the region start (POOL_<region>_<size>_OFFSET,
+// a running sum whose final value is the region's heap size) and index of each pool's first block
+// within the region, built the same way.
+#define HEAP_POOL_MARK_(r, size, count) HEAP_##r##_##size##_MARK_,
+#define HEAP_POOL_OFFSET_(r, size, count) POOL_##r##_##size##_OFFSET, POOL_##r##_##size##_LAST_BYTE_ = POOL_##r##_##size##_OFFSET + (size) * (count) - 1,
+#define HEAP_POOL_FIRST_BLOCK_(r, size, count) POOL_##r##_##size##_FIRST_BLOCK, POOL_##r##_##size##_LAST_BLOCK_ = POOL_##r##_##size##_FIRST_BLOCK + (count) - 1,
+#define HEAP_REGION_LAYOUT_(name, start, end) \
+    enum { HEAP_POOLS_##name(HEAP_POOL_MARK_, name) HEAP_##name##_POOL_COUNT }; \
+    enum { HEAP_##name##_OFFSET_BASE_ = -1, HEAP_POOLS_##name(HEAP_POOL_OFFSET_, name) HEAP_##name##_SIZE }; \
+    enum { HEAP_##name##_BLOCK_BASE_ = -1, HEAP_POOLS_##name(HEAP_POOL_FIRST_BLOCK_, name) HEAP_##name##_BLOCK_COUNT };
+HEAP_REGIONS(HEAP_REGION_LAYOUT_)
+
+// Pool ids (POOL_SRAM123_16, ..., POOL_DTCM_16, ...) numbered across all regions in table order, so
+// every region's pools are contiguous.
+#define HEAP_POOL_ID_(r, size, count) POOL_##r##_##size,
+#define HEAP_REGION_POOL_IDS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_ID_, name)
+enum { HEAP_REGIONS(HEAP_REGION_POOL_IDS_) TOTAL_POOL_COUNT };
+
+// First pool id and first bitmap index of each region.
+#define HEAP_REGION_FIRST_POOL_(name, start, end) HEAP_##name##_FIRST_POOL, HEAP_##name##_LAST_POOL_ = HEAP_##name##_FIRST_POOL + HEAP_##name##_POOL_COUNT - 1,
+enum { HEAP_FIRST_POOL_BASE_ = -1, HEAP_REGIONS(HEAP_REGION_FIRST_POOL_) };
+#define HEAP_REGION_FIRST_BLOCK_(name, start, end) HEAP_##name##_FIRST_BLOCK, HEAP_##name##_LAST_BLOCK_ = HEAP_##name##_FIRST_BLOCK + HEAP_##name##_BLOCK_COUNT - 1,
+enum { HEAP_FIRST_BLOCK_BASE_ = -1, HEAP_REGIONS(HEAP_REGION_FIRST_BLOCK_) HEAP_TOTAL_BLOCK_COUNT };
+
+// The default heap keeps the names the rest of the code base uses. It is the first region, so its
+// pool ids are 0 .. NUMBER_OF_POOLS - 1.
+#define HEAP_REGION_DEFAULT HEAP_REGION_SRAM123
+#define NUMBER_OF_POOLS   HEAP_SRAM123_POOL_COUNT
+#define TOTAL_HEAP_SIZE   HEAP_SRAM123_SIZE
+#define TOTAL_BLOCK_COUNT HEAP_SRAM123_BLOCK_COUNT
+_Static_assert(HEAP_SRAM123_FIRST_POOL == 0, "the default heap must be the first region");
+
+// One bit per block in every region, rounded up to whole bytes.
+#define IS_FREE_SIZE ((HEAP_TOTAL_BLOCK_COUNT + 7) / 8)
+
+// log2 of a power-of-two block size.
+#define POOL_BLOCK_SHIFT_(size) \
+    ((size) >> 1 == 0 ? 0 : (size) >> 2 == 0 ? 1 : (size) >> 3 == 0 ? 2 : (size) >> 4 == 0 ? 3 : \
+     (size) >> 5 == 0 ? 4 : (size) >> 6 == 0 ? 5 : (size) >> 7 == 0 ? 6 : (size) >> 8 == 0 ? 7 : \
+     (size) >> 9 == 0 ? 8 : (size) >> 10 == 0 ? 9 : (size) >> 11 == 0 ? 10 : (size) >> 12 == 0 ? 11 : \
+     (size) >> 13 == 0 ? 12 : (size) >> 14 == 0 ? 13 : (size) >> 15 == 0 ? 14 : 15)
+
+// Per-pool tables, indexed by pool id. POOL_OFFSETS are relative to the pool's region start;
+// POOL_FIRST_BLOCKS index the bitmap shared by all regions.
+#define HEAP_POOL_SIZE_(r, size, count) size,
+#define HEAP_POOL_COUNT_(r, size, count) count,
+#define HEAP_POOL_OFFSET_ENTRY_(r, size, count) POOL_##r##_##size##_OFFSET,
+#define HEAP_POOL_FIRST_BLOCK_ENTRY_(r, size, count) HEAP_##r##_FIRST_BLOCK + POOL_##r##_##size##_FIRST_BLOCK,
+#define HEAP_POOL_SHIFT_ENTRY_(r, size, count) POOL_BLOCK_SHIFT_(size),
+#define HEAP_POOL_REGION_ENTRY_(r, size, count) HEAP_REGION_##r,
+#define HEAP_REGION_SIZES_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_SIZE_, name)
+#define HEAP_REGION_COUNTS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_COUNT_, name)
+#define HEAP_REGION_OFFSETS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_OFFSET_ENTRY_, name)
+#define HEAP_REGION_FIRST_BLOCKS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_FIRST_BLOCK_ENTRY_, name)
+#define HEAP_REGION_SHIFTS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_SHIFT_ENTRY_, name)
+#define HEAP_REGION_POOL_REGIONS_(name, start, end) HEAP_POOLS_##name(HEAP_POOL_REGION_ENTRY_, name)
+
+static const uint32_t POOL_BLOCK_SIZES[TOTAL_POOL_COUNT]  = { HEAP_REGIONS(HEAP_REGION_SIZES_) };
+static const uint32_t POOL_SIZES[TOTAL_POOL_COUNT]        = { HEAP_REGIONS(HEAP_REGION_COUNTS_) };
+static const uint32_t POOL_OFFSETS[TOTAL_POOL_COUNT]      = { HEAP_REGIONS(HEAP_REGION_OFFSETS_) };
+static const uint32_t POOL_FIRST_BLOCKS[TOTAL_POOL_COUNT] = { HEAP_REGIONS(HEAP_REGION_FIRST_BLOCKS_) };
+static const uint8_t POOL_BLOCK_SHIFTS[TOTAL_POOL_COUNT]  = { HEAP_REGIONS(HEAP_REGION_SHIFTS_) };
+static const uint8_t POOL_REGIONS[TOTAL_POOL_COUNT]       = { HEAP_REGIONS(HEAP_REGION_POOL_REGIONS_) };
+
+// Per-region tables, indexed by region id.
+#define HEAP_REGION_FIRST_POOL_ENTRY_(name, start, end) HEAP_##name##_FIRST_POOL,
+#define HEAP_REGION_POOL_COUNT_ENTRY_(name, start, end) HEAP_##name##_POOL_COUNT,
+#define HEAP_REGION_SIZE_ENTRY_(name, start, end) HEAP_##name##_SIZE,
+
+static const uint32_t HEAP_REGION_FIRST_POOLS[HEAP_REGION_COUNT] = { HEAP_REGIONS(HEAP_REGION_FIRST_POOL_ENTRY_) };
+static const uint32_t HEAP_REGION_POOL_COUNTS[HEAP_REGION_COUNT] = { HEAP_REGIONS(HEAP_REGION_POOL_COUNT_ENTRY_) };
+static const uint32_t HEAP_REGION_SIZES[HEAP_REGION_COUNT]       = { HEAP_REGIONS(HEAP_REGION_SIZE_ENTRY_) };
+
+// Strictly increasing block sizes: each POOL_x_MIN_SIZE_ is one more than the previous block size.
+#define HEAP_POOL_ORDER_(r, size, count) POOL_##r##_##size##_MIN_SIZE_, POOL_##r##_##size##_SIZE_ = (size),
+#define HEAP_POOL_CHECK_(r, size, count) \
+    _Static_assert((size) >= POOL_##r##_##size##_MIN_SIZE_, "pool block sizes must be strictly increasing"); \
+    _Static_assert(((size) & ((size) - 1)) == 0, "pool block sizes must be powers of two"); \
+    _Static_assert((size) >= sizeof(void*), "pool blocks must be able to hold a pointer"); \
+    _Static_assert((count) > 0, "pools must have at least one block"); \
+    _Static_assert((count) < 0xFFFF, "pools must fit a 16 bit free-list link"); \
+    _Static_assert((size) < CACHE_LINE_SIZE || POOL_##r##_##size##_OFFSET % CACHE_LINE_SIZE == 0, \
+                   "pools with cache-line sized blocks must start on a cache line");
+#define HEAP_REGION_CHECK_(name, start, end) \
+    enum { HEAP_##name##_MIN_SIZE_BASE_ = 0, HEAP_POOLS_##name(HEAP_POOL_ORDER_, name) }; \
+    HEAP_POOLS_##name(HEAP_POOL_CHECK_, name) \
+    _Static_assert(HEAP_##name##_POOL_COUNT <= ALLOC_MAX_REGION_POOLS, "too many pools in one region");
+HEAP_REGIONS(HEAP_REGION_CHECK_)
+
+// Start and end of each region's heap. On the target these come from the linker script; host tests
+// point them at static arrays before calling init_heap. A region with a NULL start is left empty,
+// and a NULL end skips the size check.
+extern void* HEAP_REGION_STARTS[HEAP_REGION_COUNT];
+extern void* HEAP_REGION_ENDS[HEAP_REGION_COUNT];
+
+// POINTER TO START OF THE DEFAULT HEAP
+#define HEAP_START (HEAP_REGION_STARTS[HEAP_REGION_DEFAULT])
+
+// Number of cores sharing the heap, and the SCB_CPUID part number that identifies the CM4.
+#define ALLOC_CORE_COUNT 2
+#define CORTEX_M4_PARTNO 0xC24
+
+/** @brief Counters for one pool. Updated lock-free, so a snapshot is not atomic across fields. */
+typedef struct {
+    uint32_t allocs;      /** @brief Blocks handed out from this pool. */
+    uint32_t frees;       /** @brief Blocks returned to this pool. */
+    uint32_t promotions;  /** @brief Requests sized for this pool that were served by a bigger one. */
+    uint32_t failures;    /** @brief Requests sized for this pool that found every pool empty. */
+    uint32_t in_use;      /** @brief Blocks currently allocated. */
+    uint32_t peak_in_use; /** @brief Most blocks allocated at once since the last clear. */
+} alloc_pool_stats_t;
+
+/** @brief Allocator counters, one entry per pool id across every region. */
+typedef struct {
+    alloc_pool_stats_t pools[TOTAL_POOL_COUNT];
+    uint32_t invalid_requests; /** @brief Zero or oversized allocs and frees of non-heap pointers. */
+} alloc_stats_t;
+
+// Downlink encoding written by alloc_pack_stats: per pool of one region, big-endian u16 peak
+// in-use, promotions and failures (the last two saturate at 0xFFFF).
+#define ALLOC_PACKED_POOL_SIZE 6U
+#define ALLOC_PACKED_STATS_MAX_SIZE (ALLOC_MAX_REGION_POOLS * ALLOC_PACKED_POOL_SIZE)
 
 /**
- * Initialize heap.  Draws on parameters set up above
- * @return ti_errc_t error code
+ * Initialize the heap in every region with a non-NULL start.  Draws on parameters set up above. Not
+ * thread safe; call once before any other core or interrupt handler uses the heap. alloc,
+ * alloc_in, alloc_uninit, alloc_dma, ti_free and isFree are lock-free and safe from interrupt
+ * handlers and either core.
+ * @return ti_errc_t error code. TI_ERRC_INVALID_ARG if a region start is not cache-line aligned,
+ *         TI_ERRC_OVERFLOW if a region's pools don't fit between its start and end.
  */
 void init_heap(enum ti_errc_t *errc);
 
 /**
- * Allocate a block of size @param size
+ * Allocate a zeroed block of size @param size from the default heap
  * @return ti_errc_t error code
  */
 void* alloc(uint32_t size, enum ti_errc_t *errc);
 
 /**
- * Free the block at @param mem
+ * Allocate a zeroed block of size @param size from the pools of @param region. Falls through to
+ * bigger pools of the same region only. DTCM can only be allocated from the CM7.
+ * @return ti_errc_t error code. TI_ERRC_INVALID_ARG for an unknown, uninitialized or unreachable
+ *         region, or a size bigger than the region's largest block.
+ */
+void* alloc_in(enum heap_region_t region, uint32_t size, enum ti_errc_t *errc);
+
+/**
+ * Allocate a block of size @param size from the default heap without zeroing it. Use when the caller overwrites the
+ * whole block straight away.
+ * @return ti_errc_t error code
+ */
+void* alloc_uninit(uint32_t size, enum ti_errc_t *errc);
+
+/**
+ * Allocate a zeroed block of size @param size that starts on a cache line and shares no cache line
+ * with any other block, so it can be cleaned/invalidated for DMA without corrupting neighbours.
+ * Heap memory (SRAM1-3) is reachable by DMA1/DMA2.
+ * @return ti_errc_t error code
+ */
+void* alloc_dma(uint32_t size, enum ti_errc_t *errc);
+
+/**
+ * Free the block at @param mem, which may come from any region
  * @return ti_errc_t error code
  */
 void ti_free(void* mem, enum ti_errc_t *errc);
 
+/**
+ * Index of the calling core (0 = CM7, 1 = CM4), used to pick a per-core cache.
+ */
+uint32_t alloc_core_id(void);
+
 /**
  * Check if the block at @param mem is free
  * @return bool true if the block is free, false if it is allocated or invalid
  */
 bool isFree(void* mem);
+
+/**
+ * Copy the allocator counters into @param stats
+ */
+void alloc_get_stats(alloc_stats_t *stats);
+
+/**
+ * Zero the event counters and restart each peak from the blocks in use now, e.g. after the stats
+ * have been downlinked. init_heap clears everything.
+ */
+void alloc_clear_stats(void);
+
+/**
+ * Encode the pools of @param region from @param stats into @param buffer for the downlink,
+ * ALLOC_PACKED_POOL_SIZE bytes per pool.
+ * @param buffer_len Size of @param buffer; TI_ERRC_INVALID_ARG if too small.
+ * @param packed_len Output number of bytes written.
+ */
+void alloc_pack_stats(const alloc_stats_t *stats,
+                      enum heap_region_t region,
+                      uint8_t *buffer,
+                      size_t buffer_len,
+                      size_t *packed_len,
+                      enum ti_errc_t *errc);
 // NOLINTEND
 
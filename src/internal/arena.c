@@ -0,0 +1,66 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file internal/arena.c
+ * @authors Joshua Beard
+ * @brief Per-tick bump allocator implementation.
+ */
+#include "arena.h"
+
+// Backing store, placed in DTCM by the .arena output section. NOLOAD, so it is not zeroed at boot.
+static uint8_t arena_mem[ARENA_SIZE] __attribute__((section(".arena"), aligned(ARENA_ALIGN)));
+
+static uint32_t arena_used = 0;
+static uint32_t arena_last_tick = 0;
+static uint32_t arena_high_water = 0;
+
+void* arena_alloc(uint32_t size, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (size == 0 || size > ARENA_SIZE) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid arena alloc size"); return NULL;
+    }
+
+    const uint32_t rounded = (size + (ARENA_ALIGN - 1)) & ~(uint32_t)(ARENA_ALIGN - 1);
+    if (rounded > ARENA_SIZE - arena_used) {
+        TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Arena full"); return NULL;
+    }
+
+    void* mem = &arena_mem[arena_used];
+    arena_used += rounded;
+    return mem;
+}
+
+void arena_reset(void) {
+    arena_last_tick = arena_used;
+    if (arena_used > arena_high_water) {
+        arena_high_water = arena_used;
+    }
+    arena_used = 0;
+}
+
+void arena_get_usage(arena_usage_t *usage) {
+    if (!usage) return;
+    usage->capacity = ARENA_SIZE;
+    usage->used = arena_used;
+    usage->last_tick = arena_last_tick;
+    // include the tick in progress so a tick that is still running is never under-reported
+    usage->high_water = (arena_used > arena_high_water) ? arena_used : arena_high_water;
+}
+
+void arena_clear_high_water(void) {
+    arena_last_tick = 0;
+    arena_high_water = 0;
+}
@@ -0,0 +1,72 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file internal/arena.h
+ * @authors Joshua Beard
+ * @brief Per-tick bump allocator for transient scratch buffers.
+ *
+ * Memory handed out by arena_alloc lives until the next arena_reset, which the state machine
+ * calls at the top of every control tick. Nothing is freed individually. The backing store is
+ * the .arena section in CM7 DTCM (see linker.ld), so it is fast for the CPU but NOT reachable by
+ * DMA1/DMA2; use alloc_dma for DMA buffers.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "../peripheral/errc.h"
+
+/** @brief Size of the arena backing store in bytes. */
+#define ARENA_SIZE (16 * 1024)
+
+/** @brief Alignment of every arena allocation (covers doubles and 64-bit integers). */
+#define ARENA_ALIGN 8
+
+_Static_assert((ARENA_ALIGN & (ARENA_ALIGN - 1)) == 0, "ARENA_ALIGN must be a power of two");
+_Static_assert(ARENA_SIZE % ARENA_ALIGN == 0, "ARENA_SIZE must be a multiple of ARENA_ALIGN");
+
+/** @brief Arena usage counters, all in bytes. */
+typedef struct {
+    uint32_t capacity;   /** @brief Total size of the arena. */
+    uint32_t used;       /** @brief Bytes handed out since the last reset. */
+    uint32_t last_tick;  /** @brief Bytes used by the tick that ended at the last reset. */
+    uint32_t high_water; /** @brief Most bytes used by any single tick so far. */
+} arena_usage_t;
+
+/**
+ * @brief Allocates @p size bytes from the arena. O(1); contents are undefined.
+ * @param size Number of bytes, rounded up to ARENA_ALIGN.
+ * @param errc Output error code. TI_ERRC_INVALID_ARG for size 0, TI_ERRC_OVERFLOW if the arena
+ *        is exhausted for this tick.
+ * @return Pointer to ARENA_ALIGN aligned memory, or NULL on failure.
+ */
+void* arena_alloc(uint32_t size, enum ti_errc_t *errc);
+
+/**
+ * @brief Releases everything allocated since the last reset and folds this tick's usage into the
+ *        high-water mark. Call once at the top of each control tick.
+ */
+void arena_reset(void);
+
+/**
+ * @brief Reads the arena usage counters.
+ * @param usage Output counters.
+ */
+void arena_get_usage(arena_usage_t *usage);
+
+/**
+ * @brief Clears the high-water mark and last-tick counters, e.g. after they've been downlinked.
+ */
+void arena_clear_high_water(void);
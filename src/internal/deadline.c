@@ -0,0 +1,49 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file internal/deadline.c
+ * @authors Joshua Beard
+ * @brief Monotonic microsecond clock and deadlines for bounding busy-wait loops.
+ */
+
+#include "internal/deadline.h"
+#if defined(__arm__)
+#include "internal/dwt.h"
+#else
+#include <time.h>
+#endif
+
+__attribute__((weak)) uint64_t deadline_ticks(void) {
+#if defined(__arm__)
+    // Read from thread context and interrupts alike, so the carry runs with interrupts masked
+    static uint64_t ticks;
+    static uint32_t last;
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    if (!(*DWT_CTRL & DWT_CTRL_CYCCNTENA.msk)) dwt_cycle_counter_init();
+    const uint32_t now = dwt_cycles();
+    ticks += (uint32_t)(now - last);
+    last = now;
+    const uint64_t result = ticks;
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+    return result;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000U * DEADLINE_TICKS_PER_US +
+           (uint64_t)ts.tv_nsec * DEADLINE_TICKS_PER_US / 1000U;
+#endif
+}
@@ -0,0 +1,82 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file internal/deadline.h
+ * @authors Joshua Beard
+ * @brief Monotonic microsecond clock and deadlines for bounding busy-wait loops.
+ *
+ * Drivers that poll a status flag take a deadline before the loop and give up once it has passed,
+ * so every blocking call has a worst case in microseconds no matter the clock speed or
+ * optimisation level. A deadline is checked after the condition it guards, so the condition is
+ * always read once more after expiry and a wait that was only preempted never reports a timeout.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Clock ticks per microsecond (the core clock, which the DWT cycle counter runs at). */
+#define DEADLINE_TICKS_PER_US 480U
+
+/** @brief Point in time a wait gives up at, in clock ticks. */
+typedef struct {
+    uint64_t expires;
+} deadline_t;
+
+/**
+ * @brief Monotonic clock in ticks since it was first read. On the target this is the DWT cycle
+ *        counter carried into 64 bits, which needs a read at least every 2^32 cycles (~8.9 s) to
+ *        see every wrap; a longer gap makes the clock fall behind, never jump ahead. Weak, so host
+ *        tests can substitute a fake clock.
+ */
+uint64_t deadline_ticks(void);
+
+/**
+ * @brief Microseconds since the clock was first read.
+ */
+static inline uint64_t time_us(void) {
+    return deadline_ticks() / DEADLINE_TICKS_PER_US;
+}
+
+/**
+ * @brief Deadline @p timeout_us microseconds from now.
+ */
+static inline deadline_t deadline_in_us(uint32_t timeout_us) {
+    return (deadline_t){ .expires = deadline_ticks() + (uint64_t)timeout_us * DEADLINE_TICKS_PER_US };
+}
+
+/**
+ * @brief True once the deadline has passed.
+ */
+static inline bool deadline_expired(deadline_t deadline) {
+    return deadline_ticks() >= deadline.expires;
+}
+
+/**
+ * @brief Microseconds left before the deadline, 0 once it has passed.
+ */
+static inline uint32_t deadline_remaining_us(deadline_t deadline) {
+    const uint64_t now = deadline_ticks();
+    return now >= deadline.expires ? 0U : (uint32_t)((deadline.expires - now) / DEADLINE_TICKS_PER_US);
+}
+
+/**
+ * @brief Blocks until the deadline has passed. For fixed settling times a datasheet asks for,
+ *        where there is no flag to poll.
+ */
+static inline void deadline_wait(deadline_t deadline) {
+    while (!deadline_expired(deadline)) continue;
+}
@@ -0,0 +1,44 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file internal/dwt.h
+ * @authors Joshua Beard
+ * @brief Cycle counting with the Cortex-M7 DWT unit, used for benchmarks and instrumentation.
+ */
+
+#pragma once
+#include <stdint.h>
+#include "internal/mmio.h"
+
+#define DWT_LAR_UNLOCK_KEY 0xC5ACCE55U
+
+/**
+ * @brief Enables trace and starts the free-running DWT cycle counter from zero.
+ */
+static inline void dwt_cycle_counter_init(void) {
+    SET_FIELD(DBG_DEMCR, DBG_DEMCR_TRCENA);
+    *DWT_LAR = DWT_LAR_UNLOCK_KEY;
+    *DWT_CYCCNT = 0U;
+    SET_FIELD(DWT_CTRL, DWT_CTRL_CYCCNTENA);
+}
+
+/**
+ * @brief Returns the current core cycle count. Wraps every 2^32 cycles (~8.9 s at 480 MHz), so
+ *        always take differences with unsigned arithmetic.
+ */
+static inline uint32_t dwt_cycles(void) {
+    return *DWT_CYCCNT;
+}
@@ -1,21 +1,330 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file peripheral/dma.c
+ * @authors Charles Faisandier
+ * @brief DMA1/DMA2 stream driver with DMAMUX1 routing and per-stream completion callbacks.
+ */
+
 #include "dma.h"
 #include "errc.h"
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "internal/deadline.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**************************************************************************************************
+ * @section Private Definitions
+ **************************************************************************************************/
+
+// Longest a stream takes to drop EN once it is cleared, in microseconds. It finishes the data beat
+// in flight first, which takes well under a microsecond; the rest is margin.
+#define DMA_DISABLE_TIMEOUT_US 100U
+
+// SxCR DIR values
+#define DMA_DIR_P2M 0b00U
+#define DMA_DIR_M2P 0b01U
+
+// Per-stream flag bits, relative to the stream's offset in LISR/HISR (and LIFCR/HIFCR)
+#define DMA_FLAG_FE  (1U << 0)
+#define DMA_FLAG_DME (1U << 2)
+#define DMA_FLAG_TE  (1U << 3)
+#define DMA_FLAG_HT  (1U << 4)
+#define DMA_FLAG_TC  (1U << 5)
+#define DMA_FLAG_ALL (DMA_FLAG_FE | DMA_FLAG_DME | DMA_FLAG_TE | DMA_FLAG_HT | DMA_FLAG_TC)
+
+// Offset of stream (x % 4)'s flags within LISR (streams 0-3) or HISR (streams 4-7)
+static const uint8_t dma_flag_shift[4] = {0, 6, 16, 22};
+
+// Owner and in-flight state of one stream
+typedef struct {
+    bool owned;
+    uint32_t request_id; // 0 while claimed but not configured
+    dma_config_t config;
+    void* context;       // context of the transfer in flight
+    bool circular;       // the transfer in flight wraps instead of finishing
+    volatile bool active;
+} dma_stream_state_t;
+
+static dma_stream_state_t dma_streams[DMA_INSTANCE_COUNT][DMA_STREAM_COUNT];
+
+/**************************************************************************************************
+ * @section Private Function Implementations
+ **************************************************************************************************/
+
+static inline bool dma_valid(dma_instance_t instance, dma_stream_t stream) {
+    return instance >= DMA1 && instance < DMA_INSTANCE_COUNT && stream >= DMA_STREAM_MIN &&
+           stream < DMA_STREAM_COUNT;
+}
+
+// mmio.h keeps each stream's control register separately; every SxCR shares the S0CR layout
+static rw_reg32_t dma_stream_cr(dma_instance_t instance, dma_stream_t stream) {
+    switch (stream) {
+        case DMA_STREAM_0: return DMAx_S0CR[instance];
+        case DMA_STREAM_1: return DMAx_S1CR[instance];
+        case DMA_STREAM_2: return DMAx_S2CR[instance];
+        case DMA_STREAM_3: return DMAx_S3CR[instance];
+        case DMA_STREAM_4: return DMAx_S4CR[instance];
+        case DMA_STREAM_5: return DMAx_S5CR[instance];
+        case DMA_STREAM_6: return DMAx_S6CR[instance];
+        default:           return DMAx_S7CR[instance];
+    }
+}
+
+// DMAMUX1 channels 0-7 feed DMA1 streams 0-7 and channels 8-15 feed DMA2. mmio.h only lists the
+// first eight; the rest follow straight on from them.
+static rw_reg32_t dma_mux_channel(dma_instance_t instance, dma_stream_t stream) {
+    return DMAMUXx_CxCR[1][0] + (instance - DMA1) * DMA_STREAM_COUNT + stream;
+}
+
+static uint32_t dma_read_flags(dma_instance_t instance, dma_stream_t stream) {
+    const uint32_t isr = (stream < DMA_STREAM_4) ? *DMAx_LISR[instance] : *DMAx_HISR[instance];
+    return (isr >> dma_flag_shift[stream % 4]) & DMA_FLAG_ALL;
+}
+
+// The flag clear registers are write-one-to-clear, so one store covers every flag
+static void dma_clear_flags(dma_instance_t instance, dma_stream_t stream, uint32_t flags) {
+    rw_reg32_t ifcr = (stream < DMA_STREAM_4) ? DMAx_LIFCR[instance] : DMAx_HIFCR[instance];
+    *ifcr = (flags & DMA_FLAG_ALL) << dma_flag_shift[stream % 4];
+}
+
+// Clears EN and waits for the stream to drop it. False if it still reads set at the deadline.
+static bool dma_stop(rw_reg32_t cr) {
+    CLR_FIELD(cr, DMAx_S0CR_EN);
+    const deadline_t deadline = deadline_in_us(DMA_DISABLE_TIMEOUT_US);
+    while (READ_FIELD(cr, DMAx_S0CR_EN)) {
+        if (deadline_expired(deadline)) return !READ_FIELD(cr, DMAx_S0CR_EN);
+    }
+    return true;
+}
+
+static bool dma_disable(dma_instance_t instance, dma_stream_t stream) {
+    const bool stopped = dma_stop(dma_stream_cr(instance, stream));
+    dma_clear_flags(instance, stream, DMA_FLAG_ALL);
+    return stopped;
+}
+
+static void dma_irq(dma_instance_t instance, dma_stream_t stream) {
+    dma_stream_state_t* st = &dma_streams[instance][stream];
+    const uint32_t flags = dma_read_flags(instance, stream);
+    dma_clear_flags(instance, stream, flags);
+
+    // FIFO errors in direct mode are informational; the stream keeps going
+    bool failed = (flags & (DMA_FLAG_TE | DMA_FLAG_DME)) != 0;
+    if (!failed && !(flags & DMA_FLAG_TC)) return;
+    if (!st->active) return;
+
+    if (failed) (void)dma_disable(instance, stream);
+    // a circular stream reloads NDTR and carries on at the start of its buffer
+    if (failed || !st->circular) st->active = false;
+    if (st->config.callback) st->config.callback(!failed, st->context);
+}
+
+static inline void dma_enable_irq(dma_instance_t instance, dma_stream_t stream) {
+    const int32_t irq = DMAx_STRx_IRQ_NUM[instance][stream];
+    *NVIC_ISERx[irq / 32] = 1U << (irq % 32);
+}
+
+/**************************************************************************************************
+ * @section Interrupt Handlers
+ **************************************************************************************************/
+
+void dma_str0_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_0); }
+void dma_str1_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_1); }
+void dma_str2_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_2); }
+void dma_str3_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_3); }
+void dma_str4_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_4); }
+void dma_str5_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_5); }
+void dma_str6_irq_handler(void)  { dma_irq(DMA1, DMA_STREAM_6); }
+void dma1_str7_irq_handler(void) { dma_irq(DMA1, DMA_STREAM_7); }
+void dma2_str0_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_0); }
+void dma2_str1_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_1); }
+void dma2_str2_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_2); }
+void dma2_str3_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_3); }
+void dma2_str4_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_4); }
+void dma2_str5_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_5); }
+void dma2_str6_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_6); }
+void dma2_str7_irq_handler(void) { dma_irq(DMA2, DMA_STREAM_7); }
+
+/**************************************************************************************************
+ * @section Public Function Implementations
+ **************************************************************************************************/
 
 void* dma_init(enum ti_errc_t *errc) {
     if (errc) *errc = TI_ERRC_NONE;
+    SET_FIELD(RCC_AHB1ENR, RCC_AHB1ENR_DMAxEN[DMA1]);
+    SET_FIELD(RCC_AHB1ENR, RCC_AHB1ENR_DMAxEN[DMA2]);
+
+    bool stopped = true;
+    for (int i = DMA1; i < DMA_INSTANCE_COUNT; i++) {
+        for (int s = DMA_STREAM_MIN; s < DMA_STREAM_COUNT; s++) {
+            stopped &= dma_disable((dma_instance_t)i, (dma_stream_t)s);
+            dma_streams[i][s] = (dma_stream_state_t){0};
+        }
+    }
+    if (!stopped) TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "DMA stream never disabled");
     return NULL;
 }
 
+bool dma_alloc_stream(dma_instance_t instance, dma_stream_t *stream) {
+    if (instance < DMA1 || instance >= DMA_INSTANCE_COUNT || !stream) return false;
+    for (int s = DMA_STREAM_MIN; s < DMA_STREAM_COUNT; s++) {
+        if (!__atomic_test_and_set(&dma_streams[instance][s].owned, __ATOMIC_ACQ_REL)) {
+            dma_streams[instance][s].request_id = 0;
+            *stream = (dma_stream_t)s;
+            return true;
+        }
+    }
+    return false;
+}
+
+void dma_release_stream(dma_instance_t instance, dma_stream_t stream) {
+    if (!dma_valid(instance, stream)) return;
+    dma_abort_transfer(instance, stream, NULL);
+    WRITE_FIELD(dma_mux_channel(instance, stream), DMAMUXx_CxCR_DMAREQ_ID, 0U);
+    dma_streams[instance][stream] = (dma_stream_state_t){0};
+}
+
 bool dma_configure_stream(const dma_config_t* config) {
-    (void)config;
+    if (!config || !dma_valid(config->instance, config->stream)) return false;
+    if (config->request_id == 0 || !IN_RANGE_FIELD(DMAMUXx_CxCR_DMAREQ_ID, config->request_id)) return false;
+    if (config->direction >= DMA_DIR_COUNT || config->priority >= DMA_PRIORITY_COUNT) return false;
+    if (config->src_data_size >= DMA_DATA_SIZE_COUNT || config->dest_data_size >= DMA_DATA_SIZE_COUNT) return false;
+    if (config->fifo_threshold >= DMA_FIFO_THRESHOLD_COUNT) return false;
+    // without the FIFO both ends move one item at a time, so they must be the same width
+    if (!config->fifo_enabled && config->src_data_size != config->dest_data_size) return false;
+
+    const dma_instance_t instance = config->instance;
+    const dma_stream_t stream = config->stream;
+    dma_stream_state_t* st = &dma_streams[instance][stream];
+
+    // Claim the stream, or accept it if it's ours already (claimed by dma_alloc_stream, or
+    // configured before for the same request)
+    if (__atomic_test_and_set(&st->owned, __ATOMIC_ACQ_REL)) {
+        if (st->request_id != 0 && st->request_id != config->request_id) return false;
+        if (st->active) return false;
+    }
+
+    dma_disable(instance, stream);
+
+    const bool p2m = config->direction == PERIPH_TO_MEM;
+    const uint32_t psize = p2m ? config->src_data_size : config->dest_data_size;
+    const uint32_t msize = p2m ? config->dest_data_size : config->src_data_size;
+    uint32_t cr = 0;
+    cr |= ((p2m ? DMA_DIR_P2M : DMA_DIR_M2P) << DMAx_S0CR_DIR.pos) & DMAx_S0CR_DIR.msk;
+    cr |= ((uint32_t)config->priority << DMAx_S0CR_PL.pos) & DMAx_S0CR_PL.msk;
+    cr |= (psize << DMAx_S0CR_PSIZE.pos) & DMAx_S0CR_PSIZE.msk;
+    cr |= (msize << DMAx_S0CR_MSIZE.pos) & DMAx_S0CR_MSIZE.msk;
+    cr |= DMAx_S0CR_MINC.msk | DMAx_S0CR_TCIE.msk | DMAx_S0CR_TEIE.msk | DMAx_S0CR_DMEIE.msk;
+    *dma_stream_cr(instance, stream) = cr;
+
+    uint32_t fcr = 0;
+    if (config->fifo_enabled) {
+        fcr |= DMAx_SxFCR_DMDIS.msk;
+        fcr |= ((uint32_t)config->fifo_threshold << DMAx_SxFCR_FTH.pos) & DMAx_SxFCR_FTH.msk;
+    }
+    *DMAx_SxFCR[instance][stream] = fcr;
+
+    WRITE_FIELD(dma_mux_channel(instance, stream), DMAMUXx_CxCR_DMAREQ_ID, config->request_id);
+
+    st->config = *config;
+    st->request_id = config->request_id;
+    st->active = false;
+    dma_enable_irq(instance, stream);
     return true;
 }
-inline static bool check_periph_dma_config_validity(periph_dma_config_t *dma_config) {
-    (void)dma_config;
+
+bool dma_start_transfer(dma_transfer_t *dma_transfer, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_INVALID_ARG;
+    if (!dma_transfer || !dma_valid(dma_transfer->instance, dma_transfer->stream)) return false;
+    const dma_instance_t instance = dma_transfer->instance;
+    const dma_stream_t stream = dma_transfer->stream;
+    dma_stream_state_t* st = &dma_streams[instance][stream];
+    if (!st->owned || st->request_id == 0) return false;
+    if (!dma_transfer->src || !dma_transfer->dest) return false;
+
+    // NDTR counts peripheral-size items
+    const bool p2m = st->config.direction == PERIPH_TO_MEM;
+    const uint32_t shift = p2m ? st->config.src_data_size : st->config.dest_data_size;
+    const size_t items = dma_transfer->size >> shift;
+    if (items == 0 || items > DMA_MAX_ITEMS || (items << shift) != dma_transfer->size) return false;
+
+    bool idle = false;
+    if (!__atomic_compare_exchange_n(&st->active, &idle, true, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        if (errc) *errc = TI_ERRC_BUSY;
+        return false;
+    }
+    if (errc) *errc = TI_ERRC_NONE;
+
+    // previous transfer finished but the stream hasn't dropped EN yet
+    rw_reg32_t cr = dma_stream_cr(instance, stream);
+    if (READ_FIELD(cr, DMAx_S0CR_EN) && !dma_stop(cr)) {
+        st->active = false;
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "DMA stream never disabled");
+        return false;
+    }
+    dma_clear_flags(instance, stream, DMA_FLAG_ALL);
+
+    const uint32_t periph = (uint32_t)(uintptr_t)(p2m ? dma_transfer->src : dma_transfer->dest);
+    const uint32_t mem = (uint32_t)(uintptr_t)(p2m ? dma_transfer->dest : dma_transfer->src);
+    *DMAx_SxPAR[instance][stream] = periph;
+    *DMAx_SxM0AR[instance][stream] = mem;
+    WRITE_FIELD(DMAx_SxNDTR[instance][stream], DMAx_SxNDTR_NDT, (uint32_t)items);
+    if (dma_transfer->disable_mem_inc) {
+        CLR_FIELD(cr, DMAx_S0CR_MINC);
+    } else {
+        SET_FIELD(cr, DMAx_S0CR_MINC);
+    }
+    if (dma_transfer->circular) {
+        SET_FIELD(cr, DMAx_S0CR_CIRC);
+    } else {
+        CLR_FIELD(cr, DMAx_S0CR_CIRC);
+    }
+
+    st->context = dma_transfer->context;
+    st->circular = dma_transfer->circular;
+    SET_FIELD(cr, DMAx_S0CR_EN);
     return true;
 }
 
-bool dma_start_transfer( dma_transfer_t *dma_transfer) {
-    (void)dma_transfer;
-    return true;
-}
\ No newline at end of file
+void dma_abort_transfer(dma_instance_t instance, dma_stream_t stream, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (!dma_valid(instance, stream)) return;
+    if (!dma_disable(instance, stream)) TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "DMA stream never disabled");
+    dma_streams[instance][stream].active = false;
+}
+
+uint32_t dma_get_remaining(dma_instance_t instance, dma_stream_t stream) {
+    if (!dma_valid(instance, stream)) return 0;
+    return READ_FIELD(DMAx_SxNDTR[instance][stream], DMAx_SxNDTR_NDT);
+}
+
+bool dma_stream_busy(dma_instance_t instance, dma_stream_t stream) {
+    if (!dma_valid(instance, stream)) return false;
+    return dma_streams[instance][stream].active;
+}
+
+bool check_periph_dma_config_validity(const periph_dma_config_t *dma_config) {
+    if (!dma_config) return false;
+    return dma_valid(dma_config->instance, dma_config->stream) &&
+           dma_config->direction < DMA_DIR_COUNT &&
+           dma_config->src_data_size < DMA_DATA_SIZE_COUNT &&
+           dma_config->dest_data_size < DMA_DATA_SIZE_COUNT &&
+           dma_config->priority < DMA_PRIORITY_COUNT &&
+           dma_config->fifo_threshold < DMA_FIFO_THRESHOLD_COUNT;
+}
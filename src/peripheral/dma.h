@@ -22,6 +22,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "errc.h"
 
 /**************************************************************************************************
@@ -86,6 +87,9 @@ typedef enum {
     DMA_FIFO_THRESHOLD_COUNT
 } dma_fifo_threshold_t;
 
+/** @brief Largest transfer one stream can do, in peripheral-size items (NDTR is 16 bits). */
+#define DMA_MAX_ITEMS 65535U
+
 // Callback function type for DMA events
 typedef void (*dma_callback_t)(bool success, void *context);
 
@@ -138,6 +142,7 @@ typedef struct {
     size_t size;
     void *context;
     bool disable_mem_inc; // Useful for dummy spi transactions
+    bool circular;        // Restart from the start of the buffers every time they fill
 } dma_transfer_t;
 
 // Used to track rx/tx stream/instance for peripheral instances
@@ -153,13 +158,33 @@ typedef struct {
 **************************************************************************************************/
 /**
  * @brief Initializes the DMA subsystem (enables clocks for all DMA controllers).
- * Should be called once during system boot.
+ * Should be called once during system boot, before any driver configures a stream. Releases
+ * every stream.
+ * @param errc Optional, TI_ERRC_TIMEOUT if a stream never drops EN.
  */
 void* dma_init(enum ti_errc_t *errc);
 
 /**
- * @brief Configures a specific DMA stream to a specific request ID, and enables it.
- * This allocates and sets up the chosen stream based on the provided configuration.
+ * @brief Claims any free stream on a DMA controller.
+ * The stream stays owned until dma_release_stream. dma_configure_stream also claims the stream it
+ * is given, so drivers that are handed fixed streams don't need this.
+ * @param instance The DMA controller to take a stream from.
+ * @param stream Output, the claimed stream.
+ * @return true if a stream was free, false otherwise.
+ */
+bool dma_alloc_stream(dma_instance_t instance, dma_stream_t *stream);
+
+/**
+ * @brief Aborts any transfer on a stream, disconnects it from DMAMUX and frees it for
+ *        dma_alloc_stream or another dma_configure_stream.
+ */
+void dma_release_stream(dma_instance_t instance, dma_stream_t stream);
+
+/**
+ * @brief Configures a specific DMA stream to a specific request ID.
+ * This claims and sets up the chosen stream based on the provided configuration and routes
+ * the request through DMAMUX1. A stream can be reconfigured by the owner of its request ID, but
+ * not taken over by a different request until it is released.
  * @param config Pointer to the configuration structure.
  * @return true if the stream was successfully configured, false otherwise.
  */
@@ -167,19 +192,38 @@ bool dma_configure_stream(const dma_config_t* config);
 
 /**
  * @brief Starts a DMA transfer for the specified stream.
- * This function initiates the transfer based on the previously configured settings.
- * @param instance The DMA instance (DMA1, DMA2, MDMA, BDMA).
- * @param stream The specific stream to start.
- * @param src Pointer to the source data buffer.
- * @param dest Pointer to the destination data buffer.
- * @param size Number of bytes to transfer.
+ * This function initiates the transfer based on the previously configured settings. The
+ * stream's callback runs from its interrupt with @p dma_transfer->context when the transfer
+ * completes or fails. Buffers must be reachable by DMA1/DMA2 (not DTCM). A circular transfer
+ * runs until dma_abort_transfer and its callback runs with success each time it wraps.
+ * @param dma_transfer Stream, buffers and size. size is in bytes and must be a whole number of
+ *        peripheral-size items, at most DMA_MAX_ITEMS of them.
+ * @param errc Optional, TI_ERRC_INVALID_ARG for a bad transfer or a stream that isn't configured,
+ *        TI_ERRC_BUSY while the stream is running, TI_ERRC_TIMEOUT if the stream never drops EN
+ *        from its last transfer.
  * @return bool, whether the transfer was successfully started.
  */
-bool dma_start_transfer( dma_transfer_t *dma_transfer);
+bool dma_start_transfer(dma_transfer_t *dma_transfer, enum ti_errc_t *errc);
+
+/**
+ * @brief Stops a stream's transfer without running its callback. Does nothing if it is idle.
+ * @param errc Optional, TI_ERRC_TIMEOUT if the stream never drops EN. It is released anyway.
+ */
+void dma_abort_transfer(dma_instance_t instance, dma_stream_t stream, enum ti_errc_t *errc);
+
+/**
+ * @brief Reads how many peripheral-size items the stream still has to move (NDTR).
+ */
+uint32_t dma_get_remaining(dma_instance_t instance, dma_stream_t stream);
+
+/**
+ * @brief Checks whether a transfer is in progress on a stream.
+ */
+bool dma_stream_busy(dma_instance_t instance, dma_stream_t stream);
 
 /**
  * @brief Checks the validity of a DMA peripheral config
  * @param config The config to check.
  * @return bool Whether the config is valid.
  */
-inline static bool check_periph_dma_config_validity(periph_dma_config_t *dma_config);
\ No newline at end of file
+bool check_periph_dma_config_validity(const periph_dma_config_t *dma_config);
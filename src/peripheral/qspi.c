@@ -21,13 +21,121 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "../internal/mmio.h"
+#include <string.h>
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "internal/deadline.h"
 #include "errc.h"
 #include "qspi.h"
 
+// Longest any one wait on a QUADSPI flag lasts before the command is abandoned, in microseconds.
+// A full 32-byte FIFO drains in well under 10us at the prescaled clock; the rest is margin.
+#define QSPI_WAIT_TIMEOUT_US 1000U
+
+// Longest a write to the flash's status/configuration registers takes (tW max), in microseconds.
+#define QSPI_WRR_TIMEOUT_US 300000U
+
+// S25FL064L commands and register bits used by the driver itself
+#define QSPI_FLASH_WREN       0x06 // Write enable
+#define QSPI_FLASH_RDSR1      0x05 // Read status register 1
+#define QSPI_FLASH_RDCR1      0x35 // Read configuration register 1
+#define QSPI_FLASH_WRR        0x01 // Write status register 1, then configuration register 1
+#define QSPI_FLASH_FAST_READ  0x0B
+#define QSPI_FLASH_QOR        0x6B // Quad output read
+#define QSPI_FLASH_QIOR       0xEB // Quad I/O read
+#define QSPI_FLASH_PP         0x02 // Page program
+#define QSPI_FLASH_QPP        0x32 // Quad page program
+#define QSPI_FLASH_CR1_QE     0x02 // Quad enable
+#define QSPI_FLASH_PAGE_SIZE  256U
+#define QSPI_ADDRESS_24BIT    2U   // ADSIZE of three address bytes
+
+// Mode bits sent after the address of a quad I/O read. Anything but 0xAx leaves the part out of
+// continuous read mode, so every read carries its instruction.
+#define QSPI_FLASH_QIOR_MODE 0xFF
+
+#define QSPI_FIFO_SIZE 32U
+
+// MDMA channel that feeds or drains the FIFO for qspi_send_cmd_dma. Its flags are C0ISR/C0IFCR.
+#define QSPI_MDMA_CHANNEL   0
+#define QSPI_MDMA_TRIGGER   22U          // MDMA request of the QUADSPI FIFO threshold flag
+#define QSPI_MDMA_BURST     4U           // Bytes per request: FTHRES + 1
+#define QSPI_MDMA_MAX_DATA  65536U       // Most BNDT can count
+#define QSPI_DR_ADDRESS     0x52005020U  // QUADSPI_DR as the MDMA addresses it
+
+// The MDMA reaches the TCMs only through its AHBS port (SBUS/DBUS set); everything else over AXI
+#define QSPI_ITCM_END       0x00010000U
+#define QSPI_DTCM_START     0x20000000U
+#define QSPI_DTCM_END       0x20020000U
+
+static bool qspi_quad = false;
+static bool qspi_mapped = false; // Memory-mapped mode is on, so indirect commands can't run
+
+// Data phase the MDMA is running, finished by quadspi_irq_handler
+static volatile bool qspi_dma_active = false;
+static qspi_callback_t qspi_dma_callback = NULL;
+static void *qspi_dma_context = NULL;
+
+// Spins until @p field of @p reg reads non-zero (@p set) or zero. False if it still doesn't at
+// the deadline. The clock is only read once the condition isn't already met.
+static bool qspi_wait(ro_reg32_t reg, field32_t field, bool set, uint32_t timeout_us) {
+    if ((READ_FIELD(reg, field) != 0) == set) return true;
+    const deadline_t deadline = deadline_in_us(timeout_us);
+    while ((READ_FIELD(reg, field) != 0) != set) {
+        if (deadline_expired(deadline)) return (READ_FIELD(reg, field) != 0) == set;
+    }
+    return true;
+}
+
+// Whether the FIFO holds @p bytes to read, or has room for @p bytes to write
+static bool qspi_fifo_ready(bool is_read, uint32_t bytes) {
+    const uint32_t level = READ_FIELD(QUADSPI_SR, QUADSPI_SR_FLEVEL);
+    return is_read ? level >= bytes : level + bytes <= QSPI_FIFO_SIZE;
+}
+
+// Spins until qspi_fifo_ready, with the same deadline as qspi_wait
+static bool qspi_wait_fifo(bool is_read, uint32_t bytes) {
+    if (qspi_fifo_ready(is_read, bytes)) return true;
+    const deadline_t deadline = deadline_in_us(QSPI_WAIT_TIMEOUT_US);
+    while (!qspi_fifo_ready(is_read, bytes)) {
+        if (deadline_expired(deadline)) return qspi_fifo_ready(is_read, bytes);
+    }
+    return true;
+}
+
+// Abandons whatever command is running and clears its flags, leaving the peripheral idle.
+static void qspi_abort(void) {
+    SET_FIELD(QUADSPI_CR, QUADSPI_CR_ABORT);
+    (void)qspi_wait(QUADSPI_CR, QUADSPI_CR_ABORT, false, QSPI_WAIT_TIMEOUT_US);
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U);
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTEF, 1U);
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CSMF, 1U);
+}
+
+// Waits for the running command to finish: transfer complete, then the bus idle.
+static bool qspi_wait_complete(void) {
+    return qspi_wait(QUADSPI_SR, QUADSPI_SR_TCF, true, QSPI_WAIT_TIMEOUT_US) &&
+           qspi_wait(QUADSPI_SR, QUADSPI_SR_BUSY, false, QSPI_WAIT_TIMEOUT_US);
+}
+
+// Stops the MDMA channel and clears its flags
+static void qspi_mdma_stop(void) {
+    CLR_FIELD(MDMA_MDMA_CxCR[QSPI_MDMA_CHANNEL], MDMA_MDMA_CxCR_EN);
+    WRITE_WO_FIELD(MDMA_MDMA_C0IFCR, MDMA_MDMA_C0IFCR_CTEIF0, 1U);
+    WRITE_WO_FIELD(MDMA_MDMA_C0IFCR, MDMA_MDMA_C0IFCR_CCTCIF0, 1U);
+    WRITE_WO_FIELD(MDMA_MDMA_C0IFCR, MDMA_MDMA_C0IFCR_CBRTIF0, 1U);
+    WRITE_WO_FIELD(MDMA_MDMA_C0IFCR, MDMA_MDMA_C0IFCR_CBTIF0, 1U);
+    WRITE_WO_FIELD(MDMA_MDMA_C0IFCR, MDMA_MDMA_C0IFCR_CLTCIF0, 1U);
+}
+
 void qspi_init() {
-    // Enable RHB3 clock and reset QSPI
+    qspi_quad = false;
+    qspi_mapped = false;
+    qspi_dma_active = false;
+
+    // Enable RHB3 clock and reset QSPI. The MDMA, also on AHB3, runs qspi_send_cmd_dma.
     SET_FIELD(RCC_AHB3ENR, RCC_AHB3ENR_QSPIEN);
+    SET_FIELD(RCC_AHB3ENR, RCC_AHB3ENR_MDMAEN);
+    qspi_mdma_stop();
     SET_FIELD(RCC_AHB3RSTR, RCC_AHB3RSTR_QSPIRST);
     CLR_FIELD(RCC_AHB3RSTR, RCC_AHB3RSTR_QSPIRST);
 
@@ -75,25 +183,36 @@ void qspi_init() {
     CLR_FIELD(QUADSPI_CR, QUADSPI_CR_DFM);             // Duel-flash mode disabled
     CLR_FIELD(QUADSPI_CR, QUADSPI_CR_FSEL);            // FLASH 1 selected
 
-    WRITE_FIELD(QUADSPI_DCR, QUADSPI_DCR_FSIZE, 25U);  // Based on the number of bytes the external chip offers (64MB)
+    WRITE_FIELD(QUADSPI_DCR, QUADSPI_DCR_FSIZE, 22U);  // 2^(FSIZE + 1) bytes: 8MB (64Mbit), the size of the memory-mapped window
     WRITE_FIELD(QUADSPI_DCR, QUADSPI_DCR_CSHT, 3U);     // Defines the minimum number of cycles chip select must remain high
     CLR_FIELD(QUADSPI_DCR, QUADSPI_DCR_CKMODE);         // CLK must stay low when NCS is high
 
     SET_FIELD(QUADSPI_CR, QUADSPI_CR_EN);               // Enable quadspi
 }
 
-static void send_wren_cmd(enum ti_errc_t *errc) {
-    qspi_cmd_t cmd;
-    cmd.instruction = 0x06; // Write enable instruction
-    cmd.instruction_mode = QSPI_MODE_SINGLE;
-    cmd.address_mode = QSPI_MODE_NONE;
-    cmd.address_size = 0;
-    cmd.dummy_cycles = 0;
-    cmd.data_mode = QSPI_MODE_NONE;
-    cmd.data_size = 0;
+// Sets up everything but the address and data of @p cmd in one CCR write, which starts the command
+// (or, with an address, readies it for the AR write). The alternate byte has to be latched first.
+static void qspi_write_ccr(const qspi_cmd_t *cmd, uint32_t fmode) {
+    // One alternate byte (ABSIZE 0)
+    if (cmd->alternate_mode != QSPI_MODE_NONE) {
+        WRITE_FIELD(QUADSPI_ABR, QUADSPI_ABR_REG, cmd->alternate);
+    }
+
+    uint32_t ccr_val = (fmode << 26)                |  // Combine all QUADSPI_CCR fields into one 32-bit value
+                       (cmd->data_mode << 24)       |  // ----------------------------------------------------
+                       (cmd->dummy_cycles << 18)    |  // The command sequence begins as soon as you write to 
+                       (cmd->alternate_mode << 14)  |  // the QUADSPI_CCR register. Therefore, it is important
+                       (cmd->address_size << 12 )   |  // to perform just one write operation.
+                       (cmd->address_mode << 10)    |
+                       (cmd->instruction_mode << 8) |  
+                       (cmd->instruction);
+
+    WRITE_FIELD(QUADSPI_CCR, QUADSPI_CCR_REG, ccr_val);
+}
 
+static void send_wren_cmd(enum ti_errc_t *errc) {
     // Directly write the command without going through qspi_send_cmd to avoid recursion
-    if (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)) {
+    if (qspi_mapped || qspi_dma_active || READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)) {
         *errc = TI_ERRC_BUSY;
         return;
     }
@@ -105,20 +224,23 @@ static void send_wren_cmd(enum ti_errc_t *errc) {
                        (0U << 18)                    |  // No dummy cycles
                        (QSPI_MODE_NONE << 10)        |  // No address phase
                        (QSPI_MODE_SINGLE << 8)       |  // Instruction over single qspi line
-                       0x06;                         // Write enable instruction
+                       QSPI_FLASH_WREN;              // Write enable instruction
 
     WRITE_FIELD(QUADSPI_CCR, QUADSPI_CCR_REG, ccr_val);
 
     // Wait for the busy flag and transfer complete flag
-    while (!READ_FIELD(QUADSPI_SR, QUADSPI_SR_TCF));
-    while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY));
+    if (!qspi_wait_complete()) {
+        qspi_abort();
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "Write enable never completed");
+        return;
+    }
 
     WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U);
     WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTEF, 1U);
 }
 
 void qspi_send_cmd(qspi_cmd_t *cmd, uint8_t *data, bool is_read, enum ti_errc_t *errc) {
-    if (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)) {
+    if (qspi_mapped || qspi_dma_active || READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)) {
         *errc = TI_ERRC_BUSY;
         return;
     }
@@ -134,44 +256,159 @@ void qspi_send_cmd(qspi_cmd_t *cmd, uint8_t *data, bool is_read, enum ti_errc_t
         fmode = 0b01;
     }
 
-    uint32_t ccr_val = (fmode << 26)                |  // Combine all QUADSPI_CCR fields into one 32-bit value
-                       (cmd->data_mode << 24)       |  // ----------------------------------------------------
-                       (cmd->dummy_cycles << 18)    |  // The command sequence begins as soon as you write to 
-                       (cmd->address_size << 12 )   |  // the QUADSPI_CCR register. Therefore, it is important
-                       (cmd->address_mode << 10)    |  // to perform just one write operation.
-                       (cmd->instruction_mode << 8) |  
-                       (cmd->instruction);
-
     // Write to CCR
-    WRITE_FIELD(QUADSPI_CCR, QUADSPI_CCR_REG, ccr_val);
+    qspi_write_ccr(cmd, fmode);
 
     // If necessary, specify the address to be sent to external memory
     if (cmd->address_mode != 0b00) {
         WRITE_FIELD(QUADSPI_AR, QUADSPI_AR_REG, cmd->address);
     }
 
-    // Run main data loop
-    for (uint32_t i = 0; i < cmd->data_size; i++) {
-        if (is_read) {
-            while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_FLEVEL) == 0);
-            
-            data[i] = (uint8_t)READ_FIELD(QUADSPI_DR, QUADSPI_DR_REG); 
+    // Run main data loop: a word per DR access while four bytes are left, a byte per access for
+    // the rest (an access moves as many bytes as it is wide, little-endian). A FIFO that neither
+    // fills nor drains for QSPI_WAIT_TIMEOUT_US ends the command, so the whole call is bounded by
+    // (data_size + 2) waits.
+    uint32_t i = 0;
+    while (i < cmd->data_size) {
+        const uint32_t width = cmd->data_size - i >= 4U ? 4U : 1U;
+        if (!qspi_wait_fifo(is_read, width)) break;
+
+        if (width == 4U) {
+            uint32_t word;
+            if (is_read) {
+                word = *QUADSPI_DR;
+                memcpy(&data[i], &word, 4);
+            } else { // (is_write)
+                memcpy(&word, &data[i], 4);
+                *QUADSPI_DR = word;
+            }
+        } else if (is_read) {
+            data[i] = *QUADSPI_DR8;
         } else { // (is_write)
-            while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_FLEVEL) >= 32);  
-            
-            WRITE_FIELD(QUADSPI_DR, QUADSPI_DR_REG, data[i]);          
+            *QUADSPI_DR8 = data[i];
         }
+        i += width;
     }
 
     // Wait for the busy flag and transfer complete flag
-    while (!READ_FIELD(QUADSPI_SR, QUADSPI_SR_TCF));  
-    while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY));  
+    if (!qspi_wait_complete()) {
+        qspi_abort();
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "QSPI command never completed");
+        return;
+    }
     
     WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U); 
     WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTEF, 1U); 
 }
 
-void qspi_poll_status_blk() {
+void qspi_send_cmd_dma(qspi_cmd_t *cmd, uint8_t *data, bool is_read, qspi_callback_t callback,
+                       void *context, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (data == NULL || cmd->data_mode == QSPI_MODE_NONE || cmd->data_size == 0 ||
+        cmd->data_size > QSPI_MDMA_MAX_DATA) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "DMA needs a data phase of 1 to 65536 bytes");
+        return;
+    }
+    if (qspi_mapped || qspi_dma_active || READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "QSPI busy");
+        return;
+    }
+
+    // The FIFO threshold flag requests a buffer transfer of QSPI_MDMA_BURST bytes (the last one
+    // takes what is left), moved as words when the buffer and length allow and as bytes otherwise.
+    // The memory side increments, the DR side stays put.
+    const uint32_t size = (cmd->data_size % 4U == 0 && (uintptr_t)data % 4U == 0) ? 0b10 : 0b00;
+    const uint32_t tcr = ((is_read ? 0b00 : 0b10) << MDMA_MDMA_CxTCR_SINC.pos) | // Increment by SINCOS
+                         ((is_read ? 0b10 : 0b00) << MDMA_MDMA_CxTCR_DINC.pos) |
+                         (size << MDMA_MDMA_CxTCR_SSIZE.pos)                   |
+                         (size << MDMA_MDMA_CxTCR_DSIZE.pos)                   |
+                         (size << MDMA_MDMA_CxTCR_SINCOS.pos)                  |
+                         (size << MDMA_MDMA_CxTCR_DINCOS.pos)                  |
+                         ((QSPI_MDMA_BURST - 1U) << MDMA_MDMA_CxTCR_TLEN.pos)  |
+                         (0b00 << MDMA_MDMA_CxTCR_TRGM.pos);                    // A buffer per request
+
+    qspi_mdma_stop();
+    *MDMA_MDMA_CxTCR[QSPI_MDMA_CHANNEL] = tcr;
+    *MDMA_MDMA_CxBNDTR[QSPI_MDMA_CHANNEL] = cmd->data_size;
+    *MDMA_MDMA_CxSAR[QSPI_MDMA_CHANNEL] = is_read ? QSPI_DR_ADDRESS : (uint32_t)(uintptr_t)data;
+    *MDMA_MDMA_CxDAR[QSPI_MDMA_CHANNEL] = is_read ? (uint32_t)(uintptr_t)data : QSPI_DR_ADDRESS;
+    // Stacks, the arena and the DTCM heap are in DTCM, which the MDMA only reaches over AHBS. DR is
+    // on AXI either way.
+    const uint32_t memory = (uint32_t)(uintptr_t)data;
+    const bool tcm = memory < QSPI_ITCM_END || (memory >= QSPI_DTCM_START && memory < QSPI_DTCM_END);
+    const field32_t memory_bus = is_read ? MDMA_MDMA_CxTBR_DBUS : MDMA_MDMA_CxTBR_SBUS;
+    *MDMA_MDMA_CxTBR[QSPI_MDMA_CHANNEL] = QSPI_MDMA_TRIGGER | (tcm ? memory_bus.msk : 0U);
+    WRITE_FIELD(MDMA_MDMA_CxCR[QSPI_MDMA_CHANNEL], MDMA_MDMA_CxCR_PL, 0b11);
+    SET_FIELD(MDMA_MDMA_CxCR[QSPI_MDMA_CHANNEL], MDMA_MDMA_CxCR_TEIE); // See mdma_irq_handler
+    SET_FIELD(MDMA_MDMA_CxCR[QSPI_MDMA_CHANNEL], MDMA_MDMA_CxCR_EN);
+
+    // Set before the command starts, as it can finish before the next line runs
+    qspi_dma_callback = callback;
+    qspi_dma_context = context;
+    qspi_dma_active = true;
+
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U);
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTEF, 1U);
+    SET_FIELD(QUADSPI_CR, QUADSPI_CR_DMAEN);
+    SET_FIELD(QUADSPI_CR, QUADSPI_CR_TCIE);
+    SET_FIELD(QUADSPI_CR, QUADSPI_CR_TEIE);
+    *NVIC_ISERx[QUADSPI_IRQ_NUM / 32] = 1U << (QUADSPI_IRQ_NUM % 32);
+    *NVIC_ISERx[MDMA_IRQ_NUM / 32] = 1U << (MDMA_IRQ_NUM % 32);
+
+    WRITE_FIELD(QUADSPI_DLR, QUADSPI_DLR_DL, cmd->data_size - 1);
+    qspi_write_ccr(cmd, is_read ? 0b01 : 0b00);
+    if (cmd->address_mode != QSPI_MODE_NONE) {
+        WRITE_FIELD(QUADSPI_AR, QUADSPI_AR_REG, cmd->address);
+    }
+}
+
+bool qspi_dma_pending(void) {
+    return qspi_dma_active;
+}
+
+// Ends the qspi_send_cmd_dma command, aborting it unless it went through, and reports it
+static void qspi_dma_finish(bool success) {
+    if (!success) qspi_abort();
+
+    CLR_FIELD(QUADSPI_CR, QUADSPI_CR_TCIE);
+    CLR_FIELD(QUADSPI_CR, QUADSPI_CR_TEIE);
+    CLR_FIELD(QUADSPI_CR, QUADSPI_CR_DMAEN);
+    qspi_mdma_stop();
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U);
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTEF, 1U);
+
+    qspi_dma_active = false;
+    if (qspi_dma_callback) qspi_dma_callback(success, qspi_dma_context);
+}
+
+// Finishes the data phase qspi_send_cmd_dma started
+void quadspi_irq_handler(void) {
+    if (!qspi_dma_active) return;
+    const bool error = READ_FIELD(QUADSPI_SR, QUADSPI_SR_TEF) ||
+                       READ_FIELD(MDMA_MDMA_C0ISR, MDMA_MDMA_C0ISR_TEIF0);
+    if (!error && !READ_FIELD(QUADSPI_SR, QUADSPI_SR_TCF)) return;
+
+    // TCF comes with the last byte on the wire; BUSY drops once the MDMA has also drained what a
+    // read left in the FIFO
+    const bool idle = !error && qspi_wait(QUADSPI_SR, QUADSPI_SR_BUSY, false, QSPI_WAIT_TIMEOUT_US);
+    qspi_dma_finish(idle);
+}
+
+// Only the QSPI channel's transfer error is enabled. A channel stopped by an error never feeds or
+// drains the FIFO again, so the QUADSPI would wait for it without ever raising TCF.
+void mdma_irq_handler(void) {
+    if (!READ_FIELD(MDMA_MDMA_C0ISR, MDMA_MDMA_C0ISR_TEIF0)) return;
+    if (qspi_dma_active) qspi_dma_finish(false);
+    else qspi_mdma_stop();
+}
+
+void qspi_poll_status_blk(uint32_t timeout_us, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (qspi_mapped || qspi_dma_active) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, qspi_mapped ? "Memory mapped mode is on" : "DMA command running");
+        return;
+    }
+
     // Stop automatic polling mode after a match
     SET_FIELD(QUADSPI_CR, QUADSPI_CR_APMS);
 
@@ -179,9 +416,10 @@ void qspi_poll_status_blk() {
     WRITE_FIELD(QUADSPI_PSMAR, QUADSPI_PSMAR_REG, 0x00); 
     WRITE_FIELD(QUADSPI_PSMKR, QUADSPI_PSMKR_REG, 0x01); 
     WRITE_FIELD(QUADSPI_PIR, QUADSPI_PIR_INTERVAL, 32U); 
+    WRITE_FIELD(QUADSPI_DLR, QUADSPI_DLR_DL, 0U);       // One status byte per poll
 
     uint32_t ccr_val = (0b10 << 26)             | // Set FMODE to 0b10 for automatic polling mode
-                       (QSPI_MODE_QUAD << 24)   | // Data uses all four qspi lines                
+                       (QSPI_MODE_SINGLE << 24) | // Status comes back on IO1 outside QPI mode     
                        (0U << 18)               | // No dummy bytes
                        (QSPI_MODE_NONE << 10)   | // No address phase
                        (QSPI_MODE_SINGLE << 8)  | // Instruction over single qspi line
@@ -191,38 +429,229 @@ void qspi_poll_status_blk() {
     WRITE_FIELD(QUADSPI_CCR, QUADSPI_CCR_REG, ccr_val); 
 
     // Wait for the hardware match-flag (keeps polling until flag is raised)
-    while (!READ_FIELD(QUADSPI_SR, QUADSPI_SR_SMF));
+    if (!qspi_wait(QUADSPI_SR, QUADSPI_SR_SMF, true, timeout_us)) {
+        qspi_abort();
+        CLR_FIELD(QUADSPI_CR, QUADSPI_CR_APMS);
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "Flash still busy at the deadline");
+        return;
+    }
 
     WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CSMF, 1U); 
     
-    while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)); 
+    if (!qspi_wait(QUADSPI_SR, QUADSPI_SR_BUSY, false, QSPI_WAIT_TIMEOUT_US)) {
+        qspi_abort();
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "QSPI stayed busy after the status match");
+    }
     
     CLR_FIELD(QUADSPI_CR, QUADSPI_CR_APMS);
 }
 
-void qspi_enter_memory_mapped(qspi_cmd_t *cmd) {
-    (void)cmd;
+// Reads or writes one of the flash's registers: a single line instruction and data, no address.
+static void qspi_register_cmd(uint8_t instruction, uint8_t *data, uint32_t length, bool is_read,
+                              enum ti_errc_t *errc) {
+    qspi_cmd_t cmd = {
+        .instruction = instruction,
+        .instruction_mode = QSPI_MODE_SINGLE,
+        .address_mode = QSPI_MODE_NONE,
+        .alternate_mode = QSPI_MODE_NONE,
+        .data_mode = QSPI_MODE_SINGLE,
+        .data_size = length
+    };
+    qspi_send_cmd(&cmd, data, is_read, errc);
+}
+
+void qspi_enable_quad(enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    enum ti_errc_t err;
+
+    // WRR writes SR1 and CR1 together, so SR1 is read back to keep its protection bits
+    uint8_t regs[2];
+    qspi_register_cmd(QSPI_FLASH_RDSR1, &regs[0], 1, true, &err);
+    if (err == TI_ERRC_NONE) qspi_register_cmd(QSPI_FLASH_RDCR1, &regs[1], 1, true, &err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Failed to read flash configuration");
+        return;
+    }
+
+    if (!(regs[1] & QSPI_FLASH_CR1_QE)) {
+        regs[0] &= (uint8_t)~0x03U; // WIP and WEL are status, not settings
+        regs[1] |= QSPI_FLASH_CR1_QE;
+        send_wren_cmd(&err);
+        if (err == TI_ERRC_NONE) qspi_register_cmd(QSPI_FLASH_WRR, regs, 2, false, &err);
+        if (err == TI_ERRC_NONE) qspi_poll_status_blk(QSPI_WRR_TIMEOUT_US, &err);
+        if (err == TI_ERRC_NONE) qspi_register_cmd(QSPI_FLASH_RDCR1, &regs[1], 1, true, &err);
+        if (err != TI_ERRC_NONE) {
+            TI_SET_ERRC(errc, err, "Failed to write flash configuration");
+            return;
+        }
+        if (!(regs[1] & QSPI_FLASH_CR1_QE)) {
+            TI_SET_ERRC(errc, TI_ERRC_DEVICE, "Quad enable bit did not stick");
+            return;
+        }
+    }
+    qspi_quad = true;
+}
+
+bool qspi_quad_enabled(void) {
+    return qspi_quad;
+}
+
+// The read command for @p mode, which indirect reads and memory-mapped mode both use
+static qspi_cmd_t qspi_read_cmd(uint32_t address, uint32_t length, qspi_read_mode_t mode) {
+    qspi_cmd_t cmd = {
+        .instruction = QSPI_FLASH_FAST_READ,
+        .instruction_mode = QSPI_MODE_SINGLE,
+        .address = address,
+        .address_mode = QSPI_MODE_SINGLE,
+        .address_size = QSPI_ADDRESS_24BIT,
+        .alternate_mode = QSPI_MODE_NONE,
+        .dummy_cycles = 8,
+        .data_mode = QSPI_MODE_SINGLE,
+        .data_size = length
+    };
+    if (mode == QSPI_READ_QUAD_OUTPUT) {
+        cmd.instruction = QSPI_FLASH_QOR;
+        cmd.data_mode = QSPI_MODE_QUAD;
+    } else if (mode == QSPI_READ_QUAD_IO) {
+        // Address and mode byte on four lines too, which leaves 4 dummy cycles at the default latency
+        cmd.instruction = QSPI_FLASH_QIOR;
+        cmd.address_mode = QSPI_MODE_QUAD;
+        cmd.alternate_mode = QSPI_MODE_QUAD;
+        cmd.alternate = QSPI_FLASH_QIOR_MODE;
+        cmd.dummy_cycles = 4;
+        cmd.data_mode = QSPI_MODE_QUAD;
+    }
+    return cmd;
+}
+
+void qspi_read(uint32_t address, uint8_t *data, uint32_t length, qspi_read_mode_t mode,
+               enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (data == NULL || length == 0) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Nothing to read");
+        return;
+    }
+    if (mode != QSPI_READ_SINGLE && !qspi_quad) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Quad read before quad enable");
+        return;
+    }
+
+    qspi_cmd_t cmd = qspi_read_cmd(address, length, mode);
+    enum ti_errc_t err;
+    qspi_send_cmd(&cmd, data, true, &err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Flash read failed");
+}
+
+// Checks a page program and sends its write enable. On success @p cmd is the program command.
+static bool qspi_program_begin(uint32_t address, const uint8_t *data, uint32_t length, qspi_cmd_t *cmd,
+                               enum ti_errc_t *errc) {
+    if (data == NULL || length == 0 || address % QSPI_FLASH_PAGE_SIZE + length > QSPI_FLASH_PAGE_SIZE) {
+        // The part wraps within the page rather than crossing it
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Program must stay within one page");
+        return false;
+    }
+
+    enum ti_errc_t err;
+    send_wren_cmd(&err);
+    if (err != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, err, "Write enable failed");
+        return false;
+    }
+
+    *cmd = (qspi_cmd_t){
+        .instruction = qspi_quad ? QSPI_FLASH_QPP : QSPI_FLASH_PP,
+        .instruction_mode = QSPI_MODE_SINGLE,
+        .address = address,
+        .address_mode = QSPI_MODE_SINGLE,
+        .address_size = QSPI_ADDRESS_24BIT,
+        .alternate_mode = QSPI_MODE_NONE,
+        .dummy_cycles = 0,
+        .data_mode = qspi_quad ? QSPI_MODE_QUAD : QSPI_MODE_SINGLE,
+        .data_size = length
+    };
+    return true;
+}
+
+void qspi_program(uint32_t address, const uint8_t *data, uint32_t length, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    qspi_cmd_t cmd;
+    if (!qspi_program_begin(address, data, length, &cmd, errc)) return;
+
+    enum ti_errc_t err;
+    qspi_send_cmd(&cmd, (uint8_t *)data, false, &err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Page program failed");
+}
+
+void qspi_program_dma(uint32_t address, const uint8_t *data, uint32_t length, qspi_callback_t callback,
+                      void *context, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    qspi_cmd_t cmd;
+    if (!qspi_program_begin(address, data, length, &cmd, errc)) return;
+
+    enum ti_errc_t err;
+    qspi_send_cmd_dma(&cmd, (uint8_t *)data, false, callback, context, &err);
+    if (err != TI_ERRC_NONE) TI_SET_ERRC(errc, err, "Page program failed");
+}
+
+const uint8_t *qspi_enter_memory_mapped(qspi_read_mode_t mode, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (mode != QSPI_READ_SINGLE && !qspi_quad) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Quad read before quad enable");
+        return NULL;
+    }
+
+    if (qspi_dma_active) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "DMA command running");
+        return NULL;
+    }
+
+    // Switching modes takes an abort first: CCR can't be written while memory-mapped mode is busy
+    enum ti_errc_t err;
+    if (qspi_mapped) {
+        qspi_exit_memory_mapped(&err);
+        if (err != TI_ERRC_NONE) {
+            TI_SET_ERRC(errc, err, "Failed to leave memory mapped mode");
+            return NULL;
+        }
+    }
+
     // Ensure the QSPI is not busy
-    while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY));
-
-    // Configure the CCR for Memory Mapped Mode
-    uint32_t ccr_val =
-        (0b11 << 26)               | // FMODE: 0b11 = Memory Mapped
-        (QSPI_MODE_SINGLE << 24)   | // DMODE: Data on 1 line
-        (8 << 18)                  | // DCYC: 8 dummy cycles (required for 0x0B)
-        (QSPI_MODE_SINGLE << 12)   | // ADSIZE: 24-bit address (0b10)
-        (QSPI_MODE_SINGLE << 10)   | // ADMODE: Address on 1 line
-        (QSPI_MODE_SINGLE << 8)    | // IMODE: Instruction on 1 line
-        0x0B;                      // Instruction: Fast Read
+    if (!qspi_wait(QUADSPI_SR, QUADSPI_SR_BUSY, false, QSPI_WAIT_TIMEOUT_US)) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "QSPI busy");
+        return NULL;
+    }
 
-    WRITE_FIELD(QUADSPI_CCR, QUADSPI_CCR_REG, ccr_val);
+    // The same command an indirect read in this mode sends; the peripheral fills in the address
+    // of each access and reads on until the bus is wanted elsewhere
+    const qspi_cmd_t cmd = qspi_read_cmd(0, 0, mode);
+    qspi_write_ccr(&cmd, 0b11); // FMODE: 0b11 = Memory Mapped
+
+    // CCR ignores writes while the peripheral is busy, which would leave the mapping reading
+    // with whatever command was there before
+    if (READ_FIELD(QUADSPI_CCR, QUADSPI_CCR_FMODE) != 0b11) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "Memory mapped mode did not take");
+        return NULL;
+    }
+    qspi_mapped = true;
+    return (const uint8_t *)QSPI_MAPPED_BASE;
 }
 
-void qspi_exit_memory_mapped() {
+void qspi_exit_memory_mapped(enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
     // Abort any ongoing memory-mapped access
     SET_FIELD(QUADSPI_CR, QUADSPI_CR_ABORT);
 
     // Wait for busy and abort flags
-    while (READ_FIELD(QUADSPI_CR, QUADSPI_CR_ABORT)); 
-    while (READ_FIELD(QUADSPI_SR, QUADSPI_SR_BUSY)); 
-}
\ No newline at end of file
+    if (!qspi_wait(QUADSPI_CR, QUADSPI_CR_ABORT, false, QSPI_WAIT_TIMEOUT_US) ||
+        !qspi_wait(QUADSPI_SR, QUADSPI_SR_BUSY, false, QSPI_WAIT_TIMEOUT_US)) {
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "QSPI abort never completed");
+        return;
+    }
+
+    WRITE_WO_FIELD(QUADSPI_FCR, QUADSPI_FCR_CTCF, 1U); // The abort sets it
+    qspi_mapped = false;
+}
+
+bool qspi_memory_mapped(void) {
+    return qspi_mapped;
+}
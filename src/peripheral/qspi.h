@@ -21,11 +21,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include "../internal/mmio.h"
+#include "internal/mmio.h"
 #include "errc.h"
 
 #pragma once
 
+/**
+ * @brief Where the flash appears in the memory map while memory-mapped mode is on.
+ */
+#define QSPI_MAPPED_BASE 0x90000000U
+
 /**************************************************************************************************
  * @section Type definitions
  **************************************************************************************************/
@@ -49,11 +54,31 @@ typedef struct {
     uint32_t address;
     qspi_mode_t address_mode;
     uint8_t address_size;
+    qspi_mode_t alternate_mode; // One alternate byte (the mode bits of a quad I/O read), or QSPI_MODE_NONE
+    uint8_t alternate;
     uint8_t dummy_cycles;
     qspi_mode_t data_mode;
     uint32_t data_size;
 } qspi_cmd_t;
 
+/**
+ * @brief How qspi_read moves data. The quad modes need qspi_enable_quad first.
+ */
+typedef enum {
+    QSPI_READ_SINGLE,      /**< Fast read (0x0B), everything on one line */
+    QSPI_READ_QUAD_OUTPUT, /**< Quad output read (0x6B), data on four lines */
+    QSPI_READ_QUAD_IO      /**< Quad I/O read (0xEB), address and data on four lines */
+} qspi_read_mode_t;
+
+/**
+ * @brief Called from the QUADSPI interrupt when a qspi_send_cmd_dma data phase ends.
+ *
+ * @param success false if the command or the MDMA failed (reported by the QUADSPI or the MDMA
+ * interrupt); the command was aborted.
+ * @param context the pointer given to qspi_send_cmd_dma.
+ */
+typedef void (*qspi_callback_t)(bool success, void *context);
+
 /**************************************************************************************************
  * @section Function Definitions
  **************************************************************************************************/
@@ -77,29 +102,123 @@ void qspi_init();
  * expecting if you're reading. 
  * @param is_read specifies whether you want to read or write. If you want to read, set
  * is_read to true.
- * @param errc pointer to an error code, TI_ERRC_NONE if no error occurs. 
+ * @param errc pointer to an error code, TI_ERRC_NONE if no error occurs. TI_ERRC_TIMEOUT if the
+ * FIFO or the transfer complete flag stalls for QSPI_WAIT_TIMEOUT_US (1ms); the command is aborted.
  */
 void qspi_send_cmd(qspi_cmd_t *cmd, uint8_t *data, bool is_read, enum ti_errc_t *errc);
 
+/**
+ * @brief Starts a command whose data phase the MDMA (channel 0, on the FIFO threshold request)
+ * moves, and returns without waiting for it: the CPU only sets up the registers. The QUADSPI
+ * interrupt finishes the command and calls @p callback, or the MDMA interrupt on a transfer error,
+ * so qspi.c defines both handlers. Until then every other command is refused
+ * with TI_ERRC_BUSY, and @p data must stay put. Worth it for page programs and longer reads;
+ * a few bytes are quicker through qspi_send_cmd.
+ *
+ * @param data buffer the MDMA reads or fills, moved a word at a time when it is word aligned and
+ * the length a multiple of four. May be anywhere in RAM: buffers in the TCMs (stacks, the arena,
+ * the DTCM heap) go over the MDMA's AHBS port, the rest over AXI. The D-cache isn't on, so nothing
+ * needs cleaning.
+ * @param callback may be NULL, then poll qspi_dma_pending.
+ * @param errc pointer to an error code, TI_ERRC_BUSY if a command is running or memory-mapped
+ * mode is on, TI_ERRC_INVALID_ARG for a command without a data phase of 1 to 65536 bytes.
+ */
+void qspi_send_cmd_dma(qspi_cmd_t *cmd, uint8_t *data, bool is_read, qspi_callback_t callback,
+                       void *context, enum ti_errc_t *errc);
+
+/**
+ * @brief Whether a qspi_send_cmd_dma command has yet to finish.
+ */
+bool qspi_dma_pending(void);
+
 /**
  * @brief status polling mode ensures that the flash memory chip is not busy.
  * This function should be used in junction with qspi_command(). If qspi_command is
  * being called repeatedly, qspi_poll_status_blk() should be called in between each command.
+ *
+ * @param timeout_us longest the flash may stay busy, which depends on the operation that was
+ * started (a page program is ~1ms, a sector erase hundreds of ms).
+ * @param errc pointer to an error code, TI_ERRC_TIMEOUT if the flash is still busy at the deadline.
  */
-void qspi_poll_status_blk();
+void qspi_poll_status_blk(uint32_t timeout_us, enum ti_errc_t *errc);
 
 /**
  * @brief entering memory mapped mode enables the CPU to treat flash memory as if it were
- * internal. If memory mapped mode is enabled, you CANNOT use the qspi_command() funciton. If you
- * wish to do so, exit memory mapped mode first.
+ * internal: the whole flash reads through the returned pointer with plain loads, the peripheral
+ * sending a read in @p mode for whatever isn't already prefetched. Suits scanning and copying out
+ * large stretches of flash. Indirect commands (qspi_send_cmd, qspi_read, qspi_program,
+ * qspi_poll_status_blk) are refused with TI_ERRC_BUSY until qspi_exit_memory_mapped, and a page
+ * program or erase must have finished before entering. Calling it again changes the mode.
  *
- * @param cmd pointer to the qspi_cmd_t structure
+ * @param mode read command used; the quad modes need qspi_enable_quad first.
+ * @param errc pointer to an error code, TI_ERRC_BUSY if a command is still running,
+ * TI_ERRC_INVALID_ARG for a quad mode before qspi_enable_quad.
+ * @return QSPI_MAPPED_BASE as a pointer to flash address 0, NULL on error.
  */
-void qspi_enter_memory_mapped(qspi_cmd_t *cmd);
+const uint8_t *qspi_enter_memory_mapped(qspi_read_mode_t mode, enum ti_errc_t *errc);
 
 /**
  * @brief exiting memory mapped mode will disallow the CPU from using flash memory
  * as if it were internal memory. However, it enables the user to use qspi in indirect mode --
  * giving them the ability to read and write to external memory through qspi_command().
+ * Pointers into the mapping must not be read after this.
+ *
+ * @param errc pointer to an error code, TI_ERRC_TIMEOUT if the abort never completes.
+ */
+void qspi_exit_memory_mapped(enum ti_errc_t *errc);
+
+/**
+ * @brief Whether memory-mapped mode is on.
+ */
+bool qspi_memory_mapped(void);
+
+/**
+ * @brief Sets the quad enable bit in the flash's configuration register 1 if it isn't already,
+ * which the quad reads and quad page program need. The bit is non-volatile, so on every boot
+ * after the first this is two register reads.
+ *
+ * @param errc pointer to an error code, TI_ERRC_DEVICE if the bit doesn't read back set,
+ * TI_ERRC_TIMEOUT if the register write never finishes.
+ */
+void qspi_enable_quad(enum ti_errc_t *errc);
+
+/**
+ * @brief Whether qspi_enable_quad has succeeded since qspi_init.
+ */
+bool qspi_quad_enabled(void);
+
+/**
+ * @brief Reads flash memory in indirect mode.
+ *
+ * @param address 24-bit flash address of the first byte.
+ * @param data where the bytes go.
+ * @param length bytes to read, 1 to 65536.
+ * @param mode lines the read uses. Quad I/O moves the most data per clock and suits long
+ * reads; the command overhead of every mode is under a microsecond.
+ * @param errc pointer to an error code, TI_ERRC_INVALID_ARG for a quad mode before
+ * qspi_enable_quad or a bad length, otherwise as qspi_send_cmd.
+ */
+void qspi_read(uint32_t address, uint8_t *data, uint32_t length, qspi_read_mode_t mode,
+               enum ti_errc_t *errc);
+
+/**
+ * @brief Starts a page program behind a write enable, with the data on four lines (0x32) once
+ * qspi_enable_quad has succeeded and on one (0x02) before. Doesn't wait for the program to
+ * finish; use qspi_poll_status_blk before the next command that needs the flash idle.
+ *
+ * @param address 24-bit flash address of the first byte.
+ * @param length bytes to program, 1 to 256, all within the page @p address is in.
+ * @param errc pointer to an error code, TI_ERRC_INVALID_ARG for a length of 0 or one crossing
+ * a page boundary, otherwise as qspi_send_cmd.
+ */
+void qspi_program(uint32_t address, const uint8_t *data, uint32_t length, enum ti_errc_t *errc);
+
+/**
+ * @brief qspi_program with the data phase on the MDMA (see qspi_send_cmd_dma): only the write
+ * enable is waited for. @p callback runs once the page is on the wire, after which the part is
+ * still busy programming it, so use qspi_poll_status_blk as after qspi_program.
+ *
+ * @param errc pointer to an error code, as qspi_program and qspi_send_cmd_dma.
  */
-void qspi_exit_memory_mapped();
\ No newline at end of file
+void qspi_program_dma(uint32_t address, const uint8_t *data, uint32_t length, qspi_callback_t callback,
+                      void *context, enum ti_errc_t *errc);
@@ -20,10 +20,16 @@
  */
 
 #include "peripheral/spi.h"
+#include "internal/deadline.h"
 #include "internal/mmio.h"
+#include "internal/interrupt.h"
 #include "peripheral/gpio.h"
 #include "peripheral/errc.h"
+#include "peripheral/dma.h"
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #define INST1_SCK 44
 #define INST1_MISO 45
@@ -60,6 +66,199 @@ enum inst {
     INST_SIX
 };
 
+// Stores dmamux request numbers. Index 0 is for RX stream, 1 for TX stream. SPI6 is only
+// reachable from BDMA through DMAMUX2, so it has no entry.
+static const uint8_t spi_dmamux_req[7][2] = {
+    [INST_ONE]   = {37, 38},
+    [INST_TWO]   = {39, 40},
+    [INST_THREE] = {61, 62},
+    [INST_FOUR]  = {83, 84},
+    [INST_FIVE]  = {85, 86},
+};
+
+// Halves of an async transfer that must both finish before the callback runs. The RX stream can
+// still be draining the FIFO when EOT fires, so neither event alone means dst is complete.
+#define SPI_ASYNC_EOT     0x1U
+#define SPI_ASYNC_RX_DONE 0x2U
+
+// State of the asynchronous transfer on one SPI instance
+typedef struct {
+    uint8_t inst;
+    uint8_t ss_pin;
+    bool dma_ready;
+    volatile bool busy;
+    volatile uint32_t pending; // SPI_ASYNC_* events still outstanding
+    spi_callback_t callback;
+    void* ctx;
+    dma_periph_streaminfo_t dma;
+    dma_config_t tx_config;    // kept so the item size can follow the frame width
+    dma_config_t rx_config;
+    uint8_t dma_frame_bytes;   // frame width the streams are configured for
+    uint16_t len;              // bytes in the transfer, for the statistics
+    uint32_t started;          // spi_stats_now when SS went low
+} spi_async_t;
+
+static spi_async_t spi_async[7];
+
+// Clocked out when the caller passes no src, and the sink for frames nobody wants. Words so a
+// 16 or 32-bit stream reading or writing them without incrementing stays in bounds.
+static const uint32_t spi_dummy_tx = 0xFFFFFFFFU;
+static uint32_t spi_dummy_rx;
+
+// Register-level form of a profile
+typedef struct {
+    uint8_t mbr;
+    uint8_t dsize;
+    uint8_t mode;
+} spi_bus_setting_t;
+
+// Profiles and the configuration currently programmed into one SPI instance
+typedef struct {
+    spi_bus_setting_t init;    // what spi_init programmed; used by SS pins without a profile
+    spi_bus_setting_t applied; // what the registers hold now
+    uint8_t count;
+    uint8_t ss_pins[SPI_MAX_PROFILES];
+    spi_bus_setting_t settings[SPI_MAX_PROFILES];
+    bool packed;               // blocking transfers use packed FIFO accesses
+    bool streaming;            // an endless packed transfer is running with SPE set
+} spi_bus_t;
+
+static spi_bus_t spi_bus[7];
+
+// Bytes one frame takes in memory and in TXDR/RXDR accesses
+static inline uint8_t spi_frame_bytes(uint8_t dsize) {
+    return dsize < 8 ? 1 : (dsize < 16 ? 2 : 4);
+}
+
+// Smallest prescaler keeping SCK at or under max_clock_hz. False if even /256 is too fast.
+static bool spi_encode_profile(const spi_profile_t* profile, spi_bus_setting_t* setting) {
+    if (profile->mode > MODE_3 || profile->word_bits < 4 || profile->word_bits > 32) return false;
+    for (uint8_t mbr = 0; mbr < 8; ++mbr) {
+        if ((SPI_KERNEL_CLOCK_HZ >> (mbr + 1)) <= profile->max_clock_hz) {
+            *setting = (spi_bus_setting_t){ .mbr = mbr, .dsize = profile->word_bits - 1, .mode = profile->mode };
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool spi_setting_equal(const spi_bus_setting_t* a, const spi_bus_setting_t* b) {
+    return a->mbr == b->mbr && a->dsize == b->dsize && a->mode == b->mode;
+}
+
+// Settings ss_pin's transfers run at: its profile, or the spi_init configuration
+static const spi_bus_setting_t* spi_find_setting(uint8_t inst, uint8_t ss_pin) {
+    const spi_bus_t* bus = &spi_bus[inst];
+    for (uint8_t i = 0; i < bus->count; ++i) {
+        if (bus->ss_pins[i] == ss_pin) return &bus->settings[i];
+    }
+    return &bus->init;
+}
+
+// Programs the profile of ss_pin if the instance isn't already running it. SPE must be clear.
+static void spi_select_profile(uint8_t inst, uint8_t ss_pin) {
+    spi_bus_t* bus = &spi_bus[inst];
+    const spi_bus_setting_t* want = spi_find_setting(inst, ss_pin);
+    if (spi_setting_equal(want, &bus->applied)) return;
+
+    if (want->mbr != bus->applied.mbr) WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_MBR, want->mbr);
+    if (want->dsize != bus->applied.dsize) WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_DSIZE, want->dsize);
+    if (want->mode != bus->applied.mode) {
+        WRITE_FIELD(SPIx_CFG2[inst], SPIx_CFG2_CPOL, (want->mode >> 1) & 1U);
+        WRITE_FIELD(SPIx_CFG2[inst], SPIx_CFG2_CPHA, want->mode & 1U);
+    }
+    bus->applied = *want;
+}
+
+// Spins until @p flag reads set in SR. False if it is still clear SPI_WAIT_TIMEOUT_US later. The
+// clock is only read once the flag isn't already up, so a ready FIFO costs nothing extra.
+static bool spi_wait_sr(uint8_t inst, field32_t flag) {
+    if (READ_FIELD(SPIx_SR[inst], flag)) return true;
+    const deadline_t deadline = deadline_in_us(SPI_WAIT_TIMEOUT_US);
+    while (!READ_FIELD(SPIx_SR[inst], flag)) {
+        if (deadline_expired(deadline)) return READ_FIELD(SPIx_SR[inst], flag) != 0;
+    }
+    return true;
+}
+
+// Ends the endless transfer packed mode leaves running and disables the instance. The FIFO is
+// empty between calls, so the suspend request completes after the frame on the wire, if any.
+static void spi_stream_stop(uint8_t inst) {
+    spi_bus_t* bus = &spi_bus[inst];
+    if (!bus->streaming) return;
+    SET_FIELD(SPIx_CR1[inst], SPIx_CR1_CSUSP);
+    (void)spi_wait_sr(inst, SPIx_SR_SUSP); // clearing SPE below ends the transfer regardless
+    *SPIx_IFCR[inst] = SPIx_IFCR_SUSPC.msk;
+    CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+    WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_FTHVL, 0);
+    bus->streaming = false;
+}
+
+// Abandons a polled transfer the peripheral stopped answering. Clearing SPE stops the clock and
+// flushes both FIFOs; the next transfer sets the instance up again.
+static void spi_poll_abort(uint8_t inst, uint8_t ss_pin) {
+    CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+    *SPIx_IFCR[inst] = SPIx_IFCR_EOTC.msk | SPIx_IFCR_TXTFC.msk | SPIx_IFCR_SUSPC.msk;
+    WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_FTHVL, 0);
+    spi_bus[inst].streaming = false;
+    tal_set_pin(ss_pin, 1);
+}
+
+#if SPI_STATS_ENABLED
+// Statistics of every chip select seen so far. A slot's key (inst << 8 | ss_pin, never 0 since
+// instances start at 1) is claimed once and kept, so slots fill in order and each is only ever
+// updated by transfers on its own instance, which never overlap.
+static uint16_t spi_stats_keys[SPI_STATS_MAX_DEVICES];
+static spi_dev_stats_t spi_stats[SPI_STATS_MAX_DEVICES];
+
+// Slot of a chip select, claiming a free one if it has none. -1 if the table is full.
+static int32_t spi_stats_slot(uint8_t inst, uint8_t ss_pin, bool claim) {
+    const uint16_t key = (uint16_t)((inst << 8) | ss_pin);
+    for (int32_t i = 0; i < SPI_STATS_MAX_DEVICES; i++) {
+        uint16_t k = __atomic_load_n(&spi_stats_keys[i], __ATOMIC_ACQUIRE);
+        if (k == 0) {
+            if (!claim) return -1;
+            if (__atomic_compare_exchange_n(&spi_stats_keys[i], &k, key, false, __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                return i;
+            }
+        }
+        if (k == key) return i;
+    }
+    return -1;
+}
+
+static inline uint8_t spi_stats_bin(uint32_t cycles) {
+    if (cycles < (1U << SPI_STATS_HIST_MIN_LOG2)) return 0;
+    const uint32_t bin = (uint32_t)(31 - __builtin_clz(cycles)) - (SPI_STATS_HIST_MIN_LOG2 - 1);
+    return bin < SPI_STATS_HIST_BINS ? (uint8_t)bin : SPI_STATS_HIST_BINS - 1;
+}
+
+static void spi_stats_copy(int32_t slot, spi_dev_stats_t* out) {
+    *out = spi_stats[slot];
+    out->inst = (uint8_t)(spi_stats_keys[slot] >> 8);
+    out->ss_pin = (uint8_t)spi_stats_keys[slot];
+}
+#endif
+
+// Counts one transfer that started (SS low) at spi_stats_now() == started and has just ended
+static void spi_stats_record(uint8_t inst, uint8_t ss_pin, uint32_t bytes, uint32_t started, bool success) {
+#if SPI_STATS_ENABLED
+    const uint32_t cycles = spi_stats_now() - started;
+    const int32_t slot = spi_stats_slot(inst, ss_pin, true);
+    if (slot < 0) return;
+    spi_dev_stats_t* st = &spi_stats[slot];
+    st->transactions++;
+    if (success) st->bytes += bytes;
+    else st->errors++;
+    st->busy_cycles += cycles;
+    if (cycles > st->max_cycles) st->max_cycles = cycles;
+    st->hist[spi_stats_bin(cycles)]++;
+#else
+    (void)inst; (void)ss_pin; (void)bytes; (void)started; (void)success;
+#endif
+}
+
 // Enables the clock of all SS pins
 static inline void enable_ss_clocks(uint8_t* ss_list, uint8_t slave_count) {
     for (int i = 0; i < slave_count; i++) {
@@ -247,7 +446,12 @@ void spi_init(uint8_t inst, uint8_t mode, uint8_t* ss_list, uint8_t slave_count,
 
     // High speed clock enable
     SET_FIELD(RCC_CR, RCC_CR_HSION);
-    while(!READ_FIELD(RCC_CR, RCC_CR_HSIRDY));
+    const deadline_t hsi_ready = deadline_in_us(SPI_WAIT_TIMEOUT_US);
+    while (!READ_FIELD(RCC_CR, RCC_CR_HSIRDY)) {
+        if (deadline_expired(hsi_ready) && !READ_FIELD(RCC_CR, RCC_CR_HSIRDY)) {
+            TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "HSI oscillator never became ready"); return;
+        }
+    }
 
     // Set clock source
     if (inst < 4) {
@@ -286,15 +490,15 @@ void spi_init(uint8_t inst, uint8_t mode, uint8_t* ss_list, uint8_t slave_count,
 
     // Ensure SPI hardware is disabled before config
     CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
-    while(READ_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE));
     // Clear mode selection field
     CLR_FIELD(SPIx_CGFR[inst], SPIx_CGFR_I2SMOD);
     // Set threshold level
     WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_FTHVL, 0x00);
-    // Set baudrate prescaler ( 64MHz /8  = 8MHz) 
+    // Set baudrate prescaler (64MHz / 256 = 250kHz), safe for any device. Faster devices get
+    // their own clock through spi_set_profile.
     WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_MBR, 0b111); 
     // Set data size
-    WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_DSIZE, 0b00111); // TODO: Ensure that this is lower than the slowest device's baudrate
+    WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_DSIZE, 0b00111);
     
     // Set clock polarities
     switch (mode) {
@@ -324,43 +528,616 @@ void spi_init(uint8_t inst, uint8_t mode, uint8_t* ss_list, uint8_t slave_count,
     // Set SPI as master
     SET_FIELD(SPIx_CFG2[inst], SPIx_CFG2_MASTER);
 
+    // Devices without a profile run at this configuration; profiles already set are kept
+    spi_bus[inst].init = (spi_bus_setting_t){ .mbr = 0b111, .dsize = 0b00111, .mode = mode };
+    spi_bus[inst].applied = spi_bus[inst].init;
+    spi_bus[inst].streaming = false;
 }
 
-void spi_transfer_sync (uint8_t inst, uint8_t ss_pin, void* src, void* dst, uint8_t size, enum ti_errc_t *errc) {
+void spi_set_profile(uint8_t inst, uint8_t ss_pin, const spi_profile_t *profile, enum ti_errc_t *errc) {
     if (errc) *errc = TI_ERRC_NONE;
-    if (size == 0) {
-        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size cannot be zero"); 
-        return; 
+    if (inst > 6 || inst < 1) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error"); return;
+    }
+    spi_bus_setting_t setting;
+    if (profile && !spi_encode_profile(profile, &setting)) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI profile out of range"); return;
+    }
+
+    spi_bus_t* bus = &spi_bus[inst];
+    uint8_t i = 0;
+    while (i < bus->count && bus->ss_pins[i] != ss_pin) i++;
+    if (!profile) {
+        if (i == bus->count) return;
+        bus->count--;
+        bus->ss_pins[i] = bus->ss_pins[bus->count];
+        bus->settings[i] = bus->settings[bus->count];
+        return;
+    }
+    if (i == bus->count) {
+        if (bus->count == SPI_MAX_PROFILES) {
+            TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Too many SPI profiles on instance"); return;
+        }
+        bus->ss_pins[i] = ss_pin;
+        bus->count++;
+    }
+    bus->settings[i] = setting;
+}
+
+void spi_set_packed(uint8_t inst, bool enable, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst > 6 || inst < 1) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error"); return;
+    }
+    if (spi_async[inst].busy) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "Async SPI transfer in progress"); return;
+    }
+    if (!enable) spi_stream_stop(inst);
+    spi_bus[inst].packed = enable;
+}
+
+// TXDR/RXDR must be accessed at the frame width so each access moves exactly one frame
+static inline void spi_write_frame(uint8_t inst, const uint8_t* p, uint8_t width) {
+    if (width == 1) {
+        *(volatile uint8_t *)SPIx_TXDR[inst] = p[0];
+    } else if (width == 2) {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        *(volatile uint16_t *)SPIx_TXDR[inst] = v;
+    } else {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        *SPIx_TXDR[inst] = v;
+    }
+}
+
+static inline void spi_read_frame(uint8_t inst, uint8_t* p, uint8_t width) {
+    if (width == 1) {
+        p[0] = *(volatile uint8_t *)SPIx_RXDR[inst];
+    } else if (width == 2) {
+        const uint16_t v = *(volatile uint16_t *)SPIx_RXDR[inst];
+        memcpy(p, &v, sizeof(v));
+    } else {
+        const uint32_t v = *SPIx_RXDR[inst];
+        memcpy(p, &v, sizeof(v));
+    }
+}
+
+// Packed mode moves this many 8-bit frames per TXDR/RXDR access; FTHVL is set to match
+#define SPI_PACKET_BYTES 4U
+
+// Data FIFO depth in bytes: 16 on SPI1-3, 8 on SPI4-6
+static inline uint32_t spi_fifo_bytes(uint8_t inst) {
+    return inst <= INST_THREE ? 16U : 8U;
+}
+
+// Position in an iov list. Packed accesses can straddle two pieces.
+typedef struct {
+    const spi_iov_t* iov;
+    uint8_t piece;
+    uint16_t off;
+} spi_cursor_t;
+
+// Takes the next n bytes to send. Pieces without a tx buffer send the fill byte.
+static inline void spi_cursor_take(spi_cursor_t* c, uint8_t* out, uint32_t n, uint8_t fill) {
+    while (n) {
+        const spi_iov_t* v = &c->iov[c->piece];
+        uint32_t chunk = (uint32_t)v->len - c->off;
+        if (chunk > n) chunk = n;
+        if (v->tx) memcpy(out, (const uint8_t*)v->tx + c->off, chunk);
+        else memset(out, fill, chunk);
+        out += chunk;
+        n -= chunk;
+        c->off += chunk;
+        if (c->off == v->len) { c->piece++; c->off = 0; }
+    }
+}
+
+// Stores the next n received bytes. Pieces without an rx buffer drop them.
+static inline void spi_cursor_put(spi_cursor_t* c, const uint8_t* in, uint32_t n) {
+    while (n) {
+        const spi_iov_t* v = &c->iov[c->piece];
+        uint32_t chunk = (uint32_t)v->len - c->off;
+        if (chunk > n) chunk = n;
+        if (v->rx) memcpy((uint8_t*)v->rx + c->off, in, chunk);
+        in += chunk;
+        n -= chunk;
+        c->off += chunk;
+        if (c->off == v->len) { c->piece++; c->off = 0; }
+    }
+}
+
+// Packed transfer of 8-bit frames on a running endless transfer. TX is kept ahead of RX by up to
+// a FIFO's worth of bytes so the clock doesn't stop between frames, but never further, since
+// the master keeps clocking while TXDR has data and would overrun a full RX FIFO. Whole packets
+// move with one 32-bit access; the last 1-3 bytes go one at a time. False if nothing moves for
+// SPI_WAIT_TIMEOUT_US; the clock is only read on passes that made no progress.
+static bool spi_packed_exchange(uint8_t inst, const spi_iov_t* iov, uint32_t total, uint8_t fill) {
+    const uint32_t depth = spi_fifo_bytes(inst);
+    spi_cursor_t txc = { .iov = iov };
+    spi_cursor_t rxc = { .iov = iov };
+    uint32_t tx_left = total;
+    uint32_t rx_left = total;
+    uint8_t buf[SPI_PACKET_BYTES];
+    deadline_t stall = { 0 };
+    bool stalled = false;
+
+    while (rx_left) {
+        const uint32_t sr = *SPIx_SR[inst];
+        const uint32_t in_flight = rx_left - tx_left;
+        const uint32_t left = tx_left + rx_left;
+        if (tx_left && (sr & SPIx_SR_TXP.msk)) {
+            if (tx_left >= SPI_PACKET_BYTES && in_flight + SPI_PACKET_BYTES <= depth) {
+                uint32_t word;
+                spi_cursor_take(&txc, buf, SPI_PACKET_BYTES, fill);
+                memcpy(&word, buf, sizeof(word));
+                *SPIx_TXDR[inst] = word;
+                tx_left -= SPI_PACKET_BYTES;
+            } else if (tx_left < SPI_PACKET_BYTES && in_flight < depth) {
+                spi_cursor_take(&txc, buf, 1, fill);
+                *(volatile uint8_t *)SPIx_TXDR[inst] = buf[0];
+                tx_left--;
+            }
+        }
+        // RXP means a whole packet is waiting; under that, RXPLVL counts the frames that are
+        if (sr & SPIx_SR_RXP.msk) {
+            const uint32_t word = *SPIx_RXDR[inst];
+            memcpy(buf, &word, sizeof(word));
+            spi_cursor_put(&rxc, buf, SPI_PACKET_BYTES);
+            rx_left -= SPI_PACKET_BYTES;
+        } else if (rx_left < SPI_PACKET_BYTES && (sr & SPIx_SR_RXPLVL.msk)) {
+            buf[0] = *(volatile uint8_t *)SPIx_RXDR[inst];
+            spi_cursor_put(&rxc, buf, 1);
+            rx_left--;
+        }
+        if (tx_left + rx_left != left) {
+            stalled = false;
+        } else if (!stalled) {
+            stall = deadline_in_us(SPI_WAIT_TIMEOUT_US);
+            stalled = true;
+        } else if (deadline_expired(stall)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Polled transfer of every piece in iov under one SS assertion. One frame is in flight at a time
+// unless the instance is in packed mode and the frames are 8 bits.
+static void spi_poll_transfer(uint8_t inst, uint8_t ss_pin, const spi_iov_t* iov, uint8_t iov_count,
+                              uint8_t fill, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < INST_ONE || inst > INST_SIX) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error");
+        return;
+    }
+    if (iov == NULL || iov_count == 0) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "No transfer buffers");
+        return;
+    }
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < iov_count; i++) total += iov[i].len;
+    if (total == 0 || total > 0xFFFFU) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size must be 1-65535 bytes");
+        return;
+    }
+    if (spi_async[inst].busy) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "Async SPI transfer in progress");
+        return;
     }
 
+    spi_bus_t* bus = &spi_bus[inst];
+    const spi_bus_setting_t* want = spi_find_setting(inst, ss_pin);
+    if (bus->packed && want->dsize < 8) {
+        // The profile can only change with SPE clear, so only a different one ends the stream
+        if (!bus->streaming || !spi_setting_equal(want, &bus->applied)) {
+            spi_stream_stop(inst);
+            CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+            spi_select_profile(inst, ss_pin);
+            WRITE_FIELD(SPIx_CFG1[inst], SPIx_CFG1_FTHVL, SPI_PACKET_BYTES - 1);
+            WRITE_FIELD(SPIx_CR2[inst], SPIx_CR2_TSIZE, 0);
+            SET_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+            // With TSIZE = 0 the master only clocks while TXDR has data, so it can start now
+            SET_FIELD(SPIx_CR1[inst], SPIx_CR1_CSTART);
+            bus->streaming = true;
+        }
+        const uint32_t started = SPI_STATS_ENABLED ? spi_stats_now() : 0;
+        tal_set_pin(ss_pin, 0);
+        if (!spi_packed_exchange(inst, iov, total, fill)) {
+            spi_poll_abort(inst, ss_pin);
+            spi_stats_record(inst, ss_pin, total, started, false);
+            TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "SPI transfer stalled");
+            return;
+        }
+        tal_set_pin(ss_pin, 1);
+        spi_stats_record(inst, ss_pin, total, started, true);
+        return;
+    }
+
+    spi_stream_stop(inst);
     CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
-    WRITE_FIELD(SPIx_CR2[inst], SPIx_CR2_TSIZE, size);
+    spi_select_profile(inst, ss_pin);
+    const uint8_t width = spi_frame_bytes(spi_bus[inst].applied.dsize);
+    for (uint8_t i = 0; i < iov_count; i++) {
+        if (iov[i].len % width) {
+            TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size not a whole number of frames");
+            return;
+        }
+    }
+    const uint8_t fill_frame[4] = { fill, fill, fill, fill };
+    uint8_t drop_frame[4];
+
+    WRITE_FIELD(SPIx_CR2[inst], SPIx_CR2_TSIZE, total / width);
     SET_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
 
-    while(!READ_FIELD(SPIx_SR[inst], SPIx_SR_TXP));
+    if (!spi_wait_sr(inst, SPIx_SR_TXP)) {
+        CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "SPI TX FIFO never ready");
+        return;
+    }
 
     // Pull SS pin low
+    const uint32_t stats_started = SPI_STATS_ENABLED ? spi_stats_now() : 0;
     tal_set_pin(ss_pin, 0);
 
-    for (int i = 0; i < size; i++) {
-        while (!READ_FIELD(SPIx_SR[inst], SPIx_SR_TXP));
-        *(volatile uint8_t *)SPIx_TXDR[inst] = ((uint8_t *)src)[i];
+    bool started = false;
+    bool ok = true;
+    for (uint8_t i = 0; ok && i < iov_count; i++) {
+        const uint8_t* tx = iov[i].tx;
+        uint8_t* rx = iov[i].rx;
+        for (uint32_t off = 0; off < iov[i].len; off += width) {
+            if (!spi_wait_sr(inst, SPIx_SR_TXP)) { ok = false; break; }
+            spi_write_frame(inst, tx ? tx + off : fill_frame, width);
 
-        // Start transfer
-        if (i == 0) {
-            SET_FIELD(SPIx_CR1[inst], SPIx_CR1_CSTART);
-        }
-
-        while (!READ_FIELD(SPIx_SR[inst], SPIx_SR_RXP));
+            // Start transfer
+            if (!started) {
+                SET_FIELD(SPIx_CR1[inst], SPIx_CR1_CSTART);
+                started = true;
+            }
 
-        ((uint8_t *)dst)[i] = *(volatile uint8_t *)SPIx_RXDR[inst];
+            if (!spi_wait_sr(inst, SPIx_SR_RXP)) { ok = false; break; }
+            spi_read_frame(inst, rx ? rx + off : drop_frame, width);
+        }
     }
 
     // Wait for end of tranfer
-    while (!READ_FIELD(SPIx_SR[inst], SPIx_SR_EOT));
-    SET_WO_FIELD(SPIx_IFCR[inst], SPIx_IFCR_EOTC);
-    SET_WO_FIELD(SPIx_IFCR[inst], SPIx_IFCR_TXTFC);
+    if (!ok || !spi_wait_sr(inst, SPIx_SR_EOT)) {
+        spi_poll_abort(inst, ss_pin);
+        spi_stats_record(inst, ss_pin, total, stats_started, false);
+        TI_SET_ERRC(errc, TI_ERRC_TIMEOUT, "SPI transfer stalled");
+        return;
+    }
+    *SPIx_IFCR[inst] = SPIx_IFCR_EOTC.msk | SPIx_IFCR_TXTFC.msk;
 
     // Pull SS pin high to end transfer
     tal_set_pin(ss_pin, 1);
-}
\ No newline at end of file
+    spi_stats_record(inst, ss_pin, total, stats_started, true);
+}
+
+void spi_transfer_sync (uint8_t inst, uint8_t ss_pin, void* src, void* dst, uint8_t size, enum ti_errc_t *errc) {
+    const spi_iov_t iov = { .tx = src, .rx = dst, .len = size };
+    spi_poll_transfer(inst, ss_pin, &iov, 1, 0xFF, errc);
+}
+
+void spi_write(uint8_t inst, uint8_t ss_pin, const void* src, uint16_t len, enum ti_errc_t *errc) {
+    if (src == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "NULL source buffer");
+        return;
+    }
+    const spi_iov_t iov = { .tx = src, .rx = NULL, .len = len };
+    spi_poll_transfer(inst, ss_pin, &iov, 1, 0xFF, errc);
+}
+
+void spi_read(uint8_t inst, uint8_t ss_pin, void* dst, uint16_t len, uint8_t fill, enum ti_errc_t *errc) {
+    if (dst == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "NULL destination buffer");
+        return;
+    }
+    const spi_iov_t iov = { .tx = NULL, .rx = dst, .len = len };
+    spi_poll_transfer(inst, ss_pin, &iov, 1, fill, errc);
+}
+
+void spi_transfer_iov(uint8_t inst, uint8_t ss_pin, const spi_iov_t* iov, uint8_t iov_count, uint8_t fill,
+                      enum ti_errc_t *errc) {
+    spi_poll_transfer(inst, ss_pin, iov, iov_count, fill, errc);
+}
+
+/**************************************************************************************************
+ * @section Asynchronous (DMA) Transfers
+ **************************************************************************************************/
+
+// Tears down the transfer and reports it. Safe to reach from both the SPI and DMA interrupts;
+// only the first caller does anything.
+static void spi_async_finish(spi_async_t* s, bool success) {
+    if (!__atomic_exchange_n(&s->busy, false, __ATOMIC_ACQ_REL)) return;
+    const uint8_t inst = s->inst;
+
+    CLR_FIELD(SPIx_IER[inst], SPIx_IER_EOTIE);
+    CLR_FIELD(SPIx_IER[inst], SPIx_IER_OVRIE);
+    CLR_FIELD(SPIx_IER[inst], SPIx_IER_UDRIE);
+    CLR_FIELD(SPIx_IER[inst], SPIx_IER_MODFIE);
+    CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+    CLR_FIELD(SPIx_CFG1[inst], SPIx_CFG1_TXDMAEN);
+    CLR_FIELD(SPIx_CFG1[inst], SPIx_CFG1_RXDMAEN);
+    if (!success) {
+        // the streams are left waiting for requests that will never come
+        dma_abort_transfer(s->dma.tx_instance, s->dma.tx_stream, NULL);
+        dma_abort_transfer(s->dma.rx_instance, s->dma.rx_stream, NULL);
+    }
+
+    // Pull SS pin high to end transfer
+    tal_set_pin(s->ss_pin, 1);
+    spi_stats_record(inst, s->ss_pin, s->len, s->started, success);
+
+    if (s->callback) s->callback(success, s->ctx);
+}
+
+// Marks one half of the transfer done and finishes it once both are
+static void spi_async_event(spi_async_t* s, uint32_t event) {
+    if (__atomic_and_fetch(&s->pending, ~event, __ATOMIC_ACQ_REL) == 0) {
+        spi_async_finish(s, true);
+    }
+}
+
+static void spi_dma_rx_callback(bool success, void* context) {
+    spi_async_t* s = context;
+    if (!success) {
+        spi_async_finish(s, false);
+        return;
+    }
+    spi_async_event(s, SPI_ASYNC_RX_DONE);
+}
+
+// TX completion only means TXDR has been fed; EOT tells us the bytes are on the wire
+static void spi_dma_tx_callback(bool success, void* context) {
+    if (!success) spi_async_finish(context, false);
+}
+
+static void spi_irq(uint8_t inst) {
+    spi_async_t* s = &spi_async[inst];
+    const uint32_t sr = *SPIx_SR[inst];
+
+    // IFCR is write-one-to-clear, so each group of flags goes in a single store
+    if (sr & (SPIx_SR_OVR.msk | SPIx_SR_UDR.msk | SPIx_SR_MODF.msk)) {
+        *SPIx_IFCR[inst] = SPIx_IFCR_OVRC.msk | SPIx_IFCR_UDRC.msk | SPIx_IFCR_MODFC.msk;
+        spi_async_finish(s, false);
+        return;
+    }
+    if (sr & SPIx_SR_EOT.msk) {
+        *SPIx_IFCR[inst] = SPIx_IFCR_EOTC.msk | SPIx_IFCR_TXTFC.msk;
+        spi_async_event(s, SPI_ASYNC_EOT);
+    }
+}
+
+void spi1_irq_handler(void) { spi_irq(INST_ONE); }
+void spi2_irq_handler(void) { spi_irq(INST_TWO); }
+void spi3_irq_handler(void) { spi_irq(INST_THREE); }
+void spi4_irq_handler(void) { spi_irq(INST_FOUR); }
+void spi5_irq_handler(void) { spi_irq(INST_FIVE); }
+
+void spi_dma_init(uint8_t inst, periph_dma_config_t *tx_stream, periph_dma_config_t *rx_stream, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < INST_ONE || inst > INST_FIVE) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance has no DMAMUX1 request"); return;
+    }
+    if (!tx_stream || !rx_stream) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Missing DMA stream config"); return;
+    }
+    if (tx_stream->instance == rx_stream->instance && tx_stream->stream == rx_stream->stream) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "TX and RX need separate DMA streams"); return;
+    }
+    if (spi_async[inst].busy) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "Async SPI transfer in progress"); return;
+    }
+
+    dma_config_t dma_tx_stream = {
+        .instance = tx_stream->instance,
+        .stream = tx_stream->stream,
+        .request_id = spi_dmamux_req[inst][1],
+        .direction = MEM_TO_PERIPH,
+        .src_data_size = DMA_DATA_SIZE_BYTE,
+        .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = tx_stream->priority,
+        .fifo_enabled = tx_stream->fifo_enabled,
+        .fifo_threshold = tx_stream->fifo_threshold,
+        .callback = spi_dma_tx_callback,
+    };
+    dma_config_t dma_rx_stream = {
+        .instance = rx_stream->instance,
+        .stream = rx_stream->stream,
+        .request_id = spi_dmamux_req[inst][0],
+        .direction = PERIPH_TO_MEM,
+        .src_data_size = DMA_DATA_SIZE_BYTE,
+        .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = rx_stream->priority,
+        .fifo_enabled = false, // RX must land byte by byte, a half-full FIFO would hold back the tail
+        .fifo_threshold = rx_stream->fifo_threshold,
+        .callback = spi_dma_rx_callback,
+    };
+    if (!dma_configure_stream(&dma_tx_stream) || !dma_configure_stream(&dma_rx_stream)) {
+        TI_SET_ERRC(errc, TI_ERRC_BUS, "DMA stream configuration failed"); return;
+    }
+
+    // Save stream info
+    spi_async[inst] = (spi_async_t){
+        .inst = inst,
+        .dma_ready = true,
+        .dma = {
+            .rx_instance = rx_stream->instance,
+            .tx_instance = tx_stream->instance,
+            .rx_stream = rx_stream->stream,
+            .tx_stream = tx_stream->stream,
+        },
+        .tx_config = dma_tx_stream,
+        .rx_config = dma_rx_stream,
+        .dma_frame_bytes = 1,
+    };
+
+    // Completion and error flags are reported through the SPI interrupt
+    const int32_t irq = SPIx_IRQ_NUM[inst];
+    *NVIC_ISERx[irq / 32] = 1U << (irq % 32);
+}
+
+void spi_transfer_async(uint8_t inst, uint8_t ss_pin, const void* src, void* dst, uint16_t len,
+                        spi_callback_t callback, void* ctx, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < INST_ONE || inst > INST_SIX) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error"); return;
+    }
+    spi_async_t* s = &spi_async[inst];
+    if (!s->dma_ready) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "spi_dma_init not called for instance"); return;
+    }
+    if (len == 0) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size cannot be zero"); return;
+    }
+    bool idle = false;
+    if (!__atomic_compare_exchange_n(&s->busy, &idle, true, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "Async SPI transfer in progress"); return;
+    }
+    s->ss_pin = ss_pin;
+    s->callback = callback;
+    s->ctx = ctx;
+    s->pending = SPI_ASYNC_EOT | SPI_ASYNC_RX_DONE;
+
+    // TSIZE and the profile can only be written while the peripheral is disabled
+    spi_stream_stop(inst);
+    CLR_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+    spi_select_profile(inst, ss_pin);
+    const uint8_t width = spi_frame_bytes(spi_bus[inst].applied.dsize);
+    if (len % width) {
+        s->busy = false;
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size not a whole number of frames"); return;
+    }
+    // Each DMA request moves one frame, so the streams' item size follows the frame width
+    if (s->dma_frame_bytes != width) {
+        const dma_data_size_t item = width == 1 ? DMA_DATA_SIZE_BYTE :
+                                     (width == 2 ? DMA_DATA_SIZE_HALFWORD : DMA_DATA_SIZE_WORD);
+        s->tx_config.src_data_size = s->tx_config.dest_data_size = item;
+        s->rx_config.src_data_size = s->rx_config.dest_data_size = item;
+        if (!dma_configure_stream(&s->tx_config) || !dma_configure_stream(&s->rx_config)) {
+            s->dma_frame_bytes = 0; // unknown, redo next time
+            s->busy = false;
+            TI_SET_ERRC(errc, TI_ERRC_BUS, "DMA stream configuration failed"); return;
+        }
+        s->dma_frame_bytes = width;
+    }
+    WRITE_FIELD(SPIx_CR2[inst], SPIx_CR2_TSIZE, len / width);
+
+    // RM0399 order: RX requests on, both streams armed, TX requests on, then enable the peripheral
+    SET_FIELD(SPIx_CFG1[inst], SPIx_CFG1_RXDMAEN);
+    dma_transfer_t rx_transfer = {
+        .instance = s->dma.rx_instance,
+        .stream = s->dma.rx_stream,
+        .src = (const void *)SPIx_RXDR[inst],
+        .dest = dst ? dst : &spi_dummy_rx,
+        .size = len,
+        .context = s,
+        .disable_mem_inc = (dst == NULL),
+    };
+    dma_transfer_t tx_transfer = {
+        .instance = s->dma.tx_instance,
+        .stream = s->dma.tx_stream,
+        .src = src ? src : &spi_dummy_tx,
+        .dest = (void *)SPIx_TXDR[inst],
+        .size = len,
+        .context = s,
+        .disable_mem_inc = (src == NULL),
+    };
+    if (!dma_start_transfer(&rx_transfer, NULL) || !dma_start_transfer(&tx_transfer, NULL)) {
+        dma_abort_transfer(s->dma.rx_instance, s->dma.rx_stream, NULL);
+        CLR_FIELD(SPIx_CFG1[inst], SPIx_CFG1_RXDMAEN);
+        s->busy = false;
+        TI_SET_ERRC(errc, TI_ERRC_BUS, "DMA transfer failed to start"); return;
+    }
+    SET_FIELD(SPIx_CFG1[inst], SPIx_CFG1_TXDMAEN);
+
+    *SPIx_IFCR[inst] = SPIx_IFCR_EOTC.msk | SPIx_IFCR_TXTFC.msk | SPIx_IFCR_OVRC.msk |
+                       SPIx_IFCR_UDRC.msk | SPIx_IFCR_MODFC.msk;
+    SET_FIELD(SPIx_IER[inst], SPIx_IER_EOTIE);
+    SET_FIELD(SPIx_IER[inst], SPIx_IER_OVRIE);
+    SET_FIELD(SPIx_IER[inst], SPIx_IER_UDRIE);
+    SET_FIELD(SPIx_IER[inst], SPIx_IER_MODFIE);
+    SET_FIELD(SPIx_CR1[inst], SPIx_CR1_SPE);
+
+    // Pull SS pin low, then start clocking
+    s->len = len;
+    s->started = SPI_STATS_ENABLED ? spi_stats_now() : 0;
+    tal_set_pin(ss_pin, 0);
+    SET_FIELD(SPIx_CR1[inst], SPIx_CR1_CSTART);
+}
+
+bool spi_async_busy(uint8_t inst) {
+    if (inst < INST_ONE || inst > INST_SIX) return false;
+    return spi_async[inst].busy;
+}
+
+/**************************************************************************************************
+ * @section Statistics
+ **************************************************************************************************/
+
+uint32_t spi_stats_now(void) {
+    return (uint32_t)deadline_ticks();
+}
+
+uint8_t spi_get_stats(spi_dev_stats_t *out, uint8_t max) {
+    uint8_t n = 0;
+#if SPI_STATS_ENABLED
+    if (out == NULL) return 0;
+    while (n < max && n < SPI_STATS_MAX_DEVICES &&
+           __atomic_load_n(&spi_stats_keys[n], __ATOMIC_ACQUIRE) != 0) {
+        spi_stats_copy(n, &out[n]);
+        n++;
+    }
+#else
+    (void)out; (void)max;
+#endif
+    return n;
+}
+
+void spi_get_device_stats(uint8_t inst, uint8_t ss_pin, spi_dev_stats_t *out, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < INST_ONE || inst > INST_SIX || out == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid SPI statistics request"); return;
+    }
+#if SPI_STATS_ENABLED
+    const int32_t slot = spi_stats_slot(inst, ss_pin, false);
+    if (slot >= 0) {
+        spi_stats_copy(slot, out);
+        return;
+    }
+#else
+    (void)ss_pin;
+#endif
+    TI_SET_ERRC(errc, TI_ERRC_NOT_FOUND, "No SPI transfers recorded for device");
+}
+
+void spi_get_bus_stats(uint8_t inst, spi_dev_stats_t *out, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < INST_ONE || inst > INST_SIX || out == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid SPI statistics request"); return;
+    }
+    memset(out, 0, sizeof(*out));
+    out->inst = inst;
+    out->ss_pin = 0xFF;
+#if SPI_STATS_ENABLED
+    for (int32_t i = 0; i < SPI_STATS_MAX_DEVICES; i++) {
+        const uint16_t key = __atomic_load_n(&spi_stats_keys[i], __ATOMIC_ACQUIRE);
+        if (key == 0) break;
+        if ((key >> 8) != inst) continue;
+        const spi_dev_stats_t* st = &spi_stats[i];
+        out->transactions += st->transactions;
+        out->errors += st->errors;
+        out->bytes += st->bytes;
+        out->busy_cycles += st->busy_cycles;
+        if (st->max_cycles > out->max_cycles) out->max_cycles = st->max_cycles;
+        for (uint32_t b = 0; b < SPI_STATS_HIST_BINS; b++) out->hist[b] += st->hist[b];
+    }
+#endif
+}
+
+void spi_clear_stats(void) {
+#if SPI_STATS_ENABLED
+    memset(spi_stats, 0, sizeof(spi_stats));
+#endif
+}
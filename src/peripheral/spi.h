@@ -21,8 +21,10 @@
 
 
 #pragma once
+#include <stdbool.h>
 #include <stdint.h>
 #include "peripheral/errc.h"
+#include "peripheral/dma.h"
 
 enum spi_mode {
     MODE_0,
@@ -31,6 +33,81 @@ enum spi_mode {
     MODE_3
 };
 
+/** @brief Kernel clock of every SPI instance (per_ck/HSI, selected in spi_init). */
+#define SPI_KERNEL_CLOCK_HZ 64000000U
+
+/** @brief Slowest SCK the baud rate prescaler can produce (kernel clock / 256). */
+#define SPI_MIN_CLOCK_HZ (SPI_KERNEL_CLOCK_HZ / 256U)
+
+/** @brief Most chip selects per instance that can have their own profile. */
+#define SPI_MAX_PROFILES 12
+
+// Per chip select transfer statistics (spi_get_stats). 0 compiles the bookkeeping and its tables
+// out; the getters then report no devices.
+#ifndef SPI_STATS_ENABLED
+#define SPI_STATS_ENABLED 1
+#endif
+
+/** @brief Chip selects, across all instances, that get their own statistics. */
+#define SPI_STATS_MAX_DEVICES 16
+
+/** @brief Latency histogram bins. Bin 0 counts transfers under 2^SPI_STATS_HIST_MIN_LOG2 cycles,
+ *         bin i [2^(SPI_STATS_HIST_MIN_LOG2 + i - 1), 2^(SPI_STATS_HIST_MIN_LOG2 + i)) and the last
+ *         bin everything longer. At 480MHz that is under 2.1us, then doubling up to 8.7ms and over. */
+#define SPI_STATS_HIST_BINS 14
+#define SPI_STATS_HIST_MIN_LOG2 10
+
+/** @brief Longest a blocking transfer waits on any one status flag before giving up, in
+ *         microseconds. A FIFO's worth of 32-bit frames at the slowest clock (250kHz) is ~0.5ms. */
+#define SPI_WAIT_TIMEOUT_US 2000U
+
+/**
+ * @brief How one device wants the bus driven. Applied by the SPI layer whenever a transfer
+ *        selects a different device than the last one.
+ */
+typedef struct {
+    uint32_t max_clock_hz; /** @brief Fastest SCK the device accepts; rounded down to a prescaler step. */
+    uint8_t mode;          /** @brief SPI mode (MODE_0 - MODE_3). */
+    uint8_t word_bits;     /** @brief Frame size in bits (4-32). Frames over 8 bits move as 16/32-bit words. */
+} spi_profile_t;
+
+/** @brief A device on an SPI bus: the instance it hangs off and its chip select. */
+typedef struct {
+    uint8_t inst;
+    uint8_t ss_pin;
+} spi_device_t;
+
+/** @brief One piece of a spi_transfer_iov transfer. */
+typedef struct {
+    const void *tx; /** @brief Bytes to send, or NULL to send the fill byte. */
+    void *rx;       /** @brief Where received bytes go, or NULL to drop them. */
+    uint16_t len;   /** @brief Bytes in this piece. */
+} spi_iov_t;
+
+/**
+ * @brief Transfer statistics of one chip select, from the first transfer or the last
+ *        spi_clear_stats. A transfer lasts from SS going low until it is released (for async
+ *        transfers, until the completion callback is about to run).
+ */
+typedef struct {
+    uint8_t inst;                        /** @brief SPI instance. */
+    uint8_t ss_pin;                      /** @brief Chip select; 0xFF in spi_get_bus_stats totals. */
+    uint32_t transactions;               /** @brief Transfers completed or failed. */
+    uint32_t errors;                     /** @brief Async transfers that ended in an error. */
+    uint32_t bytes;                      /** @brief Bytes moved by transfers that completed. */
+    uint64_t busy_cycles;                /** @brief Total time SS was asserted, in cycles. */
+    uint32_t max_cycles;                 /** @brief Longest single transfer, in cycles. */
+    uint32_t hist[SPI_STATS_HIST_BINS];  /** @brief log2 latency histogram (see SPI_STATS_HIST_BINS). */
+} spi_dev_stats_t;
+
+/**
+ * @brief Completion callback for spi_transfer_async. Runs in interrupt context once the whole
+ *        transfer has been clocked out and the received bytes are in memory.
+ * @param success False if the SPI peripheral or either DMA stream reported an error.
+ * @param ctx The context pointer passed to spi_transfer_async.
+ */
+typedef void (*spi_callback_t)(bool success, void *ctx);
+
 /**************************************************************************************************
  * @section Function Definitions
  **************************************************************************************************/
@@ -52,6 +129,43 @@ enum spi_mode {
  */
 void spi_init(uint8_t inst, uint8_t mode, uint8_t* ss_list, uint8_t slave_count, enum ti_errc_t *errc);
 
+/**
+ * @brief Give a chip select its own clock, mode and frame size.
+ *
+ * Nothing is written to the peripheral here. Each transfer looks up the profile of the chip
+ * select it drives and reprograms the instance only if that differs from what was last applied,
+ * so back-to-back transfers to the same device (or to devices sharing a profile) cost nothing.
+ * Chip selects without a profile get the configuration spi_init set up.
+ *
+ * @param inst  SPI instance.
+ * @param ss_pin  The device's SS pin.
+ * @param profile  Profile to use, or NULL to go back to the spi_init configuration. Must stay
+ *                 valid while registered.
+ *
+ * @param errc Pointer to error status output. TI_ERRC_INVALID_ARG for a profile the peripheral
+ *             can't run (clock under SPI_MIN_CLOCK_HZ, bad mode or frame size), TI_ERRC_OVERFLOW
+ *             if the instance already has SPI_MAX_PROFILES profiles.
+ */
+void spi_set_profile(uint8_t inst, uint8_t ss_pin, const spi_profile_t *profile, enum ti_errc_t *errc);
+
+/**
+ * @brief Turn packed FIFO mode on or off for an instance's blocking transfers.
+ *
+ * In packed mode spi_transfer_sync, spi_write, spi_read and spi_transfer_iov move four 8-bit
+ * frames per TXDR/RXDR access with the FIFO threshold at four frames, and keep the FIFO topped
+ * up instead of waiting on every byte. The instance is left enabled between calls as an endless
+ * (TSIZE = 0) transfer whose clock only runs while there is data to send, so back-to-back calls
+ * on the same profile skip the disable/TSIZE/enable sequence. Switching to a profile with
+ * different settings, an async transfer or non-packed mode ends that transfer first.
+ * Devices with frames over 8 bits keep one access per frame.
+ *
+ * @param inst  SPI instance.
+ * @param enable  true for packed mode, false for one frame in flight at a time (the default).
+ *
+ * @param errc Pointer to error status output. TI_ERRC_BUSY if an async transfer is in progress.
+ */
+void spi_set_packed(uint8_t inst, bool enable, enum ti_errc_t *errc);
+
 /**
  * @brief Perform an SPI data transfer with blocking. 
  * 
@@ -72,11 +186,145 @@ void spi_init(uint8_t inst, uint8_t mode, uint8_t* ss_list, uint8_t slave_count,
  * transfer is complete.
  *
  * @param inst  SPI instance to use for the transfer.
- * @param src   Pointer to the transmit (source) buffer.
- * @param dst   Pointer to the receive (destination) buffer.
- * @param size  Number of bytes to transfer.
+ * @param src   Pointer to the transmit (source) buffer, or NULL to send 0xFF.
+ * @param dst   Pointer to the receive (destination) buffer, or NULL to discard.
+ * @param size  Number of bytes to transfer (up to 255; see spi_transfer_iov for more). A multiple of the frame width when the device's
+ *              profile has frames over 8 bits.
  * @param ss_pin  The SS pin of the slave SPI will communicate with. 
  *
  * @param errc Pointer to error status output.
  */ 
-void spi_transfer_sync(uint8_t inst, uint8_t ss_pin, void* src, void* dst, uint8_t size, enum ti_errc_t *errc); 
\ No newline at end of file
+void spi_transfer_sync(uint8_t inst, uint8_t ss_pin, void* src, void* dst, uint8_t size, enum ti_errc_t *errc);
+
+/**
+ * @brief Send bytes with blocking, discarding whatever the device sends back.
+ *
+ * @param inst  SPI instance to use for the transfer.
+ * @param ss_pin  The SS pin of the slave SPI will communicate with.
+ * @param src  Bytes to send.
+ * @param len  Number of bytes (1-65535).
+ *
+ * @param errc Pointer to error status output.
+ */
+void spi_write(uint8_t inst, uint8_t ss_pin, const void* src, uint16_t len, enum ti_errc_t *errc);
+
+/**
+ * @brief Receive bytes with blocking while clocking out a fixed fill byte.
+ *
+ * @param inst  SPI instance to use for the transfer.
+ * @param ss_pin  The SS pin of the slave SPI will communicate with.
+ * @param dst  Where the received bytes go.
+ * @param len  Number of bytes (1-65535).
+ * @param fill  Byte sent for every byte received (most devices want 0x00 or 0xFF).
+ *
+ * @param errc Pointer to error status output.
+ */
+void spi_read(uint8_t inst, uint8_t ss_pin, void* dst, uint16_t len, uint8_t fill, enum ti_errc_t *errc);
+
+/**
+ * @brief Run several buffers as one blocking transfer under a single SS assertion.
+ *
+ * Lets a driver send a command header and a payload, or a command followed by a read, without
+ * copying them into one staging buffer first. Pieces are clocked back to back in order.
+ *
+ * @param inst  SPI instance to use for the transfer.
+ * @param ss_pin  The SS pin of the slave SPI will communicate with.
+ * @param iov  The pieces. Each length must be a whole number of frames.
+ * @param iov_count  Number of pieces (at least 1).
+ * @param fill  Byte sent for pieces with no tx buffer.
+ *
+ * @param errc Pointer to error status output. TI_ERRC_INVALID_ARG if the pieces add up to 0 or
+ *             more than 65535 bytes, TI_ERRC_BUSY if an async transfer is in progress,
+ *             TI_ERRC_TIMEOUT if the peripheral stalls for SPI_WAIT_TIMEOUT_US (the transfer is
+ *             abandoned with SS released). The blocking transfers all share this bound.
+ */
+void spi_transfer_iov(uint8_t inst, uint8_t ss_pin, const spi_iov_t* iov, uint8_t iov_count, uint8_t fill,
+                      enum ti_errc_t *errc);
+
+/**
+ * @brief Routes an SPI instance's TX and RX requests through DMAMUX to two DMA streams.
+ *
+ * Must be called after spi_init and before spi_transfer_async. Also enables the instance's
+ * interrupt in the NVIC. SPI6 sits on BDMA/DMAMUX2 and is not supported.
+ *
+ * @param inst  SPI instance (1-5).
+ * @param tx_stream  Stream used to feed TXDR. Direction and data sizes are forced to
+ *                   memory-to-peripheral bytes.
+ * @param rx_stream  Stream used to drain RXDR. Direction and data sizes are forced to
+ *                   peripheral-to-memory bytes.
+ *
+ * @param errc Pointer to error status output.
+ */
+void spi_dma_init(uint8_t inst, periph_dma_config_t *tx_stream, periph_dma_config_t *rx_stream, enum ti_errc_t *errc);
+
+/**
+ * @brief Start a full-duplex SPI transfer driven by DMA and return immediately.
+ *
+ * SS is pulled low before the transfer starts and released before @p callback runs. The buffers
+ * must stay valid until then and must be reachable by DMA1/DMA2 (not DTCM); see alloc_dma.
+ *
+ * @param inst  SPI instance, set up with spi_dma_init.
+ * @param ss_pin  The SS pin of the slave SPI will communicate with.
+ * @param src  Transmit buffer, or NULL to clock out 0xFF.
+ * @param dst  Receive buffer, or NULL to discard received bytes.
+ * @param len  Number of bytes to transfer (1-65535). A multiple of the frame width when the
+ *             device's profile has frames over 8 bits; buffers must then be aligned to it.
+ * @param callback  Called from interrupt context when the transfer ends. May be NULL.
+ * @param ctx  Passed through to @p callback.
+ *
+ * @param errc Pointer to error status output. TI_ERRC_BUSY if a transfer is already in progress
+ *             on @p inst, TI_ERRC_INVALID_ARG if DMA was not set up or @p len is 0.
+ */
+void spi_transfer_async(uint8_t inst, uint8_t ss_pin, const void* src, void* dst, uint16_t len,
+                        spi_callback_t callback, void* ctx, enum ti_errc_t *errc);
+
+/**
+ * @brief Check whether an asynchronous transfer is still in progress on an SPI instance.
+ * @param inst  SPI instance.
+ * @return true until the transfer's callback has been called.
+ */
+bool spi_async_busy(uint8_t inst);
+
+/**
+ * @brief Clock the transfer statistics are kept in: the low 32 bits of deadline_ticks, so
+ *        DEADLINE_TICKS_PER_US per microsecond. Host tests substitute deadline_ticks.
+ */
+uint32_t spi_stats_now(void);
+
+/**
+ * @brief Copy the statistics of every chip select that has had a transfer.
+ *
+ * Each entry is copied as is, so one whose bus finishes a transfer mid-copy can mix that transfer's
+ * counts in partially. Once SPI_STATS_MAX_DEVICES chip selects are known, new ones are not
+ * recorded.
+ *
+ * @param out  Where the entries go, in the order the chip selects were first seen.
+ * @param max  Size of @p out.
+ * @return Entries written.
+ */
+uint8_t spi_get_stats(spi_dev_stats_t *out, uint8_t max);
+
+/**
+ * @brief Read the statistics of one chip select.
+ * @param inst  SPI instance.
+ * @param ss_pin  The device's SS pin.
+ * @param out  Statistics output.
+ *
+ * @param errc Pointer to error status output. TI_ERRC_NOT_FOUND if it has had no transfers.
+ */
+void spi_get_device_stats(uint8_t inst, uint8_t ss_pin, spi_dev_stats_t *out, enum ti_errc_t *errc);
+
+/**
+ * @brief Sum the statistics of every chip select on an instance. max_cycles is the longest
+ *        transfer on any of them.
+ * @param inst  SPI instance.
+ * @param out  Totals output, with ss_pin set to 0xFF.
+ *
+ * @param errc Pointer to error status output.
+ */
+void spi_get_bus_stats(uint8_t inst, spi_dev_stats_t *out, enum ti_errc_t *errc);
+
+/**
+ * @brief Zero every counter. Chip selects already seen keep their entries.
+ */
+void spi_clear_stats(void);
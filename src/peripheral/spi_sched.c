@@ -0,0 +1,282 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file peripheral/spi_sched.c
+ * @authors Joshua Beard
+ * @brief Implementation of the per-bus SPI transaction queue.
+ */
+
+#include "peripheral/spi_sched.h"
+#include "internal/deadline.h"
+#include "internal/mmio.h"
+#include <stddef.h>
+
+/**************************************************************************************************
+ * @section Private Types and Data
+ **************************************************************************************************/
+
+typedef struct {
+    bool ready;
+    spi_job_t *head;      // waiting jobs, highest priority first
+    spi_job_t *running;
+    uint64_t started_at;
+
+    uint32_t depth;
+    uint32_t max_depth;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t expired;
+    uint64_t max_wait;
+    uint64_t busy_ticks;
+    uint64_t window_start;
+} spi_sched_bus_t;
+
+static spi_sched_bus_t spi_sched_bus[SPI_SCHED_BUS_COUNT];
+
+/**************************************************************************************************
+ * @section Private Functions
+ **************************************************************************************************/
+
+// The queue is touched from thread context and from the SPI/DMA completion interrupts, so every
+// list operation runs with interrupts masked. The sections are a handful of pointer updates long.
+static inline uint32_t spi_sched_lock(void) {
+#if defined(__arm__)
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    return primask;
+#else
+    return 0;
+#endif
+}
+
+static inline void spi_sched_unlock(uint32_t primask) {
+#if defined(__arm__)
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+#else
+    (void)primask;
+#endif
+}
+
+// true if a should run before b
+static bool spi_sched_before(const spi_job_t *a, const spi_job_t *b) {
+    if (a->priority != b->priority) return a->priority > b->priority;
+    if (a->has_deadline != b->has_deadline) return a->has_deadline;
+    if (a->has_deadline) return a->deadline.expires < b->deadline.expires;
+    return false; // FIFO among equals
+}
+
+static void spi_sched_end(spi_job_t *job, spi_job_state_t state) {
+    job->state = state;
+    if (job->callback) job->callback(state == SPI_JOB_DONE, job->ctx);
+}
+
+static void spi_sched_done(bool success, void *ctx);
+
+// Starts the best waiting job if the bus is idle. Jobs whose deadline has passed are dropped
+// on the way; their callbacks run after the next job is already on the wire.
+static void spi_sched_kick(spi_sched_bus_t *bus) {
+    for (;;) {
+        spi_job_t *expired = NULL;
+        spi_job_t *job = NULL;
+        uint64_t now = 0;
+
+        uint32_t key = spi_sched_lock();
+        if (bus->running == NULL) {
+            now = spi_sched_now();
+            while (bus->head) {
+                spi_job_t *j = bus->head;
+                bus->head = j->next;
+                bus->depth--;
+                if (j->has_deadline && now > j->deadline.expires) {
+                    j->next = expired;
+                    expired = j;
+                    bus->expired++;
+                    continue;
+                }
+                job = j;
+                break;
+            }
+            if (job) {
+                job->next = NULL;
+                job->state = SPI_JOB_RUNNING;
+                bus->running = job;
+                bus->started_at = now;
+                const uint64_t wait = now - job->queued_at;
+                if (wait > bus->max_wait) bus->max_wait = wait;
+            }
+        }
+        spi_sched_unlock(key);
+
+        bool start_failed = false;
+        if (job) {
+            enum ti_errc_t errc;
+            spi_transfer_async(job->dev->inst, job->dev->ss_pin, job->src, job->dst, job->len,
+                               spi_sched_done, bus, &errc);
+            if (errc != TI_ERRC_NONE) {
+                key = spi_sched_lock();
+                bus->running = NULL;
+                bus->failed++;
+                spi_sched_unlock(key);
+                start_failed = true;
+            }
+        }
+
+        while (expired) {
+            spi_job_t *j = expired;
+            expired = j->next;
+            j->next = NULL;
+            spi_sched_end(j, SPI_JOB_EXPIRED);
+        }
+        if (!start_failed) return;
+        spi_sched_end(job, SPI_JOB_FAILED);
+    }
+}
+
+// Completion of the running job, from the SPI or DMA interrupt. The next job is started before
+// the finished job's callback runs so the callback's work overlaps the next transfer.
+static void spi_sched_done(bool success, void *ctx) {
+    spi_sched_bus_t *bus = ctx;
+
+    uint32_t key = spi_sched_lock();
+    spi_job_t *job = bus->running;
+    bus->running = NULL;
+    bus->busy_ticks += spi_sched_now() - bus->started_at;
+    if (success) bus->completed++;
+    else bus->failed++;
+    spi_sched_unlock(key);
+
+    spi_sched_kick(bus);
+    if (job) spi_sched_end(job, success ? SPI_JOB_DONE : SPI_JOB_FAILED);
+}
+
+/**************************************************************************************************
+ * @section Public Functions
+ **************************************************************************************************/
+
+uint64_t spi_sched_now(void) {
+    return deadline_ticks();
+}
+
+void spi_sched_init(uint8_t inst, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst == 0 || inst >= SPI_SCHED_BUS_COUNT) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid SPI instance.");
+        return;
+    }
+    spi_sched_bus_t *bus = &spi_sched_bus[inst];
+    if (bus->running || bus->head) {
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "SPI bus has scheduled jobs.");
+        return;
+    }
+    *bus = (spi_sched_bus_t){0};
+    bus->window_start = spi_sched_now();
+    bus->ready = true;
+}
+
+void spi_sched_submit(spi_job_t *job, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (job == NULL || job->dev == NULL || job->len == 0) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid SPI job.");
+        return;
+    }
+    const uint8_t inst = job->dev->inst;
+    if (inst == 0 || inst >= SPI_SCHED_BUS_COUNT || !spi_sched_bus[inst].ready) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI bus not set up for scheduling.");
+        return;
+    }
+    spi_sched_bus_t *bus = &spi_sched_bus[inst];
+
+    uint32_t key = spi_sched_lock();
+    if (job->state == SPI_JOB_QUEUED || job->state == SPI_JOB_RUNNING) {
+        spi_sched_unlock(key);
+        TI_SET_ERRC(errc, TI_ERRC_BUSY, "SPI job already submitted.");
+        return;
+    }
+    job->state = SPI_JOB_QUEUED;
+    job->queued_at = spi_sched_now();
+    spi_job_t **link = &bus->head;
+    while (*link && !spi_sched_before(job, *link)) link = &(*link)->next;
+    job->next = *link;
+    *link = job;
+    if (++bus->depth > bus->max_depth) bus->max_depth = bus->depth;
+    spi_sched_unlock(key);
+
+    spi_sched_kick(bus);
+}
+
+bool spi_sched_cancel(spi_job_t *job) {
+    if (job == NULL || job->dev == NULL) return false;
+    const uint8_t inst = job->dev->inst;
+    if (inst == 0 || inst >= SPI_SCHED_BUS_COUNT) return false;
+    spi_sched_bus_t *bus = &spi_sched_bus[inst];
+
+    bool removed = false;
+    uint32_t key = spi_sched_lock();
+    for (spi_job_t **link = &bus->head; *link; link = &(*link)->next) {
+        if (*link == job) {
+            *link = job->next;
+            job->next = NULL;
+            job->state = SPI_JOB_CANCELLED;
+            bus->depth--;
+            removed = true;
+            break;
+        }
+    }
+    spi_sched_unlock(key);
+    return removed;
+}
+
+void spi_sched_get_stats(uint8_t inst, spi_sched_stats_t *stats) {
+    if (stats == NULL) return;
+    *stats = (spi_sched_stats_t){0};
+    if (inst == 0 || inst >= SPI_SCHED_BUS_COUNT) return;
+    spi_sched_bus_t *bus = &spi_sched_bus[inst];
+
+    uint32_t key = spi_sched_lock();
+    const uint64_t now = spi_sched_now();
+    stats->queue_depth = bus->depth;
+    stats->max_queue_depth = bus->max_depth;
+    stats->completed = bus->completed;
+    stats->failed = bus->failed;
+    stats->expired = bus->expired;
+    stats->max_wait = bus->max_wait;
+    stats->busy_ticks = bus->busy_ticks;
+    if (bus->running) stats->busy_ticks += now - bus->started_at;
+    stats->window_ticks = now - bus->window_start;
+    spi_sched_unlock(key);
+
+    if (stats->window_ticks) {
+        uint64_t pct = stats->busy_ticks * 100U / stats->window_ticks;
+        stats->utilisation_pct = (uint8_t)(pct > 100U ? 100U : pct);
+    }
+}
+
+void spi_sched_clear_stats(uint8_t inst) {
+    if (inst == 0 || inst >= SPI_SCHED_BUS_COUNT) return;
+    spi_sched_bus_t *bus = &spi_sched_bus[inst];
+
+    uint32_t key = spi_sched_lock();
+    const uint64_t now = spi_sched_now();
+    bus->max_depth = bus->depth;
+    bus->completed = 0;
+    bus->failed = 0;
+    bus->expired = 0;
+    bus->max_wait = 0;
+    bus->busy_ticks = 0;
+    bus->window_start = now;
+    if (bus->running) bus->started_at = now; // only count the rest of the running job
+    spi_sched_unlock(key);
+}
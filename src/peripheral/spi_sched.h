@@ -0,0 +1,121 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file peripheral/spi_sched.h
+ * @authors Joshua Beard
+ * @brief Per-bus SPI transaction queue with priorities and deadlines.
+ *
+ * Jobs for devices sharing a bus are queued here instead of being issued as blocking transfers
+ * in whatever order the caller happens to use. Each bus runs one job at a time through
+ * spi_transfer_async; when a job ends, the next one is started straight from the completion
+ * interrupt, so back-to-back jobs need no help from the main loop. The highest priority job
+ * always goes next, and among equal priorities the earliest deadline. A job that is still queued
+ * when its deadline passes is dropped rather than run late.
+ *
+ * Job structs are owned by the caller and must stay valid until their callback has run.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "peripheral/errc.h"
+#include "peripheral/spi.h"
+#include "internal/deadline.h"
+
+/** @brief Number of bus slots, indexed by SPI instance. */
+#define SPI_SCHED_BUS_COUNT 7
+
+/** @brief Lifecycle of a job. */
+typedef enum {
+    SPI_JOB_IDLE = 0, /** @brief Never submitted. */
+    SPI_JOB_QUEUED,   /** @brief Waiting for the bus. */
+    SPI_JOB_RUNNING,  /** @brief On the wire. */
+    SPI_JOB_DONE,     /** @brief Finished; callback ran with success = true. */
+    SPI_JOB_FAILED,   /** @brief SPI or DMA error; callback ran with success = false. */
+    SPI_JOB_EXPIRED,  /** @brief Deadline passed while queued; callback ran with success = false. */
+    SPI_JOB_CANCELLED /** @brief Removed by spi_sched_cancel; no callback. */
+} spi_job_state_t;
+
+/** @brief One SPI transaction. Fill in the fields above the bookkeeping before submitting. */
+typedef struct spi_job_t {
+    const spi_device_t *dev;  /** @brief Device to talk to; selects the bus and chip select. */
+    const void *src;          /** @brief Transmit buffer, or NULL to clock out 0xFF. */
+    void *dst;                /** @brief Receive buffer, or NULL to discard. */
+    uint16_t len;             /** @brief Bytes to transfer. */
+    uint8_t priority;         /** @brief Higher runs first. */
+    bool has_deadline;        /** @brief Whether deadline applies. */
+    deadline_t deadline;      /** @brief Latest start time, e.g. from deadline_in_us. */
+    spi_callback_t callback;  /** @brief Runs from interrupt context when the job ends. May be NULL. */
+    void *ctx;                /** @brief Passed to callback. */
+
+    // Scheduler bookkeeping
+    struct spi_job_t *next;
+    uint64_t queued_at;
+    volatile spi_job_state_t state;
+} spi_job_t;
+
+/** @brief Per-bus queue metrics, in spi_sched_now ticks where timed. The times are 64-bit, so
+ *         they stay right however long it is between clears. */
+typedef struct {
+    uint32_t queue_depth;     /** @brief Jobs waiting right now (excluding the running one). */
+    uint32_t max_queue_depth; /** @brief Most jobs waiting at once since the last clear. */
+    uint32_t completed;       /** @brief Jobs that finished successfully. */
+    uint32_t failed;          /** @brief Jobs that ended in an SPI or DMA error. */
+    uint32_t expired;         /** @brief Jobs dropped because their deadline passed. */
+    uint64_t max_wait;        /** @brief Longest time a job waited between submit and start. */
+    uint64_t busy_ticks;      /** @brief Time the bus spent running jobs since the last clear. */
+    uint64_t window_ticks;    /** @brief Time since the last clear. */
+    uint8_t utilisation_pct;  /** @brief busy_ticks as a percentage of window_ticks. */
+} spi_sched_stats_t;
+
+/**
+ * @brief Current scheduler time: deadline_ticks, DEADLINE_TICKS_PER_US per microsecond. 64-bit, so
+ *        it doesn't wrap and a deadline can be any time ahead, as long as something reads the clock
+ *        at least every ~8.9 s (see deadline_ticks). Host tests substitute deadline_ticks.
+ */
+uint64_t spi_sched_now(void);
+
+/**
+ * @brief Prepares a bus for scheduled jobs. Call after spi_init and spi_dma_init.
+ * @param inst SPI instance.
+ * @param errc Pointer to error status output.
+ */
+void spi_sched_init(uint8_t inst, enum ti_errc_t *errc);
+
+/**
+ * @brief Queues a job on its device's bus, starting it straight away if the bus is idle.
+ * @param job Job to queue. Must not already be queued or running.
+ * @param errc Pointer to error status output. TI_ERRC_INVALID_ARG for a bad job or a bus
+ *             without spi_sched_init, TI_ERRC_BUSY if the job is already queued or running.
+ */
+void spi_sched_submit(spi_job_t *job, enum ti_errc_t *errc);
+
+/**
+ * @brief Removes a job that is still waiting. A running job can't be cancelled.
+ * @return true if the job was removed.
+ */
+bool spi_sched_cancel(spi_job_t *job);
+
+/**
+ * @brief Reads a bus's queue metrics.
+ * @param inst SPI instance.
+ * @param stats Output metrics.
+ */
+void spi_sched_get_stats(uint8_t inst, spi_sched_stats_t *stats);
+
+/**
+ * @brief Restarts a bus's utilisation window and clears its counters and high-water marks.
+ */
+void spi_sched_clear_stats(uint8_t inst);
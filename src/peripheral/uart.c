@@ -20,7 +20,9 @@
  */
 
 #include "uart.h"
-#include "../internal/mmio.h"
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "internal/deadline.h"
 #include "gpio.h"
 #include <stdbool.h>
 #include <stddef.h>
@@ -34,6 +36,17 @@
   ((channel) == UART1 || (channel) == UART2 || (channel) == UART3 ||           \
    (channel) == UART6)
 
+// mmio.h lists USART1-3 and 6 under USARTx and the rest under UARTx; every field is shared
+#define UART_REG(reg, channel)                                                 \
+  (IS_USART_CHANNEL(channel) ? USARTx_##reg[channel] : UARTx_##reg[channel])
+
+// mmio.h only lists DEAT and DEDT bit by bit
+static const field32_t UART_CR1_DEAT = {.msk = 0x03E00000U, .pos = 21};
+static const field32_t UART_CR1_DEDT = {.msk = 0x001F0000U, .pos = 16};
+
+#define UART_RX_LINE_ERRORS                                                    \
+  (USARTx_ISR_ORE.msk | USARTx_ISR_NF.msk | USARTx_ISR_FE.msk | USARTx_ISR_PE.msk)
+
 /**************************************************************************************************
  * @section  Data Structures
  **************************************************************************************************/
@@ -89,7 +102,49 @@ static bool uart_busy[UART_CHANNEL_COUNT] = {false};
 
 static uart_context_t uart_contexts[UART_CHANNEL_COUNT];
 
-static uint32_t timeout;
+// Receive ring of one channel. head and tail count bytes since uart_rx_ring_start and wrap
+// around at 2^32; masking a count gives its place in buf.
+typedef struct {
+  uint8_t *buf;
+  uint32_t mask;                // ring size - 1
+  volatile bool active;
+  volatile bool failed;         // the RX stream reported an error and stopped
+  volatile uint32_t wraps;      // times the stream has wrapped, counted by its interrupt
+  volatile uint32_t head;       // bytes the stream has written, as of the last uart_rx_sync
+  uint32_t tail;                // bytes read or dropped
+  volatile uint32_t frame_end[UART_RX_FRAME_SLOTS]; // head at each idle line, oldest first
+  volatile uint32_t frame_wr;   // written by the USART interrupt
+  volatile uint32_t frame_rd;   // written by the reader
+  uint32_t last_end;            // head at the last recorded idle line
+  uint32_t reported_drops;      // stats.dropped as of the last uart_read_some
+  uart_rx_stats_t stats;
+} uart_rx_ring_t;
+
+static uart_rx_ring_t uart_rx_rings[UART_CHANNEL_COUNT];
+
+// RX stream configuration from uart_init, restored when the ring stops
+static dma_config_t uart_rx_stream_config[UART_CHANNEL_COUNT];
+
+// Transmit queue of one channel. head and tail count bytes since uart_tx_queue_start like the
+// receive ring's; bytes between them are waiting or with the TX stream.
+typedef struct {
+  uint8_t *buf;
+  uint32_t mask;                // queue size - 1
+  volatile bool active;
+  volatile bool busy;           // a run of bytes is with the TX stream
+  volatile bool failed;         // the TX stream failed since the last completion
+  volatile uint32_t head;       // bytes queued, written by uart_write_queued
+  volatile uint32_t tail;       // bytes the stream has finished with
+  volatile uint32_t in_flight;  // bytes of the run the stream is moving
+  dma_callback_t done;
+  void *context;
+  uart_tx_stats_t stats;
+} uart_tx_queue_t;
+
+static uart_tx_queue_t uart_tx_queues[UART_CHANNEL_COUNT];
+
+// TX stream configuration from uart_init, restored when the queue stops
+static dma_config_t uart_tx_stream_config[UART_CHANNEL_COUNT];
 
 /**************************************************************************************************
  * @section Private Function Implementations
@@ -408,73 +463,106 @@ static bool set_alternate_function /* NOLINT(bugprone-easily-swappable-parameter
   return true;
 }
 
-static bool uart_write_byte /* NOLINT(bugprone-easily-swappable-parameters) */(uart_channel_t channel, uint8_t data) {
-  uint32_t count = 0;
-
-  if (IS_USART_CHANNEL(channel)) {
-    // Wait until the receive FIFO is not empty.
-    while (READ_FIELD(USARTx_ISR[channel], USARTx_ISR_TXE) == 0) {
-      if (count++ >= 1000000000) {
-        return false; // Return false on timeout
+// Routes the channel's hardware driver enable (the RTS/DE line) to de_pin.
+static bool set_de_function(uart_channel_t channel, uint8_t de_pin) {
+  switch (channel) {
+    case UART1:
+      if (de_pin == 101) {
+        tal_alternate_mode(de_pin, 7);
+      } else {
+        return false;
       }
-    }
-    WRITE_FIELD(USARTx_TDR[channel], USARTx_TDR_TDR, data);
-
-    // This is a blocking function, so we return immediately after the data is
-    // placed in the FIFO. If you needed to ensure the data was completely sent,
-    // you would wait for the TC (Transmission Complete) flag.
-    while (READ_FIELD(USARTx_ISR[channel], USARTx_ISR_TC) == 0) {
-      asm("nop");
-    }
-  } else {
-    while (READ_FIELD(UARTx_ISR[channel], UARTx_ISR_TXE) == 0) {
-      if (count++ >= 1000000000) {
-        return false; // Return false on timeout
+      break;
+    case UART2:
+      if (de_pin == 38 || de_pin == 116) {
+        tal_alternate_mode(de_pin, 7);
+      } else {
+        return false;
       }
-    }
-     WRITE_FIELD(UARTx_TDR[channel], UARTx_TDR_TDR, data);
+      break;
+    case UART3:
+      if (de_pin == 74 || de_pin == 82) {
+        tal_alternate_mode(de_pin, 7);
+      } else {
+        return false;
+      }
+      break;
+    case UART4:
+      if (de_pin == 108) {
+        tal_alternate_mode(de_pin, 8);
+      } else {
+        return false;
+      }
+      break;
+    case UART5:
+      if (de_pin == 95) {
+        tal_alternate_mode(de_pin, 8);
+      } else {
+        return false;
+      }
+      break;
+    case UART6:
+      if (de_pin == 88) {
+        tal_alternate_mode(de_pin, 7);
+      } else {
+        return false;
+      }
+      break;
+    case UART7:
+      if (de_pin == 59 || de_pin == 22) {
+        tal_alternate_mode(de_pin, 7);
+      } else {
+        return false;
+      }
+      break;
+    case UART8:
+      if (de_pin == 85) {
+        tal_alternate_mode(de_pin, 8);
+      } else {
+        return false;
+      }
+      break;
+    default:
+      return false;
+  }
 
-    // This is a blocking function, so we return immediately after the data is
-    // placed in the FIFO. If you needed to ensure the data was completely sent,
-    // you would wait for the TC (Transmission Complete) flag.
-    while (READ_FIELD(UARTx_ISR[channel], UARTx_ISR_TC) == 0) {
-      asm("nop");
+  return true;
+}
+
+// Spins until @p flag reads set in the channel's ISR. False if it is still clear at the deadline.
+static bool uart_wait_isr(uart_channel_t channel, field32_t flag, deadline_t deadline) {
+  while (READ_FIELD(UART_REG(ISR, channel), flag) == 0) {
+    if (deadline_expired(deadline)) {
+      return READ_FIELD(UART_REG(ISR, channel), flag) != 0;
     }
   }
-
   return true;
 }
 
-static bool uart_read_byte(uint8_t channel, uint8_t *data) {
-  uint32_t count = 0;
+static bool uart_write_byte /* NOLINT(bugprone-easily-swappable-parameters) */(uart_channel_t channel, uint8_t data) {
+  const deadline_t deadline = deadline_in_us(UART_TX_TIMEOUT_US);
 
+  // Wait until the transmit FIFO has room.
+  if (!uart_wait_isr(channel, USARTx_ISR_TXE, deadline)) {
+    return false; // Return false on timeout
+  }
+  WRITE_FIELD(UART_REG(TDR, channel), USARTx_TDR_TDR, data);
+
+  // Wait for TC so the byte is fully on the line before the call returns.
+  return uart_wait_isr(channel, USARTx_ISR_TC, deadline);
+}
+
+static bool uart_read_byte(uint8_t channel, uint8_t *data) {
   // Input validation: ensure the destination pointer is not NULL
   if (data == NULL) {
     return false;
   }
 
-  if (IS_USART_CHANNEL(channel)) {
-    // Wait until the receive FIFO is not empty.
-    while (READ_FIELD(USARTx_ISR[channel], USARTx_ISR_RXNE) == 0) {
-      asm("nop");
-    }
-    *data = (uint8_t)READ_FIELD(USARTx_RDR[channel], USARTx_RDR_RDR);
-    // while (READ_FIELD(USARTx_ISR[channel], USARTx_ISR_RXNE) == 0) {
-    //   asm("nop");
-    // }
-  } else {
-    while (READ_FIELD(UARTx_ISR[channel], UARTx_ISR_RXNE) == 0) {
-      asm("nop");
-    }
-    *data = (uint8_t)READ_FIELD(UARTx_RDR[channel], UARTx_RDR_RDR);
-    // while (READ_FIELD(UARTx_ISR[channel], UARTx_ISR_RXNE) == 0) {
-    //   asm("nop");
-    // }
+  // Wait until the receive FIFO is not empty.
+  if (!uart_wait_isr(channel, USARTx_ISR_RXNE, deadline_in_us(UART_RX_TIMEOUT_US))) {
+    return false; // Return false on timeout
   }
-
-  // Read the data from the receive data register.
-  // The hardware automatically retrieves the next available byte from the FIFO.
-
+  *data = (uint8_t)READ_FIELD(UART_REG(RDR, channel), USARTx_RDR_RDR);
 
   return true;
 }
@@ -496,6 +584,165 @@ static inline bool verify_transfer_parameters(uart_channel_t channel, const uint
   return true;
 }
 
+// Brings head up to where the RX stream has written. Runs from the reader and from both
+// interrupts, so head only ever moves forward, through a compare-and-swap.
+static uint32_t uart_rx_sync(uart_channel_t channel) {
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  const uint32_t size = ring->mask + 1;
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  const uint32_t wraps = __atomic_load_n(&ring->wraps, __ATOMIC_ACQUIRE);
+  const uint32_t remaining = dma_get_remaining(uart_to_dma[channel].rx_instance,
+                                               uart_to_dma[channel].rx_stream);
+  uint32_t seen = wraps * size + ((size - remaining) & ring->mask);
+  // The stream has wrapped but its interrupt hasn't counted it yet
+  if ((int32_t)(seen - head) < 0) {
+    seen += size;
+  }
+  while ((int32_t)(seen - head) > 0) {
+    if (__atomic_compare_exchange_n(&ring->head, &head, seen, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+      return seen;
+    }
+  }
+  return head;
+}
+
+// RX stream callback while the ring runs: every wrap, or the stream failing
+static void uart_rx_dma_callback(bool success, void *context) {
+  const uart_channel_t channel = (uart_channel_t)(uintptr_t)context;
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  if (!success) {
+    ring->failed = true;
+    return;
+  }
+  __atomic_add_fetch(&ring->wraps, 1U, __ATOMIC_ACQ_REL);
+  uart_rx_sync(channel);
+}
+
+static void uart_rx_irq(uart_channel_t channel, uint32_t isr) {
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+
+  // The flag clear register is write-one-to-clear
+  uint32_t clear = 0;
+  if (isr & UART_RX_LINE_ERRORS) {
+    clear |= USARTx_ICR_ORECF.msk | USARTx_ICR_NCF.msk | USARTx_ICR_FECF.msk | USARTx_ICR_PECF.msk;
+    ring->stats.line_errors++;
+  }
+  if (isr & USARTx_ISR_IDLE.msk) {
+    clear |= USARTx_ICR_IDLECF.msk;
+  }
+  if (clear != 0) {
+    *UART_REG(ICR, channel) = clear;
+  }
+  if (!(isr & USARTx_ISR_IDLE.msk) || !ring->active) {
+    return;
+  }
+
+  // Record where the frame ended. An idle line with nothing since the last one ends no frame,
+  // and with every slot taken the frame runs into the one before it.
+  const uint32_t head = uart_rx_sync(channel);
+  const uint32_t wr = ring->frame_wr;
+  if (head == ring->last_end || wr - ring->frame_rd >= UART_RX_FRAME_SLOTS) {
+    return;
+  }
+  ring->frame_end[wr & (UART_RX_FRAME_SLOTS - 1)] = head;
+  __atomic_store_n(&ring->frame_wr, wr + 1, __ATOMIC_RELEASE);
+  ring->last_end = head;
+  ring->stats.frames++;
+}
+
+// Hands the next contiguous run of queued bytes to the TX stream, or arms the TC interrupt once
+// the queue is empty. Runs from the writer and from the stream's interrupt; whichever claims
+// busy first does the work.
+static void uart_tx_kick(uart_channel_t channel) {
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  const uint32_t size = queue->mask + 1;
+  for (;;) {
+    bool idle = false;
+    if (!__atomic_compare_exchange_n(&queue->busy, &idle, true, false, __ATOMIC_ACQ_REL,
+                                     __ATOMIC_ACQUIRE)) {
+      return;
+    }
+    const uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    const uint32_t tail = queue->tail;
+    if (head != tail) {
+      const uint32_t start = tail & queue->mask;
+      const uint32_t pending = head - tail;
+      const uint32_t run = (pending < size - start) ? pending : size - start;
+      queue->in_flight = run;
+      dma_transfer_t tx_transfer = {
+          .instance = uart_to_dma[channel].tx_instance,
+          .stream = uart_to_dma[channel].tx_stream,
+          .src = queue->buf + start,
+          .dest = (void *)UART_REG(TDR, channel),
+          .size = run,
+          .context = (void *)(uintptr_t)channel,
+      };
+      if (dma_start_transfer(&tx_transfer, NULL)) {
+        queue->stats.dma_transfers++;
+        return;
+      }
+      // The stream was taken away from under the queue; drop what's waiting
+      queue->tail = head;
+      queue->in_flight = 0;
+      queue->failed = true;
+    }
+    __atomic_store_n(&queue->busy, false, __ATOMIC_RELEASE);
+    // TC goes up once the last stop bit has left, and not before: any byte the stream writes
+    // to TDR clears it
+    SET_FIELD(UART_REG(CR1, channel), USARTx_CR1_TCIE);
+    if (__atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == queue->tail) {
+      return;
+    }
+  }
+}
+
+// TX stream callback while the queue runs: a run of queued bytes is in the USART FIFO
+static void uart_tx_dma_callback(bool success, void *context) {
+  const uart_channel_t channel = (uart_channel_t)(uintptr_t)context;
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  if (success) {
+    queue->stats.bytes_sent += queue->in_flight;
+    queue->tail += queue->in_flight;
+  } else {
+    queue->failed = true;
+    queue->tail = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+  }
+  queue->in_flight = 0;
+  __atomic_store_n(&queue->busy, false, __ATOMIC_RELEASE);
+  uart_tx_kick(channel);
+}
+
+static void uart_tx_irq(uart_channel_t channel, uint32_t isr) {
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  if (!(isr & USARTx_ISR_TC.msk) || !READ_FIELD(UART_REG(CR1, channel), USARTx_CR1_TCIE)) {
+    return;
+  }
+  CLR_FIELD(UART_REG(CR1, channel), USARTx_CR1_TCIE);
+  *UART_REG(ICR, channel) = USARTx_ICR_TCCF.msk;
+  // More bytes were queued after TC was armed and are on their way
+  if (queue->busy || __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) != queue->tail) {
+    return;
+  }
+  const bool success = !queue->failed;
+  queue->failed = false;
+  queue->stats.completions++;
+  if (queue->done) {
+    queue->done(success, queue->context);
+  }
+}
+
+static void uart_irq(uart_channel_t channel) {
+  const uint32_t isr = *UART_REG(ISR, channel);
+  uart_tx_irq(channel, isr);
+  uart_rx_irq(channel, isr);
+}
+
+static inline void uart_enable_irq(uart_channel_t channel) {
+  const int32_t irq = IS_USART_CHANNEL(channel) ? USARTx_IRQ_NUM[channel] : UARTx_IRQ_NUM[channel];
+  *NVIC_ISERx[irq / 32] = 1U << (irq % 32);
+}
+
 /**
  * Macro that generates cases for uart init
  * @author Owen Voskuhl Hayes, Lorde of the Isle, first of his name.
@@ -510,6 +757,19 @@ static inline bool verify_transfer_parameters(uart_channel_t channel, const uint
     break;                                                                     \
   }
 
+/**************************************************************************************************
+ * @section Interrupt Handlers
+ **************************************************************************************************/
+
+void usart1_irq_handler(void) { uart_irq(UART1); }
+void usart2_irq_handler(void) { uart_irq(UART2); }
+void usart3_irq_handler(void) { uart_irq(UART3); }
+void uart4_irq_handler(void)  { uart_irq(UART4); }
+void uart5_irq_handler(void)  { uart_irq(UART5); }
+void usart6_irq_handler(void) { uart_irq(UART6); }
+void uart7_irq_handler(void)  { uart_irq(UART7); }
+void uart8_irq_handler(void)  { uart_irq(UART8); }
+
 /**************************************************************************************************
  * @section Public Function Implementations
  **************************************************************************************************/
@@ -525,6 +785,14 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
   uint32_t baud_rate = usart_config->baud_rate;
   // TODO: I think to get exact numbers for this I need devboard
   uint32_t clk_freq = usart_config->clk_freq;
+  const uart_rs485_config_t *rs485 = &usart_config->rs485;
+
+  if (errc) *errc = TI_ERRC_NONE;
+  if (rs485->enabled && (rs485->assertion_time > UART_RS485_MAX_DE_TIME ||
+                         rs485->deassertion_time > UART_RS485_MAX_DE_TIME)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "RS485 driver enable time out of range");
+    return;
+  }
 
   // Enable usart clock
   switch (channel) {
@@ -600,6 +868,15 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
     return; //
   } //
 
+  if (rs485->enabled) {
+    tal_enable_clock(rs485->de_pin);
+    tal_set_mode(rs485->de_pin, 2);
+    if (!set_de_function(channel, rs485->de_pin)) {
+      TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Pin cannot carry the UART driver enable");
+      return;
+    }
+  }
+
 
   // Ensure the clock pin is disabled for asynchronous mode
   // TODO: check on this
@@ -607,6 +884,9 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
     CLR_FIELD(UARTx_CR2[channel], UARTx_CR2_CLKEN);
   }
 
+  // BRR, DEAT and DEDT are read-only while the USART is enabled
+  CLR_FIELD(UART_REG(CR1, channel), USARTx_CR1_UE);
+
   // TODO: maybe calculate via using ints for mantissa/exponent field?
   uint32_t brr_value = clk_freq / baud_rate;
   if (IS_USART_CHANNEL(channel)) {
@@ -704,6 +984,21 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
 
 }
 
+  // RS485: the USART frames every transmission with DE itself. DEAT/DEDT only take while UE is
+  // clear, which it still is here.
+  if (rs485->enabled) {
+    WRITE_FIELD(UART_REG(CR1, channel), UART_CR1_DEAT, (uint32_t)rs485->assertion_time);
+    WRITE_FIELD(UART_REG(CR1, channel), UART_CR1_DEDT, (uint32_t)rs485->deassertion_time);
+    if (rs485->de_active_low) {
+      SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DEP);
+    } else {
+      CLR_FIELD(UART_REG(CR3, channel), USARTx_CR3_DEP);
+    }
+    SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DEM);
+  } else {
+    CLR_FIELD(UART_REG(CR3, channel), USARTx_CR3_DEM);
+  }
+
   dma_config_t dma_tx_stream = {
       .instance = tx_stream->instance,
       .stream = tx_stream->stream,
@@ -717,6 +1012,7 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
       .callback = *callback, // We need to know if it failed.
   };
   dma_configure_stream(&dma_tx_stream);
+  uart_tx_stream_config[channel] = dma_tx_stream;
 
   dma_config_t dma_rx_stream = {
       .instance = rx_stream->instance,
@@ -731,6 +1027,7 @@ void uart_init(uart_config_t *usart_config, dma_callback_t *callback,
       .callback = *callback, // We need to know if it failed.
   };
   dma_configure_stream(&dma_rx_stream);
+  uart_rx_stream_config[channel] = dma_rx_stream;
 
   // Save stream info
   dma_periph_streaminfo_t info = {.rx_instance = rx_stream->instance,
@@ -765,6 +1062,9 @@ void uart_write_async(uart_channel_t channel, uint8_t *tx_buff, uint32_t size, e
     // tal_raise(flag, "USART channel is busy");
     TI_SET_ERRC(errc, TI_ERRC_BUSY, "Channel busy"); return;
   }
+  if (uart_tx_queues[channel].active) {
+    TI_SET_ERRC(errc, TI_ERRC_BUSY, "TX stream in use by the transmit queue"); return;
+  }
   uart_busy[channel] = true;
 
   // Configure DMA stream
@@ -777,15 +1077,15 @@ void uart_write_async(uart_channel_t channel, uint8_t *tx_buff, uint32_t size, e
       .instance = uart_to_dma[channel].tx_instance,
       .stream = uart_to_dma[channel].tx_stream,
       .src = tx_buff,
-      .dest = (void *)UARTx_TDR[channel], // maybe revisit the cast... in dma transfer struct
+      .dest = (void *)UART_REG(TDR, channel), // maybe revisit the cast... in dma transfer struct
       .size = size,
       .context = &uart_contexts[channel],
       .disable_mem_inc = false,
   };
-  dma_start_transfer(&tx_transfer);
+  dma_start_transfer(&tx_transfer, NULL);
 
   // Enable the dma requests
-  SET_FIELD(UARTx_CR3[channel], UARTx_CR3_DMAT);
+  SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAT);
 }
 
 void uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size, enum ti_errc_t *errc) {
@@ -801,6 +1101,9 @@ void uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size, en
     // tal_raise(flag, "USART channel is busy");
     TI_SET_ERRC(errc, TI_ERRC_BUSY, "Channel busy"); return; //
   }
+  if (uart_rx_rings[channel].active) {
+    TI_SET_ERRC(errc, TI_ERRC_BUSY, "RX stream in use by the receive ring"); return;
+  }
   uart_busy[channel] = true;
 
   // Configure DMA stream
@@ -809,19 +1112,19 @@ void uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size, en
       .channel = channel,
   };
   uart_contexts[channel] = context;
-  dma_transfer_t tx_transfer = {
-      .instance = uart_to_dma[channel].tx_instance,
-      .stream = uart_to_dma[channel].tx_stream,
-      .src = (void *) UARTx_RDR[channel],
+  dma_transfer_t rx_transfer = {
+      .instance = uart_to_dma[channel].rx_instance,
+      .stream = uart_to_dma[channel].rx_stream,
+      .src = (void *) UART_REG(RDR, channel),
       .dest = rx_buff,
       .size = size,
       .context = &uart_contexts[channel],
       .disable_mem_inc = false,
   };
-  dma_start_transfer(&tx_transfer);
+  dma_start_transfer(&rx_transfer, NULL);
 
   // Enable the dma requests
-  SET_FIELD(UARTx_CR3[channel], UARTx_CR3_DMAT);
+  SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAR);
   // No explicit return needed for void function
 }
 
@@ -834,6 +1137,10 @@ void uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
   if (!test_params) {
     TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return; //
   }
+  // Bytes written here would cut into the middle of the queue
+  if (channel < UART_CHANNEL_COUNT && uart_tx_queues[channel].active) {
+    TI_SET_ERRC(errc, TI_ERRC_BUSY, "Transmit queue running"); return;
+  }
 
   // Check if usart channel is busy
   // while (!READ_FIELD(USARTx_ISR[channel], USARTx_ISR_BUSY)) {
@@ -863,21 +1170,6 @@ void uart_read_blocking(uart_channel_t channel, uint8_t *rx_buff,
     TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return; //
   }
 
-  // Check if usart channel is bus
-  if(IS_USART_CHANNEL(channel)) {
-  while (!READ_FIELD(USARTx_ISR[channel], USARTx_ISR_BUSY)) {
-    asm("nop");
-    // tal_raise(flag, "USART channel is busy");
-  }
-} else {
-  while (!READ_FIELD(UARTx_ISR[channel], UARTx_ISR_BUSY)) {
-    asm("nop");
-    // tal_raise(flag, "USART channel is busy");
-  }
-}
-  // uart_busy[channel] = true;
-
-
   // Receive the data byte by byte
   for (uint32_t i = 0; i < size; i++) {
     if (!uart_read_byte(channel, rx_buff+i)) {
@@ -885,4 +1177,240 @@ void uart_read_blocking(uart_channel_t channel, uint8_t *rx_buff,
       return; //
     }
   }
-}
\ No newline at end of file
+}
+
+void uart_rx_ring_start(uart_channel_t channel, uint8_t *buf, uint32_t size, enum ti_errc_t *errc) {
+  if (errc) *errc = TI_ERRC_NONE;
+  if (channel >= UART_CHANNEL_COUNT || !verify_transfer_parameters(channel, buf, size)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return;
+  }
+  if (size < 2 || size > DMA_MAX_ITEMS || (size & (size - 1)) != 0) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Ring size must be a power of two"); return;
+  }
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  const dma_instance_t instance = uart_to_dma[channel].rx_instance;
+  const dma_stream_t stream = uart_to_dma[channel].rx_stream;
+  if (ring->active || dma_stream_busy(instance, stream)) {
+    TI_SET_ERRC(errc, TI_ERRC_BUSY, "RX stream busy"); return;
+  }
+
+  // Bytes straight from RDR, with the ring's own callback counting the wraps
+  dma_config_t config = uart_rx_stream_config[channel];
+  config.direction = PERIPH_TO_MEM;
+  config.src_data_size = DMA_DATA_SIZE_BYTE;
+  config.dest_data_size = DMA_DATA_SIZE_BYTE;
+  config.fifo_enabled = false;
+  config.callback = uart_rx_dma_callback;
+  if (!dma_configure_stream(&config)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "RX DMA stream not set up by uart_init"); return;
+  }
+
+  *ring = (uart_rx_ring_t){.buf = buf, .mask = size - 1};
+  dma_transfer_t rx_transfer = {
+      .instance = instance,
+      .stream = stream,
+      .src = (void *)UART_REG(RDR, channel),
+      .dest = buf,
+      .size = size,
+      .context = (void *)(uintptr_t)channel,
+      .circular = true,
+  };
+  if (!dma_start_transfer(&rx_transfer, NULL)) {
+    TI_SET_ERRC(errc, TI_ERRC_INTERNAL, "Failed to start RX DMA"); return;
+  }
+  ring->active = true;
+
+  // A stale idle flag would end an empty frame straight away
+  *UART_REG(ICR, channel) = USARTx_ICR_IDLECF.msk | USARTx_ICR_ORECF.msk;
+  SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_EIE);
+  SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAR);
+  SET_FIELD(UART_REG(CR1, channel), USARTx_CR1_IDLEIE);
+  uart_enable_irq(channel);
+}
+
+void uart_rx_ring_stop(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || !uart_rx_rings[channel].active) {
+    return;
+  }
+  CLR_FIELD(UART_REG(CR1, channel), USARTx_CR1_IDLEIE);
+  CLR_FIELD(UART_REG(CR3, channel), USARTx_CR3_EIE);
+  CLR_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAR);
+  dma_abort_transfer(uart_to_dma[channel].rx_instance, uart_to_dma[channel].rx_stream, NULL);
+  uart_rx_rings[channel].active = false;
+  dma_configure_stream(&uart_rx_stream_config[channel]);
+}
+
+uint32_t uart_read_available(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || !uart_rx_rings[channel].active) {
+    return 0;
+  }
+  const uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  const uint32_t pending = uart_rx_sync(channel) - ring->tail;
+  return pending > ring->mask + 1 ? ring->mask + 1 : pending;
+}
+
+uint32_t uart_read_some(uart_channel_t channel, uint8_t *dst, uint32_t max, bool *frame_end,
+                        enum ti_errc_t *errc) {
+  if (errc) *errc = TI_ERRC_NONE;
+  if (frame_end) *frame_end = false;
+  if (channel >= UART_CHANNEL_COUNT || !verify_transfer_parameters(channel, dst, max)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return 0;
+  }
+  uart_rx_ring_t *ring = &uart_rx_rings[channel];
+  if (!ring->active) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Receive ring not started"); return 0;
+  }
+
+  const uint32_t size = ring->mask + 1;
+  const uint32_t head = uart_rx_sync(channel);
+  uint32_t tail = ring->tail;
+  if (head - tail > size) {
+    // The stream lapped the reader; everything older than one ring is gone
+    ring->stats.dropped += head - tail - size;
+    tail = head - size;
+  }
+
+  // Stop at the first frame end ahead of tail, dropping any the overflow skipped
+  uint32_t limit = head;
+  bool ends_frame = false;
+  uint32_t rd = ring->frame_rd;
+  const uint32_t wr = __atomic_load_n(&ring->frame_wr, __ATOMIC_ACQUIRE);
+  for (; rd != wr; rd++) {
+    const uint32_t end = ring->frame_end[rd & (UART_RX_FRAME_SLOTS - 1)];
+    if ((int32_t)(end - tail) > 0) {
+      limit = end;
+      ends_frame = true;
+      break;
+    }
+  }
+
+  uint32_t count = limit - tail;
+  if (count > max) {
+    count = max;
+    ends_frame = false;
+  }
+  const uint32_t start = tail & ring->mask;
+  const uint32_t first = (count < size - start) ? count : size - start;
+  memcpy(dst, ring->buf + start, first);
+  memcpy(dst + first, ring->buf, count - first);
+  ring->tail = tail + count;
+  if (ends_frame) {
+    rd++;
+    if (frame_end) *frame_end = true;
+  }
+  __atomic_store_n(&ring->frame_rd, rd, __ATOMIC_RELEASE);
+
+  if (ring->stats.dropped != ring->reported_drops) {
+    ring->reported_drops = ring->stats.dropped;
+    TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "UART receive ring overflowed");
+  } else if (ring->failed) {
+    TI_SET_ERRC(errc, TI_ERRC_BUS, "UART RX DMA stream failed");
+  }
+  return count;
+}
+
+void uart_rx_get_stats(uart_channel_t channel, uart_rx_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    *out = (uart_rx_stats_t){0};
+    return;
+  }
+  *out = uart_rx_rings[channel].stats;
+}
+
+void uart_tx_queue_start(uart_channel_t channel, uint8_t *buf, uint32_t size, dma_callback_t done,
+                         void *context, enum ti_errc_t *errc) {
+  if (errc) *errc = TI_ERRC_NONE;
+  if (channel >= UART_CHANNEL_COUNT || !verify_transfer_parameters(channel, buf, size)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return;
+  }
+  if (size < 2 || size > DMA_MAX_ITEMS || (size & (size - 1)) != 0) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Queue size must be a power of two"); return;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  if (queue->active || uart_busy[channel] ||
+      dma_stream_busy(uart_to_dma[channel].tx_instance, uart_to_dma[channel].tx_stream)) {
+    TI_SET_ERRC(errc, TI_ERRC_BUSY, "TX stream busy"); return;
+  }
+
+  dma_config_t config = uart_tx_stream_config[channel];
+  config.direction = MEM_TO_PERIPH;
+  config.src_data_size = DMA_DATA_SIZE_BYTE;
+  config.dest_data_size = DMA_DATA_SIZE_BYTE;
+  config.fifo_enabled = false;
+  config.callback = uart_tx_dma_callback;
+  if (!dma_configure_stream(&config)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "TX DMA stream not set up by uart_init"); return;
+  }
+
+  *queue = (uart_tx_queue_t){.buf = buf, .mask = size - 1, .done = done, .context = context};
+  queue->active = true;
+  SET_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAT);
+  uart_enable_irq(channel);
+}
+
+void uart_tx_queue_stop(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || !uart_tx_queues[channel].active) {
+    return;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  CLR_FIELD(UART_REG(CR1, channel), USARTx_CR1_TCIE);
+  CLR_FIELD(UART_REG(CR3, channel), USARTx_CR3_DMAT);
+  dma_abort_transfer(uart_to_dma[channel].tx_instance, uart_to_dma[channel].tx_stream, NULL);
+  queue->active = false;
+  queue->busy = false;
+  dma_configure_stream(&uart_tx_stream_config[channel]);
+}
+
+void uart_write_queued(uart_channel_t channel, const uint8_t *data, uint32_t size,
+                       enum ti_errc_t *errc) {
+  if (errc) *errc = TI_ERRC_NONE;
+  if (channel >= UART_CHANNEL_COUNT || !verify_transfer_parameters(channel, data, size)) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Invalid params"); return;
+  }
+  uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  if (!queue->active) {
+    TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transmit queue not started"); return;
+  }
+
+  // Only the writer moves head, so the space can only grow under it
+  const uint32_t qsize = queue->mask + 1;
+  const uint32_t head = queue->head;
+  const uint32_t depth = head - __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+  if (size > qsize - depth) {
+    queue->stats.overflows++;
+    TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Transmit queue full"); return;
+  }
+  const uint32_t start = head & queue->mask;
+  const uint32_t first = (size < qsize - start) ? size : qsize - start;
+  memcpy(queue->buf + start, data, first);
+  memcpy(queue->buf, data + first, size - first);
+  __atomic_store_n(&queue->head, head + size, __ATOMIC_RELEASE);
+
+  queue->stats.bytes_queued += size;
+  if (depth + size > queue->stats.peak_depth) {
+    queue->stats.peak_depth = depth + size;
+  }
+  uart_tx_kick(channel);
+}
+
+uint32_t uart_tx_pending(uart_channel_t channel) {
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT || !uart_tx_queues[channel].active) {
+    return 0;
+  }
+  const uart_tx_queue_t *queue = &uart_tx_queues[channel];
+  return queue->head - queue->tail;
+}
+
+void uart_tx_get_stats(uart_channel_t channel, uart_tx_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  if (channel == 0 || channel >= UART_CHANNEL_COUNT) {
+    *out = (uart_tx_stats_t){0};
+    return;
+  }
+  *out = uart_tx_queues[channel].stats;
+}
@@ -20,18 +20,12 @@
  */
 #pragma once
 #include "dma.h"
-#include "../internal/mmio.h"
+#include "internal/mmio.h"
 #include "errc.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
-/**************************************************************************************************
- * @section Data Structures
- **************************************************************************************************/
-// NOLINTNEXTLINE(readability-identifier-naming)
-static const rw_reg32_t **UARTx_CRx;
-
 /**************************************************************************************************
  * @section Type Definitions
  **************************************************************************************************/
@@ -59,12 +53,30 @@ typedef enum {
   UART_DATALENGTH_9,
 } uart_datalength_t;
 
+/** @brief Longest driver enable assertion or deassertion time, in sample times (1/16 bit). */
+#define UART_RS485_MAX_DE_TIME 31U
+
+/**
+ * @brief RS485 half-duplex settings. The USART drives the transceiver's DE pin itself: it is
+ *        raised assertion_time before each start bit and dropped deassertion_time after the last
+ *        stop bit of the transfer, so no software runs on turnaround. Times are in sample times
+ *        (1/16 of a bit at 16x oversampling), 0 to UART_RS485_MAX_DE_TIME.
+ */
+typedef struct {
+  bool enabled;
+  uint8_t de_pin;           // pin wired to the transceiver's DE; must carry the channel's DE signal
+  bool de_active_low;       // DE asserted low instead of high
+  uint8_t assertion_time;   // DE to start bit
+  uint8_t deassertion_time; // end of last stop bit to DE released
+} uart_rs485_config_t;
+
 typedef struct {
   uart_channel_t channel;
   uart_parity_t parity;
   uart_datalength_t data_length;
   uint32_t clk_freq;
   uint32_t baud_rate;
+  uart_rs485_config_t rs485; // zeroed leaves driver enable off
 } uart_config_t;
 
 typedef struct {
@@ -72,6 +84,34 @@ typedef struct {
   uart_channel_t channel;
 } uart_context_t;
 
+/** @brief Longest uart_write_blocking waits on each byte, in microseconds: for room in the FIFO,
+ *         then for the byte to leave the line. A character at 1200 baud plus slack. */
+#define UART_TX_TIMEOUT_US 10000U
+
+/** @brief Longest uart_read_blocking waits for each byte to arrive, in microseconds. */
+#define UART_RX_TIMEOUT_US 1000000U
+
+/** @brief Idle-line frame ends the receive ring holds before uart_read_some catches up. More
+ *         than this many unread frames run together. Power of two. */
+#define UART_RX_FRAME_SLOTS 16
+
+/** @brief Receive ring counters since uart_rx_ring_start. */
+typedef struct {
+  uint32_t frames;      // idle lines that ended a frame
+  uint32_t dropped;     // bytes overwritten before they were read
+  uint32_t line_errors; // overrun, framing, noise and parity errors flagged by the USART
+} uart_rx_stats_t;
+
+/** @brief Transmit queue counters since uart_tx_queue_start. */
+typedef struct {
+  uint32_t bytes_queued;  // bytes accepted by uart_write_queued
+  uint32_t bytes_sent;    // bytes the TX stream has handed to the USART
+  uint32_t dma_transfers; // runs of bytes given to the TX stream
+  uint32_t completions;   // times the queue drained and the line went quiet
+  uint32_t overflows;     // writes refused for lack of space
+  uint32_t peak_depth;    // most bytes ever waiting at once
+} uart_tx_stats_t;
+
 /**************************************************************************************************
  * @section Function Definitions
  **************************************************************************************************/
@@ -115,7 +155,8 @@ void uart_read_async(uart_channel_t channel, uint8_t *rx_buff, uint32_t size, en
  * @param channel USART channel
  * @param tx_buff Pointer to the data buffer to be transmitted.
  * @param size Number of bytes to transmit.
- * @param errc Pointer to error status output.
+ * @param errc Pointer to error status output. TI_ERRC_TIMEOUT if a byte takes longer than
+ * UART_TX_TIMEOUT_US, so the call blocks for at most size * UART_TX_TIMEOUT_US.
  */
 void uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
                              uint32_t size, enum ti_errc_t *errc);
@@ -127,10 +168,130 @@ void uart_write_blocking(uart_channel_t channel, uint8_t *tx_buff,
  * @param channel USART channel
  * @param rx_buff Pointer to the buffer where received data will be stored.
  * @param size Number of bytes to read.
- * @param errc Pointer to error status output.
+ * @param errc Pointer to error status output. TI_ERRC_TIMEOUT if a byte takes longer than
+ * UART_RX_TIMEOUT_US to arrive.
  */
 void uart_read_blocking(uart_channel_t channel, uint8_t *rx_buff,
                             uint32_t size, enum ti_errc_t *errc);
 
+/**
+ * @brief Starts receiving continuously into a ring buffer.
+ *
+ * The channel's RX DMA stream runs in circular mode from RDR into @p buf, so bytes keep landing
+ * while the caller is busy elsewhere, and an idle line marks the end of a frame. Read the ring
+ * with uart_read_available and uart_read_some. If the reader falls a whole ring behind, the
+ * oldest bytes are overwritten and the next uart_read_some reports it. Call after uart_init;
+ * uart_read_async is refused until uart_rx_ring_stop.
+ *
+ * @param channel USART channel
+ * @param buf Ring storage, reachable by DMA1/DMA2 (not DTCM). Must stay valid until
+ *        uart_rx_ring_stop.
+ * @param size Size of @p buf in bytes: a power of two, at least 2 and below DMA_MAX_ITEMS.
+ * @param errc Pointer to error status output.
+ */
+void uart_rx_ring_start(uart_channel_t channel, uint8_t *buf, uint32_t size, enum ti_errc_t *errc);
+
+/**
+ * @brief Stops the receive ring and gives the RX DMA stream back to uart_read_async. Unread bytes
+ * are discarded.
+ *
+ * @param channel USART channel
+ */
+void uart_rx_ring_stop(uart_channel_t channel);
+
+/**
+ * @brief Counts the received bytes waiting in the ring, across frames. Never blocks.
+ *
+ * @param channel USART channel
+ * @return Bytes uart_read_some can return, or 0 if the ring isn't running.
+ */
+uint32_t uart_read_available(uart_channel_t channel);
+
+/**
+ * @brief Copies received bytes out of the ring. Never blocks, and never crosses the end of a
+ * frame, so a call returns bytes from one frame at most.
+ *
+ * Bytes are still returned alongside TI_ERRC_OVERFLOW (the ring overflowed and the oldest bytes
+ * were dropped since the last call) and TI_ERRC_BUS (the RX DMA stream failed and reception
+ * stopped).
+ *
+ * @param channel USART channel
+ * @param dst Destination buffer.
+ * @param max Size of @p dst in bytes.
+ * @param frame_end Set when the bytes returned finish a frame. May be NULL.
+ * @param errc Pointer to error status output.
+ * @return Bytes copied to @p dst.
+ */
+uint32_t uart_read_some(uart_channel_t channel, uint8_t *dst, uint32_t max, bool *frame_end,
+                        enum ti_errc_t *errc);
+
+/**
+ * @brief Reads the receive ring counters of a channel.
+ *
+ * @param channel USART channel
+ * @param out Counters since uart_rx_ring_start.
+ */
+void uart_rx_get_stats(uart_channel_t channel, uart_rx_stats_t *out);
+
+/**
+ * @brief Starts a transmit queue that uart_write_queued feeds.
+ *
+ * Queued bytes go out through the channel's TX DMA stream into the USART FIFO, one contiguous
+ * run of the queue per DMA transfer, with the next run started from the stream's interrupt, so
+ * back-to-back writes keep the line busy without the caller waiting on it. Once the queue
+ * drains, the USART's TC interrupt runs @p done a single time, after the last stop bit has left.
+ * Call after uart_init; uart_write_async and uart_write_blocking are refused until
+ * uart_tx_queue_stop.
+ *
+ * @param channel USART channel
+ * @param buf Queue storage, reachable by DMA1/DMA2 (not DTCM). Must stay valid until
+ *        uart_tx_queue_stop.
+ * @param size Size of @p buf in bytes: a power of two, at least 2 and below DMA_MAX_ITEMS.
+ * @param done Runs from the USART interrupt each time the line goes quiet, with success false
+ *        if the TX stream failed and dropped queued bytes. May be NULL.
+ * @param context Passed to @p done.
+ * @param errc Pointer to error status output.
+ */
+void uart_tx_queue_start(uart_channel_t channel, uint8_t *buf, uint32_t size, dma_callback_t done,
+                         void *context, enum ti_errc_t *errc);
+
+/**
+ * @brief Stops the transmit queue and gives the TX DMA stream back to uart_write_async. Bytes not
+ * yet sent are discarded.
+ *
+ * @param channel USART channel
+ */
+void uart_tx_queue_stop(uart_channel_t channel);
+
+/**
+ * @brief Copies bytes into the transmit queue and returns. Never blocks.
+ *
+ * A write goes in whole or not at all: if the queue can't hold all of it, nothing is queued and
+ * errc is TI_ERRC_OVERFLOW.
+ *
+ * @param channel USART channel
+ * @param data Bytes to send. Can be reused as soon as the call returns.
+ * @param size Number of bytes.
+ * @param errc Pointer to error status output.
+ */
+void uart_write_queued(uart_channel_t channel, const uint8_t *data, uint32_t size,
+                       enum ti_errc_t *errc);
+
+/**
+ * @brief Counts the queued bytes the TX stream hasn't finished handing to the USART.
+ *
+ * @param channel USART channel
+ * @return Bytes in the queue, or 0 if it isn't running.
+ */
+uint32_t uart_tx_pending(uart_channel_t channel);
+
+/**
+ * @brief Reads the transmit queue counters of a channel.
+ *
+ * @param channel USART channel
+ * @param out Counters since uart_tx_queue_start.
+ */
+void uart_tx_get_stats(uart_channel_t channel, uart_tx_stats_t *out);
+
 static inline bool verify_transfer_parameters(uart_channel_t channel, const uint8_t *buff,
                                        size_t size);
\ No newline at end of file
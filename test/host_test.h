@@ -0,0 +1,251 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/host_test.h
+ * @authors Joshua Beard
+ * @brief Minimal fork-per-test harness shared by the native host unit tests.
+ *
+ * Include this from exactly one translation unit per test binary. Each test case runs in a
+ * forked child so a crash in one case doesn't stop the rest from running.
+ */
+#pragma once
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef void (*test_fn_t)(void);
+
+// test case object
+typedef struct { const char* name; test_fn_t fn; } TestCase;
+#define TEST_CASE(fn) { #fn, fn }
+
+// global counters
+static int total_asserts = 0;
+static int total_failures = 0;
+
+// failure object
+typedef struct { const char* test_name; const char* msg; } Failure;
+#define MAX_FAILURES 512
+static Failure failures[MAX_FAILURES];
+static int failure_count = 0;
+
+static const char* current_test_name = NULL;
+static int failure_pipe_fd = -1;
+static int local_asserts = 0;
+static int local_failures = 0;
+
+static FILE* out_fp = NULL;
+
+// write to stdout and output file (if open)
+static void log_printf(const char* fmt, ...) {
+	va_list ap;
+	va_start(ap, fmt);
+	vfprintf(stdout, fmt, ap);
+	va_end(ap);
+
+	if (out_fp) {
+		va_list ap2;
+		va_start(ap2, fmt);
+		vfprintf(out_fp, fmt, ap2);
+		va_end(ap2);
+		fflush(out_fp);
+	}
+	fflush(stdout);
+}
+
+// monotonic clock for host micro-benchmarks
+static inline uint64_t host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// assert helper
+static void assert_check(int condition, const char* msg) {
+    local_asserts++; // count each assertion
+
+    const char* tag = condition ? "[OK]" : "[FAIL]";
+    const int tag_col = 80;
+    const int indent = 6;  
+    int tag_len = (int)strlen(tag);
+    int max_msg_len = tag_col - indent - tag_len;
+    if (max_msg_len < 0) max_msg_len = 0;
+
+    char trunc_msg[1024];
+    int msg_len = snprintf(trunc_msg, sizeof(trunc_msg), "%s", msg);
+    if (msg_len > max_msg_len) msg_len = max_msg_len;
+
+    // build aligned line into buffer, then print via log_printf
+    char linebuf[2048];
+    int pos = 0;
+    pos += snprintf(linebuf + pos, sizeof(linebuf) - pos, "    - ");
+    // append truncated message
+    if (msg_len > 0) {
+        strncat(linebuf + pos, trunc_msg, (size_t)msg_len);
+        pos = (int)strlen(linebuf);
+    }
+    int spaces = tag_col - indent - msg_len - tag_len;
+    if (spaces < 1) spaces = 1;
+    for (int i = 0; i < spaces && pos + 1 < (int)sizeof(linebuf); ++i) {
+        linebuf[pos++] = ' ';
+    }
+    // append tag and null-terminate
+    if (pos + tag_len + 2 < (int)sizeof(linebuf)) {
+        strcpy(linebuf + pos, tag);
+        pos += tag_len;
+    }
+    linebuf[pos++] = '\n';
+    linebuf[pos] = '\0';
+
+    log_printf("%s", linebuf);
+
+    if (!condition) {
+        local_failures++;
+        if (failure_pipe_fd >= 0) { // pipe to parent
+            char buf[1024];
+            int n = snprintf(buf, sizeof(buf), "%s|%s\n", current_test_name, msg);
+            if (n > 0) write(failure_pipe_fd, buf, (size_t)n);
+        }
+    }
+}
+
+// run test in forked child
+static void run_test(const TestCase* tc) {
+    int pfd[2];
+    // idea is that one failure shouldn't cause rest of tests to not run.
+    // so separate child process is made w/ fork(). pipe is used for communication w/
+    // processes-- info about failures is written to pipe.
+    if (pipe(pfd) != 0) { perror("pipe"); pfd[0] = pfd[1] = -1; }
+
+    pid_t pid = fork(); // child process for isolation
+    if (pid < 0) { perror("fork"); return; }
+
+    if (pid == 0) {
+        if (pfd[0] >= 0) close(pfd[0]);
+        failure_pipe_fd = (pfd[1] >= 0) ? pfd[1] : -1;
+
+        current_test_name = tc->name;
+        log_printf("%s\n", tc->name);
+        fflush(stdout);
+
+        failure_count = 0;
+        local_asserts = 0;
+        local_failures = 0;
+
+        tc->fn(); // execute test
+
+        // send counts to parent
+        if (failure_pipe_fd >= 0) {
+            char cntbuf[128];
+            int n = snprintf(cntbuf, sizeof(cntbuf), "__COUNTS__|%d|%d\n", local_asserts, local_failures);
+            if (n > 0) write(failure_pipe_fd, cntbuf, (size_t)n);
+            close(failure_pipe_fd);
+        }
+        exit(0);
+    }
+
+    if (pfd[1] >= 0) close(pfd[1]);
+    int status = 0;
+    waitpid(pid, &status, 0); // wait child
+
+    if (pfd[0] >= 0) {
+        FILE* rf = fdopen(pfd[0], "r");
+        if (rf) {
+            char line[1024];
+            while (fgets(line, sizeof(line), rf)) {
+                char* sep = strchr(line, '|');
+                if (!sep) continue;
+                *sep = '\0';
+                char* tname = line;
+                char* msg = sep + 1;
+                char* nl = strchr(msg, '\n');
+                if (nl) *nl = '\0';
+
+                if (strcmp(tname, "__COUNTS__") == 0) {
+                    char* second_sep = strchr(msg, '|');
+                    if (second_sep) {
+                        *second_sep = '\0';
+                        int a = atoi(msg);
+                        int f = atoi(second_sep + 1);
+                        total_asserts += a;
+                        total_failures += f;
+                    }
+                    continue;
+                }
+
+                if (failure_count < MAX_FAILURES) {
+                    failures[failure_count].test_name = strdup(tname);
+                    failures[failure_count].msg = strdup(msg);
+                    failure_count++;
+                }
+            }
+            fclose(rf);
+        } else close(pfd[0]);
+    }
+
+    if (WIFSIGNALED(status)) { // crash
+        int sig = WTERMSIG(status);
+        log_printf("    Result: CRASH (signal %d)\n", sig);
+        if (failure_count < MAX_FAILURES) {
+            failures[failure_count].test_name = tc->name;
+            failures[failure_count].msg = "test crashed (signal)";
+            failure_count++;
+        }
+        total_failures += 1;
+    }
+}
+
+// run every test case and print a summary. returns the process exit code.
+static int run_test_suite(const char* title, const char* out_path, const TestCase* tests, int num_tests) {
+    // open output file
+    out_fp = fopen(out_path, "w");
+    if (!out_fp) {
+        perror(out_path);
+        // continue without file output
+    }
+
+    log_printf("Running %s...\n", title);
+
+    for (int i = 0; i < num_tests; ++i) {
+        run_test(&tests[i]);
+    }
+
+    log_printf("\nSummary: %d/%d assertions passed, %d failed.\n",
+           total_asserts - total_failures, total_asserts, total_failures);
+
+    if (total_failures > 0) {
+        log_printf("Failures:\n");
+        for (int i = 0; i < failure_count; ++i) {
+            log_printf("  [%s] %s\n", failures[i].test_name, failures[i].msg);
+        }
+    }
+
+    if (out_fp) {
+        fclose(out_fp);
+        out_fp = NULL;
+    }
+
+    return (total_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,326 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/internal/mmio.h
+ * @authors Joshua Beard
+ * @brief Host stand-in for internal/mmio.h that moves simulated peripherals into plain memory.
+ *
+ * Put test/sim ahead of src on the include path and driver sources that include
+ * "internal/mmio.h" pick this up instead. Every field, macro and untouched register comes from the
+ * real header; only the registers listed below are redirected to sim_* storage in sim_regs.c.
+ * Link sim_regs.c into every test built against this header.
+ */
+#pragma once
+#include "../../../src/internal/mmio.h"
+
+/** @brief Simulated register file of one SPI instance. */
+typedef struct {
+    uint32_t cr1;
+    uint32_t cr2;
+    uint32_t cfg1;
+    uint32_t cfg2;
+    uint32_t ier;
+    uint32_t sr;
+    uint32_t ifcr; // write-only on the chip; the simulator applies and clears it
+    uint32_t txdr;
+    uint32_t rxdr;
+} sim_spi_regs_t;
+
+/** @brief Simulated register file of one DMA1/DMA2 controller. */
+typedef struct {
+    uint32_t lisr;
+    uint32_t hisr;
+    uint32_t lifcr; // write-only on the chip; the simulator applies and clears it
+    uint32_t hifcr;
+    struct { uint32_t cr, ndtr, par, m0ar, m1ar, fcr; } s[8];
+} sim_dmac_regs_t;
+
+/** @brief Simulated register file of one USART/UART, indexed by channel (USART1-3 and 6 are
+ *         USARTx, 4, 5, 7 and 8 UARTx, as in mmio.h). */
+typedef struct {
+    uint32_t cr1;
+    uint32_t cr2;
+    uint32_t cr3;
+    uint32_t brr;
+    uint32_t isr;
+    uint32_t icr; // write-only on the chip; the simulator applies and clears it
+    uint32_t rdr;
+    uint32_t tdr;
+} sim_usart_regs_t;
+
+/** @brief Simulated QUADSPI register file. */
+typedef struct {
+    uint32_t cr;
+    uint32_t dcr;
+    uint32_t sr;
+    uint32_t fcr; // write-only on the chip; the simulator applies and clears it
+    uint32_t dlr;
+    uint32_t ccr;
+    uint32_t ar;
+    uint32_t abr;
+    uint32_t dr;
+    uint32_t psmkr;
+    uint32_t psmar;
+    uint32_t pir;
+    uint32_t lptr;
+} sim_quadspi_regs_t;
+
+/** @brief Simulated registers of one MDMA channel, those the QSPI driver uses. */
+typedef struct {
+    uint32_t isr;  // read-only on the chip; the QUADSPI simulator sets it
+    uint32_t ifcr; // write-only on the chip; the simulator applies and clears it
+    uint32_t cr;
+    uint32_t tcr;
+    uint32_t bndtr;
+    uint32_t sar;
+    uint32_t dar;
+    uint32_t tbr;
+} sim_mdma_channel_t;
+
+/** @brief Simulated pin configuration registers of one GPIO port (A to K). */
+typedef struct {
+    uint32_t moder;
+    uint32_t ospeedr;
+    uint32_t pupdr;
+    uint32_t afrl;
+    uint32_t afrh;
+} sim_gpio_regs_t;
+
+// Backing memory for every redirected register, defined in test/sim/sim_regs.c
+extern volatile sim_spi_regs_t sim_spi[7];
+extern volatile sim_usart_regs_t sim_usart[9];
+extern volatile sim_dmac_regs_t sim_dmac[3];
+extern volatile uint32_t sim_dmamux1_ccr[16]; // DMA1 streams on channels 0-7, DMA2 on 8-15
+extern volatile uint32_t sim_dmamux2_ccr[8];
+extern volatile uint32_t sim_rcc_ahb1enr;
+extern volatile uint32_t sim_rcc_apb1lenr;
+extern volatile uint32_t sim_rcc_apb2enr;
+extern volatile uint32_t sim_nvic_iser[4];
+extern volatile sim_quadspi_regs_t sim_quadspi;
+extern volatile sim_gpio_regs_t sim_gpio[11];
+extern volatile uint32_t sim_rcc_ahb3enr;
+extern volatile uint32_t sim_rcc_ahb3rstr;
+extern volatile uint32_t sim_rcc_ahb4enr;
+extern volatile sim_mdma_channel_t sim_mdma[16];
+
+#define SIM_SPI_REG_(reg) \
+    { [1] = &sim_spi[1].reg, [2] = &sim_spi[2].reg, [3] = &sim_spi[3].reg, \
+      [4] = &sim_spi[4].reg, [5] = &sim_spi[5].reg, [6] = &sim_spi[6].reg }
+
+static rw_reg32_t const sim_SPIx_CR1[7]  = SIM_SPI_REG_(cr1);
+static rw_reg32_t const sim_SPIx_CR2[7]  = SIM_SPI_REG_(cr2);
+static rw_reg32_t const sim_SPIx_CFG1[7] = SIM_SPI_REG_(cfg1);
+static rw_reg32_t const sim_SPIx_CFG2[7] = SIM_SPI_REG_(cfg2);
+static rw_reg32_t const sim_SPIx_IER[7]  = SIM_SPI_REG_(ier);
+static rw_reg32_t const sim_SPIx_SR[7]   = SIM_SPI_REG_(sr);
+static rw_reg32_t const sim_SPIx_IFCR[7] = SIM_SPI_REG_(ifcr);
+static rw_reg32_t const sim_SPIx_TXDR[7] = SIM_SPI_REG_(txdr);
+static rw_reg32_t const sim_SPIx_RXDR[7] = SIM_SPI_REG_(rxdr);
+
+#define SIM_USART_REG_(type, reg) \
+    { [1] = (type)&sim_usart[1].reg, [2] = (type)&sim_usart[2].reg, [3] = (type)&sim_usart[3].reg, \
+      [6] = (type)&sim_usart[6].reg }
+#define SIM_UART_REG_(type, reg) \
+    { [4] = (type)&sim_usart[4].reg, [5] = (type)&sim_usart[5].reg, [7] = (type)&sim_usart[7].reg, \
+      [8] = (type)&sim_usart[8].reg }
+
+static rw_reg32_t const sim_USARTx_CR1[7] = SIM_USART_REG_(rw_reg32_t, cr1);
+static rw_reg32_t const sim_USARTx_CR2[7] = SIM_USART_REG_(rw_reg32_t, cr2);
+static rw_reg32_t const sim_USARTx_CR3[7] = SIM_USART_REG_(rw_reg32_t, cr3);
+static rw_reg32_t const sim_USARTx_BRR[7] = SIM_USART_REG_(rw_reg32_t, brr);
+static ro_reg32_t const sim_USARTx_ISR[7] = SIM_USART_REG_(ro_reg32_t, isr);
+static rw_reg32_t const sim_USARTx_ICR[7] = SIM_USART_REG_(rw_reg32_t, icr);
+static ro_reg32_t const sim_USARTx_RDR[7] = SIM_USART_REG_(ro_reg32_t, rdr);
+static rw_reg32_t const sim_USARTx_TDR[7] = SIM_USART_REG_(rw_reg32_t, tdr);
+static rw_reg32_t const sim_UARTx_CR1[9]  = SIM_UART_REG_(rw_reg32_t, cr1);
+static rw_reg32_t const sim_UARTx_CR2[9]  = SIM_UART_REG_(rw_reg32_t, cr2);
+static rw_reg32_t const sim_UARTx_CR3[9]  = SIM_UART_REG_(rw_reg32_t, cr3);
+static rw_reg32_t const sim_UARTx_BRR[9]  = SIM_UART_REG_(rw_reg32_t, brr);
+static ro_reg32_t const sim_UARTx_ISR[9]  = SIM_UART_REG_(ro_reg32_t, isr);
+static rw_reg32_t const sim_UARTx_ICR[9]  = SIM_UART_REG_(rw_reg32_t, icr);
+static ro_reg32_t const sim_UARTx_RDR[9]  = SIM_UART_REG_(ro_reg32_t, rdr);
+static rw_reg32_t const sim_UARTx_TDR[9]  = SIM_UART_REG_(rw_reg32_t, tdr);
+
+static rw_reg32_t const sim_NVIC_ISERx[4] = {
+    &sim_nvic_iser[0], &sim_nvic_iser[1], &sim_nvic_iser[2], &sim_nvic_iser[3],
+};
+
+#define SIM_DMA_STREAMS_(reg, i) \
+    { [0] = &sim_dmac[i].s[0].reg, [1] = &sim_dmac[i].s[1].reg, [2] = &sim_dmac[i].s[2].reg, \
+      [3] = &sim_dmac[i].s[3].reg, [4] = &sim_dmac[i].s[4].reg, [5] = &sim_dmac[i].s[5].reg, \
+      [6] = &sim_dmac[i].s[6].reg, [7] = &sim_dmac[i].s[7].reg }
+#define SIM_DMA_SX_(reg)  { [1] = SIM_DMA_STREAMS_(reg, 1), [2] = SIM_DMA_STREAMS_(reg, 2) }
+#define SIM_DMA_CR_(n)    { [1] = &sim_dmac[1].s[n].cr, [2] = &sim_dmac[2].s[n].cr }
+
+static ro_reg32_t const sim_DMAx_LISR[3]  = { [1] = &sim_dmac[1].lisr,  [2] = &sim_dmac[2].lisr };
+static ro_reg32_t const sim_DMAx_HISR[3]  = { [1] = &sim_dmac[1].hisr,  [2] = &sim_dmac[2].hisr };
+static rw_reg32_t const sim_DMAx_LIFCR[3] = { [1] = &sim_dmac[1].lifcr, [2] = &sim_dmac[2].lifcr };
+static rw_reg32_t const sim_DMAx_HIFCR[3] = { [1] = &sim_dmac[1].hifcr, [2] = &sim_dmac[2].hifcr };
+static rw_reg32_t const sim_DMAx_S0CR[3] = SIM_DMA_CR_(0);
+static rw_reg32_t const sim_DMAx_S1CR[3] = SIM_DMA_CR_(1);
+static rw_reg32_t const sim_DMAx_S2CR[3] = SIM_DMA_CR_(2);
+static rw_reg32_t const sim_DMAx_S3CR[3] = SIM_DMA_CR_(3);
+static rw_reg32_t const sim_DMAx_S4CR[3] = SIM_DMA_CR_(4);
+static rw_reg32_t const sim_DMAx_S5CR[3] = SIM_DMA_CR_(5);
+static rw_reg32_t const sim_DMAx_S6CR[3] = SIM_DMA_CR_(6);
+static rw_reg32_t const sim_DMAx_S7CR[3] = SIM_DMA_CR_(7);
+static rw_reg32_t const sim_DMAx_SxNDTR[3][8] = SIM_DMA_SX_(ndtr);
+static rw_reg32_t const sim_DMAx_SxPAR[3][8]  = SIM_DMA_SX_(par);
+static rw_reg32_t const sim_DMAx_SxM0AR[3][8] = SIM_DMA_SX_(m0ar);
+static rw_reg32_t const sim_DMAx_SxM1AR[3][8] = SIM_DMA_SX_(m1ar);
+static rw_reg32_t const sim_DMAx_SxFCR[3][8]  = SIM_DMA_SX_(fcr);
+
+static rw_reg32_t const sim_DMAMUXx_CxCR[3][8] = {
+    [1] = { &sim_dmamux1_ccr[0], &sim_dmamux1_ccr[1], &sim_dmamux1_ccr[2], &sim_dmamux1_ccr[3],
+            &sim_dmamux1_ccr[4], &sim_dmamux1_ccr[5], &sim_dmamux1_ccr[6], &sim_dmamux1_ccr[7] },
+    [2] = { &sim_dmamux2_ccr[0], &sim_dmamux2_ccr[1], &sim_dmamux2_ccr[2], &sim_dmamux2_ccr[3],
+            &sim_dmamux2_ccr[4], &sim_dmamux2_ccr[5], &sim_dmamux2_ccr[6], &sim_dmamux2_ccr[7] },
+};
+
+static rw_reg32_t const sim_RCC_AHB1ENR = &sim_rcc_ahb1enr;
+static rw_reg32_t const sim_RCC_APB1LENR = &sim_rcc_apb1lenr;
+static rw_reg32_t const sim_RCC_APB2ENR = &sim_rcc_apb2enr;
+static rw_reg32_t const sim_RCC_AHB3ENR = &sim_rcc_ahb3enr;
+static rw_reg32_t const sim_RCC_AHB3RSTR = &sim_rcc_ahb3rstr;
+static rw_reg32_t const sim_RCC_AHB4ENR = &sim_rcc_ahb4enr;
+
+#define SIM_GPIO_REG_(reg) \
+    { &sim_gpio[0].reg, &sim_gpio[1].reg, &sim_gpio[2].reg, &sim_gpio[3].reg, &sim_gpio[4].reg, \
+      &sim_gpio[5].reg, &sim_gpio[6].reg, &sim_gpio[7].reg, &sim_gpio[8].reg, &sim_gpio[9].reg, \
+      &sim_gpio[10].reg }
+
+static rw_reg32_t const sim_GPIOx_MODER[11]   = SIM_GPIO_REG_(moder);
+static rw_reg32_t const sim_GPIOx_OSPEEDR[11] = SIM_GPIO_REG_(ospeedr);
+static rw_reg32_t const sim_GPIOx_PUPDR[11]   = SIM_GPIO_REG_(pupdr);
+static rw_reg32_t const sim_GPIOx_AFRL[11]    = SIM_GPIO_REG_(afrl);
+static rw_reg32_t const sim_GPIOx_AFRH[11]    = SIM_GPIO_REG_(afrh);
+
+#define SIM_MDMA_REG_(reg) \
+    { &sim_mdma[0].reg,  &sim_mdma[1].reg,  &sim_mdma[2].reg,  &sim_mdma[3].reg,  \
+      &sim_mdma[4].reg,  &sim_mdma[5].reg,  &sim_mdma[6].reg,  &sim_mdma[7].reg,  \
+      &sim_mdma[8].reg,  &sim_mdma[9].reg,  &sim_mdma[10].reg, &sim_mdma[11].reg, \
+      &sim_mdma[12].reg, &sim_mdma[13].reg, &sim_mdma[14].reg, &sim_mdma[15].reg }
+
+static rw_reg32_t const sim_MDMA_CxISR[16]   = SIM_MDMA_REG_(isr);
+static rw_reg32_t const sim_MDMA_CxIFCR[16]  = SIM_MDMA_REG_(ifcr);
+static rw_reg32_t const sim_MDMA_CxCR[16]    = SIM_MDMA_REG_(cr);
+static rw_reg32_t const sim_MDMA_CxTCR[16]   = SIM_MDMA_REG_(tcr);
+static rw_reg32_t const sim_MDMA_CxBNDTR[16] = SIM_MDMA_REG_(bndtr);
+static rw_reg32_t const sim_MDMA_CxSAR[16]   = SIM_MDMA_REG_(sar);
+static rw_reg32_t const sim_MDMA_CxDAR[16]   = SIM_MDMA_REG_(dar);
+static rw_reg32_t const sim_MDMA_CxTBR[16]   = SIM_MDMA_REG_(tbr);
+
+// Polled transfers talk to SR, TXDR and RXDR frame by frame, so those go through accessors that
+// let the simulator collect each TXDR write, clock it and present the answer in RXDR. Defined in
+// test/sim/spi_dma_sim.c.
+rw_reg32_t const* sim_spi_sr_regs(void);
+rw_reg32_t const* sim_spi_txdr_regs(void);
+rw_reg32_t const* sim_spi_rxdr_regs(void);
+
+// The QUADSPI starts commands on CCR/AR writes and moves data through DR, so all its registers go
+// through an accessor that lets the simulator act on the previous access first. QUADSPI_DR and
+// QUADSPI_DR8 get their own, as the width of a data register access is how many bytes it moves.
+// Defined in test/sim/qspi_reg_sim.c; tests that don't link it never expand these.
+rw_reg32_t sim_qspi_reg(volatile uint32_t* reg);
+rw_reg32_t sim_qspi_dr(void);
+rw_reg8_t sim_qspi_dr8(void);
+
+// MDMA channel registers go through an accessor too, which applies IFCR writes and counts the
+// access, so tests can weigh what setting up a transfer costs. Also in test/sim/qspi_reg_sim.c.
+rw_reg32_t const* sim_mdma_regs(rw_reg32_t const* regs);
+
+#define SPIx_CR1   sim_SPIx_CR1
+#define SPIx_CR2   sim_SPIx_CR2
+#define SPIx_CFG1  sim_SPIx_CFG1
+#define SPIx_CFG2  sim_SPIx_CFG2
+#define SPIx_IER   sim_SPIx_IER
+#define SPIx_SR    (sim_spi_sr_regs())
+#define SPIx_IFCR  sim_SPIx_IFCR
+#define SPIx_TXDR  (sim_spi_txdr_regs())
+#define SPIx_RXDR  (sim_spi_rxdr_regs())
+#define NVIC_ISERx sim_NVIC_ISERx
+
+#define USARTx_CR1 sim_USARTx_CR1
+#define USARTx_CR2 sim_USARTx_CR2
+#define USARTx_CR3 sim_USARTx_CR3
+#define USARTx_BRR sim_USARTx_BRR
+#define USARTx_ISR sim_USARTx_ISR
+#define USARTx_ICR sim_USARTx_ICR
+#define USARTx_RDR sim_USARTx_RDR
+#define USARTx_TDR sim_USARTx_TDR
+#define UARTx_CR1  sim_UARTx_CR1
+#define UARTx_CR2  sim_UARTx_CR2
+#define UARTx_CR3  sim_UARTx_CR3
+#define UARTx_BRR  sim_UARTx_BRR
+#define UARTx_ISR  sim_UARTx_ISR
+#define UARTx_ICR  sim_UARTx_ICR
+#define UARTx_RDR  sim_UARTx_RDR
+#define UARTx_TDR  sim_UARTx_TDR
+
+#define DMAx_LISR      sim_DMAx_LISR
+#define DMAx_HISR      sim_DMAx_HISR
+#define DMAx_LIFCR     sim_DMAx_LIFCR
+#define DMAx_HIFCR     sim_DMAx_HIFCR
+#define DMAx_S0CR      sim_DMAx_S0CR
+#define DMAx_S1CR      sim_DMAx_S1CR
+#define DMAx_S2CR      sim_DMAx_S2CR
+#define DMAx_S3CR      sim_DMAx_S3CR
+#define DMAx_S4CR      sim_DMAx_S4CR
+#define DMAx_S5CR      sim_DMAx_S5CR
+#define DMAx_S6CR      sim_DMAx_S6CR
+#define DMAx_S7CR      sim_DMAx_S7CR
+#define DMAx_SxNDTR    sim_DMAx_SxNDTR
+#define DMAx_SxPAR     sim_DMAx_SxPAR
+#define DMAx_SxM0AR    sim_DMAx_SxM0AR
+#define DMAx_SxM1AR    sim_DMAx_SxM1AR
+#define DMAx_SxFCR     sim_DMAx_SxFCR
+#define DMAMUXx_CxCR   sim_DMAMUXx_CxCR
+#define RCC_AHB1ENR    sim_RCC_AHB1ENR
+#define RCC_APB1LENR   sim_RCC_APB1LENR
+#define RCC_APB2ENR    sim_RCC_APB2ENR
+#define RCC_AHB3ENR    sim_RCC_AHB3ENR
+#define RCC_AHB3RSTR   sim_RCC_AHB3RSTR
+#define RCC_AHB4ENR    sim_RCC_AHB4ENR
+
+#define GPIOx_MODER    sim_GPIOx_MODER
+#define GPIOx_OSPEEDR  sim_GPIOx_OSPEEDR
+#define GPIOx_PUPDR    sim_GPIOx_PUPDR
+#define GPIOx_AFRL     sim_GPIOx_AFRL
+#define GPIOx_AFRH     sim_GPIOx_AFRH
+
+#define QUADSPI_CR     (sim_qspi_reg(&sim_quadspi.cr))
+#define QUADSPI_DCR    (sim_qspi_reg(&sim_quadspi.dcr))
+#define QUADSPI_SR     ((ro_reg32_t)sim_qspi_reg(&sim_quadspi.sr))
+#define QUADSPI_FCR    (sim_qspi_reg(&sim_quadspi.fcr))
+#define QUADSPI_DLR    (sim_qspi_reg(&sim_quadspi.dlr))
+#define QUADSPI_CCR    (sim_qspi_reg(&sim_quadspi.ccr))
+#define QUADSPI_AR     (sim_qspi_reg(&sim_quadspi.ar))
+#define QUADSPI_ABR    (sim_qspi_reg(&sim_quadspi.abr))
+#define QUADSPI_DR     (sim_qspi_dr())
+#define QUADSPI_DR8    (sim_qspi_dr8())
+#define QUADSPI_PSMKR  (sim_qspi_reg(&sim_quadspi.psmkr))
+#define QUADSPI_PSMAR  (sim_qspi_reg(&sim_quadspi.psmar))
+#define QUADSPI_PIR    (sim_qspi_reg(&sim_quadspi.pir))
+#define QUADSPI_LPTR   (sim_qspi_reg(&sim_quadspi.lptr))
+
+#define MDMA_MDMA_C0ISR    ((ro_reg32_t)sim_mdma_regs(sim_MDMA_CxISR)[0])
+#define MDMA_MDMA_C0IFCR   (sim_mdma_regs(sim_MDMA_CxIFCR)[0])
+#define MDMA_MDMA_CxCR     (sim_mdma_regs(sim_MDMA_CxCR))
+#define MDMA_MDMA_CxTCR    (sim_mdma_regs(sim_MDMA_CxTCR))
+#define MDMA_MDMA_CxBNDTR  (sim_mdma_regs(sim_MDMA_CxBNDTR))
+#define MDMA_MDMA_CxSAR    (sim_mdma_regs(sim_MDMA_CxSAR))
+#define MDMA_MDMA_CxDAR    (sim_mdma_regs(sim_MDMA_CxDAR))
+#define MDMA_MDMA_CxTBR    (sim_mdma_regs(sim_MDMA_CxTBR))
@@ -0,0 +1,60 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/qspi_mmap_sim.c
+ * @authors Joshua Beard
+ * @brief File mapped at the QUADSPI memory-mapped window, standing in for the flash on the host.
+ */
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "peripheral/qspi.h"
+#include "sim_nor_flash.h"
+#include "qspi_mmap_sim.h"
+
+static uint8_t* window = NULL;
+
+bool sim_qspi_mmap_open(const char* path) {
+    if (window) return false;
+    const int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    if (ftruncate(fd, SIM_NOR_SIZE) != 0) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap((void*)(uintptr_t)QSPI_MAPPED_BASE, SIM_NOR_SIZE, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FIXED_NOREPLACE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if (map != (void*)(uintptr_t)QSPI_MAPPED_BASE) {
+        if (map != MAP_FAILED) munmap(map, SIM_NOR_SIZE);
+        return false;
+    }
+    window = map;
+    return true;
+}
+
+void sim_qspi_mmap_close(void) {
+    if (!window) return;
+    munmap(window, SIM_NOR_SIZE);
+    window = NULL;
+}
+
+void sim_qspi_mmap_refresh(bool well_formed) {
+    if (!window) return;
+    if (well_formed) memcpy(window, sim_nor_mem, SIM_NOR_SIZE);
+    else memset(window, 0xFF, SIM_NOR_SIZE);
+}
@@ -0,0 +1,44 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/qspi_mmap_sim.h
+ * @authors Joshua Beard
+ * @brief File mapped at the QUADSPI memory-mapped window, standing in for the flash on the host.
+ *
+ * In memory-mapped mode the driver hands out QSPI_MAPPED_BASE as a pointer and callers read the
+ * flash with plain loads. On the host that address is given a shared mapping of a file the size
+ * of the flash, so the same pointer works, and the file is a flash image other tools can read.
+ * The register sim copies the NOR model's array into it each time memory-mapped mode is entered;
+ * with the sim not linked, whatever the file holds (a dump pulled off the board, say) is the flash.
+ */
+#pragma once
+#include <stdbool.h>
+
+/**
+ * @brief Maps @p path at QSPI_MAPPED_BASE, creating it or growing it to the flash size.
+ * @return False if the file can't be opened or the address is already taken.
+ */
+bool sim_qspi_mmap_open(const char* path);
+
+/** @brief Unmaps the file. The file itself stays. */
+void sim_qspi_mmap_close(void);
+
+/**
+ * @brief Called by the register sim on entering memory-mapped mode: copies the NOR model's array
+ *        into the mapping, or fills it with 0xFF for a command the part would misread. Does
+ *        nothing with no file mapped.
+ */
+void sim_qspi_mmap_refresh(bool well_formed);
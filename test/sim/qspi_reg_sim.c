@@ -0,0 +1,381 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/qspi_reg_sim.c
+ * @authors Joshua Beard
+ * @brief Simulated QUADSPI register block with the NOR flash model behind it.
+ */
+#include <stdbool.h>
+#include <string.h>
+#include "internal/mmio.h"
+#include "qspi_reg_sim.h"
+#include "qspi_mmap_sim.h"
+
+/**************************************************************************************************
+ * @section Simulated State
+ **************************************************************************************************/
+
+#define SIM_QSPI_FIFO_SIZE 32U
+#define SIM_QSPI_MAX_DATA  65536U
+
+#define FMODE_WRITE 0U
+#define FMODE_READ  1U
+#define FMODE_POLL  2U
+#define FMODE_MAPPED 3U
+
+#define SIM_MDMA_CHANNELS    16U
+#define SIM_MDMA_QSPI_FIFO   22U          // TSEL of the QUADSPI FIFO threshold request
+#define SIM_QSPI_DR_ADDRESS  0x52005020U
+#define SIM_QSPI_IRQ_NUM     92U
+#define SIM_MDMA_IRQ_NUM     122U
+#define SIM_ITCM_END         0x00010000U
+#define SIM_DTCM_START       0x20000000U
+#define SIM_DTCM_END         0x20020000U
+
+typedef struct {
+    bool active;
+    uint32_t fmode;
+    sim_nor_frame_t frame;
+    bool well_formed;
+    uint32_t address;
+    uint32_t length;
+    uint32_t pos;            // bytes moved through DR so far
+    uint8_t data[SIM_QSPI_MAX_DATA];
+} sim_qspi_cmd_t;
+
+sim_qspi_stats_t sim_qspi_stats;
+
+static sim_qspi_cmd_t cmd;
+static bool ccr_written;
+static bool ar_written;
+static bool fcr_written;
+static bool mapped;              // in memory-mapped mode until an abort
+static uint32_t mapped_ccr;      // the CCR it was entered with
+static bool waiting_for_address; // CCR written, command starts on the AR write
+static uint32_t dr_pending;      // width of a DR write that hasn't landed yet
+static bool dma_error_next;      // the next MDMA data phase stops on a bus error
+
+/**************************************************************************************************
+ * @section Helpers
+ **************************************************************************************************/
+
+static uint32_t sim_qspi_field(uint32_t reg, field32_t field) {
+    return (reg & field.msk) >> field.pos;
+}
+
+uint32_t sim_qspi_sck_hz(void) {
+    return SIM_QSPI_KERNEL_HZ / (sim_qspi_field(sim_quadspi.cr, QUADSPI_CR_PRESCALER) + 1U);
+}
+
+static uint8_t sim_qspi_lines(uint32_t mode) {
+    static const uint8_t lines[4] = {0, 1, 2, 4};
+    return lines[mode & 3U];
+}
+
+static void sim_qspi_complete(bool transfer_complete) {
+    cmd.active = false;
+    sim_quadspi.sr &= ~QUADSPI_SR_BUSY.msk;
+    if (transfer_complete) sim_quadspi.sr |= QUADSPI_SR_TCF.msk;
+}
+
+// Hands a finished write command to the model
+static void sim_qspi_run_write(void) {
+    if (cmd.well_formed) sim_nor_command(cmd.frame.instruction, cmd.address, cmd.data, cmd.length);
+    sim_qspi_complete(true);
+}
+
+// The frame CCR describes
+static void sim_qspi_decode(uint32_t ccr, sim_nor_frame_t* frame) {
+    memset(frame, 0, sizeof(*frame));
+    frame->instruction = (uint8_t)sim_qspi_field(ccr, QUADSPI_CCR_INSTRUCTION);
+    frame->instruction_lines = sim_qspi_lines(sim_qspi_field(ccr, QUADSPI_CCR_IMODE));
+    frame->address_lines = sim_qspi_lines(sim_qspi_field(ccr, QUADSPI_CCR_ADMODE));
+    if (frame->address_lines) frame->address_bytes = (uint8_t)(sim_qspi_field(ccr, QUADSPI_CCR_ADSIZE) + 1U);
+    frame->alternate_lines = sim_qspi_lines(sim_qspi_field(ccr, QUADSPI_CCR_ABMODE));
+    if (frame->alternate_lines) frame->alternate_bytes = (uint8_t)(sim_qspi_field(ccr, QUADSPI_CCR_ABSIZE) + 1U);
+    frame->dummy_cycles = (uint8_t)sim_qspi_field(ccr, QUADSPI_CCR_DCYC);
+    frame->data_lines = sim_qspi_lines(sim_qspi_field(ccr, QUADSPI_CCR_DMODE));
+}
+
+// Memory-mapped mode: the part is read with the CCR's command from then on, which the file
+// mapping stands in for. Only reads make sense there.
+static void sim_qspi_enter_mapped(void) {
+    sim_nor_frame_t frame;
+    sim_qspi_decode(sim_quadspi.ccr, &frame);
+    const bool read = frame.instruction == 0x03 || frame.instruction == 0x0B ||
+                      frame.instruction == 0x6B || frame.instruction == 0xEB;
+    const bool ok = sim_nor_frame_ok(&frame) && read && sim_nor_busy_ns() == 0;
+    if (!ok) sim_qspi_stats.mapped_malformed++;
+    sim_qspi_stats.mapped_entries++;
+    sim_qspi_mmap_refresh(ok);
+    mapped = true;
+    mapped_ccr = sim_quadspi.ccr;
+    sim_quadspi.sr |= QUADSPI_SR_BUSY.msk;
+}
+
+// The host address an MDMA address register holds. The driver can only store the low half of a
+// pointer, so the high half is taken from this file's own statics: DMA buffers have to be statics
+// too, and the test built without PIE so no 4GB boundary falls between them.
+static uint8_t* sim_mdma_host_ptr(uint32_t address) {
+    return (uint8_t*)(((uintptr_t)&cmd & ~(uintptr_t)UINT32_MAX) | address);
+}
+
+// Whether an MDMA channel is set up the way a QUADSPI data phase of the command needs: the
+// peripheral side on DR and fixed, the memory side incrementing by the data size, both sides the
+// same size, one FIFO threshold per request and a block of exactly DLR + 1 bytes
+static bool sim_mdma_channel_ok(volatile sim_mdma_channel_t* ch) {
+    const uint32_t tcr = ch->tcr;
+    const uint32_t size = sim_qspi_field(tcr, MDMA_MDMA_CxTCR_SSIZE);
+    const bool read = cmd.fmode == FMODE_READ;
+    const uint32_t dr_inc = sim_qspi_field(tcr, read ? MDMA_MDMA_CxTCR_SINC : MDMA_MDMA_CxTCR_DINC);
+    const uint32_t mem_inc = sim_qspi_field(tcr, read ? MDMA_MDMA_CxTCR_DINC : MDMA_MDMA_CxTCR_SINC);
+    const uint32_t mem_incos = sim_qspi_field(tcr, read ? MDMA_MDMA_CxTCR_DINCOS : MDMA_MDMA_CxTCR_SINCOS);
+    return (read ? ch->sar : ch->dar) == SIM_QSPI_DR_ADDRESS &&
+           size == sim_qspi_field(tcr, MDMA_MDMA_CxTCR_DSIZE) && size <= 2U &&
+           dr_inc == 0 && mem_inc == 2U && mem_incos == size &&
+           sim_qspi_field(tcr, MDMA_MDMA_CxTCR_TLEN) == sim_qspi_field(sim_quadspi.cr, QUADSPI_CR_FTHRES) &&
+           sim_qspi_field(tcr, MDMA_MDMA_CxTCR_TRGM) == 0 && sim_qspi_field(tcr, MDMA_MDMA_CxTCR_SWRM) == 0 &&
+           (cmd.length % (1U << size)) == 0 &&
+           sim_qspi_field(ch->bndtr, MDMA_MDMA_CxBNDTR_BNDT) == cmd.length;
+}
+
+// With DMAEN set, the enabled MDMA channel on the FIFO request moves the whole data phase as soon
+// as the command starts. A channel set up wrong, or with the memory side on the wrong bus (the TCMs
+// are only on AHBS, everything else only on AXI), moves nothing and stops with a transfer error;
+// the QUADSPI then waits on its FIFO, busy, until the command is aborted.
+static void sim_qspi_dma(void) {
+    volatile sim_mdma_channel_t* ch = NULL;
+    for (uint32_t c = 0; c < SIM_MDMA_CHANNELS && ch == NULL; c++) {
+        if ((sim_mdma[c].cr & MDMA_MDMA_CxCR_EN.msk) &&
+            sim_qspi_field(sim_mdma[c].tbr, MDMA_MDMA_CxTBR_TSEL) == SIM_MDMA_QSPI_FIFO) ch = &sim_mdma[c];
+    }
+    if (ch == NULL || cmd.length == 0) return; // the FIFO waits for a CPU that isn't coming
+
+    sim_qspi_stats.dma_transfers++;
+    const bool read = cmd.fmode == FMODE_READ;
+    const uint32_t memory = read ? ch->dar : ch->sar;
+    const bool tcm = memory < SIM_ITCM_END || (memory >= SIM_DTCM_START && memory < SIM_DTCM_END);
+    const bool ahbs = (ch->tbr & (read ? MDMA_MDMA_CxTBR_DBUS : MDMA_MDMA_CxTBR_SBUS).msk) != 0;
+    const bool dr_ahbs = (ch->tbr & (read ? MDMA_MDMA_CxTBR_SBUS : MDMA_MDMA_CxTBR_DBUS).msk) != 0;
+    bool ok = sim_mdma_channel_ok(ch);
+    if (!ok) sim_qspi_stats.dma_malformed++;
+    else if (tcm != ahbs || dr_ahbs || dma_error_next) {
+        sim_qspi_stats.dma_bus_errors++;
+        ok = false;
+    }
+    dma_error_next = false;
+    if (!ok) {
+        ch->isr |= MDMA_MDMA_C0ISR_TEIF0.msk;
+        ch->cr &= ~MDMA_MDMA_CxCR_EN.msk;
+        return;
+    }
+    if (read) {
+        memcpy(sim_mdma_host_ptr(ch->dar), cmd.data, cmd.length);
+        sim_qspi_complete(true);
+    } else {
+        memcpy(cmd.data, sim_mdma_host_ptr(ch->sar), cmd.length);
+        cmd.pos = cmd.length;
+        sim_qspi_run_write();
+    }
+    ch->bndtr &= ~MDMA_MDMA_CxBNDTR_BNDT.msk;
+    ch->cr &= ~MDMA_MDMA_CxCR_EN.msk;
+    ch->isr |= MDMA_MDMA_C0ISR_CTCIF0.msk | MDMA_MDMA_C0ISR_BTIF0.msk | MDMA_MDMA_C0ISR_TCIF0.msk;
+}
+
+static void sim_qspi_start(void) {
+    sim_qspi_decode(sim_quadspi.ccr, &cmd.frame);
+    cmd.active = true;
+    cmd.fmode = sim_qspi_field(sim_quadspi.ccr, QUADSPI_CCR_FMODE);
+    cmd.address = sim_quadspi.ar;
+    cmd.length = cmd.frame.data_lines ? sim_quadspi.dlr + 1U : 0U;
+    if (cmd.length > SIM_QSPI_MAX_DATA) cmd.length = SIM_QSPI_MAX_DATA;
+    cmd.pos = 0;
+    cmd.well_formed = sim_nor_frame_ok(&cmd.frame);
+    sim_qspi_stats.commands++;
+    sim_quadspi.sr |= QUADSPI_SR_BUSY.msk;
+    sim_quadspi.sr &= ~QUADSPI_SR_TCF.msk;
+
+    const uint64_t ns = sim_nor_frame_ns(&cmd.frame, cmd.fmode == FMODE_POLL ? 1U : cmd.length, sim_qspi_sck_hz());
+    sim_qspi_stats.bus_ns += ns;
+    sim_nor_advance_ns(ns);
+    const bool dma = (sim_quadspi.cr & QUADSPI_CR_DMAEN.msk) && cmd.length > 0;
+    if (dma) sim_qspi_stats.dma_bus_ns += ns;
+
+    if (cmd.fmode == FMODE_READ) {
+        if (cmd.well_formed) sim_nor_command(cmd.frame.instruction, cmd.address, cmd.data, cmd.length);
+        else memset(cmd.data, 0xFF, cmd.length);
+        if (cmd.length == 0) sim_qspi_complete(true);
+    } else if (cmd.fmode == FMODE_WRITE && cmd.length == 0) {
+        sim_qspi_run_write();
+    }
+    if (dma && (cmd.fmode == FMODE_READ || cmd.fmode == FMODE_WRITE)) sim_qspi_dma();
+}
+
+// One automatic poll: waits out the part, then reads the status and compares
+static void sim_qspi_poll(void) {
+    const uint64_t busy_ns = sim_nor_busy_ns();
+    sim_nor_advance_ns(busy_ns);
+    uint8_t status = 0xFF;
+    if (cmd.well_formed) sim_nor_command(cmd.frame.instruction, 0, &status, 1);
+    const uint32_t mask = sim_quadspi.psmkr & 0xFFU;
+    if (((status ^ sim_quadspi.psmar) & mask) == 0) {
+        sim_quadspi.sr |= QUADSPI_SR_SMF.msk;
+        if (sim_quadspi.cr & QUADSPI_CR_APMS.msk) sim_qspi_complete(false);
+    }
+}
+
+// Acts on everything the driver did since the last register access
+static void sim_qspi_step(void) {
+    if (fcr_written) {
+        const uint32_t clear = QUADSPI_FCR_CTEF.msk | QUADSPI_FCR_CTCF.msk | QUADSPI_FCR_CSMF.msk | QUADSPI_FCR_CTOF.msk;
+        sim_quadspi.sr &= ~(sim_quadspi.fcr & clear);
+        sim_quadspi.fcr = 0;
+        fcr_written = false;
+    }
+    if (sim_quadspi.cr & QUADSPI_CR_ABORT.msk) {
+        if (cmd.active || mapped) sim_qspi_complete(true);
+        mapped = false;
+        waiting_for_address = false;
+        dr_pending = 0;
+        sim_quadspi.cr &= ~(QUADSPI_CR_ABORT.msk | QUADSPI_CR_DMAEN.msk);
+    }
+    if (dr_pending) {
+        const uint32_t value = sim_quadspi.dr;
+        for (uint32_t b = 0; b < dr_pending && cmd.active && cmd.pos < cmd.length; b++) {
+            cmd.data[cmd.pos++] = (uint8_t)(value >> (8U * b));
+        }
+        dr_pending = 0;
+        if (cmd.active && cmd.pos == cmd.length) sim_qspi_run_write();
+    }
+    if (ccr_written) {
+        ccr_written = false;
+        const uint32_t fmode = sim_qspi_field(sim_quadspi.ccr, QUADSPI_CCR_FMODE);
+        if (mapped) sim_quadspi.ccr = mapped_ccr; // ignored until an abort, as the peripheral is busy
+        else if (fmode == FMODE_MAPPED) sim_qspi_enter_mapped();
+        else if (sim_qspi_field(sim_quadspi.ccr, QUADSPI_CCR_ADMODE) == 0) sim_qspi_start();
+        else waiting_for_address = true;
+    }
+    if (ar_written) {
+        ar_written = false;
+        if (waiting_for_address) {
+            waiting_for_address = false;
+            sim_qspi_start();
+        }
+    }
+    if (cmd.active && cmd.fmode == FMODE_POLL) sim_qspi_poll();
+
+    uint32_t level = 0;
+    if (cmd.active && cmd.fmode == FMODE_READ) {
+        level = cmd.length - cmd.pos;
+        if (level > SIM_QSPI_FIFO_SIZE) level = SIM_QSPI_FIFO_SIZE;
+    }
+    sim_quadspi.sr = (sim_quadspi.sr & ~QUADSPI_SR_FLEVEL.msk) | (level << QUADSPI_SR_FLEVEL.pos);
+}
+
+// A DR access of @p width bytes: reads take the next bytes now, writes land after the call returns
+static void sim_qspi_dr_access(uint32_t width) {
+    sim_qspi_stats.dr_accesses++;
+    sim_qspi_step();
+    if (!cmd.active) return;
+    if (cmd.fmode == FMODE_READ) {
+        uint32_t value = 0;
+        for (uint32_t b = 0; b < width && cmd.pos < cmd.length; b++) {
+            value |= (uint32_t)cmd.data[cmd.pos++] << (8U * b);
+        }
+        sim_quadspi.dr = value;
+        if (cmd.pos == cmd.length) sim_qspi_complete(true);
+    } else if (cmd.fmode == FMODE_WRITE) {
+        dr_pending = width;
+    }
+}
+
+/**************************************************************************************************
+ * @section Register Accessors
+ **************************************************************************************************/
+
+void sim_qspi_reset(void) {
+    memset((void*)&sim_quadspi, 0, sizeof(sim_quadspi));
+    memset(&sim_qspi_stats, 0, sizeof(sim_qspi_stats));
+    cmd.active = false;
+    ccr_written = false;
+    ar_written = false;
+    fcr_written = false;
+    mapped = false;
+    waiting_for_address = false;
+    dr_pending = 0;
+    dma_error_next = false;
+    memset((void*)sim_mdma, 0, sizeof(sim_mdma));
+    sim_nor_reset();
+}
+
+bool sim_qspi_irq_pending(void) {
+    sim_qspi_step();
+    const uint32_t sr = sim_quadspi.sr, cr = sim_quadspi.cr;
+    const bool enabled = sim_nvic_iser[SIM_QSPI_IRQ_NUM / 32U] & (1U << (SIM_QSPI_IRQ_NUM % 32U));
+    return enabled && (((cr & QUADSPI_CR_TCIE.msk) && (sr & QUADSPI_SR_TCF.msk)) ||
+                       ((cr & QUADSPI_CR_TEIE.msk) && (sr & QUADSPI_SR_TEF.msk)));
+}
+
+// The driver only ever writes CCR, AR and FCR, so an access to one of them is a write
+rw_reg32_t sim_qspi_reg(volatile uint32_t* reg) {
+    sim_qspi_stats.register_reads++;
+    sim_qspi_step();
+    if (reg == &sim_quadspi.ccr) ccr_written = true;
+    else if (reg == &sim_quadspi.ar) ar_written = true;
+    else if (reg == &sim_quadspi.fcr) fcr_written = true;
+    return reg;
+}
+
+rw_reg32_t sim_qspi_dr(void) {
+    sim_qspi_dr_access(4);
+    return &sim_quadspi.dr;
+}
+
+rw_reg8_t sim_qspi_dr8(void) {
+    sim_qspi_dr_access(1);
+    return (rw_reg8_t)&sim_quadspi.dr;
+}
+
+// Clears the flags IFCR writes since the last MDMA access asked for
+static void sim_mdma_apply_ifcr(void) {
+    for (uint32_t c = 0; c < SIM_MDMA_CHANNELS; c++) {
+        sim_mdma[c].isr &= ~sim_mdma[c].ifcr;
+        sim_mdma[c].ifcr = 0;
+    }
+}
+
+void sim_qspi_inject_dma_error(void) {
+    dma_error_next = true;
+}
+
+bool sim_mdma_irq_pending(void) {
+    sim_mdma_apply_ifcr();
+    if (!(sim_nvic_iser[SIM_MDMA_IRQ_NUM / 32U] & (1U << (SIM_MDMA_IRQ_NUM % 32U)))) return false;
+    for (uint32_t c = 0; c < SIM_MDMA_CHANNELS; c++) {
+        const uint32_t isr = sim_mdma[c].isr, cr = sim_mdma[c].cr;
+        if (((cr & MDMA_MDMA_CxCR_TEIE.msk) && (isr & MDMA_MDMA_C0ISR_TEIF0.msk)) ||
+            ((cr & MDMA_MDMA_CxCR_CTCIE.msk) && (isr & MDMA_MDMA_C0ISR_CTCIF0.msk)) ||
+            ((cr & MDMA_MDMA_CxCR_BTIE.msk) && (isr & MDMA_MDMA_C0ISR_BTIF0.msk)) ||
+            ((cr & MDMA_MDMA_CxCR_TCIE.msk) && (isr & MDMA_MDMA_C0ISR_TCIF0.msk))) return true;
+    }
+    return false;
+}
+
+rw_reg32_t const* sim_mdma_regs(rw_reg32_t const* regs) {
+    sim_qspi_stats.mdma_accesses++;
+    sim_mdma_apply_ifcr();
+    return regs;
+}
@@ -0,0 +1,78 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/qspi_reg_sim.h
+ * @authors Joshua Beard
+ * @brief Simulated QUADSPI register block with the NOR flash model behind it.
+ *
+ * Link with peripheral/qspi.c, test/sim/sim_regs.c and test/sim/sim_nor_flash.c, and put test/sim
+ * ahead of src on the include path. Indirect commands start on the CCR write, or on the AR write
+ * when they have an address, the way the peripheral starts them; write data is collected from DR
+ * a byte or a word per access until DLR is reached and then handed to the model as one command.
+ * Read data is fetched from the model when the command starts and handed out through DR. The
+ * FIFO never fills in write mode and reads are never starved, so FLEVEL only says how much read
+ * data is left. Automatic polling jumps virtual time to the end of the part's busy time and
+ * matches on the next status read. Time advances by each command's wire time at the SCK CR sets.
+ * Entering memory-mapped mode checks the read command it is given and copies the array into the
+ * file mapping of test/sim/qspi_mmap_sim.h, which the driver's pointer then reads.
+ *
+ * With DMAEN set, a command's data phase is moved in one go by the enabled MDMA channel triggered
+ * by the FIFO threshold, as soon as the command starts. A channel set up wrong, or reaching its
+ * buffer over the wrong bus (AHBS for the TCMs, AXI for the rest), stops with a transfer error
+ * instead and leaves the QUADSPI busy. The MDMA only holds the low 32 bits of a host pointer, so
+ * DMA buffers must be statics, or mapped at their target address, and the test linked with -no-pie.
+ * Nothing runs the interrupts: tests call quadspi_irq_handler and mdma_irq_handler themselves
+ * once sim_qspi_irq_pending or sim_mdma_irq_pending says they would fire.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "sim_nor_flash.h"
+
+/** @brief Kernel clock the QUADSPI prescaler divides. */
+#define SIM_QSPI_KERNEL_HZ 200000000U
+
+/** @brief What the driver did to the register block since sim_qspi_reset. */
+typedef struct {
+    uint32_t commands;         // commands started
+    uint32_t register_reads;   // accesses to anything but DR
+    uint32_t dr_accesses;
+    uint64_t bus_ns;           // virtual time commands spent on the wire, not counting waits for the part
+    uint32_t mapped_entries;   // times memory-mapped mode was entered
+    uint32_t mapped_malformed; // of those, with a command the part would misread, or while it was busy
+    uint32_t mdma_accesses;    // accesses to the MDMA channel registers
+    uint32_t dma_transfers;    // data phases the MDMA moved, or tried to
+    uint32_t dma_malformed;    // of those, with a channel set up wrong for the command
+    uint32_t dma_bus_errors;   // of those, stopped by a bus error (wrong bus, or injected)
+    uint64_t dma_bus_ns;       // part of bus_ns spent in data phases the MDMA fed
+} sim_qspi_stats_t;
+
+extern sim_qspi_stats_t sim_qspi_stats;
+
+/** @brief Clears the register block and statistics and resets the flash model. */
+void sim_qspi_reset(void);
+
+/** @brief SCK the last command ran at. */
+uint32_t sim_qspi_sck_hz(void);
+
+/** @brief Whether the QUADSPI interrupt is enabled in the NVIC and would fire now (TCF or TEF). */
+bool sim_qspi_irq_pending(void);
+
+/** @brief Whether the MDMA interrupt is enabled in the NVIC and a channel would raise it now. */
+bool sim_mdma_irq_pending(void);
+
+/** @brief Stops the next MDMA data phase with a bus error before it moves anything. */
+void sim_qspi_inject_dma_error(void);
@@ -0,0 +1,496 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/sim_devices.c
+ * @authors Joshua Beard
+ * @brief Device models for the simulated SPI bus.
+ */
+#include <string.h>
+#include "sim_devices.h"
+
+/**************************************************************************************************
+ * @section MS5611 Barometer
+ **************************************************************************************************/
+
+#define MS5611_RESET    0x1E
+#define MS5611_D1       0x40
+#define MS5611_D2       0x50
+#define MS5611_ADC_READ 0x00
+#define MS5611_PROM     0xA0
+
+// Maximum conversion time per OSR (256, 512, 1024, 2048, 4096)
+static const uint32_t ms5611_conv_ns[5] = { 600000, 1170000, 2280000, 4540000, 9040000 };
+
+void sim_ms5611_init(sim_ms5611_t *dev) {
+    static const uint16_t prom[8] = { 0x0000, 40127, 36924, 23317, 23282, 33464, 28312, 0x0000 };
+    memset(dev, 0, sizeof(*dev));
+    memcpy(dev->prom, prom, sizeof(prom));
+    dev->d1 = 9085466;
+    dev->d2 = 8569150;
+}
+
+static void ms5611_select(void *ctx) {
+    ((sim_ms5611_t *)ctx)->pos = 0;
+}
+
+// Starts whatever the command byte asks for; later bytes shift out the 24-bit out register.
+static void ms5611_command(sim_ms5611_t *dev, uint8_t cmd) {
+    const uint8_t osr = (cmd & 0x0F) >> 1;
+    if (cmd == MS5611_RESET) {
+        dev->resets++;
+        dev->converting = 0;
+    } else if ((cmd & 0xF0) == MS5611_D1 || (cmd & 0xF0) == MS5611_D2) {
+        if (osr > 4) return;
+        dev->converting = ((cmd & 0xF0) == MS5611_D1) ? 1 : 2;
+        dev->ready_ns = sim_bus_now_ns + ms5611_conv_ns[osr];
+        dev->conversions++;
+    } else if (cmd == MS5611_ADC_READ) {
+        if (dev->converting && sim_bus_now_ns >= dev->ready_ns) {
+            dev->out = (dev->converting == 1) ? dev->d1 : dev->d2;
+        } else {
+            dev->out = 0;
+            dev->early_reads++;
+        }
+        dev->converting = 0;
+    } else if ((cmd & 0xF0) == MS5611_PROM) {
+        dev->out = (uint32_t)dev->prom[(cmd >> 1) & 0x07] << 8;
+    }
+}
+
+static uint8_t ms5611_exchange(void *ctx, uint8_t mosi) {
+    sim_ms5611_t *dev = ctx;
+    if (dev->pos++ == 0) {
+        dev->cmd = mosi;
+        dev->out = 0;
+        ms5611_command(dev, mosi);
+        return 0x00;
+    }
+    const uint8_t miso = (uint8_t)(dev->out >> 16);
+    dev->out <<= 8;
+    return miso;
+}
+
+const sim_bus_model_t sim_ms5611_model = { ms5611_select, ms5611_exchange, NULL };
+
+/**************************************************************************************************
+ * @section ADS124S08 ADC
+ **************************************************************************************************/
+
+#define ADS_RESET  0x06
+#define ADS_START  0x08
+#define ADS_STOP   0x0A
+#define ADS_RDATA  0x12
+#define ADS_RREG   0x20
+#define ADS_WREG   0x40
+#define ADS_STATUS 0x01
+#define ADS_INPMUX 0x02
+#define ADS_PGA    0x03
+#define ADS_STATUS_NRDY  0x40
+#define ADS_PGA_EN       0x08
+
+static const uint8_t ads_reset_regs[SIM_ADS124S08_REG_COUNT] = {
+    0x00, 0x80, 0x01, 0x00, 0x14, 0x10, 0x00, 0xFF, 0x00,
+    0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00, 0x00,
+};
+
+void sim_ads124s08_init(sim_ads124s08_t *dev) {
+    memset(dev, 0, sizeof(*dev));
+    memcpy(dev->regs, ads_reset_regs, sizeof(ads_reset_regs));
+}
+
+static void ads_select(void *ctx) {
+    ((sim_ads124s08_t *)ctx)->pos = 0;
+}
+
+static uint8_t ads_read_reg(const sim_ads124s08_t *dev, uint8_t idx) {
+    if (idx != ADS_STATUS) return dev->regs[idx];
+    const uint8_t nrdy = (sim_bus_now_ns < dev->ready_ns) ? ADS_STATUS_NRDY : 0;
+    return (uint8_t)((dev->regs[idx] & ~ADS_STATUS_NRDY) | nrdy);
+}
+
+static void ads_write_reg(sim_ads124s08_t *dev, uint8_t idx, uint8_t value) {
+    dev->reg_writes++;
+    if (idx == 0x00) return; // ID is read only
+    if (idx == ADS_STATUS) {
+        dev->regs[idx] = (uint8_t)((dev->regs[idx] & 0x7F) | (value & 0x80)); // only FL_POR
+        return;
+    }
+    dev->regs[idx] = value;
+}
+
+// Latches the conversion result of the selected input, shifted out by the bytes after RDATA.
+static void ads_latch_data(sim_ads124s08_t *dev) {
+    int64_t code = dev->code[dev->regs[ADS_INPMUX] >> 4];
+    if (dev->regs[ADS_PGA] & ADS_PGA_EN) code *= 1 << (dev->regs[ADS_PGA] & 0x07);
+    if (code > 0x7FFFFF) code = 0x7FFFFF;
+    if (code < -0x800000) code = -0x800000;
+    dev->out[0] = (uint8_t)(code >> 16);
+    dev->out[1] = (uint8_t)(code >> 8);
+    dev->out[2] = (uint8_t)code;
+}
+
+static uint8_t ads_exchange(void *ctx, uint8_t mosi) {
+    sim_ads124s08_t *dev = ctx;
+    const uint8_t pos = dev->pos++;
+    if (pos == 0) {
+        dev->cmd = mosi;
+        switch (mosi & 0xFE) {
+            case ADS_RESET:
+                memcpy(dev->regs, ads_reset_regs, sizeof(ads_reset_regs));
+                dev->resets++;
+                dev->ready_ns = sim_bus_now_ns + SIM_ADS124S08_RESET_NS;
+                break;
+            case ADS_START: dev->starts++; break;
+            case ADS_RDATA: dev->reads++; ads_latch_data(dev); break;
+            default: break;
+        }
+        return 0x00;
+    }
+
+    const uint8_t op = dev->cmd & 0xE0;
+    if ((dev->cmd & 0xFE) == ADS_RDATA) {
+        return (pos <= 3) ? dev->out[pos - 1] : 0x00;
+    }
+    if (op != ADS_RREG && op != ADS_WREG) return 0x00;
+    if (pos == 1) {
+        dev->count = (uint8_t)((mosi & 0x1F) + 1);
+        return 0x00;
+    }
+    const uint8_t idx = (uint8_t)((dev->cmd & 0x1F) + pos - 2);
+    if (pos - 2 >= dev->count || idx >= SIM_ADS124S08_REG_COUNT) return 0x00;
+    if (op == ADS_RREG) return ads_read_reg(dev, idx);
+    ads_write_reg(dev, idx, mosi);
+    return 0x00;
+}
+
+const sim_bus_model_t sim_ads124s08_model = { ads_select, ads_exchange, NULL };
+
+/**************************************************************************************************
+ * @section Si4468 Radio
+ **************************************************************************************************/
+
+#define SI_POWER_UP      0x02
+#define SI_FIFO_INFO     0x15
+#define SI_PACKET_INFO   0x16
+#define SI_GET_INT       0x20
+#define SI_START_TX      0x31
+#define SI_START_RX      0x32
+#define SI_CHANGE_STATE  0x34
+#define SI_READ_CMD_BUFF 0x44
+#define SI_WRITE_TX_FIFO 0x66
+#define SI_READ_RX_FIFO  0x77
+#define SI_PH_PACKET_SENT 0x20
+#define SI_PH_PACKET_RX   0x10
+
+void sim_si4468_init(sim_si4468_t *dev) {
+    memset(dev, 0, sizeof(*dev));
+}
+
+static void si_update_nirq(sim_si4468_t *dev) {
+    if (dev->nirq_pin) sim_bus_pin_level[dev->nirq_pin] = dev->ph_pend ? 0 : 1;
+}
+
+void sim_si4468_inject_rx(sim_si4468_t *dev, const uint8_t *data, uint8_t len) {
+    if (len > SIM_SI4468_FIFO_SIZE) len = SIM_SI4468_FIFO_SIZE;
+    memcpy(dev->rx_fifo, data, len);
+    dev->rx_len = len;
+    dev->rx_pos = 0;
+    dev->rx_armed = false;
+    dev->ph_pend |= SI_PH_PACKET_RX;
+    si_update_nirq(dev);
+}
+
+static bool si_cts(const sim_si4468_t *dev) {
+    return !dev->dead && sim_bus_now_ns >= dev->cts_ns;
+}
+
+static void si_select(void *ctx) {
+    sim_si4468_t *dev = ctx;
+    dev->pos = 0;
+    dev->cmd_len = 0;
+}
+
+static uint8_t si_exchange(void *ctx, uint8_t mosi) {
+    sim_si4468_t *dev = ctx;
+    const uint8_t pos = dev->pos++;
+    if (pos == 0) {
+        dev->cmd[0] = mosi;
+        dev->cmd_len = 1;
+        if (mosi == SI_READ_CMD_BUFF) dev->cts_polls++;
+        return 0x00;
+    }
+    switch (dev->cmd[0]) {
+        case SI_READ_CMD_BUFF:
+            if (!si_cts(dev)) return 0x00;
+            if (pos == 1) return 0xFF;
+            return (pos - 2 < (int)sizeof(dev->resp)) ? dev->resp[pos - 2] : 0x00;
+        case SI_WRITE_TX_FIFO:
+            if (dev->tx_len < SIM_SI4468_FIFO_SIZE) dev->tx_fifo[dev->tx_len++] = mosi;
+            return 0x00;
+        case SI_READ_RX_FIFO:
+            return (dev->rx_pos < dev->rx_len) ? dev->rx_fifo[dev->rx_pos++] : 0x00;
+        default:
+            if (dev->cmd_len < sizeof(dev->cmd)) dev->cmd[dev->cmd_len++] = mosi;
+            return 0x00;
+    }
+}
+
+// Runs the command clocked in under this chip select once SS goes high.
+static void si_execute(sim_si4468_t *dev) {
+    const uint8_t *cmd = dev->cmd;
+    dev->commands++;
+    if (!si_cts(dev) || (!dev->powered && cmd[0] != SI_POWER_UP)) {
+        dev->rejected++;
+        return;
+    }
+    memset(dev->resp, 0, sizeof(dev->resp));
+    dev->cts_ns = sim_bus_now_ns + SIM_SI4468_CMD_NS;
+
+    switch (cmd[0]) {
+        case SI_POWER_UP:
+            dev->powered = true;
+            dev->cts_ns = sim_bus_now_ns + SIM_SI4468_POWER_UP_NS;
+            break;
+        case SI_FIFO_INFO:
+            if (dev->cmd_len > 1 && (cmd[1] & 0x01)) dev->tx_len = 0;
+            if (dev->cmd_len > 1 && (cmd[1] & 0x02)) dev->rx_len = dev->rx_pos = 0;
+            dev->resp[0] = (uint8_t)(dev->rx_len - dev->rx_pos);
+            dev->resp[1] = (uint8_t)(SIM_SI4468_FIFO_SIZE - dev->tx_len);
+            break;
+        case SI_PACKET_INFO:
+            dev->resp[0] = 0;
+            dev->resp[1] = dev->rx_len;
+            break;
+        case SI_GET_INT:
+            dev->resp[0] = dev->ph_pend ? 0x01 : 0x00;
+            dev->resp[1] = dev->resp[0];
+            dev->resp[2] = dev->ph_pend;
+            dev->resp[3] = dev->ph_pend;
+            // Zero bits in the first argument clear the matching pending interrupts
+            dev->ph_pend &= (dev->cmd_len > 1) ? cmd[1] : 0x00;
+            si_update_nirq(dev);
+            break;
+        case SI_START_TX: {
+            dev->channel = cmd[1];
+            uint16_t len = (dev->cmd_len > 4) ? (uint16_t)((cmd[3] << 8) | cmd[4]) : 0;
+            if (len == 0 || len > dev->tx_len) len = dev->tx_len;
+            memcpy(dev->sent, dev->tx_fifo, len);
+            dev->sent_len = (uint8_t)len;
+            dev->tx_len = 0;
+            dev->packets_sent++;
+            dev->ph_pend |= SI_PH_PACKET_SENT;
+            si_update_nirq(dev);
+            break;
+        }
+        case SI_START_RX:
+            dev->channel = cmd[1];
+            dev->rx_armed = true;
+            break;
+        case SI_CHANGE_STATE:
+            dev->state = cmd[1];
+            break;
+        default:
+            break;
+    }
+}
+
+static void si_deselect(void *ctx) {
+    sim_si4468_t *dev = ctx;
+    const uint8_t op = dev->cmd[0];
+    if (dev->pos == 0 || op == SI_READ_CMD_BUFF || op == SI_WRITE_TX_FIFO || op == SI_READ_RX_FIFO) return;
+    si_execute(dev);
+}
+
+const sim_bus_model_t sim_si4468_model = { si_select, si_exchange, si_deselect };
+
+/**************************************************************************************************
+ * @section u-blox M8 GNSS
+ **************************************************************************************************/
+
+#define UBX_SYNC1     0xB5
+#define UBX_SYNC2     0x62
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+#define UBX_NAV_PVT   0x07
+
+void sim_ubx_init(sim_ubx_t *dev) {
+    memset(dev, 0, sizeof(*dev));
+}
+
+static void ubx_put_le(uint8_t *p, uint32_t v, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+void sim_ubx_set_pvt(sim_ubx_t *dev, uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                     uint8_t min, uint8_t sec, uint8_t fix, uint8_t num_sv, int32_t lon, int32_t lat,
+                     int32_t height, int32_t h_msl, int32_t vel_n, int32_t vel_e, int32_t vel_d,
+                     uint16_t p_dop) {
+    uint8_t *p = dev->pvt;
+    ubx_put_le(&p[4], year, 2);
+    p[6] = month;
+    p[7] = day;
+    p[8] = hour;
+    p[9] = min;
+    p[10] = sec;
+    p[20] = fix;
+    p[23] = num_sv;
+    ubx_put_le(&p[24], (uint32_t)lon, 4);
+    ubx_put_le(&p[28], (uint32_t)lat, 4);
+    ubx_put_le(&p[32], (uint32_t)height, 4);
+    ubx_put_le(&p[36], (uint32_t)h_msl, 4);
+    ubx_put_le(&p[48], (uint32_t)vel_n, 4);
+    ubx_put_le(&p[52], (uint32_t)vel_e, 4);
+    ubx_put_le(&p[56], (uint32_t)vel_d, 4);
+    ubx_put_le(&p[76], p_dop, 2);
+}
+
+static void ubx_checksum(const uint8_t *p, uint16_t n, uint8_t *ck_a, uint8_t *ck_b) {
+    *ck_a = 0;
+    *ck_b = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        *ck_a += p[i];
+        *ck_b += *ck_a;
+    }
+}
+
+static void ubx_out(sim_ubx_t *dev, uint8_t b) {
+    dev->out[dev->out_head] = b;
+    dev->out_head = (uint16_t)((dev->out_head + 1) % SIM_UBX_OUT_SIZE);
+}
+
+static void ubx_queue(sim_ubx_t *dev, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len) {
+    uint8_t frame[6 + SIM_UBX_PVT_LEN + 2] = { UBX_SYNC1, UBX_SYNC2, cls, id, (uint8_t)len, (uint8_t)(len >> 8) };
+    memcpy(&frame[6], payload, len);
+    ubx_checksum(&frame[2], (uint16_t)(4 + len), &frame[6 + len], &frame[7 + len]);
+    if (dev->corrupt_next) {
+        frame[7 + len] ^= 0xFF;
+        dev->corrupt_next = false;
+    }
+    for (uint16_t i = 0; i < len + 8; i++) ubx_out(dev, frame[i]);
+    dev->idle = dev->reply_delay;
+}
+
+// Handles a whole frame sitting in dev->in.
+static void ubx_frame(sim_ubx_t *dev) {
+    const uint16_t len = (uint16_t)(dev->in[4] | (dev->in[5] << 8));
+    uint8_t ck_a;
+    uint8_t ck_b;
+    ubx_checksum(&dev->in[2], (uint16_t)(4 + len), &ck_a, &ck_b);
+    if (ck_a != dev->in[6 + len] || ck_b != dev->in[7 + len]) {
+        dev->bad_frames++;
+        return;
+    }
+    const uint8_t cls = dev->in[2];
+    const uint8_t id = dev->in[3];
+    dev->frames++;
+    dev->last_cls = cls;
+    dev->last_id = id;
+
+    if (cls == UBX_CLASS_CFG) {
+        if (dev->cfg_count < sizeof(dev->cfg)) dev->cfg[dev->cfg_count++] = id;
+        const uint8_t ack[2] = { cls, id };
+        ubx_queue(dev, UBX_CLASS_ACK, (id == dev->nak_id) ? 0x00 : 0x01, ack, 2);
+    } else if (cls == UBX_CLASS_NAV && id == UBX_NAV_PVT && len == 0) {
+        ubx_queue(dev, UBX_CLASS_NAV, UBX_NAV_PVT, dev->pvt, SIM_UBX_PVT_LEN);
+    }
+}
+
+static uint8_t ubx_exchange(void *ctx, uint8_t mosi) {
+    sim_ubx_t *dev = ctx;
+
+    // Output first: MISO is already shifting out while this MOSI byte comes in
+    uint8_t miso = 0xFF;
+    if (dev->out_head != dev->out_tail) {
+        if (dev->idle) {
+            dev->idle--;
+        } else {
+            miso = dev->out[dev->out_tail];
+            dev->out_tail = (uint16_t)((dev->out_tail + 1) % SIM_UBX_OUT_SIZE);
+        }
+    }
+
+    // Input: idle bytes are dropped between frames
+    if (dev->in_len > 0 || mosi == UBX_SYNC1) {
+        dev->in[dev->in_len++] = mosi;
+        if (dev->in_len == 2 && mosi != UBX_SYNC2) dev->in_len = 0;
+        if (dev->in_len == 6) {
+            dev->want = (uint16_t)(8 + (dev->in[4] | (dev->in[5] << 8)));
+            if (dev->want > sizeof(dev->in)) {
+                dev->bad_frames++;
+                dev->in_len = 0;
+            }
+        }
+        if (dev->in_len >= 6 && dev->in_len == dev->want) {
+            ubx_frame(dev);
+            dev->in_len = 0;
+        }
+    }
+    return miso;
+}
+
+const sim_bus_model_t sim_ubx_model = { NULL, ubx_exchange, NULL };
+
+/**************************************************************************************************
+ * @section MAX22217 Solenoid Driver
+ **************************************************************************************************/
+
+#define MAX_WRITE  0x80
+#define MAX_FAULT0 0x65
+#define MAX_FAULT1 0x66
+
+void sim_max22217_init(sim_max22217_t *dev) {
+    memset(dev, 0, sizeof(*dev));
+}
+
+static void max_select(void *ctx) {
+    ((sim_max22217_t *)ctx)->pos = 0;
+}
+
+static uint8_t max_exchange(void *ctx, uint8_t mosi) {
+    sim_max22217_t *dev = ctx;
+    switch (dev->pos++) {
+        case 0:
+            dev->addr = mosi;
+            return dev->status;
+        case 1:
+            dev->data = (uint16_t)(mosi << 8);
+            return (uint8_t)(dev->latched >> 8);
+        case 2:
+            dev->data |= mosi;
+            return (uint8_t)dev->latched;
+        default:
+            return 0x00;
+    }
+}
+
+static void max_deselect(void *ctx) {
+    sim_max22217_t *dev = ctx;
+    if (dev->pos != 3) {
+        dev->bad_frames++;
+        return;
+    }
+    const uint8_t reg = dev->addr & 0x7F;
+    dev->frames++;
+    if (dev->addr & MAX_WRITE) {
+        dev->regs[reg] = dev->data;
+        dev->writes++;
+    }
+    dev->latched = dev->regs[reg];
+    if (!(dev->addr & MAX_WRITE) && (reg == MAX_FAULT0 || reg == MAX_FAULT1)) dev->regs[reg] = 0;
+}
+
+const sim_bus_model_t sim_max22217_model = { max_select, max_exchange, max_deselect };
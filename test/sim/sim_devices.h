@@ -0,0 +1,214 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/sim_devices.h
+ * @authors Joshua Beard
+ * @brief Device models for the simulated SPI bus.
+ *
+ * One model per driver in src/devices that talks SPI. Each is a state struct plus a
+ * sim_bus_model_t: initialize the struct, set the fields marked as script to what the part
+ * should report, and attach it with sim_bus_attach(inst, ss_pin, &sim_x_model, &state). The
+ * fields marked as observed record what the driver did to the part.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "spi_bus_sim.h"
+
+/**************************************************************************************************
+ * @section MS5611 Barometer
+ **************************************************************************************************/
+
+/**
+ * @brief MS5611: RESET, PROM reads, D1/D2 conversions and ADC reads. Conversions take the
+ *        datasheet's maximum time for their OSR, and an ADC read before one finishes returns 0
+ *        like the part does.
+ */
+typedef struct {
+    uint16_t prom[8];      // script: PROM words 0xA0-0xAE (factory data, C1-C6, CRC)
+    uint32_t d1;           // script: raw pressure the next D1 conversion produces
+    uint32_t d2;           // script: raw temperature the next D2 conversion produces
+
+    uint32_t resets;       // observed
+    uint32_t conversions;  // observed
+    uint32_t early_reads;  // observed: ADC reads with no finished conversion
+
+    uint8_t pos;           // internal
+    uint8_t cmd;
+    uint32_t out;
+    uint8_t converting;
+    uint64_t ready_ns;
+} sim_ms5611_t;
+
+/** @brief Sets the datasheet's example PROM and readings (20.07 C, 1000.09 mbar). */
+void sim_ms5611_init(sim_ms5611_t *dev);
+
+extern const sim_bus_model_t sim_ms5611_model;
+
+/**************************************************************************************************
+ * @section ADS124S08 ADC
+ **************************************************************************************************/
+
+#define SIM_ADS124S08_REG_COUNT 18
+#define SIM_ADS124S08_RESET_NS 1000000U // 4096 clocks of the 4.096MHz oscillator
+
+/**
+ * @brief ADS124S08: the register map through RREG/WREG, RESET/START/STOP and RDATA. STATUS
+ *        reports not ready until SIM_ADS124S08_RESET_NS after a reset. RDATA returns the code
+ *        scripted for INPMUX's positive input, scaled by the PGA gain when the PGA is enabled.
+ */
+typedef struct {
+    uint8_t regs[SIM_ADS124S08_REG_COUNT]; // script/observed: register file, reset values on init
+    int32_t code[16];        // script: 24-bit code at gain 1, per positive input (AIN0-AINCOM)
+
+    uint32_t resets;         // observed
+    uint32_t starts;         // observed
+    uint32_t reads;          // observed: RDATA commands
+    uint32_t reg_writes;     // observed: registers written through WREG
+
+    uint8_t pos;             // internal
+    uint8_t cmd;
+    uint8_t count;
+    uint8_t out[3];
+    uint64_t ready_ns;
+} sim_ads124s08_t;
+
+/** @brief Puts the register file in its power-on state. */
+void sim_ads124s08_init(sim_ads124s08_t *dev);
+
+extern const sim_bus_model_t sim_ads124s08_model;
+
+/**************************************************************************************************
+ * @section Si4468 Radio
+ **************************************************************************************************/
+
+#define SIM_SI4468_FIFO_SIZE 64
+#define SIM_SI4468_CMD_NS 20000U        // CTS latency of an ordinary command
+#define SIM_SI4468_POWER_UP_NS 15000000U // CTS latency of POWER_UP (boot and crystal start)
+
+/**
+ * @brief Si4468: the command/CTS protocol (commands take cts_ns to process, READ_CMD_BUFF reads
+ *        0xFF then the response once they are done), the 64-byte TX and RX FIFOs, START_TX,
+ *        START_RX, CHANGE_STATE, PACKET_INFO and GET_INT_STATUS. START_TX "sends" the TX FIFO;
+ *        sim_si4468_inject_rx makes a packet arrive. Pending packet handler interrupts pull
+ *        nirq_pin low until GET_INT_STATUS clears them.
+ */
+typedef struct {
+    uint8_t nirq_pin;        // script: pin driven as nIRQ, or 0
+    bool dead;               // script: never raise CTS
+
+    bool powered;            // observed: POWER_UP received
+    uint8_t state;           // observed: last CHANGE_STATE target
+    uint8_t channel;         // observed: channel of the last START_TX/START_RX
+    bool rx_armed;           // observed: START_RX received since the last packet
+    uint32_t commands;       // observed
+    uint32_t rejected;       // observed: commands sent before CTS or before POWER_UP
+    uint32_t cts_polls;      // observed: READ_CMD_BUFF transfers
+    uint32_t packets_sent;   // observed
+    uint8_t sent[SIM_SI4468_FIFO_SIZE]; // observed: payload of the last START_TX
+    uint8_t sent_len;        // observed
+
+    uint8_t pos;             // internal
+    uint8_t cmd[16];
+    uint8_t cmd_len;
+    uint8_t resp[16];
+    uint64_t cts_ns;
+    uint8_t tx_fifo[SIM_SI4468_FIFO_SIZE];
+    uint8_t tx_len;
+    uint8_t rx_fifo[SIM_SI4468_FIFO_SIZE];
+    uint8_t rx_len;
+    uint8_t rx_pos;
+    uint8_t ph_pend;
+} sim_si4468_t;
+
+void sim_si4468_init(sim_si4468_t *dev);
+
+/** @brief Puts a received packet in the RX FIFO and raises the packet received interrupt. */
+void sim_si4468_inject_rx(sim_si4468_t *dev, const uint8_t *data, uint8_t len);
+
+extern const sim_bus_model_t sim_si4468_model;
+
+/**************************************************************************************************
+ * @section u-blox M8 GNSS
+ **************************************************************************************************/
+
+#define SIM_UBX_OUT_SIZE 256
+#define SIM_UBX_PVT_LEN 92
+
+/**
+ * @brief u-blox M8 on SPI: parses the UBX frames clocked in (0xFF is idle), answers CFG messages
+ *        with ACK-ACK, or ACK-NAK for nak_id, and NAV-PVT polls with the scripted solution. Its
+ *        output stream reads 0xFF when empty and keeps its place across chip selects, and each
+ *        answer is preceded by reply_delay idle bytes.
+ */
+typedef struct {
+    uint8_t pvt[SIM_UBX_PVT_LEN]; // script: NAV-PVT payload, see sim_ubx_set_pvt
+    uint8_t nak_id;          // script: CFG message id to NAK, or 0
+    uint16_t reply_delay;    // script: idle bytes before each answer
+    bool corrupt_next;       // script: send the next answer with a bad checksum
+
+    uint32_t frames;         // observed: valid frames received
+    uint32_t bad_frames;     // observed: frames with a bad checksum
+    uint8_t last_cls;        // observed: class and id of the last valid frame
+    uint8_t last_id;
+    uint8_t cfg[8];          // observed: ids of the CFG messages received, in order
+    uint8_t cfg_count;
+
+    uint8_t in[128];         // internal
+    uint16_t in_len;
+    uint16_t want;
+    uint8_t out[SIM_UBX_OUT_SIZE];
+    uint16_t out_head;
+    uint16_t out_tail;
+    uint16_t idle;
+} sim_ubx_t;
+
+void sim_ubx_init(sim_ubx_t *dev);
+
+/** @brief Scripts the NAV-PVT fields gnss_get_pvt reports, at their UBX offsets. */
+void sim_ubx_set_pvt(sim_ubx_t *dev, uint16_t year, uint8_t month, uint8_t day, uint8_t hour,
+                     uint8_t min, uint8_t sec, uint8_t fix, uint8_t num_sv, int32_t lon, int32_t lat,
+                     int32_t height, int32_t h_msl, int32_t vel_n, int32_t vel_e, int32_t vel_d,
+                     uint16_t p_dop);
+
+extern const sim_bus_model_t sim_ubx_model;
+
+/**************************************************************************************************
+ * @section MAX22217 Solenoid Driver
+ **************************************************************************************************/
+
+/**
+ * @brief MAX22216/MAX22217: 3-byte frames of [RW|addr, data hi, data lo]. The first byte out is
+ *        the status byte; the data bytes are the register addressed by the previous frame, so a
+ *        read takes two frames like the part. Reading FAULT0 or FAULT1 clears it.
+ */
+typedef struct {
+    uint16_t regs[128];      // script/observed: register file
+    uint8_t status;          // script: status byte returned with every frame
+
+    uint32_t frames;         // observed
+    uint32_t writes;         // observed
+    uint32_t bad_frames;     // observed: frames that were not 3 bytes
+
+    uint8_t pos;             // internal
+    uint8_t addr;
+    uint16_t data;
+    uint16_t latched;
+} sim_max22217_t;
+
+void sim_max22217_init(sim_max22217_t *dev);
+
+extern const sim_bus_model_t sim_max22217_model;
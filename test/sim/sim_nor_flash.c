@@ -0,0 +1,156 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/sim_nor_flash.c
+ * @authors Joshua Beard
+ * @brief Model of the S25FL064L NOR flash behind the QUADSPI, for host tests.
+ */
+#include <string.h>
+#include "sim_nor_flash.h"
+
+#define NOR_SR1_WIP 0x01U
+#define NOR_SR1_WEL 0x02U
+
+uint8_t sim_nor_mem[SIM_NOR_SIZE];
+uint8_t sim_nor_cr1;
+uint64_t sim_nor_now_ns;
+sim_nor_stats_t sim_nor_stats;
+
+static uint64_t busy_until_ns;
+static bool write_enabled;
+
+void sim_nor_reset(void) {
+    memset(sim_nor_mem, 0xFF, sizeof(sim_nor_mem));
+    memset(&sim_nor_stats, 0, sizeof(sim_nor_stats));
+    sim_nor_cr1 = 0;
+    sim_nor_now_ns = 0;
+    busy_until_ns = 0;
+    write_enabled = false;
+}
+
+void sim_nor_advance_ns(uint64_t ns) {
+    sim_nor_now_ns += ns;
+}
+
+uint64_t sim_nor_busy_ns(void) {
+    return busy_until_ns > sim_nor_now_ns ? busy_until_ns - sim_nor_now_ns : 0;
+}
+
+// Starts a program or erase if the part will take one. The write enable is used up either way.
+static bool sim_nor_start(uint64_t busy_ns) {
+    if (!write_enabled) {
+        sim_nor_stats.rejected++;
+        return false;
+    }
+    write_enabled = false;
+    busy_until_ns = sim_nor_now_ns + busy_ns;
+    return true;
+}
+
+bool sim_nor_frame_ok(const sim_nor_frame_t* f) {
+    // instruction: address lines, dummy cycles, data lines, mode byte lines, needs QE
+    static const struct { uint8_t insn, addr, dummy, data, alt; bool quad; } formats[] = {
+        {0x06, 0, 0, 0, 0, false}, {0x04, 0, 0, 0, 0, false}, {0x05, 0, 0, 1, 0, false},
+        {0x35, 0, 0, 1, 0, false}, {0x01, 0, 0, 1, 0, false}, {0x03, 1, 0, 1, 0, false},
+        {0x0B, 1, 8, 1, 0, false}, {0x6B, 1, 8, 4, 0, true},  {0xEB, 4, 4, 4, 4, true},
+        {0x02, 1, 0, 1, 0, false}, {0x32, 1, 0, 4, 0, true},  {0x20, 1, 0, 0, 0, false},
+    };
+    for (uint32_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (formats[i].insn != f->instruction) continue;
+        const bool ok = f->instruction_lines == 1 &&
+                        f->address_lines == formats[i].addr &&
+                        f->address_bytes == (formats[i].addr ? 3U : 0U) &&
+                        f->alternate_lines == formats[i].alt &&
+                        f->alternate_bytes == (formats[i].alt ? 1U : 0U) &&
+                        f->dummy_cycles == formats[i].dummy &&
+                        f->data_lines == formats[i].data &&
+                        (!formats[i].quad || (sim_nor_cr1 & SIM_NOR_CR1_QE));
+        if (!ok) sim_nor_stats.malformed++;
+        return ok;
+    }
+    sim_nor_stats.malformed++;
+    return false;
+}
+
+// Clock cycles to move bytes over a number of lines
+static uint64_t sim_nor_cycles(uint8_t lines, uint32_t bytes) {
+    return lines ? (uint64_t)bytes * 8U / lines : 0U;
+}
+
+uint64_t sim_nor_frame_ns(const sim_nor_frame_t* f, uint32_t length, uint32_t sck_hz) {
+    const uint64_t cycles = sim_nor_cycles(f->instruction_lines, 1) +
+                            sim_nor_cycles(f->address_lines, f->address_bytes) +
+                            sim_nor_cycles(f->alternate_lines, f->alternate_bytes) + f->dummy_cycles +
+                            sim_nor_cycles(f->data_lines, length);
+    return cycles * 1000000000ULL / sck_hz;
+}
+
+void sim_nor_command(uint8_t instruction, uint32_t address, uint8_t* data, uint32_t length) {
+    sim_nor_stats.commands++;
+    address %= SIM_NOR_SIZE;
+    const bool busy = sim_nor_busy_ns() > 0;
+
+    if (instruction == 0x05) { // RDSR1, the one command served while busy
+        sim_nor_stats.status_reads++;
+        const uint8_t status = (uint8_t)((busy ? NOR_SR1_WIP : 0U) | (write_enabled ? NOR_SR1_WEL : 0U));
+        memset(data, status, length);
+        return;
+    }
+    const bool read = instruction == 0x03 || instruction == 0x0B || instruction == 0x6B || instruction == 0xEB;
+    if (busy) {
+        sim_nor_stats.rejected++;
+        if (read) memset(data, 0xFF, length);
+        return;
+    }
+    if (instruction == 0x6B || instruction == 0xEB || instruction == 0x32) sim_nor_stats.quad_commands++;
+
+    switch (instruction) {
+        case 0x06: write_enabled = true; break;
+        case 0x04: write_enabled = false; break;
+        case 0x35: memset(data, sim_nor_cr1, length); break;
+        case 0x01: // WRR: SR1, then CR1. Only QE of either is modelled.
+            if (!sim_nor_start(SIM_NOR_WRR_NS)) break;
+            if (length >= 2) sim_nor_cr1 = data[1] & SIM_NOR_CR1_QE;
+            break;
+        case 0x03:
+        case 0x0B:
+        case 0x6B:
+        case 0xEB:
+            for (uint32_t i = 0; i < length; i++) data[i] = sim_nor_mem[(address + i) % SIM_NOR_SIZE];
+            break;
+        case 0x02:
+        case 0x32: { // PP wraps within its page
+            if (!sim_nor_start(SIM_NOR_PROGRAM_NS)) break;
+            const uint32_t page = address & ~(SIM_NOR_PAGE_SIZE - 1U);
+            for (uint32_t i = 0; i < length; i++) {
+                uint8_t* cell = &sim_nor_mem[page + ((address + i) % SIM_NOR_PAGE_SIZE)];
+                if ((*cell & data[i]) != data[i]) sim_nor_stats.overprogrammed++;
+                *cell &= data[i];
+            }
+            sim_nor_stats.programs++;
+            sim_nor_stats.program_bytes += length;
+            break;
+        }
+        case 0x20:
+            if (!sim_nor_start(SIM_NOR_ERASE_NS)) break;
+            memset(&sim_nor_mem[address & ~(SIM_NOR_SECTOR_SIZE - 1U)], 0xFF, SIM_NOR_SECTOR_SIZE);
+            sim_nor_stats.erases++;
+            break;
+        default:
+            sim_nor_stats.rejected++;
+            break;
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/sim_nor_flash.h
+ * @authors Joshua Beard
+ * @brief Model of the S25FL064L NOR flash behind the QUADSPI, for host tests.
+ *
+ * The model works a command at a time: whoever drives it (a stand-in for the QSPI driver or for
+ * its registers) collects one instruction, address and data phase and hands it over. Programming
+ * only clears bits, erases set a whole sector back to 0xFF, and both need a write enable first and
+ * keep the part busy for a while in virtual time, during which everything but a status read is
+ * refused. The quad commands only work once the QE bit in configuration register 1 is set. Misuse a
+ * real part would silently get wrong is counted, so tests can assert on it.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_NOR_SIZE        0x00800000U // 64 Mbit
+#define SIM_NOR_PAGE_SIZE   256U
+#define SIM_NOR_SECTOR_SIZE 4096U
+
+/** @brief Busy time of a page program, whatever its length (tPP typical). */
+#define SIM_NOR_PROGRAM_NS 450000U
+
+/** @brief Busy time of a 4KB sector erase (tSE typical). */
+#define SIM_NOR_ERASE_NS 50000000U
+
+/** @brief Busy time of a non-volatile status/configuration register write (tW typical). */
+#define SIM_NOR_WRR_NS 60000000U
+
+#define SIM_NOR_CR1_QE 0x02U // Quad enable, configuration register 1
+
+/** @brief How one command goes over the wire. Lines are 1, 2 or 4, or 0 for an absent phase. */
+typedef struct {
+    uint8_t instruction;
+    uint8_t instruction_lines;
+    uint8_t address_bytes;
+    uint8_t address_lines;
+    uint8_t alternate_bytes;  // mode bits of the quad I/O read
+    uint8_t alternate_lines;
+    uint8_t dummy_cycles;
+    uint8_t data_lines;
+} sim_nor_frame_t;
+
+/** @brief What the part has been asked to do since sim_nor_reset. */
+typedef struct {
+    uint32_t commands;
+    uint32_t programs;       // page programs carried out
+    uint32_t program_bytes;
+    uint32_t erases;         // sector erases carried out
+    uint32_t status_reads;
+    uint32_t rejected;       // program/erase without write enable, anything but a status read while busy
+    uint32_t overprogrammed; // bytes programmed over a cleared bit, which stays cleared
+    uint32_t malformed;      // frames the part would misread (see sim_nor_frame_ok)
+    uint32_t quad_commands;  // reads and programs with a four line data phase
+} sim_nor_stats_t;
+
+extern uint8_t sim_nor_mem[SIM_NOR_SIZE];
+extern uint8_t sim_nor_cr1;             // configuration register 1, non-volatile
+extern uint64_t sim_nor_now_ns;         // virtual time since sim_nor_reset
+extern sim_nor_stats_t sim_nor_stats;
+
+/** @brief Erases the whole array, drops the write enable, clears the statistics and restarts time. */
+void sim_nor_reset(void);
+
+/** @brief Moves virtual time on, finishing any program or erase that ends meanwhile. */
+void sim_nor_advance_ns(uint64_t ns);
+
+/** @brief Virtual time until the running program or erase finishes, 0 when idle. */
+uint64_t sim_nor_busy_ns(void);
+
+/**
+ * @brief Whether the part decodes a frame as intended: the instruction is one it knows, sent with
+ *        the phases, line counts and dummy cycles the datasheet gives for it (at the default
+ *        latency code), and, for a quad command, with QE set. Counts a false in malformed.
+ */
+bool sim_nor_frame_ok(const sim_nor_frame_t* frame);
+
+/** @brief Virtual time a frame with @p length data bytes takes on the wire at @p sck_hz. */
+uint64_t sim_nor_frame_ns(const sim_nor_frame_t* frame, uint32_t length, uint32_t sck_hz);
+
+/**
+ * @brief Carries out one command: WREN (0x06), WRDI (0x04), RDSR1 (0x05), RDCR1 (0x35),
+ *        WRR (0x01), READ (0x03), FAST_READ (0x0B), quad output read (0x6B), quad I/O read (0xEB),
+ *        PP (0x02), quad PP (0x32) or SE (0x20). Anything else is counted and ignored. Check the
+ *        frame with sim_nor_frame_ok first.
+ * @param data Filled by reads and status reads, taken from by programs and register writes.
+ * @param length Bytes in the data phase.
+ */
+void sim_nor_command(uint8_t instruction, uint32_t address, uint8_t* data, uint32_t length);
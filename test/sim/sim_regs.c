@@ -0,0 +1,38 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/sim_regs.c
+ * @authors Joshua Beard
+ * @brief Backing memory for the registers test/sim/internal/mmio.h redirects.
+ */
+
+#include "internal/mmio.h"
+
+volatile sim_spi_regs_t sim_spi[7];
+volatile sim_usart_regs_t sim_usart[9];
+volatile sim_dmac_regs_t sim_dmac[3];
+volatile uint32_t sim_dmamux1_ccr[16];
+volatile uint32_t sim_dmamux2_ccr[8];
+volatile uint32_t sim_rcc_ahb1enr;
+volatile uint32_t sim_rcc_apb1lenr;
+volatile uint32_t sim_rcc_apb2enr;
+volatile uint32_t sim_nvic_iser[4];
+volatile sim_quadspi_regs_t sim_quadspi;
+volatile sim_gpio_regs_t sim_gpio[11];
+volatile uint32_t sim_rcc_ahb3enr;
+volatile uint32_t sim_rcc_ahb3rstr;
+volatile uint32_t sim_rcc_ahb4enr;
+volatile sim_mdma_channel_t sim_mdma[16];
@@ -0,0 +1,235 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/spi_bus_sim.c
+ * @authors Joshua Beard
+ * @brief Host-side simulated SPI bus for running the drivers in src/devices on Linux.
+ */
+#include <stddef.h>
+#include <string.h>
+#include "peripheral/gpio.h"
+#include "peripheral/spi.h"
+#include "peripheral/systick.h"
+#include "spi_bus_sim.h"
+
+/**************************************************************************************************
+ * @section Simulated State
+ **************************************************************************************************/
+
+#define SIM_BUS_INST_COUNT 7 // indexed by instance number, 0 unused
+#define SIM_BUS_MAX_DEVICES 16
+
+typedef struct {
+    bool used;
+    uint8_t inst;
+    uint8_t ss_pin;
+    const sim_bus_model_t* model;
+    void* ctx;
+    const spi_profile_t* profile; // set by spi_set_profile, NULL for the instance clock
+    sim_bus_stats_t stats;
+} sim_bus_device_t;
+
+uint64_t sim_bus_now_ns;
+uint8_t sim_bus_pin_level[SIM_BUS_PIN_COUNT];
+
+static sim_bus_device_t sim_devices[SIM_BUS_MAX_DEVICES];
+static uint32_t sim_sck_hz[SIM_BUS_INST_COUNT];
+static enum ti_errc_t sim_fault[SIM_BUS_INST_COUNT];
+
+/**************************************************************************************************
+ * @section Helpers
+ **************************************************************************************************/
+
+// Finds the entry of a chip select, taking a free one if create is set and there is none.
+static sim_bus_device_t* sim_bus_device(uint8_t inst, uint8_t ss_pin, bool create) {
+    sim_bus_device_t* free_slot = NULL;
+    for (uint8_t i = 0; i < SIM_BUS_MAX_DEVICES; i++) {
+        sim_bus_device_t* d = &sim_devices[i];
+        if (d->used && d->inst == inst && d->ss_pin == ss_pin) return d;
+        if (!d->used && free_slot == NULL) free_slot = d;
+    }
+    if (!create || free_slot == NULL) return NULL;
+    memset(free_slot, 0, sizeof(*free_slot));
+    free_slot->used = true;
+    free_slot->inst = inst;
+    free_slot->ss_pin = ss_pin;
+    return free_slot;
+}
+
+// Blocking transfer of every piece in iov under one SS assertion, with spi.c's argument checks.
+static void sim_bus_transfer(uint8_t inst, uint8_t ss_pin, const spi_iov_t* iov, uint8_t iov_count,
+                             uint8_t fill, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < 1 || inst > 6) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error");
+        return;
+    }
+    if (iov == NULL || iov_count == 0) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "No transfer buffers");
+        return;
+    }
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < iov_count; i++) total += iov[i].len;
+    if (total == 0 || total > 0xFFFFU) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "Transfer size must be 1-65535 bytes");
+        return;
+    }
+    if (sim_fault[inst] != TI_ERRC_NONE) {
+        TI_SET_ERRC(errc, sim_fault[inst], "Injected SPI fault");
+        sim_fault[inst] = TI_ERRC_NONE;
+        return;
+    }
+
+    sim_bus_device_t* dev = sim_bus_device(inst, ss_pin, true);
+    const sim_bus_model_t* model = dev ? dev->model : NULL;
+    void* ctx = dev ? dev->ctx : NULL;
+    const spi_profile_t* profile = dev ? dev->profile : NULL;
+    uint32_t sck_hz = sim_sck_hz[inst];
+    if (profile) {
+        // same rounding as spi_encode_profile: fastest kernel / 2^(MBR + 1) not over the limit
+        sck_hz = SPI_KERNEL_CLOCK_HZ / 2U;
+        while (sck_hz > profile->max_clock_hz) sck_hz /= 2U;
+    }
+
+    const uint64_t started = sim_bus_now_ns;
+    sim_bus_pin_level[ss_pin] = 0;
+    if (model && model->select) model->select(ctx);
+    for (uint8_t i = 0; i < iov_count; i++) {
+        const uint8_t* tx = iov[i].tx;
+        uint8_t* rx = iov[i].rx;
+        for (uint16_t off = 0; off < iov[i].len; off++) {
+            const uint8_t miso = model ? model->exchange(ctx, tx ? tx[off] : fill) : 0xFF;
+            if (rx) rx[off] = miso;
+        }
+    }
+    sim_bus_now_ns += SIM_BUS_TRANSFER_NS + (uint64_t)total * 8U * 1000000000U / sck_hz;
+    if (model && model->deselect) model->deselect(ctx);
+    sim_bus_pin_level[ss_pin] = 1;
+
+    if (dev) {
+        dev->stats.transfers++;
+        dev->stats.bytes += total;
+        dev->stats.bus_ns += sim_bus_now_ns - started;
+        dev->stats.sck_hz = sck_hz;
+        dev->stats.mode = profile ? profile->mode : MODE_0;
+    }
+}
+
+/**************************************************************************************************
+ * @section Simulator Control
+ **************************************************************************************************/
+
+void sim_bus_reset(void) {
+    memset(sim_devices, 0, sizeof(sim_devices));
+    memset(sim_bus_pin_level, 1, sizeof(sim_bus_pin_level));
+    for (uint8_t i = 0; i < SIM_BUS_INST_COUNT; i++) {
+        sim_sck_hz[i] = SIM_BUS_DEFAULT_SCK_HZ;
+        sim_fault[i] = TI_ERRC_NONE;
+    }
+    sim_bus_now_ns = 0;
+}
+
+void sim_bus_attach(uint8_t inst, uint8_t ss_pin, const sim_bus_model_t* model, void* ctx) {
+    sim_bus_device_t* dev = sim_bus_device(inst, ss_pin, model != NULL);
+    if (dev == NULL) return;
+    dev->model = model;
+    dev->ctx = ctx;
+}
+
+void sim_bus_set_clock(uint8_t inst, uint32_t sck_hz) {
+    if (inst < SIM_BUS_INST_COUNT && sck_hz) sim_sck_hz[inst] = sck_hz;
+}
+
+void sim_bus_inject_error(uint8_t inst, enum ti_errc_t errc) {
+    if (inst < SIM_BUS_INST_COUNT) sim_fault[inst] = errc;
+}
+
+void sim_bus_get_stats(uint8_t inst, uint8_t ss_pin, sim_bus_stats_t* out) {
+    const sim_bus_device_t* dev = sim_bus_device(inst, ss_pin, false);
+    if (dev) {
+        *out = dev->stats;
+    } else {
+        memset(out, 0, sizeof(*out));
+    }
+}
+
+/**************************************************************************************************
+ * @section Simulated spi.h
+ **************************************************************************************************/
+
+void spi_set_profile(uint8_t inst, uint8_t ss_pin, const spi_profile_t *profile, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    if (inst < 1 || inst > 6) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI instance range error");
+        return;
+    }
+    if (profile && (profile->max_clock_hz < SPI_MIN_CLOCK_HZ || profile->mode > MODE_3 ||
+                    profile->word_bits < 4 || profile->word_bits > 32)) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "SPI profile out of range");
+        return;
+    }
+    sim_bus_device_t* dev = sim_bus_device(inst, ss_pin, profile != NULL);
+    if (dev == NULL) {
+        if (profile) TI_SET_ERRC(errc, TI_ERRC_OVERFLOW, "Too many SPI profiles on instance");
+        return;
+    }
+    dev->profile = profile;
+}
+
+void spi_transfer_sync(uint8_t inst, uint8_t ss_pin, void* src, void* dst, uint8_t size, enum ti_errc_t *errc) {
+    const spi_iov_t iov = { .tx = src, .rx = dst, .len = size };
+    sim_bus_transfer(inst, ss_pin, &iov, 1, 0xFF, errc);
+}
+
+void spi_write(uint8_t inst, uint8_t ss_pin, const void* src, uint16_t len, enum ti_errc_t *errc) {
+    if (src == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "NULL source buffer");
+        return;
+    }
+    const spi_iov_t iov = { .tx = src, .rx = NULL, .len = len };
+    sim_bus_transfer(inst, ss_pin, &iov, 1, 0xFF, errc);
+}
+
+void spi_read(uint8_t inst, uint8_t ss_pin, void* dst, uint16_t len, uint8_t fill, enum ti_errc_t *errc) {
+    if (dst == NULL) {
+        TI_SET_ERRC(errc, TI_ERRC_INVALID_ARG, "NULL destination buffer");
+        return;
+    }
+    const spi_iov_t iov = { .tx = NULL, .rx = dst, .len = len };
+    sim_bus_transfer(inst, ss_pin, &iov, 1, fill, errc);
+}
+
+void spi_transfer_iov(uint8_t inst, uint8_t ss_pin, const spi_iov_t* iov, uint8_t iov_count, uint8_t fill,
+                      enum ti_errc_t *errc) {
+    sim_bus_transfer(inst, ss_pin, iov, iov_count, fill, errc);
+}
+
+/**************************************************************************************************
+ * @section Simulated gpio.h and systick.h
+ **************************************************************************************************/
+
+void tal_set_pin(int pin, int value) { sim_bus_pin_level[pin] = (uint8_t)(value != 0); }
+bool tal_read_pin(int pin) { return sim_bus_pin_level[pin] != 0; }
+void tal_set_mode(int pin, int mode) { (void)pin; (void)mode; }
+void tal_set_drain(int pin, int drain) { (void)pin; (void)drain; }
+void tal_set_speed(int pin, int speed) { (void)pin; (void)speed; }
+void tal_pull_pin(int pin, int pull) { (void)pin; (void)pull; }
+void tal_alternate_mode(int pin, int value) { (void)pin; (void)value; }
+bool tal_enable_clock(int pin) { (void)pin; return true; }
+bool tal_disable_clock(int pin) { (void)pin; return true; }
+
+void systick_init() {}
+void systick_delay(uint32_t delay) { sim_bus_now_ns += (uint64_t)delay * 1000000U; }
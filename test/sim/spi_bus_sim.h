@@ -0,0 +1,85 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/spi_bus_sim.h
+ * @authors Joshua Beard
+ * @brief Host-side simulated SPI bus for running the drivers in src/devices on Linux.
+ *
+ * Links in place of peripheral/spi.c, gpio.c and systick.c: the blocking transfers
+ * (spi_transfer_sync, spi_write, spi_read, spi_transfer_iov), spi_set_profile, the tal_* pin
+ * functions and systick_delay. Each transfer selects the device model attached to its (instance, SS pin),
+ * exchanges every byte with it and deselects it, the way the chip select frames it on the board.
+ * A chip select with a profile is clocked the way spi.c would run it (the fastest prescaler step
+ * at or under its max_clock_hz); the others run at their instance's clock in mode 0.
+ * Time is virtual: transfers advance it by their SCK time plus a fixed per-transfer cost, and
+ * systick_delay by the delay, so models can enforce conversion and busy times and tests can
+ * measure how much bus time a driver call costs. Unlike test/sim/spi_dma_sim.h nothing below the
+ * spi.h API is simulated, so the two backends are never linked together.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "peripheral/errc.h"
+
+#define SIM_BUS_PIN_COUNT 256
+
+/** @brief SCK every instance runs at until sim_bus_set_clock. */
+#define SIM_BUS_DEFAULT_SCK_HZ 8000000U
+
+/** @brief Virtual time each transfer costs on top of its SCK time: SS setup/hold and the driver
+ *         programming the peripheral. */
+#define SIM_BUS_TRANSFER_NS 500U
+
+/**
+ * @brief A device on the simulated bus. select and deselect may be NULL.
+ */
+typedef struct {
+    void (*select)(void* ctx);                   /** @brief SS went low. */
+    uint8_t (*exchange)(void* ctx, uint8_t mosi); /** @brief One byte clocked; returns MISO. */
+    void (*deselect)(void* ctx);                 /** @brief SS went high. */
+} sim_bus_model_t;
+
+/** @brief Traffic seen by one chip select since sim_bus_reset. */
+typedef struct {
+    uint32_t transfers;
+    uint32_t bytes;
+    uint64_t bus_ns;   // virtual time its transfers took
+    uint32_t sck_hz;   // clock of its last transfer
+    uint8_t mode;      // SPI mode of its last transfer
+} sim_bus_stats_t;
+
+extern uint64_t sim_bus_now_ns;                       // virtual time since sim_bus_reset
+extern uint8_t sim_bus_pin_level[SIM_BUS_PIN_COUNT];  // level of every pin, idle high
+
+/** @brief Detaches every model, clears the statistics and fault injection, and restarts time. */
+void sim_bus_reset(void);
+
+/**
+ * @brief Attaches a device model to a chip select. Transfers to chip selects without a model
+ *        read 0xFF, as MISO is pulled up.
+ * @param model Model callbacks, or NULL to detach. Must stay valid while attached.
+ * @param ctx Passed to every callback; usually the model's state.
+ */
+void sim_bus_attach(uint8_t inst, uint8_t ss_pin, const sim_bus_model_t* model, void* ctx);
+
+/** @brief Sets the SCK an instance's transfers to chip selects without a profile are timed at. */
+void sim_bus_set_clock(uint8_t inst, uint32_t sck_hz);
+
+/** @brief Makes the next transfer on an instance fail with errc without reaching the device. */
+void sim_bus_inject_error(uint8_t inst, enum ti_errc_t errc);
+
+/** @brief Reads the traffic of one chip select. */
+void sim_bus_get_stats(uint8_t inst, uint8_t ss_pin, sim_bus_stats_t* out);
@@ -0,0 +1,460 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/spi_dma_sim.c
+ * @authors Joshua Beard
+ * @brief Host-side simulated SPI/DMA backend.
+ */
+
+#include "spi_dma_sim.h"
+#include "peripheral/gpio.h"
+#include "peripheral/spi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**************************************************************************************************
+ * @section Simulated State
+ **************************************************************************************************/
+
+sim_dma_stream_t sim_dma[DMA_INSTANCE_COUNT][DMA_STREAM_COUNT];
+uint8_t sim_pin_level[SIM_PIN_COUNT];
+uint32_t sim_pin_falls[SIM_PIN_COUNT];
+bool sim_dma_fail_start;
+bool sim_spi_stalled;
+uint64_t sim_spi_bus_ns[7];
+uint32_t sim_spi_sr_reads;
+uint32_t sim_spi_dr_accesses;
+
+// DMAMUX1 request lines of SPI1-5. Index 0 is RX, 1 is TX.
+static const uint32_t sim_spi_req[7][2] = {
+    [1] = {37, 38}, [2] = {39, 40}, [3] = {61, 62}, [4] = {83, 84}, [5] = {85, 86},
+};
+
+static sim_spi_device_t sim_devices[7];
+static void* sim_device_ctx[7];
+
+// last SS pin driven low; the device on the bus only sees traffic while it stays low
+static int sim_selected = -1;
+
+void spi1_irq_handler(void);
+void spi2_irq_handler(void);
+void spi3_irq_handler(void);
+void spi4_irq_handler(void);
+void spi5_irq_handler(void);
+
+static void (*const sim_spi_handlers[7])(void) = {
+    [1] = spi1_irq_handler, [2] = spi2_irq_handler, [3] = spi3_irq_handler,
+    [4] = spi4_irq_handler, [5] = spi5_irq_handler,
+};
+
+// SR flags that raise the SPI interrupt share their bit position with the IER enable bit
+#define SIM_SPI_IRQ_FLAGS 0x3F8U
+
+// Data FIFO depth in bytes: 16 on SPI1-3, 8 on SPI4-6
+#define SIM_FIFO_MAX 16
+static const uint32_t sim_fifo_bytes[7] = { 0, 16, 16, 16, 8, 8, 8 };
+
+// A polled (non-DMA) transfer in progress. Every TXDR access is assumed to be a write; its value
+// is collected at the next SR/TXDR/RXDR access. Only one instance is expected to be polled at once;
+// one left streaming in packed mode counts until its stream is ended.
+typedef struct {
+    bool tx_pending;
+    uint32_t tx_nonce;   // what TXDR held before a packed-mode write, to tell its width
+    bool running;        // CSTART seen, frames still to clock
+    bool endless;        // started with TSIZE = 0: clocks whenever there is data, never ends
+    uint32_t frames_left;
+    uint8_t tx[SIM_FIFO_MAX];
+    uint32_t tx_count;
+    uint8_t rx[SIM_FIFO_MAX];
+    uint32_t rx_count;
+} sim_poll_t;
+
+static sim_poll_t sim_poll[7];
+
+/**************************************************************************************************
+ * @section Helpers
+ **************************************************************************************************/
+
+static uint8_t sim_loopback(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ss_pin; (void)ctx;
+    return mosi;
+}
+
+static sim_dma_stream_t* sim_find_stream(uint32_t request_id) {
+    for (int i = DMA1; i < DMA_INSTANCE_COUNT; ++i) {
+        for (int s = 0; s < DMA_STREAM_COUNT; ++s) {
+            sim_dma_stream_t* st = &sim_dma[i][s];
+            if (st->configured && st->armed && st->config.request_id == request_id) return st;
+        }
+    }
+    return NULL;
+}
+
+static uint8_t sim_spi_of_request(uint32_t request_id) {
+    for (uint8_t inst = 1; inst < 7; ++inst) {
+        if (sim_spi_req[inst][0] == request_id || sim_spi_req[inst][1] == request_id) return inst;
+    }
+    return 0;
+}
+
+// IFCR is write-one-to-clear on the chip
+static void sim_apply_ifcr(uint8_t inst) {
+    sim_spi[inst].sr &= ~sim_spi[inst].ifcr;
+    sim_spi[inst].ifcr = 0;
+}
+
+static uint32_t sim_frame_bytes(uint8_t inst) {
+    const uint32_t dsize = (sim_spi[inst].cfg1 & SPIx_CFG1_DSIZE.msk) >> SPIx_CFG1_DSIZE.pos;
+    return dsize < 8 ? 1 : (dsize < 16 ? 2 : 4);
+}
+
+// One byte on the wire: the selected device sees MOSI and drives MISO
+static uint8_t sim_clock_byte(uint8_t inst, uint8_t mosi) {
+    sim_spi_device_t device = sim_devices[inst] ? sim_devices[inst] : sim_loopback;
+    if (sim_selected >= 0 && sim_pin_level[sim_selected] == 0) {
+        return device((uint8_t)sim_selected, mosi, sim_device_ctx[inst]);
+    }
+    return 0xFF; // pulled up when nobody drives MISO
+}
+
+// SCK = kernel clock / 2^(MBR + 1)
+static void sim_add_bus_time(uint8_t inst, uint32_t frames) {
+    const uint32_t cfg1 = sim_spi[inst].cfg1;
+    const uint32_t dsize = (cfg1 & SPIx_CFG1_DSIZE.msk) >> SPIx_CFG1_DSIZE.pos;
+    const uint32_t mbr = (cfg1 & SPIx_CFG1_MBR.msk) >> SPIx_CFG1_MBR.pos;
+    sim_spi_bus_ns[inst] += (uint64_t)frames * (dsize + 1) * (2U << mbr) * 1000000000ULL / SPI_KERNEL_CLOCK_HZ;
+}
+
+// Frames per packet, from FTHVL. TXP needs room for one, RXP a whole one waiting.
+static uint32_t sim_packet_frames(uint8_t inst) {
+    return ((sim_spi[inst].cfg1 & SPIx_CFG1_FTHVL.msk) >> SPIx_CFG1_FTHVL.pos) + 1;
+}
+
+// True when a packet fills a 32-bit access, so a data register access is either one frame or
+// the whole packet. The width of a read can't be seen, so it is taken to be a packet whenever
+// one is waiting, which is what the driver does.
+static bool sim_packed(uint8_t inst) {
+    const uint32_t width = sim_frame_bytes(inst);
+    return width < 4 && sim_packet_frames(inst) * width == 4;
+}
+
+static bool sim_polled(uint8_t inst) {
+    const volatile sim_spi_regs_t* r = &sim_spi[inst];
+    return (r->cr1 & SPIx_CR1_SPE.msk) &&
+           !(r->cfg1 & (SPIx_CFG1_TXDMAEN.msk | SPIx_CFG1_RXDMAEN.msk));
+}
+
+// Moves the polled transfer on: collects the last TXDR write, clocks every frame the RX FIFO can
+// take, and updates TXP/RXP/EOT/OVR.
+static void sim_poll_step(uint8_t inst) {
+    volatile sim_spi_regs_t* r = &sim_spi[inst];
+    sim_poll_t* p = &sim_poll[inst];
+    sim_apply_ifcr(inst);
+    if (!(r->cr1 & SPIx_CR1_SPE.msk)) r->cr1 &= ~(SPIx_CR1_CSTART.msk | SPIx_CR1_CSUSP.msk); // disabling resets the transfer
+    if (!sim_polled(inst)) {
+        *p = (sim_poll_t){0};
+        return;
+    }
+    const uint32_t width = sim_frame_bytes(inst);
+    const uint32_t depth = sim_fifo_bytes[inst];
+    const uint32_t packet = sim_packet_frames(inst) * width;
+
+    if (p->tx_pending) {
+        p->tx_pending = false;
+        const uint32_t v = r->txdr;
+        // a packed write that changed the bytes past the first frame was a 32-bit one
+        const uint32_t bytes = (sim_packed(inst) && (v ^ p->tx_nonce) >> (8 * width)) ? 4 : width;
+        if (p->tx_count + bytes <= depth) {
+            for (uint32_t b = 0; b < bytes; ++b) p->tx[p->tx_count++] = (uint8_t)(v >> (8 * b));
+        } else {
+            r->sr |= SPIx_SR_UDR.msk; // written with no room in the FIFO; the data is lost
+        }
+    }
+
+    if (!p->running && (r->cr1 & SPIx_CR1_CSTART.msk)) {
+        p->running = true;
+        p->frames_left = r->cr2 & SPIx_CR2_TSIZE.msk;
+        p->endless = p->frames_left == 0;
+    }
+    if (p->running && (r->cr1 & SPIx_CR1_CSUSP.msk)) {
+        p->running = false;
+        r->cr1 &= ~(SPIx_CR1_CSTART.msk | SPIx_CR1_CSUSP.msk);
+        r->sr |= SPIx_SR_SUSP.msk;
+    }
+    while (!sim_spi_stalled && p->running && (p->endless || p->frames_left > 0) && p->tx_count >= width) {
+        uint8_t miso[4];
+        for (uint32_t b = 0; b < width; ++b) miso[b] = sim_clock_byte(inst, p->tx[b]);
+        p->tx_count -= width;
+        memmove(p->tx, p->tx + width, p->tx_count);
+        if (p->rx_count + width <= depth) {
+            memcpy(p->rx + p->rx_count, miso, width);
+            p->rx_count += width;
+        } else {
+            r->sr |= SPIx_SR_OVR.msk; // RX FIFO full; the frame is dropped
+        }
+        sim_add_bus_time(inst, 1);
+        if (!p->endless && --p->frames_left == 0) {
+            p->running = false;
+            r->cr1 &= ~SPIx_CR1_CSTART.msk;
+            r->sr |= SPIx_SR_EOT.msk | SPIx_SR_TXTF.msk;
+        }
+    }
+
+    r->sr &= ~(SPIx_SR_TXP.msk | SPIx_SR_RXP.msk | SPIx_SR_RXPLVL.msk);
+    if (p->tx_count + packet <= depth) r->sr |= SPIx_SR_TXP.msk;
+    if (p->rx_count >= packet) {
+        r->sr |= SPIx_SR_RXP.msk;
+    } else if (width == 1) {
+        r->sr |= (p->rx_count << SPIx_SR_RXPLVL.pos) & SPIx_SR_RXPLVL.msk;
+    }
+}
+
+static void sim_poll_all(void) {
+    for (uint8_t inst = 1; inst < 7; ++inst) sim_poll_step(inst);
+}
+
+/**************************************************************************************************
+ * @section Simulator Control
+ **************************************************************************************************/
+
+void sim_reset(void) {
+    memset((void*)sim_spi, 0, sizeof(sim_spi));
+    memset((void*)sim_nvic_iser, 0, sizeof(sim_nvic_iser));
+    memset(sim_dma, 0, sizeof(sim_dma));
+    memset(sim_pin_level, 1, sizeof(sim_pin_level));
+    memset(sim_pin_falls, 0, sizeof(sim_pin_falls));
+    memset(sim_devices, 0, sizeof(sim_devices));
+    memset(sim_device_ctx, 0, sizeof(sim_device_ctx));
+    memset(sim_spi_bus_ns, 0, sizeof(sim_spi_bus_ns));
+    memset(sim_poll, 0, sizeof(sim_poll));
+    sim_spi_sr_reads = 0;
+    sim_spi_dr_accesses = 0;
+    sim_dma_fail_start = false;
+    sim_spi_stalled = false;
+    sim_selected = -1;
+}
+
+void sim_spi_attach(uint8_t inst, sim_spi_device_t device, void* ctx) {
+    sim_devices[inst] = device;
+    sim_device_ctx[inst] = ctx;
+}
+
+bool sim_spi_clock(uint8_t inst) {
+    volatile sim_spi_regs_t* r = &sim_spi[inst];
+    sim_apply_ifcr(inst);
+    if (!(r->cr1 & SPIx_CR1_SPE.msk) || !(r->cr1 & SPIx_CR1_CSTART.msk)) return false;
+    if (!(r->cfg1 & SPIx_CFG1_RXDMAEN.msk) || !(r->cfg1 & SPIx_CFG1_TXDMAEN.msk)) return false;
+
+    sim_dma_stream_t* rx = sim_find_stream(sim_spi_req[inst][0]);
+    sim_dma_stream_t* tx = sim_find_stream(sim_spi_req[inst][1]);
+    if (!rx || !tx) return false;
+    if (rx->transfer.src != (const void*)&r->rxdr || tx->transfer.dest != (void*)&r->txdr) return false;
+
+    // TSIZE counts frames; each DMA item is one frame of 1, 2 or 4 bytes
+    const uint32_t tsize = r->cr2 & SPIx_CR2_TSIZE.msk;
+    const uint32_t width = sim_frame_bytes(inst);
+    const uint32_t item = width == 1 ? DMA_DATA_SIZE_BYTE : (width == 2 ? DMA_DATA_SIZE_HALFWORD : DMA_DATA_SIZE_WORD);
+    if (rx->config.src_data_size != item || tx->config.dest_data_size != item) return false;
+    const uint32_t bytes = tsize * width;
+    if (rx->transfer.size != bytes || tx->transfer.size != bytes) return false;
+
+    const uint8_t* src = tx->transfer.src;
+    uint8_t* dst = rx->transfer.dest;
+    for (uint32_t i = 0; i < bytes; ++i) {
+        const uint8_t mosi = src[tx->transfer.disable_mem_inc ? i % width : i];
+        dst[rx->transfer.disable_mem_inc ? i % width : i] = sim_clock_byte(inst, mosi);
+    }
+    sim_add_bus_time(inst, tsize);
+
+    r->cr1 &= ~SPIx_CR1_CSTART.msk;
+    r->sr |= SPIx_SR_EOT.msk | SPIx_SR_TXTF.msk;
+    return true;
+}
+
+void sim_spi_irq(uint8_t inst) {
+    if ((sim_spi[inst].sr & sim_spi[inst].ier & SIM_SPI_IRQ_FLAGS) && sim_spi_handlers[inst]) {
+        sim_spi_handlers[inst]();
+    }
+    sim_apply_ifcr(inst);
+}
+
+void sim_dma_complete(dma_instance_t instance, dma_stream_t stream, bool success) {
+    sim_dma_stream_t* st = &sim_dma[instance][stream];
+    if (!st->armed) return;
+    st->armed = false;
+    if (st->config.callback) st->config.callback(success, st->transfer.context);
+}
+
+bool sim_spi_run(uint8_t inst, sim_irq_order_t order) {
+    sim_dma_stream_t* rx = sim_find_stream(sim_spi_req[inst][0]);
+    sim_dma_stream_t* tx = sim_find_stream(sim_spi_req[inst][1]);
+    if (!sim_spi_clock(inst)) return false;
+
+    // the TX stream is done as soon as the last byte is in the FIFO
+    sim_dma_complete(tx->config.instance, tx->config.stream, true);
+    if (order == SIM_EOT_THEN_RX_DMA) {
+        sim_spi_irq(inst);
+        sim_dma_complete(rx->config.instance, rx->config.stream, true);
+    } else {
+        sim_dma_complete(rx->config.instance, rx->config.stream, true);
+        sim_spi_irq(inst);
+    }
+    return true;
+}
+
+void sim_spi_raise(uint8_t inst, uint32_t sr_bits) {
+    sim_apply_ifcr(inst); // clears the driver already wrote land before the new flags
+    sim_spi[inst].sr |= sr_bits;
+    sim_spi_irq(inst);
+}
+
+/**************************************************************************************************
+ * @section Data Register Accessors
+ **************************************************************************************************/
+
+rw_reg32_t const* sim_spi_sr_regs(void) {
+    sim_spi_sr_reads++;
+    sim_poll_all();
+    return sim_SPIx_SR;
+}
+
+rw_reg32_t const* sim_spi_txdr_regs(void) {
+    sim_spi_dr_accesses++;
+    sim_poll_all();
+    for (uint8_t inst = 1; inst < 7; ++inst) {
+        if (!sim_polled(inst)) continue;
+        sim_poll_t* p = &sim_poll[inst];
+        p->tx_pending = true;
+        if (sim_packed(inst)) {
+            // a fresh pattern each time, so a 32-bit write is told from a frame-wide one
+            p->tx_nonce = p->tx_nonce * 1664525U + 1013904223U;
+            sim_spi[inst].txdr = p->tx_nonce;
+        }
+    }
+    return sim_SPIx_TXDR;
+}
+
+rw_reg32_t const* sim_spi_rxdr_regs(void) {
+    sim_spi_dr_accesses++;
+    sim_poll_all();
+    for (uint8_t inst = 1; inst < 7; ++inst) {
+        sim_poll_t* p = &sim_poll[inst];
+        const uint32_t width = sim_frame_bytes(inst);
+        if (!sim_polled(inst) || p->rx_count < width) continue;
+        const uint32_t bytes = (sim_packed(inst) && p->rx_count >= 4) ? 4 : width;
+        uint32_t v = 0;
+        for (uint32_t b = 0; b < bytes; ++b) v |= (uint32_t)p->rx[b] << (8 * b);
+        sim_spi[inst].rxdr = v;
+        p->rx_count -= bytes;
+        memmove(p->rx, p->rx + bytes, p->rx_count);
+        if (p->rx_count < sim_packet_frames(inst) * width) sim_spi[inst].sr &= ~SPIx_SR_RXP.msk;
+    }
+    return sim_SPIx_RXDR;
+}
+
+/**************************************************************************************************
+ * @section Simulated dma.h
+ **************************************************************************************************/
+
+void* dma_init(enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    return NULL;
+}
+
+bool dma_configure_stream(const dma_config_t* config) {
+    if (config->instance < DMA1 || config->instance >= DMA_INSTANCE_COUNT) return false;
+    if (config->stream >= DMA_STREAM_COUNT) return false;
+    sim_dma_stream_t* st = &sim_dma[config->instance][config->stream];
+    st->configured = true;
+    st->armed = false;
+    st->config = *config;
+    return true;
+}
+
+void dma_abort_transfer(dma_instance_t instance, dma_stream_t stream, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_NONE;
+    sim_dma[instance][stream].armed = false;
+}
+
+bool dma_start_transfer(dma_transfer_t *dma_transfer, enum ti_errc_t *errc) {
+    if (errc) *errc = TI_ERRC_INVALID_ARG;
+    if (sim_dma_fail_start) return false;
+    sim_dma_stream_t* st = &sim_dma[dma_transfer->instance][dma_transfer->stream];
+    if (!st->configured) return false;
+    if (errc) *errc = st->armed ? TI_ERRC_BUSY : TI_ERRC_NONE;
+    if (st->armed) return false;
+    st->armed = true;
+    st->transfer = *dma_transfer;
+
+    const uint8_t inst = sim_spi_of_request(st->config.request_id);
+    if (inst) {
+        st->started_with_spe = (sim_spi[inst].cr1 & SPIx_CR1_SPE.msk) != 0;
+        st->started_without_rxdmaen = st->config.direction == PERIPH_TO_MEM &&
+                                      !(sim_spi[inst].cfg1 & SPIx_CFG1_RXDMAEN.msk);
+    }
+    return true;
+}
+
+/**************************************************************************************************
+ * @section Simulated gpio.h
+ **************************************************************************************************/
+
+void tal_set_pin(int pin, int value) {
+    if (value == 0 && sim_pin_level[pin]) sim_pin_falls[pin]++;
+    sim_pin_level[pin] = (uint8_t)(value != 0);
+    if (value == 0) sim_selected = pin;
+}
+
+bool tal_read_pin(int pin) { return sim_pin_level[pin] != 0; }
+void tal_set_mode(int pin, int mode) { (void)pin; (void)mode; }
+void tal_set_drain(int pin, int drain) { (void)pin; (void)drain; }
+void tal_set_speed(int pin, int speed) { (void)pin; (void)speed; }
+void tal_pull_pin(int pin, int pull) { (void)pin; (void)pull; }
+void tal_alternate_mode(int pin, int value) { (void)pin; (void)value; }
+bool tal_enable_clock(int pin) { (void)pin; return true; }
+bool tal_disable_clock(int pin) { (void)pin; return true; }
+
+/**************************************************************************************************
+ * @section Test Fixtures
+ **************************************************************************************************/
+
+uint8_t sim_mosi_log[SIM_MOSI_LOG_MAX];
+uint32_t sim_mosi_log_len;
+
+uint8_t sim_logging_device(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ss_pin; (void)ctx;
+    const uint8_t miso = (uint8_t)(sim_mosi_log_len * 3 + 1);
+    if (sim_mosi_log_len < SIM_MOSI_LOG_MAX) sim_mosi_log[sim_mosi_log_len] = mosi;
+    sim_mosi_log_len++;
+    return miso;
+}
+
+void spi_dma_sim_log_setup(uint8_t inst) {
+    sim_reset();
+    sim_mosi_log_len = 0;
+    sim_spi_attach(inst, sim_logging_device, NULL);
+}
+
+periph_dma_config_t sim_spi_tx_cfg = { .instance = DMA1, .stream = DMA_STREAM_0, .priority = DMA_PRIORITY_HIGH };
+periph_dma_config_t sim_spi_rx_cfg = { .instance = DMA1, .stream = DMA_STREAM_1, .priority = DMA_PRIORITY_HIGH };
+
+void spi_dma_sim_setup(uint8_t inst) {
+    sim_reset();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_dma_init(inst, &sim_spi_tx_cfg, &sim_spi_rx_cfg, &err);
+    if (err != TI_ERRC_NONE) { fprintf(stderr, "[ERROR] spi_dma_init failed\n"); exit(1); }
+}
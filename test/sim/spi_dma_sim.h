@@ -0,0 +1,117 @@
+/**
+ * This file is part of the Titan Flight Computer Project
+ * Copyright (c) 2026 UW SARP
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * @file test/sim/spi_dma_sim.h
+ * @authors Joshua Beard
+ * @brief Host-side simulated SPI/DMA backend for running peripheral/spi.c on Linux.
+ *
+ * Stands in for the dma.h API and the gpio functions spi.c links against; the SPI registers
+ * themselves come from test/sim/internal/mmio.h and sim_regs.c. DMA transfers don't move on their
+ * own: a test starts one through the driver, then calls sim_spi_run to clock it through an
+ * attached device model and deliver the DMA and SPI interrupts in a chosen order. Polled
+ * transfers run as the driver spins on SR, with TXDR writes clocked through the same device
+ * models and 16 (SPI1-3) or 8 (SPI4-6) byte FIFOs. FTHVL sets the packet size TXP and RXP wait
+ * for, and packed mode's 32-bit data register accesses move a whole packet.
+ */
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "internal/mmio.h"
+#include "peripheral/dma.h"
+
+#define SIM_PIN_COUNT 256
+
+/**
+ * @brief Device model on the simulated bus. Called once per byte while its SS pin is low.
+ * @param ss_pin The selected SS pin.
+ * @param mosi Byte clocked out by the master.
+ * @param ctx Pointer given to sim_spi_attach.
+ * @return Byte the device drives on MISO.
+ */
+typedef uint8_t (*sim_spi_device_t)(uint8_t ss_pin, uint8_t mosi, void* ctx);
+
+/** @brief Order in which a finished transfer's completion interrupts are delivered. */
+typedef enum {
+    SIM_EOT_THEN_RX_DMA, // SPI EOT interrupt, then RX stream transfer complete
+    SIM_RX_DMA_THEN_EOT, // RX stream still draining when EOT fires is the other way round
+} sim_irq_order_t;
+
+/** @brief Simulated DMA1/DMA2 stream. */
+typedef struct {
+    bool configured;
+    dma_config_t config;
+    bool armed;             // dma_start_transfer called, not yet completed
+    dma_transfer_t transfer;
+    bool started_with_spe;  // the owning SPI was enabled when the stream was armed
+    bool started_without_rxdmaen; // an RX stream was armed before RXDMAEN was set
+} sim_dma_stream_t;
+
+extern sim_dma_stream_t sim_dma[DMA_INSTANCE_COUNT][DMA_STREAM_COUNT];
+extern uint8_t sim_pin_level[SIM_PIN_COUNT];
+extern uint32_t sim_pin_falls[SIM_PIN_COUNT]; // high-to-low edges, i.e. chip select assertions
+extern bool sim_dma_fail_start; // make the next dma_start_transfer calls fail
+extern bool sim_spi_stalled;    // polled transfers stop clocking: SCK held, no frame moves
+extern uint64_t sim_spi_bus_ns[7]; // SCK time clocked on each instance, from its MBR and DSIZE
+extern uint32_t sim_spi_sr_reads;    // SR reads by the driver, all instances
+extern uint32_t sim_spi_dr_accesses; // TXDR/RXDR accesses by the driver, all instances
+
+/** @brief Resets every simulated register, stream, pin and device. Pins idle high. */
+void sim_reset(void);
+
+/** @brief Attaches a device model to an SPI instance. NULL restores the default loopback. */
+void sim_spi_attach(uint8_t inst, sim_spi_device_t device, void* ctx);
+
+/**
+ * @brief Clocks a started transfer through the attached device and delivers its interrupts.
+ * @return false if no transfer was ready to run (CSTART, SPE or a DMA stream missing).
+ */
+bool sim_spi_run(uint8_t inst, sim_irq_order_t order);
+
+/** @brief Clocks the bytes and raises EOT, but delivers no interrupts. */
+bool sim_spi_clock(uint8_t inst);
+
+/** @brief Delivers the SPI interrupt if any enabled flag is set, then applies IFCR. */
+void sim_spi_irq(uint8_t inst);
+
+/** @brief Completes the RX stream of a clocked transfer through its DMA callback. */
+void sim_dma_complete(dma_instance_t instance, dma_stream_t stream, bool success);
+
+/** @brief Sets SR error bits on an instance and delivers the interrupt. */
+void sim_spi_raise(uint8_t inst, uint32_t sr_bits);
+
+#define SIM_MOSI_LOG_MAX 70000
+
+extern uint8_t sim_mosi_log[SIM_MOSI_LOG_MAX]; // MOSI bytes seen by sim_logging_device
+extern uint32_t sim_mosi_log_len;              // bytes it has seen, including any past the log
+
+/**
+ * @brief Device model that answers byte n of the session with (n * 3 + 1) and logs what it was
+ * sent in sim_mosi_log.
+ */
+uint8_t sim_logging_device(uint8_t ss_pin, uint8_t mosi, void* ctx);
+
+/** @brief sim_reset, then an empty MOSI log and sim_logging_device on inst. */
+void spi_dma_sim_log_setup(uint8_t inst);
+
+extern periph_dma_config_t sim_spi_tx_cfg; // DMA1 stream 0, high priority
+extern periph_dma_config_t sim_spi_rx_cfg; // DMA1 stream 1, high priority
+
+/**
+ * @brief sim_reset, then spi_dma_init on inst with sim_spi_tx_cfg and sim_spi_rx_cfg. Exits the
+ * test process if the driver refuses them.
+ */
+void spi_dma_sim_setup(uint8_t inst);
@@ -1,12 +1,4 @@
-#define _POSIX_C_SOURCE 200809L
-
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <stdarg.h>
+#include "host_test.h"
 #include "../src/internal/alloc.h"
 
 // Overwrite TI_SET_ERRC for unit tests to avoid hardware dependencies (like flash)
@@ -20,10 +12,8 @@ void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const
     (void)errc; (void)msg; (void)func; (void)file; (void)line;
 }
 
-extern void* HEAP_START;
-
 // heap buffer + reset helper
-static unsigned char heap_buf[TOTAL_HEAP_SIZE];
+static _Alignas(CACHE_LINE_SIZE) unsigned char heap_buf[TOTAL_HEAP_SIZE];
 static void reset_heap(void) {
     memset(heap_buf, 0xA5, sizeof(heap_buf)); // fill pattern
     HEAP_START = (void*)heap_buf;
@@ -32,181 +22,6 @@ static void reset_heap(void) {
     if (err != TI_ERRC_NONE) { fprintf(stderr, "[ERROR] init_heap failed\n"); exit(1); }
 }
 
-typedef void (*test_fn_t)(void);
-
-// test case object
-typedef struct { const char* name; test_fn_t fn; } TestCase;
-#define TEST_CASE(fn) { #fn, fn }
-
-// global counters
-static int total_asserts = 0;
-static int total_failures = 0;
-
-// failure object
-typedef struct { const char* test_name; const char* msg; } Failure;
-#define MAX_FAILURES 512
-static Failure failures[MAX_FAILURES];
-static int failure_count = 0;
-
-static const char* current_test_name = NULL;
-static int failure_pipe_fd = -1;
-static int local_asserts = 0;
-static int local_failures = 0;
-
-static FILE* out_fp = NULL;
-
-// write to stdout and output file (if open)
-static void log_printf(const char* fmt, ...) {
-	va_list ap;
-	va_start(ap, fmt);
-	vfprintf(stdout, fmt, ap);
-	va_end(ap);
-
-	if (out_fp) {
-		va_list ap2;
-		va_start(ap2, fmt);
-		vfprintf(out_fp, fmt, ap2);
-		va_end(ap2);
-		fflush(out_fp);
-	}
-	fflush(stdout);
-}
-
-// assert helper
-static void assert_check(int condition, const char* msg) {
-    local_asserts++; // count each assertion
-
-    const char* tag = condition ? "[OK]" : "[FAIL]";
-    const int tag_col = 80;
-    const int indent = 6;  
-    int tag_len = (int)strlen(tag);
-    int max_msg_len = tag_col - indent - tag_len;
-    if (max_msg_len < 0) max_msg_len = 0;
-
-    char trunc_msg[1024];
-    int msg_len = snprintf(trunc_msg, sizeof(trunc_msg), "%s", msg);
-    if (msg_len > max_msg_len) msg_len = max_msg_len;
-
-    // build aligned line into buffer, then print via log_printf
-    char linebuf[2048];
-    int pos = 0;
-    pos += snprintf(linebuf + pos, sizeof(linebuf) - pos, "    - ");
-    // append truncated message
-    if (msg_len > 0) {
-        strncat(linebuf + pos, trunc_msg, (size_t)msg_len);
-        pos = (int)strlen(linebuf);
-    }
-    int spaces = tag_col - indent - msg_len - tag_len;
-    if (spaces < 1) spaces = 1;
-    for (int i = 0; i < spaces && pos + 1 < (int)sizeof(linebuf); ++i) {
-        linebuf[pos++] = ' ';
-    }
-    // append tag and null-terminate
-    if (pos + tag_len + 2 < (int)sizeof(linebuf)) {
-        strcpy(linebuf + pos, tag);
-        pos += tag_len;
-    }
-    linebuf[pos++] = '\n';
-    linebuf[pos] = '\0';
-
-    log_printf("%s", linebuf);
-
-    if (!condition) {
-        local_failures++;
-        if (failure_pipe_fd >= 0) { // pipe to parent
-            char buf[1024];
-            int n = snprintf(buf, sizeof(buf), "%s|%s\n", current_test_name, msg);
-            if (n > 0) write(failure_pipe_fd, buf, (size_t)n);
-        }
-    }
-}
-
-// run test in forked child
-static void run_test(const TestCase* tc) {
-    int pfd[2];
-    // idea is that one failure shouldn't cause rest of tests to not run.
-    // so separate child process is made w/ fork(). pipe is used for communication w/
-    // processes-- info about failures is written to pipe.
-    if (pipe(pfd) != 0) { perror("pipe"); pfd[0] = pfd[1] = -1; }
-
-    pid_t pid = fork(); // child process for isolation
-    if (pid < 0) { perror("fork"); return; }
-
-    if (pid == 0) {
-        if (pfd[0] >= 0) close(pfd[0]);
-        failure_pipe_fd = (pfd[1] >= 0) ? pfd[1] : -1;
-
-        current_test_name = tc->name;
-        log_printf("%s\n", tc->name);
-        fflush(stdout);
-
-        failure_count = 0;
-        local_asserts = 0;
-        local_failures = 0;
-
-        tc->fn(); // execute test
-
-        // send counts to parent
-        if (failure_pipe_fd >= 0) {
-            char cntbuf[128];
-            int n = snprintf(cntbuf, sizeof(cntbuf), "__COUNTS__|%d|%d\n", local_asserts, local_failures);
-            if (n > 0) write(failure_pipe_fd, cntbuf, (size_t)n);
-            close(failure_pipe_fd);
-        }
-        exit(0);
-    }
-
-    if (pfd[1] >= 0) close(pfd[1]);
-    int status = 0;
-    waitpid(pid, &status, 0); // wait child
-
-    if (pfd[0] >= 0) {
-        FILE* rf = fdopen(pfd[0], "r");
-        if (rf) {
-            char line[1024];
-            while (fgets(line, sizeof(line), rf)) {
-                char* sep = strchr(line, '|');
-                if (!sep) continue;
-                *sep = '\0';
-                char* tname = line;
-                char* msg = sep + 1;
-                char* nl = strchr(msg, '\n');
-                if (nl) *nl = '\0';
-
-                if (strcmp(tname, "__COUNTS__") == 0) {
-                    char* second_sep = strchr(msg, '|');
-                    if (second_sep) {
-                        *second_sep = '\0';
-                        int a = atoi(msg);
-                        int f = atoi(second_sep + 1);
-                        total_asserts += a;
-                        total_failures += f;
-                    }
-                    continue;
-                }
-
-                if (failure_count < MAX_FAILURES) {
-                    failures[failure_count].test_name = strdup(tname);
-                    failures[failure_count].msg = strdup(msg);
-                    failure_count++;
-                }
-            }
-            fclose(rf);
-        } else close(pfd[0]);
-    }
-
-    if (WIFSIGNALED(status)) { // crash
-        int sig = WTERMSIG(status);
-        log_printf("    Result: CRASH (signal %d)\n", sig);
-        if (failure_count < MAX_FAILURES) {
-            failures[failure_count].test_name = tc->name;
-            failures[failure_count].msg = "test crashed (signal)";
-            failure_count++;
-        }
-        total_failures += 1;
-    }
-}
-
 // basic heap init
 static void test_init_heap_basic(void) {
     reset_heap();
@@ -373,17 +188,245 @@ static void test_pool_256(void)  { test_pool_generic(4); }
 static void test_pool_512(void)  { test_pool_generic(5); }
 static void test_pool_1024(void) { test_pool_generic(6); }
 
-int main(void) {
-    // open output file
-    out_fp = fopen("alloctest_output.txt", "w");
-    if (!out_fp) {
-        perror("fopen alloctest_output.txt");
-        // continue without file output
+// derived heap constants match the pool table (and the old hand-computed values)
+static void test_heap_config(void) {
+    uint32_t total = 0, blocks = 0;
+    for (uint32_t i = 0; i < NUMBER_OF_POOLS; ++i) {
+        assert_check(POOL_OFFSETS[i] == total, "pool offset is running byte sum");
+        assert_check(POOL_FIRST_BLOCKS[i] == blocks, "first block is running block sum");
+        assert_check((1u << POOL_BLOCK_SHIFTS[i]) == POOL_BLOCK_SIZES[i], "shift matches block size");
+        total += POOL_BLOCK_SIZES[i] * POOL_SIZES[i];
+        blocks += POOL_SIZES[i];
+    }
+    assert_check(TOTAL_HEAP_SIZE == total && TOTAL_HEAP_SIZE == 63968, "total heap size");
+    assert_check(TOTAL_BLOCK_COUNT == blocks, "total block count");
+
+    // every region's pools follow the default heap's, with offsets restarting at each region
+    uint32_t id = 0, all_blocks = 0;
+    int layout_ok = 1;
+    for (uint32_t r = 0; r < HEAP_REGION_COUNT; ++r) {
+        uint32_t region_total = 0;
+        layout_ok &= HEAP_REGION_FIRST_POOLS[r] == id;
+        for (uint32_t j = 0; j < HEAP_REGION_POOL_COUNTS[r]; ++j, ++id) {
+            layout_ok &= POOL_REGIONS[id] == r && POOL_OFFSETS[id] == region_total && POOL_FIRST_BLOCKS[id] == all_blocks;
+            region_total += POOL_BLOCK_SIZES[id] * POOL_SIZES[id];
+            all_blocks += POOL_SIZES[id];
+        }
+        layout_ok &= HEAP_REGION_SIZES[r] == region_total;
+    }
+    assert_check(layout_ok && id == TOTAL_POOL_COUNT, "region layout is a running sum per region");
+    assert_check(HEAP_TOTAL_BLOCK_COUNT == all_blocks && IS_FREE_SIZE == (all_blocks + 7) / 8, "bitmap size");
+}
+
+// boot-time init latency, and every block is on a free list afterwards
+#define BENCH_INITS 2000
+
+static void test_bench_init_heap(void) {
+    HEAP_START = (void*)heap_buf;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    uint64_t start = host_now_ns();
+    for (int n = 0; n < BENCH_INITS; ++n) {
+        init_heap(&err);
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    log_printf("      init_heap: %.2f us\n", (double)elapsed / BENCH_INITS / 1000.0);
+    assert_check(err == TI_ERRC_NONE, "init_heap ok");
+
+    int all_allocated = 1;
+    for (uint32_t i = 0; i < NUMBER_OF_POOLS; ++i) {
+        for (uint32_t j = 0; j < POOL_SIZES[i]; ++j) {
+            void* p = alloc(POOL_BLOCK_SIZES[i], &err);
+            if (err != TI_ERRC_NONE || p != (void*)(heap_buf + POOL_OFFSETS[i] + j * POOL_BLOCK_SIZES[i])) {
+                all_allocated = 0;
+            }
+        }
+    }
+    assert_check(all_allocated, "free lists hand out every block in address order");
+    alloc(16, &err);
+    assert_check(err == TI_ERRC_OVERFLOW, "heap exhausted afterwards");
+}
+
+// alloc_uninit hands out blocks without touching their contents
+static void test_alloc_uninit(void) {
+    reset_heap();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    unsigned char* p = alloc_uninit(16, &err);
+    assert_check(err == TI_ERRC_NONE && p != NULL, "alloc_uninit 16");
+    assert_check(!isFree(p), "uninit block marked allocated");
+    // bytes past the free-list pointer still hold reset_heap's fill pattern
+    assert_check(p[sizeof(void*)] == 0xA5 && p[15] == 0xA5, "contents left untouched");
+    ti_free(p, &err);
+    assert_check(err == TI_ERRC_NONE && isFree(p), "uninit block frees normally");
+
+    unsigned char* z = alloc(16, &err);
+    int zeroed = 1;
+    for (int i = 0; i < 16; ++i) zeroed &= (z[i] == 0);
+    assert_check(z == p && zeroed, "alloc zeroes the same block");
+}
+
+// alloc_dma blocks are cache-line aligned, whole lines, and zeroed
+static void test_alloc_dma(void) {
+    reset_heap();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (uint32_t size = 1; size <= 1024; size *= 2) {
+        unsigned char* p = alloc_dma(size, &err);
+        char msg[96];
+        snprintf(msg, sizeof(msg), "alloc_dma(%u) aligned to a cache line", size);
+        assert_check(err == TI_ERRC_NONE && p && ((uintptr_t)p % CACHE_LINE_SIZE) == 0, msg);
+        int zeroed = 1;
+        uint32_t span = size < CACHE_LINE_SIZE ? CACHE_LINE_SIZE : size;
+        for (uint32_t i = 0; i < span; ++i) zeroed &= (p[i] == 0);
+        snprintf(msg, sizeof(msg), "alloc_dma(%u) zeroed over whole lines", size);
+        assert_check(zeroed, msg);
+    }
+    assert_check(alloc_dma(0, &err) == NULL && err == TI_ERRC_INVALID_ARG, "alloc_dma(0) rejected");
+}
+
+// init_heap refuses a heap that isn't cache-line aligned
+static void test_init_heap_misaligned(void) {
+    HEAP_START = (void*)(heap_buf + 16);
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "misaligned heap start rejected");
+}
+
+// micro-benchmark: alloc/free pairs on the last block of each pool (worst case for a
+// linear block walk), zeroed vs uninitialised, reported in ns/op
+#define BENCH_PAIRS 200000
+
+static uint64_t bench_pairs(uint32_t idx, void* (*fn)(uint32_t, enum ti_errc_t*), int* ok) {
+    reset_heap();
+    uint32_t sz = POOL_BLOCK_SIZES[idx];
+    enum ti_errc_t err = TI_ERRC_NONE;
+
+    // leave only the last block of the pool on its free list
+    for (uint32_t i = 0; i + 1 < POOL_SIZES[idx]; ++i) {
+        alloc_uninit(sz, &err);
+    }
+
+    uint64_t start = host_now_ns();
+    for (int n = 0; n < BENCH_PAIRS; ++n) {
+        void* p = fn(sz, &err);
+        if (err != TI_ERRC_NONE || !p) { *ok = 0; break; }
+        ti_free(p, &err);
+    }
+    return host_now_ns() - start;
+}
+
+static void test_bench_alloc_free(void) {
+    char msg[128];
+    for (uint32_t idx = 0; idx < NUMBER_OF_POOLS; ++idx) {
+        int ok = 1;
+        uint64_t zeroed = bench_pairs(idx, alloc, &ok);
+        uint64_t uninit = bench_pairs(idx, alloc_uninit, &ok);
+
+        log_printf("      pool %u (%4u B): zeroed %7.1f ns/op, uninit %7.1f ns/op\n", idx, POOL_BLOCK_SIZES[idx],
+                   (double)zeroed / (2.0 * BENCH_PAIRS), (double)uninit / (2.0 * BENCH_PAIRS));
+        snprintf(msg, sizeof(msg), "alloc/free pairs in pool %u succeed", idx);
+        assert_check(ok, msg);
+    }
+}
+
+// counters: allocs/frees/in-use/peak on the serving pool
+static void test_stats_counts(void) {
+    reset_heap();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    alloc_stats_t st;
+    alloc_get_stats(&st);
+    int zero = 1;
+    for (int i = 0; i < NUMBER_OF_POOLS; ++i) {
+        zero &= st.pools[i].allocs == 0 && st.pools[i].frees == 0 && st.pools[i].in_use == 0 && st.pools[i].peak_in_use == 0;
+    }
+    assert_check(zero && st.invalid_requests == 0, "init_heap starts counters at zero");
+
+    void* a = alloc(64, &err);
+    void* b = alloc_uninit(60, &err);
+    void* c = alloc_dma(8, &err);
+    ti_free(a, &err);
+    alloc_get_stats(&st);
+    assert_check(st.pools[POOL_SRAM123_64].allocs == 2 && st.pools[POOL_SRAM123_64].frees == 1, "64 B pool allocs/frees");
+    assert_check(st.pools[POOL_SRAM123_64].in_use == 1 && st.pools[POOL_SRAM123_64].peak_in_use == 2, "64 B pool in-use and peak");
+    assert_check(st.pools[POOL_SRAM123_32].allocs == 1 && st.pools[POOL_SRAM123_32].in_use == 1, "alloc_dma counted on the 32 B pool");
+    assert_check(st.pools[POOL_SRAM123_16].allocs == 0, "untouched pool stays zero");
+
+    ti_free(b, &err);
+    ti_free(b, &err); // double free
+    ti_free(c, &err);
+    ti_free((unsigned char*)c + 4, &err); // not a block start
+    alloc(0, &err);
+    alloc(POOL_BLOCK_SIZES[NUMBER_OF_POOLS - 1] + 1, &err);
+    alloc_get_stats(&st);
+    assert_check(st.pools[POOL_SRAM123_64].in_use == 0 && st.pools[POOL_SRAM123_64].frees == 2, "double free not counted as a free");
+    assert_check(st.invalid_requests == 4, "double free, bad pointer and bad sizes counted as invalid");
+}
+
+// a full pool falls through: the ideal pool records a promotion, then a failure once nothing fits
+static void test_stats_promotions_and_failures(void) {
+    reset_heap();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    static void* held[TOTAL_BLOCK_COUNT];
+    uint32_t n = 0;
+    for (; n < TOTAL_BLOCK_COUNT; ++n) {
+        held[n] = alloc_uninit(512, &err);
+        if (!held[n]) break;
     }
+    alloc_stats_t st;
+    alloc_get_stats(&st);
+    assert_check(n == POOL_SIZES[POOL_SRAM123_512] + POOL_SIZES[POOL_SRAM123_1024], "512 B requests fill 512 and 1024 B pools");
+    assert_check(st.pools[POOL_SRAM123_512].promotions == POOL_SIZES[POOL_SRAM123_1024], "promotions counted on the ideal pool");
+    assert_check(st.pools[POOL_SRAM123_1024].allocs == POOL_SIZES[POOL_SRAM123_1024] && st.pools[POOL_SRAM123_1024].promotions == 0,
+                 "allocs counted on the serving pool");
+    assert_check(st.pools[POOL_SRAM123_512].failures == 1 && err == TI_ERRC_OVERFLOW, "failure counted on the ideal pool");
+    assert_check(st.pools[POOL_SRAM123_1024].peak_in_use == POOL_SIZES[POOL_SRAM123_1024], "peak reaches pool capacity");
+
+    for (uint32_t j = 0; j < n; ++j) ti_free(held[j], &err);
+    alloc_clear_stats();
+    alloc_get_stats(&st);
+    assert_check(st.pools[POOL_SRAM123_512].promotions == 0 && st.pools[POOL_SRAM123_512].failures == 0, "clear zeroes event counters");
+    assert_check(st.pools[POOL_SRAM123_1024].peak_in_use == 0 && st.pools[POOL_SRAM123_1024].in_use == 0, "clear restarts peak from in-use");
+
+    void* keep = alloc(1024, &err);
+    alloc_clear_stats();
+    alloc_get_stats(&st);
+    assert_check(st.pools[POOL_SRAM123_1024].peak_in_use == 1, "peak after clear covers blocks still held");
+    ti_free(keep, &err);
+}
 
-    log_printf("Running alloc unit tests...\n");
+// downlink encoding: big-endian u16 triples per pool of one region, saturating
+static void test_stats_pack(void) {
+    alloc_stats_t st;
+    memset(&st, 0, sizeof(st));
+    st.pools[0].peak_in_use = 0x0102;
+    st.pools[0].promotions = 0x0304;
+    st.pools[0].failures = 0x0506;
+    st.pools[NUMBER_OF_POOLS - 1].promotions = 0x12345;
+    st.pools[NUMBER_OF_POOLS].peak_in_use = 0x0A0B; // first pool of the next region
+
+    const size_t default_len = NUMBER_OF_POOLS * ALLOC_PACKED_POOL_SIZE;
+    uint8_t buf[ALLOC_PACKED_STATS_MAX_SIZE + 1];
+    memset(buf, 0xEE, sizeof(buf));
+    enum ti_errc_t err = TI_ERRC_NONE;
+    size_t len = 0;
+    alloc_pack_stats(&st, HEAP_REGION_DEFAULT, buf, default_len, &len, &err);
+    assert_check(err == TI_ERRC_NONE && len == default_len, "pack ok");
+    assert_check(buf[0] == 0x01 && buf[1] == 0x02 && buf[2] == 0x03 && buf[3] == 0x04 && buf[4] == 0x05 && buf[5] == 0x06,
+                 "first pool encoded big-endian");
+    const uint8_t* last = &buf[(NUMBER_OF_POOLS - 1) * ALLOC_PACKED_POOL_SIZE];
+    assert_check(last[2] == 0xFF && last[3] == 0xFF, "counter saturates at 0xFFFF");
+    assert_check(buf[default_len] == 0xEE, "nothing written past the region's pools");
+
+    alloc_pack_stats(&st, HEAP_REGION_DEFAULT, buf, default_len - 1, &len, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "short buffer rejected");
+
+    alloc_pack_stats(&st, (enum heap_region_t)(HEAP_REGION_DEFAULT + 1), buf, sizeof(buf), &len, &err);
+    assert_check(err == TI_ERRC_NONE && buf[0] == 0x0A && buf[1] == 0x0B, "other region packs its own pools");
+    alloc_pack_stats(&st, HEAP_REGION_COUNT, buf, sizeof(buf), &len, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "unknown region rejected");
+}
 
+int main(void) {
     TestCase tests[] = {
+        TEST_CASE(test_heap_config),
         TEST_CASE(test_init_heap_basic),
         TEST_CASE(test_alloc_free_realloc),
         TEST_CASE(test_double_free),
@@ -400,28 +443,18 @@ int main(void) {
         TEST_CASE(test_pool_512),
         TEST_CASE(test_pool_1024),
 
-        TEST_CASE(test_stress_pattern)
-    };
-
-    int num_tests = sizeof(tests) / sizeof(tests[0]);
-    for (int i = 0; i < num_tests; ++i) {
-        run_test(&tests[i]);
-    }
-
-    log_printf("\nSummary: %d/%d assertions passed, %d failed.\n",
-           total_asserts - total_failures, total_asserts, total_failures);
+        TEST_CASE(test_stress_pattern),
+        TEST_CASE(test_alloc_uninit),
+        TEST_CASE(test_alloc_dma),
+        TEST_CASE(test_init_heap_misaligned),
+        TEST_CASE(test_stats_counts),
+        TEST_CASE(test_stats_promotions_and_failures),
+        TEST_CASE(test_stats_pack),
 
-    if (total_failures > 0) {
-        log_printf("Failures:\n");
-        for (int i = 0; i < failure_count; ++i) {
-            log_printf("  [%s] %s\n", failures[i].test_name, failures[i].msg);
-        }
-    }
-
-    if (out_fp) {
-        fclose(out_fp);
-        out_fp = NULL;
-    }
+        TEST_CASE(test_bench_init_heap),
+        TEST_CASE(test_bench_alloc_free)
+    };
 
-    return (total_failures == 0) ? 0 : 1;
-}
\ No newline at end of file
+    return run_test_suite("alloc unit tests", "alloctest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
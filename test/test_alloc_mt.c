@@ -0,0 +1,211 @@
+#include "host_test.h"
+#include "../src/internal/alloc.h"
+#include <pthread.h>
+
+// Concurrency stress test for the lock-free pool allocator. Threads stand in for the two cores
+// and their interrupt handlers; built with ALLOC_CORE_CACHE_SIZE > 0 so the per-core caches are
+// exercised alongside the shared free lists.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+// each thread pretends to run on the core given by its id
+static _Thread_local uint32_t thread_core = 0;
+uint32_t alloc_core_id(void) { return thread_core; }
+
+#define STRESS_THREADS 4
+#define STRESS_ITERS   200000
+#define STRESS_HELD    8
+
+static _Alignas(CACHE_LINE_SIZE) unsigned char heap_buf[TOTAL_HEAP_SIZE];
+
+typedef struct {
+    uint32_t id;
+    uint32_t corrupt;  // blocks whose stamp changed while we owned them
+    uint32_t failures; // unexpected alloc/free errors
+    uint32_t allocs;
+} stress_ctx_t;
+
+static uint32_t next_rand(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static void* stress_worker(void* arg) {
+    stress_ctx_t* ctx = arg;
+    thread_core = ctx->id % ALLOC_CORE_COUNT;
+    uint32_t seed = 0x9E3779B9u * (ctx->id + 1);
+
+    uint32_t* held[STRESS_HELD] = {0};
+    uint32_t stamp[STRESS_HELD] = {0};
+
+    for (uint32_t n = 0; n < STRESS_ITERS; ++n) {
+        uint32_t slot = next_rand(&seed) % STRESS_HELD;
+        enum ti_errc_t err = TI_ERRC_NONE;
+
+        if (held[slot]) {
+            // if another thread was handed the same block it will have overwritten the stamp
+            if (held[slot][0] != stamp[slot] || held[slot][1] != ~stamp[slot]) ctx->corrupt++;
+            ti_free(held[slot], &err);
+            if (err != TI_ERRC_NONE) ctx->failures++;
+            held[slot] = NULL;
+            continue;
+        }
+
+        uint32_t size = 16u << (next_rand(&seed) % 5); // 16..256 bytes
+        uint32_t* p = (next_rand(&seed) & 1) ? alloc(size, &err) : alloc_uninit(size, &err);
+        if (!p) {
+            if (err != TI_ERRC_OVERFLOW) ctx->failures++;
+            continue;
+        }
+        ctx->allocs++;
+        stamp[slot] = (ctx->id << 24) ^ n;
+        p[0] = stamp[slot];
+        p[1] = ~stamp[slot];
+        held[slot] = p;
+    }
+
+    for (int s = 0; s < STRESS_HELD; ++s) {
+        if (!held[s]) continue;
+        enum ti_errc_t err = TI_ERRC_NONE;
+        if (held[s][0] != stamp[s] || held[s][1] != ~stamp[s]) ctx->corrupt++;
+        ti_free(held[s], &err);
+        if (err != TI_ERRC_NONE) ctx->failures++;
+    }
+    return NULL;
+}
+
+// allocate everything reachable from one core; returns the number of blocks handed out
+static uint32_t drain_from_core(uint32_t core, unsigned char* seen) {
+    thread_core = core;
+    uint32_t count = 0;
+    for (;;) {
+        enum ti_errc_t err = TI_ERRC_NONE;
+        unsigned char* p = alloc_uninit(16, &err);
+        if (!p) break;
+        uint32_t off = (uint32_t)(p - heap_buf);
+        seen[off]++;
+        count++;
+    }
+    return count;
+}
+
+static void run_stress(void) {
+    HEAP_START = (void*)heap_buf;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+    assert_check(err == TI_ERRC_NONE, "init_heap ok");
+
+    pthread_t threads[STRESS_THREADS];
+    stress_ctx_t ctx[STRESS_THREADS];
+    uint64_t start = host_now_ns();
+    for (uint32_t t = 0; t < STRESS_THREADS; ++t) {
+        ctx[t] = (stress_ctx_t){ .id = t };
+        pthread_create(&threads[t], NULL, stress_worker, &ctx[t]);
+    }
+    uint32_t corrupt = 0, failures = 0, allocs = 0;
+    for (uint32_t t = 0; t < STRESS_THREADS; ++t) {
+        pthread_join(threads[t], NULL);
+        corrupt += ctx[t].corrupt;
+        failures += ctx[t].failures;
+        allocs += ctx[t].allocs;
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    log_printf("      %u threads, %u allocs, %.1f ns/op\n", STRESS_THREADS, allocs,
+               (double)elapsed / (2.0 * allocs));
+
+    assert_check(allocs > 0, "threads allocated");
+    assert_check(corrupt == 0, "no block handed to two owners at once");
+    assert_check(failures == 0, "no unexpected alloc/free errors");
+
+    // every block must be free again, and reachable exactly once from some core
+    int all_free = 1;
+    for (uint32_t i = 0; i < NUMBER_OF_POOLS; ++i) {
+        for (uint32_t j = 0; j < POOL_SIZES[i]; ++j) {
+            all_free &= isFree(heap_buf + POOL_OFFSETS[i] + j * POOL_BLOCK_SIZES[i]);
+        }
+    }
+    assert_check(all_free, "every block free after the threads finish");
+
+    // lock-free counters must not lose updates under contention
+    alloc_stats_t st;
+    alloc_get_stats(&st);
+    uint32_t counted = 0, in_use = 0, balanced = 1;
+    for (uint32_t i = 0; i < NUMBER_OF_POOLS; ++i) {
+        counted += st.pools[i].allocs;
+        in_use += st.pools[i].in_use;
+        balanced &= st.pools[i].allocs == st.pools[i].frees;
+    }
+    assert_check(counted == allocs && balanced && in_use == 0, "stats agree with the threads' own counts");
+
+    static unsigned char seen[TOTAL_HEAP_SIZE];
+    uint32_t total = 0;
+    for (uint32_t core = 0; core < ALLOC_CORE_COUNT; ++core) {
+        total += drain_from_core(core, seen);
+    }
+    int unique = 1;
+    for (uint32_t i = 0; i < TOTAL_HEAP_SIZE; ++i) unique &= (seen[i] <= 1);
+    assert_check(total == TOTAL_BLOCK_COUNT, "free lists hold every block after the stress run");
+    assert_check(unique, "no block on two free lists");
+}
+
+static void test_concurrent_alloc_free(void) {
+    run_stress();
+}
+
+// racing double frees of the same block must leave exactly one copy on the free lists
+#define DOUBLE_FREE_ROUNDS 2000
+
+typedef struct { void* block; pthread_barrier_t* barrier; uint32_t core; } double_free_ctx_t;
+
+static void* double_free_worker(void* arg) {
+    double_free_ctx_t* ctx = arg;
+    thread_core = ctx->core;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    pthread_barrier_wait(ctx->barrier);
+    ti_free(ctx->block, &err);
+    return NULL;
+}
+
+static void test_racing_double_free(void) {
+    HEAP_START = (void*)heap_buf;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+
+    int ok = 1;
+    for (int r = 0; r < DOUBLE_FREE_ROUNDS && ok; ++r) {
+        thread_core = 0;
+        void* b = alloc(64, &err);
+        pthread_barrier_t barrier;
+        pthread_barrier_init(&barrier, NULL, 2);
+        pthread_t t1, t2;
+        double_free_ctx_t c1 = { b, &barrier, 0 }, c2 = { b, &barrier, 1 };
+        pthread_create(&t1, NULL, double_free_worker, &c1);
+        pthread_create(&t2, NULL, double_free_worker, &c2);
+        pthread_join(t1, NULL);
+        pthread_join(t2, NULL);
+        pthread_barrier_destroy(&barrier);
+        ok &= isFree(b);
+    }
+    assert_check(ok, "block free after racing frees");
+
+    static unsigned char seen[TOTAL_HEAP_SIZE];
+    uint32_t total = 0;
+    for (uint32_t core = 0; core < ALLOC_CORE_COUNT; ++core) {
+        total += drain_from_core(core, seen);
+    }
+    int unique = 1;
+    for (uint32_t i = 0; i < TOTAL_HEAP_SIZE; ++i) unique &= (seen[i] <= 1);
+    assert_check(total == TOTAL_BLOCK_COUNT && unique, "racing double frees never duplicate a block");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_concurrent_alloc_free),
+        TEST_CASE(test_racing_double_free),
+    };
+
+    return run_test_suite("alloc concurrency tests", "allocmttest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,161 @@
+#include "host_test.h"
+#include "../src/internal/alloc.h"
+
+// Region-aware heap tests. Each region is backed by a static array standing in for the memory the
+// linker script reserves on the target.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+// lets a test pretend to run on the CM4
+static uint32_t test_core = 0;
+uint32_t alloc_core_id(void) { return test_core; }
+
+#define REGION_BUF_(name, start, end) static _Alignas(CACHE_LINE_SIZE) unsigned char name##_buf[HEAP_##name##_SIZE];
+HEAP_REGIONS(REGION_BUF_)
+
+#define REGION_BUF_ENTRY_(name, start, end) name##_buf,
+static unsigned char* const region_bufs[HEAP_REGION_COUNT] = { HEAP_REGIONS(REGION_BUF_ENTRY_) };
+
+static const char* const region_names[HEAP_REGION_COUNT] = { "SRAM123", "DTCM", "AXI_SRAM", "SRAM4", "BKUP_RAM" };
+
+static void setup_regions(void) {
+    test_core = 0;
+    for (uint32_t r = 0; r < HEAP_REGION_COUNT; ++r) {
+        HEAP_REGION_STARTS[r] = region_bufs[r];
+        HEAP_REGION_ENDS[r] = region_bufs[r] + HEAP_REGION_SIZES[r];
+    }
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+    if (err != TI_ERRC_NONE) { fprintf(stderr, "[ERROR] init_heap failed\n"); exit(1); }
+}
+
+static int in_region(const void* p, uint32_t r) {
+    const unsigned char* c = p;
+    return c >= region_bufs[r] && c < region_bufs[r] + HEAP_REGION_SIZES[r];
+}
+
+// alloc_in hands out zeroed, aligned blocks from the requested region only, and ti_free finds them
+static void test_alloc_in_each_region(void) {
+    setup_regions();
+    char msg[128];
+    for (uint32_t r = 0; r < HEAP_REGION_COUNT; ++r) {
+        enum ti_errc_t err = TI_ERRC_NONE;
+        const uint32_t size = POOL_BLOCK_SIZES[HEAP_REGION_FIRST_POOLS[r]];
+        region_bufs[r][0] = 0xA5; // a block is zeroed even if the memory wasn't
+        unsigned char* p = alloc_in((enum heap_region_t)r, size, &err);
+        snprintf(msg, sizeof(msg), "%s: alloc_in lands in the region", region_names[r]);
+        assert_check(err == TI_ERRC_NONE && p != NULL && in_region(p, r), msg);
+        snprintf(msg, sizeof(msg), "%s: block zeroed and allocated", region_names[r]);
+        assert_check(p[0] == 0 && !isFree(p), msg);
+
+        ti_free(p, &err);
+        snprintf(msg, sizeof(msg), "%s: ti_free returns the block", region_names[r]);
+        assert_check(err == TI_ERRC_NONE && isFree(p), msg);
+    }
+
+    enum ti_errc_t err = TI_ERRC_NONE;
+    void* d = alloc(64, &err);
+    assert_check(in_region(d, HEAP_REGION_DEFAULT), "alloc uses the default region");
+}
+
+// exhausting one region never borrows from another, and the others keep working
+static void test_regions_independent(void) {
+    setup_regions();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    const uint32_t r = HEAP_REGION_BKUP_RAM;
+    const uint32_t largest = POOL_BLOCK_SIZES[HEAP_REGION_FIRST_POOLS[r] + HEAP_REGION_POOL_COUNTS[r] - 1];
+
+    uint32_t n = 0;
+    int all_inside = 1;
+    for (;;) {
+        void* p = alloc_in(HEAP_REGION_BKUP_RAM, largest, &err);
+        if (!p) break;
+        all_inside &= in_region(p, r);
+        n++;
+    }
+    assert_check(err == TI_ERRC_OVERFLOW, "full region overflows");
+    assert_check(all_inside && n == POOL_SIZES[HEAP_REGION_FIRST_POOLS[r] + HEAP_REGION_POOL_COUNTS[r] - 1],
+                 "only the region's own largest pool is used");
+
+    void* other = alloc_in(HEAP_REGION_SRAM4, largest, &err);
+    assert_check(err == TI_ERRC_NONE && in_region(other, HEAP_REGION_SRAM4), "other regions unaffected");
+    void* small = alloc_in(HEAP_REGION_BKUP_RAM, 16, &err);
+    assert_check(err == TI_ERRC_NONE && in_region(small, r), "smaller pools of the full region still work");
+}
+
+// falls through to bigger pools of the same region, and stats land on that region's pool ids
+static void test_region_fall_through_and_stats(void) {
+    setup_regions();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    const uint32_t first = HEAP_REGION_FIRST_POOLS[HEAP_REGION_DTCM];
+    for (uint32_t j = 0; j < POOL_SIZES[first]; ++j) alloc_in(HEAP_REGION_DTCM, 16, &err);
+    void* p = alloc_in(HEAP_REGION_DTCM, 16, &err);
+    assert_check(err == TI_ERRC_NONE && in_region(p, HEAP_REGION_DTCM), "full pool falls through within region");
+    assert_check(p == region_bufs[HEAP_REGION_DTCM] + POOL_OFFSETS[first + 1], "promoted to the next pool's first block");
+
+    alloc_stats_t st;
+    alloc_get_stats(&st);
+    assert_check(st.pools[POOL_DTCM_16].promotions == 1 && st.pools[POOL_DTCM_32].allocs == 1, "stats per region pool");
+    assert_check(st.pools[POOL_SRAM123_16].allocs == 0, "default heap stats untouched");
+}
+
+// bad regions, oversized requests, CM4 access to DTCM
+static void test_region_invalid(void) {
+    setup_regions();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    assert_check(alloc_in(HEAP_REGION_COUNT, 16, &err) == NULL && err == TI_ERRC_INVALID_ARG, "unknown region rejected");
+
+    const uint32_t r = HEAP_REGION_DTCM;
+    const uint32_t largest = POOL_BLOCK_SIZES[HEAP_REGION_FIRST_POOLS[r] + HEAP_REGION_POOL_COUNTS[r] - 1];
+    assert_check(alloc_in(HEAP_REGION_DTCM, largest + 1, &err) == NULL && err == TI_ERRC_INVALID_ARG,
+                 "size above the region's largest block rejected");
+
+    test_core = 1;
+    assert_check(alloc_in(HEAP_REGION_DTCM, 16, &err) == NULL && err == TI_ERRC_INVALID_ARG, "CM4 can't allocate DTCM");
+    assert_check(alloc_in(HEAP_REGION_SRAM4, 16, &err) != NULL && err == TI_ERRC_NONE, "CM4 can allocate SRAM4");
+    test_core = 0;
+
+    unsigned char* p = alloc_in(HEAP_REGION_AXI_SRAM, 64, &err);
+    ti_free(p + 8, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG && !isFree(p), "interior pointer rejected in other regions too");
+}
+
+// a region with no memory behind it is skipped; one that's too small fails init
+static void test_region_setup_errors(void) {
+    for (uint32_t r = 0; r < HEAP_REGION_COUNT; ++r) {
+        HEAP_REGION_STARTS[r] = NULL;
+        HEAP_REGION_ENDS[r] = NULL;
+    }
+    HEAP_REGION_STARTS[HEAP_REGION_DEFAULT] = region_bufs[HEAP_REGION_DEFAULT];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+    assert_check(err == TI_ERRC_NONE, "init with only the default region");
+    assert_check(alloc(16, &err) != NULL, "default region works");
+    assert_check(alloc_in(HEAP_REGION_AXI_SRAM, 16, &err) == NULL && err == TI_ERRC_INVALID_ARG,
+                 "region without memory rejected");
+
+    HEAP_REGION_STARTS[HEAP_REGION_SRAM4] = region_bufs[HEAP_REGION_SRAM4];
+    HEAP_REGION_ENDS[HEAP_REGION_SRAM4] = region_bufs[HEAP_REGION_SRAM4] + HEAP_REGION_SIZES[HEAP_REGION_SRAM4] - 1;
+    init_heap(&err);
+    assert_check(err == TI_ERRC_OVERFLOW, "region smaller than its pools fails init");
+
+    HEAP_REGION_ENDS[HEAP_REGION_SRAM4] = NULL;
+    HEAP_REGION_STARTS[HEAP_REGION_SRAM4] = region_bufs[HEAP_REGION_SRAM4] + 4;
+    init_heap(&err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "misaligned region start fails init");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_alloc_in_each_region),
+        TEST_CASE(test_regions_independent),
+        TEST_CASE(test_region_fall_through_and_stats),
+        TEST_CASE(test_region_invalid),
+        TEST_CASE(test_region_setup_errors),
+    };
+
+    return run_test_suite("alloc region tests", "allocregionstest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,136 @@
+#include "host_test.h"
+#include "../src/internal/arena.h"
+#include "../src/internal/alloc.h"
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+// allocations are aligned, disjoint and bump forward
+static void test_arena_alloc_basic(void) {
+    arena_reset();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    unsigned char* a = arena_alloc(1, &err);
+    assert_check(err == TI_ERRC_NONE && a != NULL, "alloc 1 byte");
+    unsigned char* b = arena_alloc(13, &err);
+    assert_check(err == TI_ERRC_NONE && b != NULL, "alloc 13 bytes");
+    assert_check(((uintptr_t)a % ARENA_ALIGN) == 0 && ((uintptr_t)b % ARENA_ALIGN) == 0, "aligned");
+    assert_check(b == a + ARENA_ALIGN, "size rounded up to alignment");
+
+    arena_usage_t usage;
+    arena_get_usage(&usage);
+    assert_check(usage.capacity == ARENA_SIZE, "capacity reported");
+    assert_check(usage.used == ARENA_ALIGN + 16, "bytes in use");
+}
+
+// reset hands the same memory out again
+static void test_arena_reset_reuses(void) {
+    arena_reset();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    void* first = arena_alloc(64, &err);
+    arena_alloc(128, &err);
+    arena_reset();
+    void* again = arena_alloc(64, &err);
+    assert_check(err == TI_ERRC_NONE && again == first, "memory reused after reset");
+}
+
+// zero and oversized requests, and exhaustion within one tick
+static void test_arena_invalid_and_overflow(void) {
+    arena_reset();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    assert_check(arena_alloc(0, &err) == NULL && err == TI_ERRC_INVALID_ARG, "alloc 0 rejected");
+    assert_check(arena_alloc(ARENA_SIZE + 1, &err) == NULL && err == TI_ERRC_INVALID_ARG, "alloc > arena rejected");
+
+    void* all = arena_alloc(ARENA_SIZE, &err);
+    assert_check(err == TI_ERRC_NONE && all != NULL, "whole arena in one alloc");
+    assert_check(arena_alloc(1, &err) == NULL && err == TI_ERRC_OVERFLOW, "full arena overflows");
+
+    arena_reset();
+    assert_check(arena_alloc(1, &err) != NULL && err == TI_ERRC_NONE, "usable again after reset");
+}
+
+// high-water mark tracks the busiest tick, last_tick the most recent one
+static void test_arena_high_water(void) {
+    arena_reset();
+    arena_clear_high_water();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    arena_usage_t usage;
+
+    arena_alloc(256, &err);
+    arena_reset();                      // tick 1: 256
+    arena_alloc(1024, &err);
+    arena_reset();                      // tick 2: 1024
+    arena_alloc(64, &err);
+    arena_reset();                      // tick 3: 64
+
+    arena_get_usage(&usage);
+    assert_check(usage.last_tick == 64, "last tick usage");
+    assert_check(usage.high_water == 1024, "high-water is busiest tick");
+    assert_check(usage.used == 0, "nothing in use after reset");
+
+    arena_alloc(2048, &err);            // tick in progress beats the mark
+    arena_get_usage(&usage);
+    assert_check(usage.high_water == 2048, "tick in progress counts toward high-water");
+
+    arena_clear_high_water();
+    arena_reset();
+    arena_get_usage(&usage);
+    assert_check(usage.high_water == 2048 && usage.last_tick == 2048, "cleared mark picks up the finished tick");
+}
+
+// micro-benchmark: per-tick scratch pattern (4 buffers, then release) against alloc/ti_free
+#define BENCH_TICKS 200000
+#define BENCH_BUFS  4
+
+static _Alignas(CACHE_LINE_SIZE) unsigned char heap_buf[TOTAL_HEAP_SIZE];
+
+static void test_bench_arena_vs_pool(void) {
+    HEAP_START = (void*)heap_buf;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    init_heap(&err);
+
+    int ok = 1;
+    for (uint32_t size = 64; size <= 256; size *= 2) {
+        void* bufs[BENCH_BUFS];
+
+        uint64_t start = host_now_ns();
+        for (int t = 0; t < BENCH_TICKS; ++t) {
+            arena_reset();
+            for (int b = 0; b < BENCH_BUFS; ++b) {
+                bufs[b] = arena_alloc(size, &err);
+                if (!bufs[b]) ok = 0;
+            }
+        }
+        uint64_t arena_ns = host_now_ns() - start;
+
+        start = host_now_ns();
+        for (int t = 0; t < BENCH_TICKS; ++t) {
+            for (int b = 0; b < BENCH_BUFS; ++b) {
+                bufs[b] = alloc_uninit(size, &err);
+                if (!bufs[b]) ok = 0;
+            }
+            for (int b = 0; b < BENCH_BUFS; ++b) {
+                ti_free(bufs[b], &err);
+            }
+        }
+        uint64_t pool_ns = host_now_ns() - start;
+
+        const double ops = (double)BENCH_TICKS * BENCH_BUFS;
+        log_printf("      %3u B scratch: arena %6.1f ns/buf, alloc_uninit+ti_free %6.1f ns/buf\n",
+                   size, (double)arena_ns / ops, (double)pool_ns / ops);
+    }
+    assert_check(ok, "all benchmark allocations succeeded");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_arena_alloc_basic),
+        TEST_CASE(test_arena_reset_reuses),
+        TEST_CASE(test_arena_invalid_and_overflow),
+        TEST_CASE(test_arena_high_water),
+        TEST_CASE(test_bench_arena_vs_pool),
+    };
+
+    return run_test_suite("arena unit tests", "arenatest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
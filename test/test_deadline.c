@@ -0,0 +1,126 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "internal/deadline.h"
+#include "peripheral/spi.h"
+
+// deadline_t against a fake clock, and the blocking SPI transfers giving up on a bus that stops
+// clocking. The fake clock moves on a fixed step every time it is read, so a timed-out wait can
+// be checked against its budget in microseconds without the test taking that long.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS 2
+#define SS  30
+
+static uint64_t fake_ticks;
+static uint32_t fake_step; // ticks added per read
+
+uint64_t deadline_ticks(void) {
+    fake_ticks += fake_step;
+    return fake_ticks;
+}
+
+static uint8_t echo_device(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ss_pin; (void)ctx;
+    return mosi;
+}
+
+static void setup(uint32_t step) {
+    sim_reset();
+    sim_spi_attach(BUS, echo_device, NULL);
+    fake_ticks = 0;
+    fake_step = step;
+}
+
+// expiry, remaining time and the microsecond clock follow the tick count
+static void test_deadline_api(void) {
+    setup(0);
+    fake_ticks = 1000U * DEADLINE_TICKS_PER_US;
+    assert_check(time_us() == 1000, "time_us converts ticks");
+    const deadline_t d = deadline_in_us(250);
+    assert_check(!deadline_expired(d) && deadline_remaining_us(d) == 250, "fresh deadline has its whole budget");
+    fake_ticks += 249U * DEADLINE_TICKS_PER_US;
+    assert_check(!deadline_expired(d) && deadline_remaining_us(d) == 1, "one microsecond left");
+    fake_ticks += DEADLINE_TICKS_PER_US;
+    assert_check(deadline_expired(d) && deadline_remaining_us(d) == 0, "expired on the dot");
+    fake_ticks += 1000000U * DEADLINE_TICKS_PER_US;
+    assert_check(deadline_expired(d) && deadline_remaining_us(d) == 0, "stays expired");
+    assert_check(!deadline_expired(deadline_in_us(UINT32_MAX)), "longest deadline is ~71 minutes out");
+}
+
+// a stalled polled transfer ends in TIMEOUT within its budget and leaves the bus usable
+static void test_spi_stall(void) {
+    setup(DEADLINE_TICKS_PER_US); // 1us per clock read
+    enum ti_errc_t err;
+    uint8_t tx[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t rx[8] = {0};
+
+    sim_spi_stalled = true;
+    const uint64_t before = fake_ticks;
+    spi_transfer_sync(BUS, SS, tx, rx, sizeof(tx), &err);
+    const uint64_t waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(err == TI_ERRC_TIMEOUT, "stalled transfer times out");
+    assert_check(waited_us >= SPI_WAIT_TIMEOUT_US && waited_us <= SPI_WAIT_TIMEOUT_US + 4,
+                 "gave up after SPI_WAIT_TIMEOUT_US");
+    assert_check(sim_pin_level[SS] == 1, "chip select released");
+    assert_check(!(sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk), "instance disabled");
+
+    (void)*SPIx_SR[BUS]; // the model only sees SPE drop, and resets, on a register access
+    sim_spi_stalled = false;
+    spi_transfer_sync(BUS, SS, tx, rx, sizeof(tx), &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(tx, rx, sizeof(tx)) == 0, "next transfer runs normally");
+}
+
+// transfers that never stall don't read the clock while flags are already up
+static void test_spi_clock_reads(void) {
+    setup(DEADLINE_TICKS_PER_US);
+    enum ti_errc_t err;
+    uint8_t buf[64] = {0};
+    spi_write(BUS, SS, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_NONE, "write completes");
+    assert_check(fake_ticks / DEADLINE_TICKS_PER_US < sizeof(buf), "fewer clock reads than bytes");
+}
+
+// packed mode's endless transfer gives up the same way and stops its stream
+static void test_spi_packed_stall(void) {
+    setup(DEADLINE_TICKS_PER_US);
+    enum ti_errc_t err;
+    spi_set_packed(BUS, true, &err);
+    assert_check(err == TI_ERRC_NONE, "packed mode on");
+    uint8_t tx[32];
+    uint8_t rx[32];
+    for (uint32_t i = 0; i < sizeof(tx); i++) tx[i] = (uint8_t)(i * 7);
+
+    spi_transfer_sync(BUS, SS, tx, rx, sizeof(tx), &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(tx, rx, sizeof(tx)) == 0, "packed transfer before the stall");
+
+    sim_spi_stalled = true;
+    const uint64_t before = fake_ticks;
+    spi_transfer_sync(BUS, SS, tx, rx, sizeof(tx), &err);
+    const uint64_t waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(err == TI_ERRC_TIMEOUT, "stalled packed transfer times out");
+    assert_check(waited_us >= SPI_WAIT_TIMEOUT_US && waited_us <= SPI_WAIT_TIMEOUT_US + 4,
+                 "gave up after SPI_WAIT_TIMEOUT_US without progress");
+    assert_check(sim_pin_level[SS] == 1 && !(sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk), "SS released, stream stopped");
+
+    (void)*SPIx_SR[BUS];
+    sim_spi_stalled = false;
+    memset(rx, 0, sizeof(rx));
+    spi_transfer_sync(BUS, SS, tx, rx, sizeof(tx), &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(tx, rx, sizeof(tx)) == 0, "stream restarts on the next transfer");
+    spi_set_packed(BUS, false, &err);
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_deadline_api),
+        TEST_CASE(test_spi_stall),
+        TEST_CASE(test_spi_clock_reads),
+        TEST_CASE(test_spi_packed_stall),
+    };
+
+    return run_test_suite("deadline unit tests", "deadlinetest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,443 @@
+#include "host_test.h"
+#include "sim/spi_bus_sim.h"
+#include "sim/sim_devices.h"
+#include "devices/actuator.h"
+#include "devices/adc.h"
+#include "devices/barometer.h"
+#include "devices/gnss.h"
+#include "devices/radio.h"
+
+// The SPI device drivers in src/devices, unmodified, against the device models in test/sim on the
+// simulated bus from test/sim/spi_bus_sim.c. Each driver gets a regression test of what it does to
+// the part and what it reports back; test_benchmark logs the bus time, transfer count and host
+// time of the common calls and fails if a call starts costing more transfers than it does now.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS         2
+#define BARO_SS     10
+#define ADC_SS      11
+#define RADIO_SS    12
+#define GNSS_SS     13
+#define ACT_SS      14
+#define NIRQ_PIN    20
+#define SDN_PIN     21
+#define EN_PIN      22
+#define PACKET_SIZE 64 // the Si4468 FIFO, radio.c's largest payload
+
+static sim_ms5611_t baro_sim;
+static sim_ads124s08_t adc_sim;
+static sim_si4468_t radio_sim;
+static sim_ubx_t gnss_sim;
+static sim_max22217_t act_sim;
+
+// Every device on one bus, the way they share SPI2 on the board.
+static void setup(void) {
+    sim_bus_reset();
+    sim_ms5611_init(&baro_sim);
+    sim_ads124s08_init(&adc_sim);
+    sim_si4468_init(&radio_sim);
+    radio_sim.nirq_pin = NIRQ_PIN;
+    sim_ubx_init(&gnss_sim);
+    sim_max22217_init(&act_sim);
+    sim_bus_attach(BUS, BARO_SS, &sim_ms5611_model, &baro_sim);
+    sim_bus_attach(BUS, ADC_SS, &sim_ads124s08_model, &adc_sim);
+    sim_bus_attach(BUS, RADIO_SS, &sim_si4468_model, &radio_sim);
+    sim_bus_attach(BUS, GNSS_SS, &sim_ubx_model, &gnss_sim);
+    sim_bus_attach(BUS, ACT_SS, &sim_max22217_model, &act_sim);
+}
+
+static barometer_t make_barometer(void) {
+    barometer_t dev = { .spi_dev = { .inst = BUS, .ss_pin = BARO_SS }, .osr = OSR_4096 };
+    return dev;
+}
+
+static radio_t make_radio(enum ti_errc_t *err) {
+    radio_t dev;
+    const radio_spi_dev spi = { .spi_inst = BUS, .ss_pin = RADIO_SS };
+    const radio_config_t cfg = { .reset_pin = SDN_PIN, .nirq_pin = NIRQ_PIN, .reset_active_high = true, .channel = 7 };
+    radio_init(&dev, &spi, &cfg, err);
+    return dev;
+}
+
+static gnss_t make_gnss(void) {
+    gnss_t dev = {
+        .spi_config = { .spi_inst = BUS, .ss_pin = GNSS_SS },
+        .config = { .meas_rate_ms = 200, .constellation_mask = GNSS_CONSTELLATION_GPS | GNSS_CONSTELLATION_GALILEO,
+                    .dyn_model = GNSS_DYN_AIRBORNE_4G, .power_mode = GNSS_POWER_CONTINUOUS },
+    };
+    return dev;
+}
+
+static actuator_t make_actuator(enum ti_errc_t *err) {
+    actuator_t dev;
+    const actuator_spi_dev spi = { .spi_inst = BUS, .ss_pin = ACT_SS };
+    const actuator_config_t cfg = { .enable_pin = EN_PIN };
+    actuator_init(&dev, &spi, &cfg, err);
+    return dev;
+}
+
+static void script_pvt(void) {
+    sim_ubx_set_pvt(&gnss_sim, 2026, 6, 21, 17, 30, 5, GNSS_FIX_3D, 14,
+                    -1224000000, 474000000, 1250000, 1230000, 1500, -2500, -300000, 145);
+}
+
+/**************************************************************************************************
+ * @section Regression Tests
+ **************************************************************************************************/
+
+static void test_barometer(void) {
+    setup();
+    enum ti_errc_t err;
+    barometer_t baro = make_barometer();
+
+    barometer_init(&baro, &err);
+    assert_check(err == TI_ERRC_NONE, "barometer_init succeeds");
+    assert_check(baro_sim.resets == 1, "MS5611 reset once");
+    assert_check(baro.calibration_data.sens == 40127 && baro.calibration_data.tempsens == 28312,
+                 "C1 and C6 read from PROM");
+
+    barometer_result_t r = get_barometer_data(&baro, &err);
+    assert_check(err == TI_ERRC_NONE, "get_barometer_data succeeds");
+    assert_check(r.pressure == 1000 && r.temperature == 20, "datasheet example gives 1000 mbar, 20 C");
+    assert_check(baro_sim.conversions == 2 && baro_sim.early_reads == 0, "both conversions finished before being read");
+
+    baro.osr = OSR_256;
+    baro_sim.d2 = 8569150 - 400000;  // colder, takes the second order branch
+    r = get_barometer_data(&baro, &err);
+    assert_check(err == TI_ERRC_NONE && baro_sim.early_reads == 0, "OSR 256 delay covers its conversion");
+    assert_check(r.temperature < 20, "lower D2 reads colder");
+
+    sim_bus_inject_error(BUS, TI_ERRC_BUSY);
+    barometer_init(&baro, &err);
+    assert_check(err == TI_ERRC_BUSY, "bus error propagates out of barometer_init");
+}
+
+static void test_adc(void) {
+    setup();
+    enum ti_errc_t err;
+    struct adc_spi_dev spi = { .inst = BUS, .ss_pin = ADC_SS };
+
+    adc_init(&spi, &err);
+    assert_check(err == TI_ERRC_NONE, "adc_init succeeds once the part is ready");
+    assert_check(adc_sim.resets == 1 && adc_sim.starts == 1, "RESET then START");
+    assert_check(sim_bus_now_ns >= SIM_ADS124S08_RESET_NS, "adc_init waits out the reset");
+    assert_check(adc_sim.regs[0x05] == 0x12, "internal reference enabled");
+
+    adc_sim.code[AIN3] = 0x200000;
+    struct adc_channel ch = { .pos_pin = AIN3, .neg_pin = AINCOM, .gain = GAIN_2, .source = REF_INTERNAL, .ref_voltage = 2 };
+    int mv = adc_read_voltage(&ch, &err);
+    assert_check(err == TI_ERRC_NONE, "adc_read_voltage succeeds");
+    assert_check(adc_sim.regs[0x02] == 0x3C && adc_sim.regs[0x03] == 0x09, "INPMUX and PGA programmed");
+    assert_check(mv == 500, "quarter scale at gain 2 reads 500 mV");
+
+    adc_sim.code[AIN4] = -838861;
+    struct adc_channel neg = { .pos_pin = AIN4, .neg_pin = AIN5, .gain = GAIN_1, .source = REF_INTERNAL, .ref_voltage = 2 };
+    mv = adc_read_voltage(&neg, &err);
+    assert_check(mv >= -201 && mv <= -199, "negative codes sign extend");
+
+    adc_set_idac(IDAC_250_UA, AIN1, AIN2, &err);
+    assert_check(adc_sim.regs[0x06] == IDAC_250_UA && adc_sim.regs[0x07] == 0x21, "IDAC magnitude and routing");
+
+    adc_sim.regs[0x00] = 0x05;
+    assert_check(adc_read_manufacturer_id(&err) == 0x05, "ID register read back");
+}
+
+static void test_adc_absent(void) {
+    setup();
+    enum ti_errc_t err;
+    sim_bus_attach(BUS, ADC_SS, NULL, NULL);
+    struct adc_spi_dev spi = { .inst = BUS, .ss_pin = ADC_SS };
+    adc_init(&spi, &err);
+    assert_check(err == TI_ERRC_TIMEOUT, "adc_init times out with nothing on the chip select");
+
+    // a part that goes away after init never reports data ready
+    setup();
+    adc_init(&spi, &err);
+    sim_bus_attach(BUS, ADC_SS, NULL, NULL);
+    struct adc_channel ch = { .pos_pin = AIN0, .neg_pin = AINCOM, .gain = GAIN_1, .source = REF_INTERNAL, .ref_voltage = 2 };
+    const int mv = adc_read_voltage(&ch, &err);
+    assert_check(err == TI_ERRC_TIMEOUT && mv == -1, "adc_read_voltage times out waiting for data ready");
+    assert_check(adc_sim.reads == 0, "no RDATA after the timeout");
+}
+
+static void test_radio(void) {
+    setup();
+    enum ti_errc_t err;
+    radio_t radio = make_radio(&err);
+    assert_check(err == TI_ERRC_NONE, "radio_init succeeds");
+    assert_check(radio_sim.powered && radio_sim.rejected == 0, "POWER_UP first, every command after CTS");
+    assert_check(radio_sim.state == 0x03, "errata 12 leaves the radio in READY");
+    assert_check(sim_bus_pin_level[SDN_PIN] == 0, "SDN released");
+
+    const uint8_t payload[5] = { 'h', 'e', 'l', 'l', 'o' };
+    radio_transmit(&radio, payload, sizeof(payload), &err);
+    assert_check(err == TI_ERRC_NONE && radio_sim.packets_sent == 1, "radio_transmit sends one packet");
+    assert_check(radio_sim.sent_len == 5 && memcmp(radio_sim.sent, payload, 5) == 0, "payload went through the TX FIFO");
+    assert_check(radio_sim.channel == 7, "sent on the configured channel");
+    assert_check(radio_nirq_asserted(&radio), "packet sent raises nIRQ");
+
+    uint8_t ph = 0;
+    radio_get_int_status(&radio, &ph, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && (ph & 0x20), "GET_INT_STATUS reports packet sent");
+    assert_check(!radio_nirq_asserted(&radio), "GET_INT_STATUS clears nIRQ");
+
+    uint8_t rx[PACKET_SIZE];
+    size_t got = 99;
+    radio_receive(&radio, rx, sizeof(rx), &got, &err);
+    assert_check(err == TI_ERRC_NONE && got == 0, "nothing received yet");
+
+    uint8_t packet[40];
+    for (uint8_t i = 0; i < sizeof(packet); i++) packet[i] = (uint8_t)(i * 3);
+    sim_si4468_inject_rx(&radio_sim, packet, sizeof(packet));
+    radio_receive(&radio, rx, sizeof(rx), &got, &err);
+    assert_check(err == TI_ERRC_NONE && got == sizeof(packet), "received length from PACKET_INFO");
+    assert_check(memcmp(rx, packet, sizeof(packet)) == 0, "payload read from the RX FIFO");
+    assert_check(radio_sim.rx_armed && radio_sim.rx_len == 0, "FIFO cleared and RX restarted");
+    assert_check(radio_sim.rejected == 0, "no command ever sent before CTS");
+}
+
+static void test_radio_no_cts(void) {
+    setup();
+    radio_sim.dead = true;
+    enum ti_errc_t err;
+    make_radio(&err);
+    assert_check(err == TI_ERRC_TIMEOUT, "radio_init times out when CTS never comes");
+}
+
+static void test_gnss(void) {
+    setup();
+    enum ti_errc_t err;
+    gnss_t gnss = make_gnss();
+    gnss_sim.reply_delay = 40;
+
+    gnss_init(&gnss, &err);
+    assert_check(err == TI_ERRC_NONE && gnss.initialized, "gnss_init succeeds");
+    assert_check(gnss_sim.cfg_count == 4 && gnss_sim.cfg[0] == 0x08 && gnss_sim.cfg[1] == 0x24 &&
+                 gnss_sim.cfg[2] == 0x86 && gnss_sim.cfg[3] == 0x3E, "CFG-RATE, NAV5, PMS and GNSS in order");
+    assert_check(gnss_sim.bad_frames == 0, "every frame sent with a valid checksum");
+
+    script_pvt();
+    gnss_pvt_t pvt;
+    memset(&pvt, 0, sizeof(pvt));
+    gnss_get_pvt(&gnss, &pvt, &err);
+    assert_check(err == TI_ERRC_NONE, "gnss_get_pvt succeeds");
+    assert_check(pvt.year == 2026 && pvt.month == 6 && pvt.day == 21 && pvt.sec == 5, "UTC time parsed");
+    assert_check(pvt.fix == GNSS_FIX_3D && pvt.num_sv == 14, "fix and satellites parsed");
+    assert_check(pvt.lon == -1224000000 && pvt.lat == 474000000 && pvt.h_msl == 1230000, "position parsed");
+    assert_check(pvt.vel_d == -300000 && pvt.p_dop == 145, "velocity and DOP parsed");
+}
+
+static void test_gnss_errors(void) {
+    setup();
+    enum ti_errc_t err;
+    gnss_t gnss = make_gnss();
+    gnss_sim.nak_id = 0x86;
+    gnss_init(&gnss, &err);
+    assert_check(err == TI_ERRC_DEVICE && !gnss.initialized, "a NAK fails gnss_init");
+    assert_check(gnss_sim.cfg_count == 3, "gnss_init stops at the NAKed message");
+
+    gnss_sim.nak_id = 0;
+    gnss_init(&gnss, &err);
+    assert_check(err == TI_ERRC_NONE, "gnss_init succeeds once the NAK goes away");
+
+    script_pvt();
+    gnss_sim.corrupt_next = true;
+    gnss_pvt_t pvt;
+    memset(&pvt, 0, sizeof(pvt));
+    gnss_get_pvt(&gnss, &pvt, &err);
+    assert_check(err == TI_ERRC_TIMEOUT && pvt.year == 0, "a corrupt NAV-PVT is never reported");
+}
+
+// the drivers give their chip selects a profile at init, and each transfer runs at its own device's
+// clock and mode however the bus was last driven
+static void test_device_profiles(void) {
+    setup();
+    enum ti_errc_t err;
+    sim_bus_set_clock(BUS, 1000000);
+    struct adc_spi_dev adc_spi = { .inst = BUS, .ss_pin = ADC_SS };
+    adc_init(&adc_spi, &err);
+    make_radio(&err);
+    gnss_t gnss = make_gnss();
+    gnss_init(&gnss, &err);
+    assert_check(err == TI_ERRC_NONE, "drivers initialise with their profiles");
+
+    barometer_t baro = make_barometer();
+    barometer_init(&baro, &err);
+    struct adc_channel ch = { .pos_pin = AIN0, .neg_pin = AINCOM, .gain = GAIN_1, .source = REF_INTERNAL, .ref_voltage = 2 };
+    adc_read_voltage(&ch, &err);
+
+    sim_bus_stats_t st;
+    sim_bus_get_stats(BUS, ADC_SS, &st);
+    assert_check(st.sck_hz == 8000000 && st.mode == MODE_1, "ADC read after the barometer runs at 8 MHz in mode 1");
+    sim_bus_get_stats(BUS, RADIO_SS, &st);
+    assert_check(st.sck_hz == 8000000 && st.mode == MODE_0, "radio at 8 MHz in mode 0");
+    sim_bus_get_stats(BUS, GNSS_SS, &st);
+    assert_check(st.sck_hz == 4000000 && st.mode == MODE_0, "GNSS at 4 MHz in mode 0");
+    sim_bus_get_stats(BUS, BARO_SS, &st);
+    assert_check(st.sck_hz == 1000000, "barometer without a profile at the instance clock");
+
+    spi_profile_t bad = { .max_clock_hz = 1000000, .mode = 4, .word_bits = 8 };
+    spi_set_profile(BUS, ADC_SS, &bad, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "bad profile rejected");
+}
+
+static void test_actuator(void) {
+    setup();
+    enum ti_errc_t err;
+    actuator_t act = make_actuator(&err);
+    assert_check(err == TI_ERRC_NONE && sim_bus_pin_level[EN_PIN] == 0, "actuator_init leaves the outputs disabled");
+
+    act_sim.regs[0x01] = 0x0123;
+    actuator_set_active(&act, true, &err);
+    assert_check(err == TI_ERRC_NONE && act_sim.regs[0x01] == 0x8123, "ACTIVE set without touching the other bits");
+
+    actuator_set_pwm_master(&act, 5, &err);
+    actuator_set_channel_enable(&act, ACTUATOR_CHANNEL_2, true, &err);
+    actuator_set_channel_enable(&act, ACTUATOR_CHANNEL_0, true, &err);
+    actuator_set_channel_enable(&act, ACTUATOR_CHANNEL_2, false, &err);
+    assert_check(act_sim.regs[0x00] == 0x0051, "F_PWM_M and channel enables share GLOBAL_CTRL");
+
+    const actuator_channel_config_t cfg = { .dc_l2h = 1000, .dc_h = 400, .dc_l = 0, .time_l2h = 50, .ramp = 0x20, .ramp_up = true };
+    actuator_configure_channel(&act, ACTUATOR_CHANNEL_1, &cfg, &err);
+    assert_check(err == TI_ERRC_NONE && act_sim.regs[0x17] == 1000 && act_sim.regs[0x18] == 400 &&
+                 act_sim.regs[0x1A] == 50, "channel 1 timing registers at 0x17");
+    assert_check(act_sim.regs[0x1B] == 0x0120, "CTRL0 packs ramp_up and ramp");
+
+    act_sim.status = 0x81;
+    act_sim.regs[0x02] = 0xBEEF;
+    uint16_t status = 0;
+    uint8_t status_byte = 0;
+    actuator_read_status(&act, &status, &status_byte, &err);
+    assert_check(status == 0xBEEF && status_byte == 0x81, "two-frame read returns STATUS and the status byte");
+
+    act_sim.regs[0x65] = 0x0004;
+    act_sim.regs[0x66] = 0x0100;
+    uint16_t f0 = 0;
+    uint16_t f1 = 0;
+    actuator_read_fault(&act, &f0, &f1, NULL, &err);
+    assert_check(f0 == 0x0004 && f1 == 0x0100, "faults read");
+    actuator_read_fault(&act, &f0, &f1, NULL, &err);
+    assert_check(f0 == 0 && f1 == 0, "reading the faults cleared them");
+
+    act_sim.regs[0x5D] = 1234;
+    uint16_t imon = 0;
+    actuator_read_i_monitor(&act, ACTUATOR_CHANNEL_3, &imon, NULL, &err);
+    assert_check(imon == 1234, "channel 3 current monitor at 0x5D");
+    assert_check(act_sim.bad_frames == 0, "every frame was 3 bytes");
+}
+
+/**************************************************************************************************
+ * @section Benchmark
+ **************************************************************************************************/
+
+#define BENCH_ITERATIONS 200U
+
+typedef struct {
+    uint64_t bus_ns;
+    uint32_t transfers;
+    uint32_t bytes;
+    uint64_t host_ns;
+} bench_t;
+
+static sim_bus_stats_t bench_before;
+static uint64_t bench_bus_start;
+static uint64_t bench_host_start;
+
+static void bench_start(uint8_t ss_pin) {
+    sim_bus_get_stats(BUS, ss_pin, &bench_before);
+    bench_bus_start = sim_bus_now_ns;
+    bench_host_start = host_now_ns();
+}
+
+// Averages over BENCH_ITERATIONS calls since bench_start.
+static bench_t bench_end(const char *name, uint8_t ss_pin) {
+    const uint64_t host = host_now_ns() - bench_host_start;
+    sim_bus_stats_t after;
+    sim_bus_get_stats(BUS, ss_pin, &after);
+    bench_t b = {
+        .bus_ns = (sim_bus_now_ns - bench_bus_start) / BENCH_ITERATIONS,
+        .transfers = (after.transfers - bench_before.transfers) / BENCH_ITERATIONS,
+        .bytes = (after.bytes - bench_before.bytes) / BENCH_ITERATIONS,
+        .host_ns = host / BENCH_ITERATIONS,
+    };
+    log_printf("  %-28s %9llu ns  %4u transfers  %5u bytes  %7llu host ns\n", name,
+               (unsigned long long)b.bus_ns, b.transfers, b.bytes, (unsigned long long)b.host_ns);
+    return b;
+}
+
+static void test_benchmark(void) {
+    setup();
+    enum ti_errc_t err;
+    log_printf("  per call, at each device's profile clock or %u Hz SCK\n", SIM_BUS_DEFAULT_SCK_HZ);
+
+    barometer_t baro = make_barometer();
+    barometer_init(&baro, &err);
+    bench_start(BARO_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) get_barometer_data(&baro, &err);
+    bench_t b = bench_end("get_barometer_data OSR4096", BARO_SS);
+    assert_check(b.transfers == 4, "barometer sample is 4 transfers");
+    assert_check(b.bus_ns < 21000000, "barometer sample under 21 ms");
+
+    struct adc_spi_dev adc_spi = { .inst = BUS, .ss_pin = ADC_SS };
+    adc_init(&adc_spi, &err);
+    struct adc_channel ch = { .pos_pin = AIN0, .neg_pin = AINCOM, .gain = GAIN_1, .source = REF_INTERNAL, .ref_voltage = 2 };
+    bench_start(ADC_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) adc_read_voltage(&ch, &err);
+    b = bench_end("adc_read_voltage", ADC_SS);
+    assert_check(b.transfers == 5, "ADC read is 5 transfers");
+
+    radio_t radio = make_radio(&err);
+    uint8_t packet[PACKET_SIZE];
+    memset(packet, 0xA5, sizeof(packet));
+    bench_start(RADIO_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) radio_transmit(&radio, packet, sizeof(packet), &err);
+    b = bench_end("radio_transmit 64 B", RADIO_SS);
+    assert_check(radio_sim.packets_sent == BENCH_ITERATIONS && radio_sim.rejected == 0, "every packet sent");
+    assert_check(b.transfers <= 24, "radio_transmit within 24 transfers");
+
+    bench_start(RADIO_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        size_t got;
+        sim_si4468_inject_rx(&radio_sim, packet, sizeof(packet));
+        radio_receive(&radio, packet, sizeof(packet), &got, &err);
+    }
+    b = bench_end("radio_receive 64 B", RADIO_SS);
+    assert_check(b.transfers <= 36, "radio_receive within 36 transfers");
+
+    gnss_t gnss = make_gnss();
+    gnss_init(&gnss, &err);
+    script_pvt();
+    gnss_sim.reply_delay = 20;
+    gnss_pvt_t pvt;
+    bench_start(GNSS_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) gnss_get_pvt(&gnss, &pvt, &err);
+    b = bench_end("gnss_get_pvt", GNSS_SS);
+    assert_check(err == TI_ERRC_NONE && b.transfers <= 1 + 20 + 100, "NAV-PVT poll within one read per byte");
+
+    actuator_t act = make_actuator(&err);
+    bench_start(ACT_SS);
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) actuator_set_channel_enable(&act, ACTUATOR_CHANNEL_1, i & 1, &err);
+    b = bench_end("actuator_set_channel_enable", ACT_SS);
+    assert_check(b.transfers == 3, "read-modify-write is 3 frames");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_barometer),
+        TEST_CASE(test_adc),
+        TEST_CASE(test_adc_absent),
+        TEST_CASE(test_radio),
+        TEST_CASE(test_radio_no_cts),
+        TEST_CASE(test_gnss),
+        TEST_CASE(test_gnss_errors),
+        TEST_CASE(test_device_profiles),
+        TEST_CASE(test_actuator),
+        TEST_CASE(test_benchmark),
+    };
+
+    return run_test_suite("SPI device driver simulation tests", "devicesimtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,385 @@
+#include "host_test.h"
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "peripheral/dma.h"
+#include "internal/deadline.h"
+
+// DMA1/DMA2 driver against the fake register block in test/sim. The helpers below play the part
+// of the DMA hardware: they count NDTR down, raise flags and enter the stream's interrupt.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+// Fake clock, a microsecond per read. A stream in stuck_cr never lets go of EN, which it gets
+// back on every clock read the driver makes while waiting for it to drop.
+static uint64_t fake_ticks;
+static volatile uint32_t* stuck_cr;
+uint64_t deadline_ticks(void) {
+    if (stuck_cr) *stuck_cr |= DMAx_S0CR_EN.msk;
+    return fake_ticks += DEADLINE_TICKS_PER_US;
+}
+
+#define FE  (1U << 0)
+#define DME (1U << 2)
+#define TE  (1U << 3)
+#define TC  (1U << 5)
+
+static const uint8_t flag_shift[4] = {0, 6, 16, 22};
+
+static void (*const handlers[3][8])(void) = {
+    [1] = { dma_str0_irq_handler, dma_str1_irq_handler, dma_str2_irq_handler, dma_str3_irq_handler,
+            dma_str4_irq_handler, dma_str5_irq_handler, dma_str6_irq_handler, dma1_str7_irq_handler },
+    [2] = { dma2_str0_irq_handler, dma2_str1_irq_handler, dma2_str2_irq_handler, dma2_str3_irq_handler,
+            dma2_str4_irq_handler, dma2_str5_irq_handler, dma2_str6_irq_handler, dma2_str7_irq_handler },
+};
+
+static volatile uint32_t* isr_of(int i, int s) { return s < 4 ? &sim_dmac[i].lisr : &sim_dmac[i].hisr; }
+
+// hardware side of a stream stopping with @p flags set and @p remaining items left in NDTR
+static void hw_event(int i, int s, uint32_t remaining, uint32_t flags) {
+    volatile uint32_t* cr = &sim_dmac[i].s[s].cr;
+    sim_dmac[i].s[s].ndtr = remaining;
+    // the stream drops EN by itself, unless it is circular and just wrapped
+    if ((flags & TE) || ((flags & TC) && !(*cr & DMAx_S0CR_CIRC.msk))) *cr &= ~DMAx_S0CR_EN.msk;
+    *isr_of(i, s) |= flags << flag_shift[s % 4];
+
+    const uint32_t enabled = ((*cr & DMAx_S0CR_TCIE.msk) ? TC : 0) | ((*cr & DMAx_S0CR_TEIE.msk) ? TE : 0) |
+                             ((*cr & DMAx_S0CR_DMEIE.msk) ? DME : 0) | FE;
+    if (flags & enabled) handlers[i][s]();
+
+    // flag clear registers are write-one-to-clear
+    sim_dmac[i].lisr &= ~sim_dmac[i].lifcr;
+    sim_dmac[i].hisr &= ~sim_dmac[i].hifcr;
+    sim_dmac[i].lifcr = sim_dmac[i].hifcr = 0;
+}
+
+typedef struct { int calls; bool success; void* ctx; } cb_record_t;
+static cb_record_t rec;
+
+static void on_done(bool success, void* ctx) {
+    rec.calls++;
+    rec.success = success;
+    rec.ctx = ctx;
+}
+
+static dma_config_t usart1_tx(dma_instance_t i, dma_stream_t s) {
+    return (dma_config_t){
+        .instance = i, .stream = s, .request_id = 42, .direction = MEM_TO_PERIPH,
+        .src_data_size = DMA_DATA_SIZE_BYTE, .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = DMA_PRIORITY_HIGH, .callback = on_done,
+    };
+}
+
+static void setup(void) {
+    memset((void*)sim_dmac, 0, sizeof(sim_dmac));
+    memset((void*)sim_dmamux1_ccr, 0, sizeof(sim_dmamux1_ccr));
+    memset((void*)sim_nvic_iser, 0, sizeof(sim_nvic_iser));
+    sim_rcc_ahb1enr = 0;
+    memset(&rec, 0, sizeof(rec));
+    stuck_cr = NULL;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    dma_init(&err);
+}
+
+// clocks on, and a configured stream's control, FIFO and DMAMUX registers
+static void test_configure_registers(void) {
+    setup();
+    assert_check((sim_rcc_ahb1enr & 0x3U) == 0x3U, "DMA1 and DMA2 clocks enabled");
+
+    dma_config_t cfg = {
+        .instance = DMA2, .stream = DMA_STREAM_5, .request_id = 41, .direction = PERIPH_TO_MEM,
+        .src_data_size = DMA_DATA_SIZE_HALFWORD, .dest_data_size = DMA_DATA_SIZE_WORD,
+        .priority = DMA_PRIORITY_VERY_HIGH, .fifo_enabled = true,
+        .fifo_threshold = DMA_FIFO_THRESHOLD_HALF, .callback = on_done,
+    };
+    assert_check(dma_configure_stream(&cfg), "stream configured");
+    const uint32_t cr = sim_dmac[2].s[5].cr;
+    assert_check(((cr & DMAx_S0CR_DIR.msk) >> DMAx_S0CR_DIR.pos) == 0, "peripheral-to-memory");
+    assert_check(((cr & DMAx_S0CR_PSIZE.msk) >> DMAx_S0CR_PSIZE.pos) == 1 &&
+                 ((cr & DMAx_S0CR_MSIZE.msk) >> DMAx_S0CR_MSIZE.pos) == 2, "PSIZE from src, MSIZE from dest");
+    assert_check(((cr & DMAx_S0CR_PL.msk) >> DMAx_S0CR_PL.pos) == 3, "priority level");
+    assert_check((cr & DMAx_S0CR_TCIE.msk) && (cr & DMAx_S0CR_TEIE.msk) && !(cr & DMAx_S0CR_EN.msk),
+                 "complete/error interrupts on, stream idle");
+    assert_check((sim_dmac[2].s[5].fcr & DMAx_SxFCR_DMDIS.msk) && (sim_dmac[2].s[5].fcr & DMAx_SxFCR_FTH.msk) == 2,
+                 "FIFO mode with threshold");
+    assert_check(sim_dmamux1_ccr[8 + 5] == 41 && sim_dmamux1_ccr[5] == 0, "DMA2 stream 5 routed on DMAMUX1 channel 13");
+    const int32_t irq = DMAx_STRx_IRQ_NUM[2][5];
+    assert_check(sim_nvic_iser[irq / 32] & (1U << (irq % 32)), "stream interrupt enabled in the NVIC");
+
+    dma_config_t tx = usart1_tx(DMA1, DMA_STREAM_3);
+    assert_check(dma_configure_stream(&tx) && sim_dmamux1_ccr[3] == 42, "DMA1 stream 3 routed on channel 3");
+    assert_check(((sim_dmac[1].s[3].cr & DMAx_S0CR_DIR.msk) >> DMAx_S0CR_DIR.pos) == 1 &&
+                 !(sim_dmac[1].s[3].fcr & DMAx_SxFCR_DMDIS.msk), "memory-to-peripheral, direct mode");
+}
+
+static void test_configure_invalid(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_0);
+    cfg.request_id = 0;
+    assert_check(!dma_configure_stream(&cfg), "request 0 rejected");
+    cfg = usart1_tx(DMA_INSTANCE_COUNT, DMA_STREAM_0);
+    assert_check(!dma_configure_stream(&cfg), "unknown controller rejected");
+    cfg = usart1_tx(DMA1, DMA_STREAM_COUNT);
+    assert_check(!dma_configure_stream(&cfg), "unknown stream rejected");
+    cfg = usart1_tx(DMA1, DMA_STREAM_0);
+    cfg.dest_data_size = DMA_DATA_SIZE_WORD;
+    assert_check(!dma_configure_stream(&cfg), "width conversion without the FIFO rejected");
+    assert_check(!dma_configure_stream(NULL), "NULL config rejected");
+}
+
+// a stream belongs to one request until it is released; dma_alloc_stream hands out the rest
+static void test_stream_ownership(void) {
+    setup();
+    dma_config_t a = usart1_tx(DMA1, DMA_STREAM_0);
+    dma_config_t b = usart1_tx(DMA1, DMA_STREAM_0);
+    b.request_id = 38;
+    assert_check(dma_configure_stream(&a), "first owner configures");
+    assert_check(!dma_configure_stream(&b) && sim_dmamux1_ccr[0] == 42, "other request can't take the stream");
+    a.priority = DMA_PRIORITY_LOW;
+    assert_check(dma_configure_stream(&a), "owner can reconfigure");
+    dma_release_stream(DMA1, DMA_STREAM_0);
+    assert_check(sim_dmamux1_ccr[0] == 0, "release disconnects DMAMUX");
+    assert_check(dma_configure_stream(&b) && sim_dmamux1_ccr[0] == 38, "released stream can be taken");
+
+    dma_stream_t s;
+    int got = 0, unique = 1;
+    uint32_t seen = 1U << DMA_STREAM_0;
+    while (dma_alloc_stream(DMA1, &s)) {
+        unique &= !(seen & (1U << s));
+        seen |= 1U << s;
+        got++;
+    }
+    assert_check(got == 7 && unique, "alloc hands out the seven free streams once each");
+    assert_check(dma_alloc_stream(DMA2, &s) && s == DMA_STREAM_0, "DMA2 pool is separate");
+
+    dma_config_t c = usart1_tx(DMA2, DMA_STREAM_0);
+    assert_check(dma_configure_stream(&c), "allocated stream can be configured by its owner");
+}
+
+// start programs NDTR/PAR/M0AR and enables the stream; completion runs the callback with context
+static void test_transfer_complete(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_2);
+    dma_configure_stream(&cfg);
+    static uint8_t buf[100];
+    static uint32_t periph;
+    int token;
+    dma_transfer_t t = { .instance = DMA1, .stream = DMA_STREAM_2, .src = buf, .dest = &periph,
+                         .size = sizeof(buf), .context = &token };
+    assert_check(dma_start_transfer(&t, NULL), "transfer started");
+    assert_check(sim_dmac[1].s[2].ndtr == 100 && (sim_dmac[1].s[2].cr & DMAx_S0CR_EN.msk), "NDTR loaded, stream on");
+    assert_check(sim_dmac[1].s[2].m0ar == (uint32_t)(uintptr_t)buf &&
+                 sim_dmac[1].s[2].par == (uint32_t)(uintptr_t)&periph, "memory and peripheral addresses");
+    assert_check(sim_dmac[1].s[2].cr & DMAx_S0CR_MINC.msk, "memory increments");
+    assert_check(dma_stream_busy(DMA1, DMA_STREAM_2) && !dma_start_transfer(&t, NULL), "busy stream refuses a second start");
+
+    hw_event(1, 2, 0, TC);
+    assert_check(rec.calls == 1 && rec.success && rec.ctx == &token, "callback with success and context");
+    assert_check(!dma_stream_busy(DMA1, DMA_STREAM_2) && sim_dmac[1].lisr == 0, "stream idle, flag cleared");
+
+    t.disable_mem_inc = true;
+    t.size = 1;
+    assert_check(dma_start_transfer(&t, NULL) && !(sim_dmac[1].s[2].cr & DMAx_S0CR_MINC.msk), "fixed memory address");
+    hw_event(1, 2, 0, TC);
+    assert_check(rec.calls == 2, "restarted stream completes again");
+}
+
+// NDTR counts peripheral-size items, and sizes the stream can't represent are refused
+static void test_transfer_sizes(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_1);
+    cfg.src_data_size = cfg.dest_data_size = DMA_DATA_SIZE_HALFWORD;
+    dma_configure_stream(&cfg);
+    static uint16_t buf[200000];
+    static uint32_t periph;
+    dma_transfer_t t = { .instance = DMA1, .stream = DMA_STREAM_1, .src = buf, .dest = &periph, .size = 64 };
+    assert_check(dma_start_transfer(&t, NULL) && sim_dmac[1].s[1].ndtr == 32, "halfword items counted");
+    dma_abort_transfer(DMA1, DMA_STREAM_1, NULL);
+    t.size = 63;
+    assert_check(!dma_start_transfer(&t, NULL), "partial item rejected");
+    t.size = 0;
+    assert_check(!dma_start_transfer(&t, NULL), "empty transfer rejected");
+    t.size = 2 * (DMA_MAX_ITEMS + 1);
+    assert_check(!dma_start_transfer(&t, NULL), "more than NDTR can hold rejected");
+    t.size = 2 * DMA_MAX_ITEMS;
+    assert_check(dma_start_transfer(&t, NULL) && sim_dmac[1].s[1].ndtr == DMA_MAX_ITEMS, "largest transfer accepted");
+
+    dma_transfer_t unconfigured = { .instance = DMA1, .stream = DMA_STREAM_6, .src = buf, .dest = &periph, .size = 4 };
+    assert_check(!dma_start_transfer(&unconfigured, NULL), "unconfigured stream refuses to start");
+}
+
+// transfer and direct-mode errors fail the transfer; FIFO errors alone don't
+static void test_transfer_errors(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA2, DMA_STREAM_6);
+    dma_configure_stream(&cfg);
+    static uint8_t buf[16];
+    static uint32_t periph;
+    dma_transfer_t t = { .instance = DMA2, .stream = DMA_STREAM_6, .src = buf, .dest = &periph, .size = 16 };
+
+    dma_start_transfer(&t, NULL);
+    hw_event(2, 6, 10, FE);
+    assert_check(rec.calls == 0 && dma_stream_busy(DMA2, DMA_STREAM_6), "FIFO error alone keeps going");
+    assert_check(sim_dmac[2].hisr == 0, "FIFO error flag cleared");
+    hw_event(2, 6, 9, TE);
+    assert_check(rec.calls == 1 && !rec.success, "transfer error reported");
+    assert_check(dma_get_remaining(DMA2, DMA_STREAM_6) == 9, "NDTR shows what didn't move");
+    assert_check(!dma_stream_busy(DMA2, DMA_STREAM_6), "stream free after error");
+
+    dma_start_transfer(&t, NULL);
+    hw_event(2, 6, 16, DME);
+    assert_check(rec.calls == 2 && !rec.success && !(sim_dmac[2].s[6].cr & DMAx_S0CR_EN.msk),
+                 "direct mode error reported and stream stopped");
+}
+
+// flags for streams 4-7 live in HISR, at the same offsets as streams 0-3 in LISR
+static void test_high_streams_and_neighbours(void) {
+    setup();
+    dma_config_t a = usart1_tx(DMA1, DMA_STREAM_4);
+    dma_config_t b = usart1_tx(DMA1, DMA_STREAM_5);
+    b.request_id = 44;
+    dma_configure_stream(&a);
+    dma_configure_stream(&b);
+    static uint8_t buf[8];
+    static uint32_t periph;
+    dma_transfer_t ta = { .instance = DMA1, .stream = DMA_STREAM_4, .src = buf, .dest = &periph, .size = 8, .context = &a };
+    dma_transfer_t tb = { .instance = DMA1, .stream = DMA_STREAM_5, .src = buf, .dest = &periph, .size = 8, .context = &b };
+    dma_start_transfer(&ta, NULL);
+    dma_start_transfer(&tb, NULL);
+
+    sim_dmac[1].hisr |= TC << flag_shift[5 % 4]; // stream 5 finished too, its interrupt is pending
+    hw_event(1, 4, 0, TC);
+    assert_check(rec.calls == 1 && rec.ctx == &a, "stream 4 completes from HISR");
+    assert_check(sim_dmac[1].hisr == (TC << flag_shift[1]), "stream 5's flag left for its own handler");
+    dma1_str7_irq_handler(); // spurious interrupt on an idle stream
+    assert_check(rec.calls == 1, "idle stream's handler does nothing");
+    hw_event(1, 5, 0, TC);
+    assert_check(rec.calls == 2 && rec.ctx == &b, "stream 5 completes");
+}
+
+// abort stops the stream without a callback and leaves it ready to restart
+static void test_abort(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_7);
+    dma_configure_stream(&cfg);
+    static uint8_t buf[32];
+    static uint32_t periph;
+    dma_transfer_t t = { .instance = DMA1, .stream = DMA_STREAM_7, .src = buf, .dest = &periph, .size = 32 };
+    dma_start_transfer(&t, NULL);
+    sim_dmac[1].s[7].ndtr = 20; // 12 bytes moved
+    dma_abort_transfer(DMA1, DMA_STREAM_7, NULL);
+    assert_check(!(sim_dmac[1].s[7].cr & DMAx_S0CR_EN.msk) && !dma_stream_busy(DMA1, DMA_STREAM_7), "stream stopped");
+    assert_check(dma_get_remaining(DMA1, DMA_STREAM_7) == 20 && rec.calls == 0, "no callback, NDTR kept");
+    assert_check(dma_start_transfer(&t, NULL), "aborted stream restarts");
+}
+
+// a stream that never drops EN fails the abort and the next start with a timeout instead of hanging
+static void test_stuck_stream(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_6);
+    dma_configure_stream(&cfg);
+    static uint8_t buf[32];
+    static uint32_t periph;
+    dma_transfer_t t = { .instance = DMA1, .stream = DMA_STREAM_6, .src = buf, .dest = &periph, .size = 32 };
+    enum ti_errc_t err;
+    assert_check(dma_start_transfer(&t, &err) && err == TI_ERRC_NONE, "transfer started");
+    assert_check(!dma_start_transfer(&t, &err) && err == TI_ERRC_BUSY, "second start busy");
+
+    stuck_cr = &sim_dmac[1].s[6].cr;
+    const uint64_t before = fake_ticks;
+    dma_abort_transfer(DMA1, DMA_STREAM_6, &err);
+    assert_check(err == TI_ERRC_TIMEOUT && !dma_stream_busy(DMA1, DMA_STREAM_6), "abort times out, stream released");
+    const uint64_t waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(waited_us >= 100 && waited_us < 200, "gave up after the deadline");
+
+    // the transfer is done as far as the driver knows, but EN is still set on the next start
+    assert_check(!dma_start_transfer(&t, &err) && err == TI_ERRC_TIMEOUT && !dma_stream_busy(DMA1, DMA_STREAM_6),
+                 "start times out and leaves the stream idle");
+
+    stuck_cr = NULL;
+    assert_check(dma_start_transfer(&t, &err) && err == TI_ERRC_NONE, "starts once EN drops");
+    t.size = 0;
+    assert_check(!dma_start_transfer(&t, &err) && err == TI_ERRC_INVALID_ARG, "bad transfer invalid");
+}
+
+// a circular transfer reports every wrap and runs until it is aborted or fails
+static void test_circular(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA1, DMA_STREAM_3);
+    cfg.direction = PERIPH_TO_MEM;
+    cfg.request_id = 41;
+    dma_configure_stream(&cfg);
+    static uint8_t ring[64];
+    static uint32_t periph;
+    int token;
+    dma_transfer_t t = { .instance = DMA1, .stream = DMA_STREAM_3, .src = &periph, .dest = ring,
+                         .size = sizeof(ring), .context = &token, .circular = true };
+    assert_check(dma_start_transfer(&t, NULL) && (sim_dmac[1].s[3].cr & DMAx_S0CR_CIRC.msk), "circular mode set");
+
+    hw_event(1, 3, 64, TC); // NDTR reloads on the wrap
+    hw_event(1, 3, 64, TC);
+    assert_check(rec.calls == 2 && rec.success && rec.ctx == &token, "callback at every wrap");
+    assert_check(dma_stream_busy(DMA1, DMA_STREAM_3) && (sim_dmac[1].s[3].cr & DMAx_S0CR_EN.msk),
+                 "stream still running");
+    assert_check(!dma_start_transfer(&t, NULL), "running circular stream refuses a second start");
+
+    dma_abort_transfer(DMA1, DMA_STREAM_3, NULL);
+    assert_check(!dma_stream_busy(DMA1, DMA_STREAM_3) && rec.calls == 2, "abort stops it quietly");
+
+    dma_start_transfer(&t, NULL);
+    hw_event(1, 3, 30, TE);
+    assert_check(rec.calls == 3 && !rec.success && !dma_stream_busy(DMA1, DMA_STREAM_3), "error ends it");
+
+    t.circular = false;
+    assert_check(dma_start_transfer(&t, NULL) && !(sim_dmac[1].s[3].cr & DMAx_S0CR_CIRC.msk), "next transfer one-shot");
+    hw_event(1, 3, 0, TC);
+    assert_check(!dma_stream_busy(DMA1, DMA_STREAM_3), "one-shot transfer finishes");
+}
+
+// the callback can start the next transfer on the same stream
+static int chain_left;
+static dma_transfer_t chain_t;
+
+static void on_chain(bool success, void* ctx) {
+    (void)ctx;
+    rec.calls++;
+    if (success && --chain_left > 0) dma_start_transfer(&chain_t, NULL);
+}
+
+static void test_chain_from_callback(void) {
+    setup();
+    dma_config_t cfg = usart1_tx(DMA2, DMA_STREAM_0);
+    cfg.callback = on_chain;
+    dma_configure_stream(&cfg);
+    static uint8_t buf[4];
+    static uint32_t periph;
+    chain_t = (dma_transfer_t){ .instance = DMA2, .stream = DMA_STREAM_0, .src = buf, .dest = &periph, .size = 4 };
+    chain_left = 3;
+    dma_start_transfer(&chain_t, NULL);
+    int events = 0;
+    while (dma_stream_busy(DMA2, DMA_STREAM_0) && events < 10) {
+        hw_event(2, 0, 0, TC);
+        events++;
+    }
+    assert_check(events == 3 && rec.calls == 3, "three chained transfers");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_configure_registers),
+        TEST_CASE(test_configure_invalid),
+        TEST_CASE(test_stream_ownership),
+        TEST_CASE(test_transfer_complete),
+        TEST_CASE(test_transfer_sizes),
+        TEST_CASE(test_transfer_errors),
+        TEST_CASE(test_high_streams_and_neighbours),
+        TEST_CASE(test_abort),
+        TEST_CASE(test_stuck_stream),
+        TEST_CASE(test_circular),
+        TEST_CASE(test_chain_from_callback),
+    };
+
+    return run_test_suite("dma unit tests", "dmatest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include "host_test.h"
+#include "sim/qspi_reg_sim.h"
+#include "sim/qspi_mmap_sim.h"
+#include "app/utils/extern_flash.h"
+
+// The data logger in app/utils/extern_flash.c and the QSPI driver under it against the NOR flash
+// model, through the simulated QUADSPI registers in test/sim. The flash starts out full of junk
+// rather than erased, so a page programmed into a sector the logger never erased reads back wrong.
+
+// the linker puts these in backup SRAM on the target
+uint32_t __flash_state_addr;
+uint32_t __flash_data_addr;
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define JUNK 0x5A
+#define LOOP_NS 1000000U // one control loop between records
+
+static void setup(void) {
+    sim_qspi_reset();
+    memset(sim_nor_mem, JUNK, sizeof(sim_nor_mem));
+    qspi_init();
+    init_extern_flash();
+}
+
+static void fill_record(uint8_t* rec, uint32_t len, uint32_t n) {
+    for (uint32_t j = 0; j < len; j++) rec[j] = (uint8_t)(n * 7U + j);
+}
+
+static bool log_matches(uint32_t records, uint32_t len) {
+    uint8_t rec[256];
+    for (uint32_t i = 0; i < records; i++) {
+        fill_record(rec, len, i);
+        if (memcmp(&sim_nor_mem[DATA_POOL_BASE_ADDR + i * len], rec, len) != 0) return false;
+    }
+    return true;
+}
+
+// small records go out a page at a time, into sectors erased ahead of them, without log_data waiting
+static void test_write_combining(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    const uint32_t records = 1000, len = 20;
+    uint8_t rec[20];
+    uint64_t worst_call_ns = 0;
+    bool all_ok = true;
+    for (uint32_t i = 0; i < records; i++) {
+        fill_record(rec, len, i);
+        const uint64_t before = sim_nor_now_ns;
+        log_data(rec, (uint16_t)len, &err);
+        all_ok &= err == TI_ERRC_NONE;
+        if (sim_nor_now_ns - before > worst_call_ns) worst_call_ns = sim_nor_now_ns - before;
+        sim_nor_advance_ns(LOOP_NS);
+    }
+    assert_check(all_ok, "every record accepted");
+    assert_check(worst_call_ns < 200000U, "log_data never waits for a program or erase");
+
+    log_sync(&err);
+    const uint32_t bytes = records * len;
+    assert_check(err == TI_ERRC_NONE && *data_addr_ptr == DATA_POOL_BASE_ADDR + bytes, "sync programs the tail");
+    assert_check(log_matches(records, len), "log reads back");
+    assert_check(sim_nor_stats.programs == (bytes + EXTERN_FLASH_PAGE_SIZE - 1) / EXTERN_FLASH_PAGE_SIZE,
+                 "one program per page, not per record");
+    const uint32_t sectors = (bytes + EXTERN_FLASH_SECTOR_SIZE - 1) / EXTERN_FLASH_SECTOR_SIZE;
+    assert_check(sim_nor_stats.erases >= sectors && sim_nor_stats.erases <= sectors + 1,
+                 "each sector erased once, at most one ahead");
+    assert_check(sim_nor_stats.rejected == 0 && sim_nor_stats.overprogrammed == 0 && sim_nor_stats.malformed == 0,
+                 "no command refused or misused");
+    assert_check(sim_nor_mem[DATA_POOL_BASE_ADDR - 1] == JUNK, "state pool sector never erased");
+
+    printf("  %u x %u-byte records: %u page programs, %u erases, %u status reads, %llu us on the bus\n",
+           (unsigned)records, (unsigned)len, (unsigned)sim_nor_stats.programs, (unsigned)sim_nor_stats.erases,
+           (unsigned)sim_nor_stats.status_reads, (unsigned long long)(sim_qspi_stats.bus_ns / 1000U));
+}
+
+// a sync programs a partial page, and later records fill in the rest of it
+static void test_sync_partial(void) {
+    setup();
+    enum ti_errc_t err;
+    uint8_t rec[200];
+    fill_record(rec, 100, 0);
+    log_data(rec, 100, &err);
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 1, "partial page programmed");
+    assert_check(memcmp(&sim_nor_mem[DATA_POOL_BASE_ADDR], rec, 100) == 0, "partial page reads back");
+    assert_check(sim_nor_mem[DATA_POOL_BASE_ADDR + 100] == 0xFF, "rest of the page still erased");
+
+    fill_record(rec, 200, 1);
+    log_data(rec, 200, &err);
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 3, "rest of the page, then the next page");
+    assert_check(memcmp(&sim_nor_mem[DATA_POOL_BASE_ADDR + 100], rec, 200) == 0, "second record reads back");
+    assert_check(sim_nor_stats.overprogrammed == 0, "no byte programmed twice");
+
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 3, "nothing left to sync");
+}
+
+// with the flash busy the RAM pages fill and further records are refused until it frees up
+static void test_backpressure(void) {
+    setup();
+    enum ti_errc_t err;
+    uint8_t rec[64];
+    uint32_t accepted = 0;
+    for (uint32_t i = 0; i < 64; i++) {
+        fill_record(rec, sizeof(rec), accepted);
+        log_data(rec, sizeof(rec), &err);
+        if (err == TI_ERRC_NONE) accepted++;
+        else break;
+    }
+    assert_check(err == TI_ERRC_BUSY, "refused while the first erase runs");
+    assert_check(accepted * sizeof(rec) == EXTERN_FLASH_LOG_PAGES * EXTERN_FLASH_PAGE_SIZE,
+                 "until every RAM page is full");
+    assert_check(sim_nor_stats.programs == 0, "nothing programmed into a sector being erased");
+
+    sim_nor_advance_ns(SIM_NOR_ERASE_NS);
+    log_service(&err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 1, "first page goes out once the erase ends");
+    fill_record(rec, sizeof(rec), accepted);
+    log_data(rec, sizeof(rec), &err);
+    assert_check(err == TI_ERRC_NONE, "and frees room for the next record");
+    accepted++;
+
+    for (uint32_t i = 0; i < EXTERN_FLASH_LOG_PAGES; i++) {
+        sim_nor_advance_ns(SIM_NOR_PROGRAM_NS);
+        log_service(&err);
+    }
+    assert_check(sim_nor_stats.programs == EXTERN_FLASH_LOG_PAGES, "full pages drain with service calls alone");
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && log_matches(accepted, sizeof(rec)), "accepted records read back in order");
+}
+
+// a state transition flushes the data log before the state byte
+static void test_state_flushes_log(void) {
+    setup();
+    memset(sim_nor_mem, 0xFF, EXTERN_FLASH_SECTOR_SIZE); // state pool erased at manufacture
+    enum ti_errc_t err;
+    uint8_t rec[50];
+    fill_record(rec, sizeof(rec), 0);
+    log_data(rec, sizeof(rec), &err);
+    log_state(ARMED_STATE, &err);
+    assert_check(err == TI_ERRC_NONE, "state logged");
+    assert_check(log_matches(1, sizeof(rec)), "pending record programmed with it");
+    assert_check(sim_nor_mem[STATE_POOL_BASE_ADDR] == ARMED_STATE && *state_addr_ptr == STATE_POOL_BASE_ADDR + 1,
+                 "state byte programmed");
+    assert_check(check_saved_state() && get_prev_state(&err) == ARMED_STATE && err == TI_ERRC_NONE,
+                 "state reads back");
+    assert_check(sim_nor_stats.rejected == 0 && sim_nor_stats.malformed == 0, "no command refused");
+}
+
+// the log picks up from the backup SRAM pointer part way into a sector, and stops at the end of flash
+static void test_resume_and_full(void) {
+    setup();
+    const uint32_t resume = EXTERN_FLASH_SIZE - 100;
+    memset(&sim_nor_mem[EXTERN_FLASH_SIZE - EXTERN_FLASH_SECTOR_SIZE], 0xFF, EXTERN_FLASH_SECTOR_SIZE);
+    *data_addr_ptr = resume;
+    enum ti_errc_t err;
+    uint8_t rec[64];
+    fill_record(rec, sizeof(rec), 0);
+    log_data(rec, sizeof(rec), &err);
+    assert_check(err == TI_ERRC_NONE, "record fits");
+    log_data(rec, sizeof(rec), &err);
+    assert_check(err == TI_ERRC_OVERFLOW, "next one doesn't");
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && memcmp(&sim_nor_mem[resume], rec, sizeof(rec)) == 0, "record programmed");
+    assert_check(sim_nor_stats.erases == 0, "sector part way through not erased again");
+
+    uint8_t big[EXTERN_FLASH_LOG_PAGES * EXTERN_FLASH_PAGE_SIZE + 1];
+    log_data(big, sizeof(big), &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "record longer than the RAM pages refused");
+    log_data(NULL, 0, &err);
+    assert_check(err == TI_ERRC_NONE, "empty record is a no-op");
+}
+
+// with quad mode on, pages and the state read go over four lines and the log is unchanged
+static void test_quad_log(void) {
+    setup();
+    memset(sim_nor_mem, 0xFF, EXTERN_FLASH_SECTOR_SIZE);
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    assert_check(err == TI_ERRC_NONE && qspi_quad_enabled(), "quad mode enabled");
+
+    uint8_t rec[40];
+    for (uint32_t i = 0; i < 100; i++) {
+        fill_record(rec, sizeof(rec), i);
+        log_data(rec, sizeof(rec), &err);
+        sim_nor_advance_ns(LOOP_NS);
+    }
+    log_state(FILL_STATE, &err);
+    assert_check(err == TI_ERRC_NONE && log_matches(100, sizeof(rec)), "log reads back");
+    assert_check(get_prev_state(&err) == FILL_STATE && err == TI_ERRC_NONE, "state reads back");
+    assert_check(sim_nor_stats.quad_commands == sim_nor_stats.programs + 1, "every program and the read on four lines");
+    assert_check(sim_nor_stats.malformed == 0 && sim_nor_stats.rejected == 0, "no command refused or misread");
+}
+
+// the log downloads through the mapping, and records logged meanwhile wait for the unmap
+static void test_map_download(void) {
+    setup();
+    enum ti_errc_t err;
+    uint8_t rec[20];
+    const uint32_t records = 300;
+    for (uint32_t i = 0; i < records; i++) {
+        fill_record(rec, sizeof(rec), i);
+        log_data(rec, sizeof(rec), &err);
+        sim_nor_advance_ns(LOOP_NS);
+    }
+    const uint8_t* flash = extern_flash_map(&err);
+    assert_check(err == TI_ERRC_NONE && flash != NULL, "mapped");
+    bool match = *data_addr_ptr == DATA_POOL_BASE_ADDR + records * sizeof(rec);
+    for (uint32_t i = 0; i < records && match; i++) {
+        fill_record(rec, sizeof(rec), i);
+        match = memcmp(&flash[DATA_POOL_BASE_ADDR + i * sizeof(rec)], rec, sizeof(rec)) == 0;
+    }
+    assert_check(match, "whole log downloads through the mapping");
+
+    fill_record(rec, sizeof(rec), records);
+    log_data(rec, sizeof(rec), &err);
+    assert_check(err == TI_ERRC_NONE, "record logged while mapped is buffered");
+    extern_flash_unmap(&err);
+    assert_check(err == TI_ERRC_NONE, "unmapped");
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && log_matches(records + 1, sizeof(rec)), "and programmed after");
+    assert_check(sim_nor_stats.malformed == 0 && sim_qspi_stats.mapped_malformed == 0, "no command misread");
+}
+
+// with the backup SRAM pointers lost, the scan finds the state and log ends again
+static void test_recover(void) {
+    setup();
+    memset(sim_nor_mem, 0xFF, EXTERN_FLASH_SECTOR_SIZE);
+    enum ti_errc_t err;
+    assert_check(!extern_flash_recover(&err) && err == TI_ERRC_NONE && sim_qspi_stats.commands == 0,
+                 "good pointers left alone");
+
+    uint8_t rec[30];
+    for (uint32_t i = 0; i < 250; i++) {
+        fill_record(rec, sizeof(rec), i);
+        log_data(rec, sizeof(rec), &err);
+        sim_nor_advance_ns(LOOP_NS);
+    }
+    log_state(ARMED_STATE, &err);
+    log_state(FIRE_STATE, &err);
+    const uint32_t state_end = *state_addr_ptr, data_end = *data_addr_ptr;
+
+    *state_addr_ptr = 0xDEADBEEF;
+    *data_addr_ptr = 0x00C0FFEE;
+    assert_check(extern_flash_recover(&err) && err == TI_ERRC_NONE, "lost pointers rebuilt");
+    assert_check(*state_addr_ptr == state_end && *data_addr_ptr == data_end, "to where they were");
+    assert_check(get_prev_state(&err) == FIRE_STATE && err == TI_ERRC_NONE, "last state reads back");
+
+    fill_record(rec, sizeof(rec), 250);
+    log_data(rec, sizeof(rec), &err);
+    log_sync(&err);
+    assert_check(err == TI_ERRC_NONE && log_matches(251, sizeof(rec)), "log carries on where it ended");
+    assert_check(sim_nor_stats.overprogrammed == 0 && sim_nor_stats.rejected == 0, "nothing programmed twice");
+}
+
+int main(void) {
+    // memory-mapped reads go to a file mapped where the flash would be
+    char image[] = "/tmp/titan_flash_XXXXXX";
+    const int fd = mkstemp(image);
+    if (fd < 0 || !sim_qspi_mmap_open(image)) {
+        printf("cannot map a flash image at 0x%x\n", (unsigned)QSPI_MAPPED_BASE);
+        return 1;
+    }
+    close(fd);
+    unlink(image);
+
+    TestCase tests[] = {
+        TEST_CASE(test_write_combining),
+        TEST_CASE(test_sync_partial),
+        TEST_CASE(test_backpressure),
+        TEST_CASE(test_state_flushes_log),
+        TEST_CASE(test_resume_and_full),
+        TEST_CASE(test_quad_log),
+        TEST_CASE(test_map_download),
+        TEST_CASE(test_recover),
+    };
+
+    return run_test_suite("extern flash unit tests", "externflashtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
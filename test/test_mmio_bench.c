@@ -0,0 +1,75 @@
+#include "internal/dwt.h"
+#include "internal/mmio.h"
+#include "peripheral/errc.h"
+#include "peripheral/gpio.h"
+#include "peripheral/spi.h"
+
+// Cycle-count benchmark for the MMIO hot paths, built with the same flags as the firmware (-O2).
+// Results are left in the bench_* globals and the core halts on a breakpoint so they can be read
+// from the debugger. The two WRITE_FIELD loops compare a folded field against one loaded from
+// memory, as every access was before mmio.h became header-only.
+
+#define BENCH_ITERATIONS 1000U
+#define BENCH_SPI_INST   1
+#define BENCH_SS_PIN     43
+#define BENCH_GPIO_PIN   44 // PA5
+#define BENCH_GPIO_PORT  0
+#define BENCH_GPIO_INDEX 5
+
+volatile uint32_t bench_set_pin_cycles;         // average cycles per tal_set_pin()
+volatile uint32_t bench_spi_transfer_cycles;    // average cycles per 1-byte spi_transfer_sync()
+volatile uint32_t bench_write_field_cycles;     // average cycles per WRITE_FIELD with a folded field
+volatile uint32_t bench_write_field_ld_cycles;  // same, but field loaded from memory (old extern form)
+
+// Forces the field through memory so the compiler cannot fold it, mimicking an extern const.
+static const field32_t *volatile loaded_field = &GPIOx_ODR_ODx[BENCH_GPIO_INDEX];
+
+static void bench_tal_set_pin() {
+    const uint32_t start = dwt_cycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        tal_set_pin(BENCH_GPIO_PIN, (int)(i & 1U));
+    }
+    bench_set_pin_cycles = (dwt_cycles() - start) / BENCH_ITERATIONS;
+}
+
+static void bench_write_field() {
+    uint32_t start = dwt_cycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        WRITE_FIELD(GPIOx_ODR[BENCH_GPIO_PORT], GPIOx_ODR_ODx[BENCH_GPIO_INDEX], i & 1U);
+    }
+    bench_write_field_cycles = (dwt_cycles() - start) / BENCH_ITERATIONS;
+
+    start = dwt_cycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        WRITE_FIELD(GPIOx_ODR[BENCH_GPIO_PORT], *loaded_field, i & 1U);
+    }
+    bench_write_field_ld_cycles = (dwt_cycles() - start) / BENCH_ITERATIONS;
+}
+
+static void bench_spi_transfer_sync() {
+    enum ti_errc_t errc;
+    uint8_t ss_pins[1] = {BENCH_SS_PIN};
+    spi_init(BENCH_SPI_INST, 1, ss_pins, 1, &errc);
+
+    uint8_t src[1] = {0xAA};
+    uint8_t dst[1] = {0x00};
+    const uint32_t start = dwt_cycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        spi_transfer_sync(BENCH_SPI_INST, BENCH_SS_PIN, src, dst, 1, &errc);
+    }
+    bench_spi_transfer_cycles = (dwt_cycles() - start) / BENCH_ITERATIONS;
+}
+
+void _start() {
+    dwt_cycle_counter_init();
+    tal_enable_clock(BENCH_GPIO_PIN);
+    tal_set_mode(BENCH_GPIO_PIN, 1);
+
+    bench_tal_set_pin();
+    bench_write_field();
+    bench_spi_transfer_sync();
+
+    while (1) {
+        asm("BKPT #0");
+    }
+}
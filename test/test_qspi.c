@@ -0,0 +1,450 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "host_test.h"
+#include "sim/qspi_reg_sim.h"
+#include "sim/qspi_mmap_sim.h"
+#include "peripheral/qspi.h"
+#include "internal/interrupt.h"
+
+// QSPI driver against the simulated QUADSPI registers and NOR flash model in test/sim: the
+// quad enable sequence, quad reads and programs, and what they buy in bus time over single line;
+// MDMA-fed data phases, and the CPU time a page program takes with and without them.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define PAGE 256U
+#define BENCH_READ 4096U  // bytes per read in the throughput run
+#define BENCH_READS 16U
+#define BENCH_PAGES 16U
+
+// Core clock, and what one QUADSPI or MDMA register access over AHB costs the core in cycles,
+// for turning the simulator's counts into CPU time per page
+#define CPU_MHZ 480U
+#define CYCLES_PER_ACCESS 10U
+
+static uint8_t buf[BENCH_READ];
+static uint8_t dma_buf[PAGE + 4] __attribute__((aligned(4))); // MDMA buffers must be statics (see qspi_reg_sim.h)
+static uint32_t dma_done, dma_failed;
+
+static void setup(void) {
+    sim_qspi_reset();
+    qspi_init();
+}
+
+static void fill_pattern(uint8_t* data, uint32_t len, uint32_t seed) {
+    for (uint32_t i = 0; i < len; i++) data[i] = (uint8_t)(seed * 13U + i * 7U + (i >> 8));
+}
+
+// QE goes into CR1 once and is only read after that
+static void test_quad_enable(void) {
+    setup();
+    enum ti_errc_t err;
+    assert_check(!qspi_quad_enabled(), "single line after init");
+    qspi_enable_quad(&err);
+    assert_check(err == TI_ERRC_NONE && qspi_quad_enabled(), "quad enabled");
+    assert_check(sim_nor_cr1 & SIM_NOR_CR1_QE, "QE set in the part");
+    assert_check(sim_nor_busy_ns() == 0, "register write waited out");
+
+    qspi_init();
+    assert_check(!qspi_quad_enabled(), "init starts over single line");
+    const uint32_t commands = sim_nor_stats.commands;
+    qspi_enable_quad(&err);
+    assert_check(err == TI_ERRC_NONE && qspi_quad_enabled(), "enabled again");
+    assert_check(sim_nor_stats.commands - commands == 2, "QE already set: two register reads, no write");
+    assert_check(sim_nor_stats.malformed == 0 && sim_nor_stats.rejected == 0, "no command refused or misread");
+}
+
+// quad commands are refused before the part can take them, and programs stay within a page
+static void test_quad_refused(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_read(0, buf, 16, QSPI_READ_QUAD_OUTPUT, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "quad output read refused before enable");
+    qspi_read(0, buf, 16, QSPI_READ_QUAD_IO, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "quad I/O read refused before enable");
+    assert_check(sim_qspi_stats.commands == 0, "nothing sent");
+
+    qspi_program(PAGE - 8, buf, 16, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "program crossing a page refused");
+    qspi_program(0, buf, 0, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "empty program refused");
+
+    fill_pattern(buf, PAGE, 1);
+    qspi_program(0, buf, PAGE, &err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 1 && sim_nor_stats.quad_commands == 0,
+                 "single line program before enable");
+    assert_check(memcmp(sim_nor_mem, buf, PAGE) == 0, "programmed");
+}
+
+// a quad program reads back the same whichever way it's read
+static void test_program_read_modes(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    uint8_t page[PAGE];
+    fill_pattern(page, PAGE, 2);
+    qspi_program(0x1000, page, PAGE, &err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.quad_commands == 1, "quad page program");
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(&sim_nor_mem[0x1000], page, PAGE) == 0, "page programmed");
+
+    static const qspi_read_mode_t modes[] = {QSPI_READ_SINGLE, QSPI_READ_QUAD_OUTPUT, QSPI_READ_QUAD_IO};
+    bool all_match = true;
+    for (uint32_t m = 0; m < 3; m++) {
+        memset(buf, 0, sizeof(buf));
+        qspi_read(0x1000 + 3, buf, PAGE - 5, modes[m], &err); // odd start and length
+        all_match &= err == TI_ERRC_NONE && memcmp(buf, &page[3], PAGE - 5) == 0;
+    }
+    assert_check(all_match, "reads back in every mode");
+    assert_check(sim_nor_stats.quad_commands == 3, "quad reads on four lines");
+    assert_check(sim_nor_stats.malformed == 0 && sim_nor_stats.rejected == 0, "no command refused or misread");
+}
+
+// the mapping reads back what was programmed in every mode, with indirect commands held off meanwhile
+static void test_memory_mapped(void) {
+    setup();
+    enum ti_errc_t err;
+    assert_check(qspi_enter_memory_mapped(QSPI_READ_QUAD_IO, &err) == NULL && err == TI_ERRC_INVALID_ARG,
+                 "quad mapping refused before enable");
+    qspi_enable_quad(&err);
+    fill_pattern(buf, PAGE, 4);
+    qspi_program(0x2000, buf, PAGE, &err);
+    qspi_poll_status_blk(3000U, &err);
+
+    static const qspi_read_mode_t modes[] = {QSPI_READ_SINGLE, QSPI_READ_QUAD_OUTPUT, QSPI_READ_QUAD_IO};
+    bool all_match = true;
+    const uint8_t* flash = NULL;
+    for (uint32_t m = 0; m < 3; m++) {
+        flash = qspi_enter_memory_mapped(modes[m], &err);
+        all_match &= err == TI_ERRC_NONE && flash == (const uint8_t*)(uintptr_t)QSPI_MAPPED_BASE &&
+                     memcmp(&flash[0x2000], buf, PAGE) == 0;
+    }
+    assert_check(all_match && qspi_memory_mapped(), "mapping reads back in every mode");
+    assert_check(sim_qspi_stats.mapped_entries == 3 && sim_qspi_stats.mapped_malformed == 0,
+                 "mapped with reads the part takes");
+
+    const uint32_t dr_accesses = sim_qspi_stats.dr_accesses, commands = sim_qspi_stats.commands;
+    uint32_t erased = 0;
+    for (uint32_t a = 0; a < 0x10000; a++) erased += flash[0x10000 + a] == 0xFF;
+    assert_check(erased == 0x10000 && sim_qspi_stats.dr_accesses == dr_accesses, "64KB scanned with plain loads");
+
+    qspi_read(0x2000, buf, 16, QSPI_READ_SINGLE, &err);
+    assert_check(err == TI_ERRC_BUSY, "indirect read refused while mapped");
+    qspi_program(0x3000, buf, 16, &err);
+    assert_check(err == TI_ERRC_BUSY, "program refused while mapped");
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_BUSY && sim_qspi_stats.commands == commands, "nothing sent while mapped");
+
+    qspi_exit_memory_mapped(&err);
+    assert_check(err == TI_ERRC_NONE && !qspi_memory_mapped(), "unmapped");
+    qspi_read(0x2000, buf, 16, QSPI_READ_QUAD_IO, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(buf, &sim_nor_mem[0x2000], 16) == 0, "indirect reads work again");
+}
+
+static void dma_callback(bool success, void* context) {
+    (void)context;
+    if (success) dma_done++;
+    else dma_failed++;
+}
+
+// Runs the QUADSPI and MDMA interrupts if they would fire, as the NVIC would
+static void dispatch_irq(void) {
+    if (sim_qspi_irq_pending()) quadspi_irq_handler();
+    if (sim_mdma_irq_pending()) mdma_irq_handler();
+}
+
+// words through DR where the length allows, bytes for the rest
+static void test_word_fifo(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    fill_pattern(buf, PAGE, 5);
+    uint32_t dr_accesses = sim_qspi_stats.dr_accesses;
+    qspi_program(0x4000, buf, PAGE, &err);
+    assert_check(err == TI_ERRC_NONE && sim_qspi_stats.dr_accesses - dr_accesses == PAGE / 4,
+                 "page programmed a word per DR access");
+    qspi_poll_status_blk(3000U, &err);
+
+    static const uint32_t lengths[] = {1, 3, 4, 7, 253};
+    bool all_match = true;
+    uint32_t expected = 0;
+    dr_accesses = sim_qspi_stats.dr_accesses;
+    for (uint32_t l = 0; l < 5; l++) {
+        memset(buf, 0, PAGE);
+        qspi_read(0x4000 + l, buf, lengths[l], QSPI_READ_QUAD_IO, &err);
+        all_match &= err == TI_ERRC_NONE && memcmp(buf, &sim_nor_mem[0x4000 + l], lengths[l]) == 0 &&
+                     buf[lengths[l]] == 0;
+        expected += lengths[l] / 4 + lengths[l] % 4;
+    }
+    assert_check(all_match, "odd lengths read back without overrun");
+    assert_check(sim_qspi_stats.dr_accesses - dr_accesses == expected, "tails moved a byte per access");
+}
+
+// a DMA page program hands the data phase to the MDMA and finishes from the interrupt
+static void test_program_dma(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    dma_done = dma_failed = 0;
+    qspi_cmd_t no_data = {.instruction = 0x06, .instruction_mode = QSPI_MODE_SINGLE};
+    qspi_send_cmd_dma(&no_data, dma_buf, false, dma_callback, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "command without a data phase refused");
+    qspi_program_dma(PAGE - 8, dma_buf, 16, dma_callback, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "program crossing a page refused");
+
+    fill_pattern(dma_buf, PAGE, 6);
+    const uint32_t dr_accesses = sim_qspi_stats.dr_accesses;
+    qspi_program_dma(0x5000, dma_buf, PAGE, dma_callback, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && qspi_dma_pending() && dma_done == 0, "returns with the page in flight");
+    qspi_read(0x5000, buf, 16, QSPI_READ_SINGLE, &err);
+    assert_check(err == TI_ERRC_BUSY, "indirect read refused meanwhile");
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_BUSY, "status poll refused meanwhile");
+    assert_check(qspi_enter_memory_mapped(QSPI_READ_SINGLE, &err) == NULL && err == TI_ERRC_BUSY,
+                 "mapping refused meanwhile");
+
+    dispatch_irq();
+    assert_check(dma_done == 1 && dma_failed == 0 && !qspi_dma_pending(), "callback from the interrupt");
+    assert_check(sim_qspi_stats.dr_accesses == dr_accesses && sim_qspi_stats.dma_transfers == 1 &&
+                 sim_qspi_stats.dma_malformed == 0, "data phase moved by the MDMA alone");
+    assert_check(sim_nor_stats.quad_commands == 1 && sim_nor_stats.programs == 1, "one quad page program");
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(&sim_nor_mem[0x5000], dma_buf, PAGE) == 0, "page programmed");
+    assert_check((sim_quadspi.cr & QUADSPI_CR_DMAEN.msk) == 0 && (sim_mdma[0].cr & MDMA_MDMA_CxCR_EN.msk) == 0,
+                 "DMA left off");
+
+    // bytes when the length or buffer isn't word sized, reads the same way
+    qspi_program_dma(0x5100, &dma_buf[1], 7, dma_callback, NULL, &err);
+    dispatch_irq();
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(&sim_nor_mem[0x5100], &dma_buf[1], 7) == 0, "unaligned program");
+    memset(dma_buf, 0, sizeof(dma_buf));
+    qspi_cmd_t read = {
+        .instruction = 0x6B, .instruction_mode = QSPI_MODE_SINGLE, .address = 0x5000,
+        .address_mode = QSPI_MODE_SINGLE, .address_size = 2, .alternate_mode = QSPI_MODE_NONE,
+        .dummy_cycles = 8, .data_mode = QSPI_MODE_QUAD, .data_size = PAGE - 3
+    };
+    qspi_send_cmd_dma(&read, dma_buf, true, dma_callback, NULL, &err);
+    dispatch_irq();
+    assert_check(err == TI_ERRC_NONE && dma_done == 3 && memcmp(dma_buf, &sim_nor_mem[0x5000], PAGE - 3) == 0 &&
+                 dma_buf[PAGE - 3] == 0, "DMA read");
+    assert_check(sim_qspi_stats.dma_malformed == 0 && sim_nor_stats.malformed == 0 && sim_nor_stats.rejected == 0,
+                 "every channel and command set up right");
+
+    // nothing held on to: the next blocking command runs
+    qspi_read(0x5000, buf, 16, QSPI_READ_QUAD_IO, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(buf, &sim_nor_mem[0x5000], 16) == 0, "blocking commands work again");
+}
+
+// an MDMA that stops on a bus error fails the command from the MDMA interrupt rather than hanging it
+static void test_dma_error(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    dma_done = dma_failed = 0;
+    fill_pattern(dma_buf, PAGE, 8);
+
+    sim_qspi_inject_dma_error();
+    qspi_program_dma(0x6000, dma_buf, PAGE, dma_callback, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && !sim_qspi_irq_pending() && sim_mdma_irq_pending(),
+                 "QUADSPI waits on its FIFO, the MDMA interrupt fires");
+    dispatch_irq();
+    assert_check(dma_failed == 1 && dma_done == 0 && !qspi_dma_pending(), "callback told it failed");
+    assert_check(!sim_mdma_irq_pending() && (sim_quadspi.sr & QUADSPI_SR_BUSY.msk) == 0 &&
+                 (sim_quadspi.cr & QUADSPI_CR_DMAEN.msk) == 0, "command aborted, flags cleared");
+
+    sim_qspi_inject_dma_error();
+    qspi_cmd_t read = {
+        .instruction = 0x0B, .instruction_mode = QSPI_MODE_SINGLE, .address = 0x6000,
+        .address_mode = QSPI_MODE_SINGLE, .address_size = 2, .alternate_mode = QSPI_MODE_NONE,
+        .dummy_cycles = 8, .data_mode = QSPI_MODE_SINGLE, .data_size = 64
+    };
+    qspi_send_cmd_dma(&read, dma_buf, true, dma_callback, NULL, &err);
+    dispatch_irq();
+    assert_check(dma_failed == 2 && !qspi_dma_pending(), "failed read reported too");
+    assert_check(sim_qspi_stats.dma_bus_errors == 2 && sim_qspi_stats.dma_malformed == 0, "both from the bus");
+
+    // the page program never reached the part, and the next one goes through
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_NONE && sim_nor_stats.programs == 0, "driver usable again, nothing programmed");
+    qspi_program_dma(0x6000, dma_buf, PAGE, dma_callback, NULL, &err);
+    dispatch_irq();
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(err == TI_ERRC_NONE && dma_done == 1 && memcmp(&sim_nor_mem[0x6000], dma_buf, PAGE) == 0,
+                 "retry programmed");
+}
+
+// buffers in DTCM (stacks, the arena, the DTCM heap) go over AHBS
+static void test_dma_dtcm(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    dma_done = dma_failed = 0;
+    uint8_t* dtcm = mmap((void*)(uintptr_t)0x20000000U, 4096, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    assert_check(dtcm == (uint8_t*)(uintptr_t)0x20000000U, "buffer at the DTCM address");
+    if (dtcm != (uint8_t*)(uintptr_t)0x20000000U) return;
+
+    fill_pattern(dtcm, PAGE, 9);
+    qspi_program_dma(0x7000, dtcm, PAGE, dma_callback, NULL, &err);
+    assert_check(sim_mdma[0].tbr & MDMA_MDMA_CxTBR_SBUS.msk, "source over AHBS");
+    dispatch_irq();
+    qspi_poll_status_blk(3000U, &err);
+    assert_check(dma_done == 1 && memcmp(&sim_nor_mem[0x7000], dtcm, PAGE) == 0, "programmed from DTCM");
+
+    memset(&dtcm[PAGE], 0, PAGE);
+    qspi_cmd_t read = {
+        .instruction = 0x6B, .instruction_mode = QSPI_MODE_SINGLE, .address = 0x7000,
+        .address_mode = QSPI_MODE_SINGLE, .address_size = 2, .alternate_mode = QSPI_MODE_NONE,
+        .dummy_cycles = 8, .data_mode = QSPI_MODE_QUAD, .data_size = PAGE
+    };
+    qspi_send_cmd_dma(&read, &dtcm[PAGE], true, dma_callback, NULL, &err);
+    assert_check((sim_mdma[0].tbr & MDMA_MDMA_CxTBR_DBUS.msk) && !(sim_mdma[0].tbr & MDMA_MDMA_CxTBR_SBUS.msk),
+                 "destination over AHBS, DR over AXI");
+    dispatch_irq();
+    assert_check(dma_done == 2 && memcmp(&dtcm[PAGE], dtcm, PAGE) == 0, "read into DTCM");
+
+    qspi_program_dma(0x7100, dma_buf, PAGE, dma_callback, NULL, &err);
+    assert_check((sim_mdma[0].tbr & (MDMA_MDMA_CxTBR_SBUS.msk | MDMA_MDMA_CxTBR_DBUS.msk)) == 0,
+                 "other RAM over AXI");
+    dispatch_irq();
+    assert_check(dma_done == 3 && sim_qspi_stats.dma_bus_errors == 0, "no bus errors");
+    munmap(dtcm, 4096);
+}
+
+// CPU time of a page program: the register accesses it makes and the wire time it spends waiting
+// on, which is all of it for qspi_program and only the write enable for qspi_program_dma
+static uint32_t accesses(void) {
+    return sim_qspi_stats.register_reads + sim_qspi_stats.dr_accesses + sim_qspi_stats.mdma_accesses;
+}
+
+// Core cycles per page, averaged over BENCH_PAGES, with the interrupt counted for the DMA path
+static uint32_t bench_page_cycles(bool dma, uint32_t* page_accesses) {
+    enum ti_errc_t err;
+    uint32_t total_accesses = 0;
+    uint64_t wait_ns = 0;
+    for (uint32_t i = 0; i < BENCH_PAGES; i++) {
+        const uint32_t accesses_before = accesses();
+        const uint64_t cpu_bus_before = sim_qspi_stats.bus_ns - sim_qspi_stats.dma_bus_ns;
+        if (dma) {
+            qspi_program_dma(0x20000 + i * PAGE, dma_buf, PAGE, dma_callback, NULL, &err);
+            dispatch_irq();
+        } else {
+            qspi_program(0x20000 + i * PAGE, dma_buf, PAGE, &err);
+        }
+        total_accesses += accesses() - accesses_before;
+        wait_ns += sim_qspi_stats.bus_ns - sim_qspi_stats.dma_bus_ns - cpu_bus_before;
+        qspi_poll_status_blk(3000U, &err);
+    }
+    *page_accesses = total_accesses / BENCH_PAGES;
+    return (uint32_t)(((uint64_t)total_accesses * CYCLES_PER_ACCESS + wait_ns * CPU_MHZ / 1000U) / BENCH_PAGES);
+}
+
+static void test_page_cpu_cost(void) {
+    setup();
+    enum ti_errc_t err;
+    qspi_enable_quad(&err);
+    fill_pattern(dma_buf, PAGE, 7);
+    dma_done = dma_failed = 0;
+    uint32_t fifo_accesses, dma_accesses;
+    const uint32_t fifo_cycles = bench_page_cycles(false, &fifo_accesses);
+    for (uint32_t i = 0; i < BENCH_PAGES; i++) { // erase what the FIFO run programmed
+        memset(&sim_nor_mem[0x20000 + i * PAGE], 0xFF, PAGE);
+    }
+    const uint32_t dma_cycles = bench_page_cycles(true, &dma_accesses);
+
+    bool all_match = true;
+    for (uint32_t i = 0; i < BENCH_PAGES; i++) all_match &= memcmp(&sim_nor_mem[0x20000 + i * PAGE], dma_buf, PAGE) == 0;
+    assert_check(all_match && dma_done == BENCH_PAGES && dma_failed == 0, "every page programmed both ways");
+    assert_check(sim_qspi_stats.dma_malformed == 0 && sim_nor_stats.rejected == 0, "channel and commands set up right");
+    assert_check(dma_cycles * 4U <= fifo_cycles, "DMA page program costs the CPU under a quarter");
+
+    printf("  quad page program, CPU per page at %u MHz (%u cycles per register access):\n",
+           (unsigned)CPU_MHZ, (unsigned)CYCLES_PER_ACCESS);
+    printf("  FIFO words %4u accesses %5u cycles, MDMA %4u accesses %5u cycles\n",
+           (unsigned)fifo_accesses, (unsigned)fifo_cycles, (unsigned)dma_accesses, (unsigned)dma_cycles);
+}
+
+// bus time of reads and page programs, single line against quad
+static uint64_t bench_read(qspi_read_mode_t mode) {
+    enum ti_errc_t err;
+    const uint64_t before = sim_qspi_stats.bus_ns;
+    for (uint32_t i = 0; i < BENCH_READS; i++) qspi_read(i * BENCH_READ, buf, BENCH_READ, mode, &err);
+    return sim_qspi_stats.bus_ns - before;
+}
+
+static void bench_program(uint64_t* bus_ns, uint64_t* total_ns) {
+    enum ti_errc_t err;
+    const uint64_t bus_before = sim_qspi_stats.bus_ns, before = sim_nor_now_ns;
+    for (uint32_t i = 0; i < BENCH_PAGES; i++) {
+        qspi_program(0x10000 + i * PAGE, buf, PAGE, &err);
+        qspi_poll_status_blk(3000U, &err);
+    }
+    *bus_ns = sim_qspi_stats.bus_ns - bus_before;
+    *total_ns = sim_nor_now_ns - before;
+}
+
+static double mb_per_s(uint32_t bytes, uint64_t ns) {
+    return (double)bytes * 1000.0 / (double)ns;
+}
+
+static void test_throughput(void) {
+    setup();
+    enum ti_errc_t err;
+    const uint32_t read_bytes = BENCH_READ * BENCH_READS, program_bytes = BENCH_PAGES * PAGE;
+    fill_pattern(buf, PAGE, 3);
+    uint64_t single_program_bus, single_program_total, quad_program_bus, quad_program_total;
+    const uint64_t single_read = bench_read(QSPI_READ_SINGLE);
+    bench_program(&single_program_bus, &single_program_total);
+
+    qspi_enable_quad(&err);
+    const uint64_t output_read = bench_read(QSPI_READ_QUAD_OUTPUT);
+    const uint64_t io_read = bench_read(QSPI_READ_QUAD_IO);
+    bench_program(&quad_program_bus, &quad_program_total);
+
+    assert_check(sim_nor_stats.malformed == 0 && sim_nor_stats.rejected == 0, "no command refused or misread");
+    assert_check(io_read * 3U <= single_read && output_read * 3U <= single_read,
+                 "4KB quad reads take under a third of the bus time");
+    assert_check(quad_program_bus * 3U <= single_program_bus, "quad program data phase under a third");
+    assert_check(quad_program_total < single_program_total, "quad page programs finish sooner");
+
+    printf("  SCK %u MHz, %u x %u-byte reads, %u page programs\n", (unsigned)(sim_qspi_sck_hz() / 1000000U),
+           (unsigned)BENCH_READS, (unsigned)BENCH_READ, (unsigned)BENCH_PAGES);
+    printf("  read   single %6.2f MB/s, quad output %6.2f MB/s, quad I/O %6.2f MB/s\n",
+           mb_per_s(read_bytes, single_read), mb_per_s(read_bytes, output_read), mb_per_s(read_bytes, io_read));
+    printf("  program on the bus: single %6.2f MB/s, quad %6.2f MB/s\n",
+           mb_per_s(program_bytes, single_program_bus), mb_per_s(program_bytes, quad_program_bus));
+    printf("  program with tPP:   single %6.3f MB/s, quad %6.3f MB/s\n",
+           mb_per_s(program_bytes, single_program_total), mb_per_s(program_bytes, quad_program_total));
+}
+
+int main(void) {
+    // memory-mapped reads go to a file mapped where the flash would be
+    char image[] = "/tmp/titan_qspi_XXXXXX";
+    const int fd = mkstemp(image);
+    if (fd < 0 || !sim_qspi_mmap_open(image)) {
+        printf("cannot map a flash image at 0x%x\n", (unsigned)QSPI_MAPPED_BASE);
+        return 1;
+    }
+    close(fd);
+    unlink(image);
+
+    TestCase tests[] = {
+        TEST_CASE(test_quad_enable),
+        TEST_CASE(test_quad_refused),
+        TEST_CASE(test_program_read_modes),
+        TEST_CASE(test_memory_mapped),
+        TEST_CASE(test_throughput),
+        TEST_CASE(test_word_fifo),
+        TEST_CASE(test_program_dma),
+        TEST_CASE(test_dma_error),
+        TEST_CASE(test_dma_dtcm),
+        TEST_CASE(test_page_cpu_cost),
+    };
+
+    return run_test_suite("qspi unit tests", "qspitest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,240 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi.h"
+#include "internal/interrupt.h"
+
+// spi_transfer_async against the simulated SPI/DMA backend in test/sim. The sensor bus instance
+// and its DMA streams below match what the flight build uses.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS   3
+#define SS    40
+#define SS2   41
+
+typedef struct {
+    int calls;
+    bool success;
+    void* ctx;
+    uint8_t ss_level;  // SS level seen from inside the callback
+    bool busy;         // spi_async_busy seen from inside the callback
+} cb_record_t;
+
+static cb_record_t record;
+
+static void on_done(bool success, void* ctx) {
+    record.calls++;
+    record.success = success;
+    record.ctx = ctx;
+    record.ss_level = sim_pin_level[SS];
+    record.busy = spi_async_busy(BUS);
+}
+
+static void setup(void) {
+    spi_dma_sim_setup(BUS);
+    memset(&record, 0, sizeof(record));
+}
+
+// device that answers every byte with its complement
+static uint8_t complement_device(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ss_pin; (void)ctx;
+    return (uint8_t)~mosi;
+}
+
+// streams are routed to SPI3's DMAMUX requests and the SPI interrupt is enabled
+static void test_dma_init_routing(void) {
+    setup();
+    sim_dma_stream_t* tx = &sim_dma[DMA1][DMA_STREAM_0];
+    sim_dma_stream_t* rx = &sim_dma[DMA1][DMA_STREAM_1];
+    assert_check(tx->configured && tx->config.request_id == 62 && tx->config.direction == MEM_TO_PERIPH,
+                 "TX stream on spi3_tx_dma");
+    assert_check(rx->configured && rx->config.request_id == 61 && rx->config.direction == PERIPH_TO_MEM,
+                 "RX stream on spi3_rx_dma");
+    assert_check(!rx->config.fifo_enabled, "RX stream runs without the DMA FIFO");
+    const int32_t irq = SPIx_IRQ_NUM[BUS];
+    assert_check(sim_nvic_iser[irq / 32] & (1U << (irq % 32)), "SPI3 interrupt enabled in the NVIC");
+}
+
+// a full-duplex transfer lands in dst, with SS framing it and one successful callback
+static void test_async_full_duplex(void) {
+    setup();
+    sim_spi_attach(BUS, complement_device, NULL);
+    uint8_t src[32], dst[32];
+    for (int i = 0; i < 32; ++i) src[i] = (uint8_t)(i * 7);
+    memset(dst, 0, sizeof(dst));
+
+    enum ti_errc_t err = TI_ERRC_NONE;
+    int ctx_token = 0;
+    spi_transfer_async(BUS, SS, src, dst, sizeof(src), on_done, &ctx_token, &err);
+    assert_check(err == TI_ERRC_NONE, "transfer started");
+    assert_check(spi_async_busy(BUS) && sim_pin_level[SS] == 0, "returns with SS low and the bus busy");
+    assert_check(record.calls == 0, "no callback before the transfer runs");
+    assert_check((sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == sizeof(src), "TSIZE holds the length");
+
+    assert_check(sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA), "transfer clocked through the bus");
+    int match = 1;
+    for (int i = 0; i < 32; ++i) {
+        const uint8_t want = (uint8_t)~src[i];
+        match &= dst[i] == want;
+    }
+    assert_check(match, "received bytes in dst");
+    assert_check(record.calls == 1 && record.success && record.ctx == &ctx_token, "callback once with ctx");
+    assert_check(record.ss_level == 1 && !record.busy, "SS released and bus free before the callback");
+    assert_check(!(sim_spi[BUS].cfg1 & (SPIx_CFG1_TXDMAEN.msk | SPIx_CFG1_RXDMAEN.msk)) &&
+                 !(sim_spi[BUS].ier & SPIx_IER_EOTIE.msk), "DMA requests and interrupts off afterwards");
+}
+
+// RM0399 start-up order: RXDMAEN before the RX stream, both streams before SPE
+static void test_async_start_order(void) {
+    setup();
+    uint8_t src[4] = {1, 2, 3, 4}, dst[4];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, SS, src, dst, 4, on_done, NULL, &err);
+    sim_dma_stream_t* tx = &sim_dma[DMA1][DMA_STREAM_0];
+    sim_dma_stream_t* rx = &sim_dma[DMA1][DMA_STREAM_1];
+    assert_check(!rx->started_without_rxdmaen, "RXDMAEN set before the RX stream is armed");
+    assert_check(!rx->started_with_spe && !tx->started_with_spe, "streams armed while SPE is off");
+    assert_check(sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk, "SPE on once streams are armed");
+}
+
+// the callback waits for both EOT and RX transfer-complete, whichever comes last
+static void test_async_waits_for_both(void) {
+    uint8_t src[8] = {0}, dst[8];
+    enum ti_errc_t err = TI_ERRC_NONE;
+
+    setup();
+    spi_transfer_async(BUS, SS, src, dst, 8, on_done, NULL, &err);
+    sim_spi_clock(BUS);
+    sim_dma_complete(DMA1, DMA_STREAM_0, true);
+    sim_spi_irq(BUS);
+    assert_check(record.calls == 0 && sim_pin_level[SS] == 0, "EOT alone doesn't complete");
+    sim_dma_complete(DMA1, DMA_STREAM_1, true);
+    assert_check(record.calls == 1 && record.success, "completes on RX transfer-complete");
+
+    setup();
+    spi_transfer_async(BUS, SS, src, dst, 8, on_done, NULL, &err);
+    sim_spi_clock(BUS);
+    sim_dma_complete(DMA1, DMA_STREAM_0, true);
+    sim_dma_complete(DMA1, DMA_STREAM_1, true);
+    assert_check(record.calls == 0 && spi_async_busy(BUS), "RX transfer-complete alone doesn't complete");
+    sim_spi_irq(BUS);
+    assert_check(record.calls == 1 && record.success, "completes on EOT");
+}
+
+// NULL src clocks out 0xFF, NULL dst discards what comes back
+static void test_async_null_buffers(void) {
+    setup();
+    uint8_t dst[6];
+    memset(dst, 0, sizeof(dst));
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, SS, NULL, dst, 6, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && sim_dma[DMA1][DMA_STREAM_0].transfer.disable_mem_inc,
+                 "read-only transfer sends from a fixed dummy byte");
+    sim_spi_run(BUS, SIM_RX_DMA_THEN_EOT);
+    int all_ff = 1;
+    for (int i = 0; i < 6; ++i) all_ff &= dst[i] == 0xFF;
+    assert_check(all_ff && record.calls == 1, "loopback returns 0xFF fill");
+
+    uint8_t src[6] = {9, 9, 9, 9, 9, 9};
+    spi_transfer_async(BUS, SS, src, NULL, 6, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && sim_dma[DMA1][DMA_STREAM_1].transfer.disable_mem_inc,
+                 "write-only transfer drains into a dummy byte");
+    assert_check(sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA) && record.calls == 2 && record.success,
+                 "write-only transfer completes");
+}
+
+// second transfer while one is running, the blocking path, and bad arguments
+static void test_async_rejections(void) {
+    setup();
+    uint8_t buf[4] = {0};
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, SS, buf, buf, 4, on_done, NULL, &err);
+    spi_transfer_async(BUS, SS2, buf, buf, 4, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_BUSY && sim_pin_level[SS2] == 1, "second async transfer rejected");
+    spi_transfer_sync(BUS, SS2, buf, buf, 4, &err);
+    assert_check(err == TI_ERRC_BUSY, "blocking transfer rejected while async runs");
+    sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+    spi_transfer_async(BUS, SS2, buf, buf, 4, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_NONE, "bus usable again after the callback");
+    sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+
+    spi_transfer_async(BUS, SS, buf, buf, 0, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "zero length rejected");
+    spi_transfer_async(2, SS, buf, buf, 4, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "instance without spi_dma_init rejected");
+    spi_dma_init(6, &sim_spi_tx_cfg, &sim_spi_rx_cfg, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "SPI6 (BDMA only) rejected");
+    spi_dma_init(2, &sim_spi_tx_cfg, &sim_spi_tx_cfg, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "shared TX/RX stream rejected");
+
+    sim_dma_fail_start = true;
+    spi_transfer_async(BUS, SS, buf, buf, 4, on_done, NULL, &err);
+    assert_check(err == TI_ERRC_BUS && !spi_async_busy(BUS) && sim_pin_level[SS] == 1,
+                 "DMA start failure reported, bus left idle");
+}
+
+// overrun on the SPI side or a DMA stream error fails the transfer exactly once
+static void test_async_errors(void) {
+    uint8_t buf[4] = {0};
+    enum ti_errc_t err = TI_ERRC_NONE;
+
+    setup();
+    spi_transfer_async(BUS, SS, buf, buf, 4, on_done, NULL, &err);
+    sim_spi_raise(BUS, SPIx_SR_OVR.msk);
+    assert_check(record.calls == 1 && !record.success && record.ss_level == 1, "overrun fails the transfer");
+    assert_check(!(sim_spi[BUS].sr & SPIx_SR_OVR.msk), "overrun flag cleared");
+    sim_dma_complete(DMA1, DMA_STREAM_1, true);
+    assert_check(record.calls == 1, "late DMA completion doesn't call back again");
+
+    setup();
+    spi_transfer_async(BUS, SS, buf, buf, 4, on_done, NULL, &err);
+    sim_spi_clock(BUS);
+    sim_dma_complete(DMA1, DMA_STREAM_0, false);
+    assert_check(record.calls == 1 && !record.success && !spi_async_busy(BUS), "TX stream error fails the transfer");
+    sim_spi_irq(BUS);
+    assert_check(record.calls == 1, "late EOT doesn't call back again");
+}
+
+// chaining from inside the callback, the way a driver reads one sensor after another
+static int chain_left;
+static uint8_t chain_buf[3][2];
+
+static void on_chain(bool success, void* ctx) {
+    (void)ctx;
+    record.calls++;
+    record.success &= success;
+    if (--chain_left > 0) {
+        enum ti_errc_t err = TI_ERRC_NONE;
+        spi_transfer_async(BUS, SS, chain_buf[chain_left], chain_buf[chain_left], 2, on_chain, NULL, &err);
+        if (err != TI_ERRC_NONE) record.success = false;
+    }
+}
+
+static void test_async_chain_from_callback(void) {
+    setup();
+    record.success = true;
+    chain_left = 3;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, SS, chain_buf[0], chain_buf[0], 2, on_chain, NULL, &err);
+    int runs = 0;
+    while (spi_async_busy(BUS) && runs < 10) runs += sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+    assert_check(runs == 3 && record.calls == 3 && record.success, "three chained transfers complete");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_dma_init_routing),
+        TEST_CASE(test_async_full_duplex),
+        TEST_CASE(test_async_start_order),
+        TEST_CASE(test_async_waits_for_both),
+        TEST_CASE(test_async_null_buffers),
+        TEST_CASE(test_async_rejections),
+        TEST_CASE(test_async_errors),
+        TEST_CASE(test_async_chain_from_callback),
+    };
+
+    return run_test_suite("spi async tests", "spiasynctest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,51 @@
+#include "internal/dwt.h"
+#include "peripheral/errc.h"
+#include "peripheral/spi.h"
+
+// Cycles per byte of blocking SPI reads, one frame at a time against packed FIFO mode, for the
+// two reads packed mode is aimed at: the 15-byte IMU burst and a 100-byte GNSS read. Results are
+// left in the bench_* globals and the core halts on a breakpoint so they can be read from the
+// debugger. The bus runs at 32MHz, 120 core cycles a byte at 480MHz, so the wire time doesn't
+// hide the per-byte overhead. Nothing needs to be attached; MISO reads whatever is floating.
+
+#define BENCH_ITERATIONS 1000U
+#define BENCH_SPI_INST   3
+#define BENCH_SS_PIN     43
+
+volatile uint32_t bench_imu_cycles_per_byte;         // 15-byte spi_read, one frame in flight
+volatile uint32_t bench_imu_packed_cycles_per_byte;  // same, packed mode
+volatile uint32_t bench_gnss_cycles_per_byte;        // 100-byte spi_read, one frame in flight
+volatile uint32_t bench_gnss_packed_cycles_per_byte; // same, packed mode
+
+static uint8_t bench_buf[100];
+
+static uint32_t bench_read(uint16_t len, bool packed) {
+    enum ti_errc_t errc;
+    spi_set_packed(BENCH_SPI_INST, packed, &errc);
+    spi_read(BENCH_SPI_INST, BENCH_SS_PIN, bench_buf, len, 0xFF, &errc); // sets the instance up
+
+    const uint32_t start = dwt_cycles();
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+        spi_read(BENCH_SPI_INST, BENCH_SS_PIN, bench_buf, len, 0xFF, &errc);
+    }
+    return (dwt_cycles() - start) / (BENCH_ITERATIONS * len);
+}
+
+void _start() {
+    dwt_cycle_counter_init();
+
+    enum ti_errc_t errc;
+    uint8_t ss_pins[1] = {BENCH_SS_PIN};
+    spi_init(BENCH_SPI_INST, MODE_0, ss_pins, 1, &errc);
+    static const spi_profile_t profile = { .max_clock_hz = 32000000, .mode = MODE_0, .word_bits = 8 };
+    spi_set_profile(BENCH_SPI_INST, BENCH_SS_PIN, &profile, &errc);
+
+    bench_imu_cycles_per_byte = bench_read(15, false);
+    bench_gnss_cycles_per_byte = bench_read(100, false);
+    bench_imu_packed_cycles_per_byte = bench_read(15, true);
+    bench_gnss_packed_cycles_per_byte = bench_read(100, true);
+
+    while (1) {
+        asm("BKPT #0");
+    }
+}
@@ -0,0 +1,225 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi.h"
+
+// Packed FIFO mode (spi_set_packed) against the polled SPI model in test/sim. Every transfer is
+// checked against what the one-frame-at-a-time path puts on the wire, on a 16-byte FIFO (SPI1-3)
+// and an 8-byte one (SPI4-6).
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS      3   // SENSOR_SPI_INST
+#define BUS_4    4
+#define SS       30
+#define SS_OTHER 31
+
+static const spi_profile_t fast = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 8 };
+static const spi_profile_t slow = { .max_clock_hz = 1000000, .mode = MODE_3, .word_bits = 8 };
+
+static void setup(void) {
+    spi_dma_sim_log_setup(BUS);
+    sim_spi_attach(BUS_4, sim_logging_device, NULL);
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_profile(BUS, SS, &fast, &err);
+    spi_set_profile(BUS_4, SS, &fast, &err);
+}
+
+static int no_fifo_errors(uint8_t inst) {
+    return !(sim_spi[inst].sr & (SPIx_SR_OVR.msk | SPIx_SR_UDR.msk));
+}
+
+static int answers_ok(const uint8_t* got, uint32_t n, uint32_t first) {
+    for (uint32_t i = 0; i < n; ++i) if (got[i] != (uint8_t)((first + i) * 3 + 1)) return 0;
+    return 1;
+}
+
+// every length, including the 15-byte IMU burst and 100-byte GNSS read, clocks exactly the bytes
+// the unpacked path does, however the tail falls against the 4-byte packets and the FIFO
+static void test_packed_matches_unpacked(void) {
+    static const uint16_t lens[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 100, 257, 1000 };
+    const uint8_t buses[2] = { BUS, BUS_4 };
+    int ok[2] = { 1, 1 };
+    setup();
+    for (int b = 0; b < 2; ++b) {
+        const uint8_t inst = buses[b];
+        enum ti_errc_t err = TI_ERRC_NONE;
+        spi_set_packed(inst, true, &err);
+        for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+            uint8_t src[1000], dst[1000] = { 0 };
+            for (uint32_t k = 0; k < lens[i]; ++k) src[k] = (uint8_t)(k * 7 + lens[i]);
+            sim_mosi_log_len = 0;
+            sim_pin_falls[SS] = 0;
+            spi_transfer_iov(inst, SS, &(spi_iov_t){ .tx = src, .rx = dst, .len = lens[i] }, 1, 0xFF, &err);
+            ok[b] &= err == TI_ERRC_NONE && sim_mosi_log_len == lens[i] && memcmp(sim_mosi_log, src, lens[i]) == 0;
+            ok[b] &= answers_ok(dst, lens[i], 0) && no_fifo_errors(inst);
+            ok[b] &= sim_pin_falls[SS] == 1 && sim_pin_level[SS] == 1;
+        }
+        spi_set_packed(inst, false, &err); // the model polls one instance at a time
+    }
+    assert_check(ok[0], "16-byte FIFO: every length matches the unpacked stream");
+    assert_check(ok[1], "8-byte FIFO: every length matches the unpacked stream");
+}
+
+// the instance stays enabled between calls: no TSIZE rewrite, FTHVL at a 4-frame packet
+static void test_packed_stays_enabled(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_packed(BUS, true, &err);
+    uint8_t dst[15];
+    spi_read(BUS, SS, dst, sizeof(dst), 0x00, &err);
+    assert_check(err == TI_ERRC_NONE && answers_ok(dst, 15, 0), "first 15-byte read");
+    assert_check((sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk) && (sim_spi[BUS].cr1 & SPIx_CR1_CSTART.msk),
+                 "left enabled and started after the call");
+    assert_check(((sim_spi[BUS].cfg1 & SPIx_CFG1_FTHVL.msk) >> SPIx_CFG1_FTHVL.pos) == 3, "FTHVL is 4 frames");
+    assert_check((sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 0, "endless transfer (TSIZE 0)");
+
+    // a restart would write TSIZE again; it never gets the chance
+    sim_spi[BUS].cr2 = 0x1234;
+    int ok = 1;
+    for (uint32_t n = 1; n < 20; ++n) {
+        spi_read(BUS, SS, dst, sizeof(dst), 0x00, &err);
+        ok &= err == TI_ERRC_NONE && answers_ok(dst, 15, 15 * n);
+    }
+    assert_check(ok, "19 more reads on the running transfer");
+    assert_check((sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 0x1234, "no disable/TSIZE/enable between calls");
+    assert_check(sim_pin_falls[SS] == 20 && no_fifo_errors(BUS), "one assertion per call, no FIFO errors");
+}
+
+// a device on another profile ends the stream and restarts it at its settings; one sharing the
+// running settings doesn't
+static void test_profile_switch(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_packed(BUS, true, &err);
+    spi_set_profile(BUS, SS_OTHER, &slow, &err);
+    uint8_t dst[100];
+
+    spi_read(BUS, SS, dst, 100, 0xFF, &err);
+    assert_check(sim_spi_bus_ns[BUS] == 100000, "100 bytes at 8MHz");
+    spi_read(BUS, SS_OTHER, dst, 100, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && answers_ok(dst, 100, 100), "read on the other profile");
+    assert_check(sim_spi_bus_ns[BUS] == 100000 + 800000, "then 100 bytes at 1MHz");
+    assert_check(((sim_spi[BUS].cfg2 & SPIx_CFG2_CPOL.msk) != 0) && ((sim_spi[BUS].cfg2 & SPIx_CFG2_CPHA.msk) != 0),
+                 "mode 3 applied");
+    assert_check((sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk) && !(sim_spi[BUS].sr & SPIx_SR_SUSP.msk),
+                 "restarted, suspend flag cleared");
+
+    spi_set_profile(BUS, SS_OTHER, &fast, &err);
+    spi_read(BUS, SS, dst, 4, 0xFF, &err);
+    sim_spi[BUS].cr2 = 0x1234;
+    spi_read(BUS, SS_OTHER, dst, 4, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 0x1234,
+                 "same settings on another chip select keep the stream");
+    assert_check(no_fifo_errors(BUS), "no FIFO errors");
+}
+
+// packets straddle iov pieces; pieces without tx send the fill byte, without rx drop
+static void test_packed_iov(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_packed(BUS, true, &err);
+    const uint8_t cmd[3] = { 0x81, 0x82, 0x83 };
+    const uint8_t payload[5] = { 1, 2, 3, 4, 5 };
+    uint8_t status[3] = { 0 }, reply[7] = { 0 };
+    const spi_iov_t iov[4] = {
+        { .tx = cmd, .rx = status, .len = 3 },
+        { .tx = payload, .len = 5 },
+        { .len = 0 },
+        { .rx = reply, .len = 7 },
+    };
+    spi_transfer_iov(BUS, SS, iov, 4, 0xA5, &err);
+    assert_check(err == TI_ERRC_NONE && sim_mosi_log_len == 15, "15 bytes over four pieces");
+    assert_check(memcmp(sim_mosi_log, cmd, 3) == 0 && memcmp(sim_mosi_log + 3, payload, 5) == 0, "cmd then payload on MOSI");
+    int fill = 1;
+    for (int i = 8; i < 15; ++i) fill &= sim_mosi_log[i] == 0xA5;
+    assert_check(fill, "fill byte for the read piece");
+    assert_check(answers_ok(status, 3, 0) && answers_ok(reply, 7, 8), "answers land in their pieces");
+}
+
+// turning packed mode off, or starting an async transfer, ends the stream cleanly
+static void test_leave_packed(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    uint8_t dst[16];
+    spi_set_packed(BUS, true, &err);
+    spi_read(BUS, SS, dst, 16, 0xFF, &err);
+    spi_set_packed(BUS, false, &err);
+    assert_check(err == TI_ERRC_NONE && !(sim_spi[BUS].cr1 & SPIx_CR1_SPE.msk), "disabled when packed mode ends");
+    assert_check((sim_spi[BUS].cfg1 & SPIx_CFG1_FTHVL.msk) == 0, "FTHVL back to one frame");
+    spi_read(BUS, SS, dst, 5, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 5 && answers_ok(dst, 5, 16),
+                 "unpacked read afterwards");
+
+    periph_dma_config_t tx_cfg = { .instance = DMA1, .stream = DMA_STREAM_2 };
+    periph_dma_config_t rx_cfg = { .instance = DMA1, .stream = DMA_STREAM_3 };
+    spi_dma_init(BUS, &tx_cfg, &rx_cfg, &err);
+    spi_set_packed(BUS, true, &err);
+    spi_read(BUS, SS, dst, 16, 0xFF, &err);
+    spi_transfer_async(BUS, SS, NULL, dst, 8, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_spi[BUS].cfg1 & SPIx_CFG1_FTHVL.msk) == 0, "async ends the stream");
+    spi_read(BUS, SS, dst, 4, 0xFF, &err);
+    assert_check(err == TI_ERRC_BUSY, "packed read refused during async transfer");
+    spi_set_packed(BUS, false, &err);
+    assert_check(err == TI_ERRC_BUSY, "mode can't change during async transfer");
+    assert_check(sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA) && answers_ok(dst, 8, 37), "async transfer runs");
+    spi_read(BUS, SS, dst, 4, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && answers_ok(dst, 4, 45), "packed again after it");
+}
+
+// frames over 8 bits keep one access per frame
+static void test_wide_frames_unpacked(void) {
+    setup();
+    static const spi_profile_t wide = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 16 };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_packed(BUS, true, &err);
+    spi_set_profile(BUS, SS_OTHER, &wide, &err);
+    _Alignas(2) uint8_t dst[6] = { 0 };
+    spi_read(BUS, SS_OTHER, dst, 6, 0x00, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 3, "three 16-bit frames");
+    assert_check(answers_ok(dst, 6, 0) && (sim_spi[BUS].cfg1 & SPIx_CFG1_FTHVL.msk) == 0, "one frame per access");
+}
+
+// register traffic per byte for the two reads packed mode is for. On the target the DWT
+// benchmark in test_spi_bench.c measures cycles; here SR polls and data register accesses
+// stand in for them.
+static void test_bench_accesses(void) {
+    static const uint16_t lens[2] = { 15, 100 };
+    static const char* const names[2] = { "IMU burst", "GNSS read" };
+    int fewer = 1;
+    setup(); // once: the driver's cached profile must match the simulated registers
+    for (int i = 0; i < 2; ++i) {
+        uint32_t sr[2], dr[2];
+        for (int packed = 0; packed < 2; ++packed) {
+            enum ti_errc_t err = TI_ERRC_NONE;
+            uint8_t dst[100];
+            spi_set_packed(BUS, packed, &err);
+            spi_read(BUS, SS, dst, lens[i], 0xFF, &err); // first call may set the instance up
+            sim_spi_sr_reads = sim_spi_dr_accesses = 0;
+            spi_read(BUS, SS, dst, lens[i], 0xFF, &err);
+            sr[packed] = sim_spi_sr_reads;
+            dr[packed] = sim_spi_dr_accesses;
+        }
+        log_printf("      %3u B %s: unpacked %.2f SR + %.2f DR per byte, packed %.2f SR + %.2f DR per byte\n",
+                   lens[i], names[i], (double)sr[0] / lens[i], (double)dr[0] / lens[i],
+                   (double)sr[1] / lens[i], (double)dr[1] / lens[i]);
+        fewer &= sr[1] + dr[1] < (sr[0] + dr[0]) / 2;
+    }
+    assert_check(fewer, "packed mode needs under half the register accesses");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_packed_matches_unpacked),
+        TEST_CASE(test_packed_stays_enabled),
+        TEST_CASE(test_profile_switch),
+        TEST_CASE(test_packed_iov),
+        TEST_CASE(test_leave_packed),
+        TEST_CASE(test_wide_frames_unpacked),
+        TEST_CASE(test_bench_accesses),
+    };
+
+    return run_test_suite("spi packed FIFO tests", "spipackedtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
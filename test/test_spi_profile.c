@@ -0,0 +1,202 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi.h"
+
+// Per-device SPI profiles against the simulated SPI/DMA backend in test/sim. Bus time comes from
+// the MBR and DSIZE values the driver actually programmed, so the sweep benchmark measures what
+// the flight board would clock, not host speed.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS  3
+#define SS_A 40
+#define SS_B 41
+
+static void setup(void) {
+    spi_dma_sim_setup(BUS);
+}
+
+static bool transfer(uint8_t ss_pin, const void* src, void* dst, uint16_t len) {
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, ss_pin, src, dst, len, NULL, NULL, &err);
+    return err == TI_ERRC_NONE && sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+}
+
+static uint32_t cfg1_field(field32_t f) { return (sim_spi[BUS].cfg1 & f.msk) >> f.pos; }
+static uint32_t cfg2_field(field32_t f) { return (sim_spi[BUS].cfg2 & f.msk) >> f.pos; }
+
+// clocks round down to the nearest prescaler step; impossible profiles are rejected
+static void test_profile_validation(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    const uint32_t clocks[] = { 64000000, 32000000, 24000000, 10000000, 300000, SPI_MIN_CLOCK_HZ };
+    const uint32_t want_mbr[] = { 0, 0, 1, 2, 7, 7 };
+    int ok = 1;
+    for (int i = 0; i < 6; ++i) {
+        spi_profile_t p = { .max_clock_hz = clocks[i], .mode = MODE_0, .word_bits = 8 };
+        spi_set_profile(BUS, SS_A, &p, &err);
+        ok &= err == TI_ERRC_NONE && transfer(SS_A, NULL, NULL, 1) && cfg1_field(SPIx_CFG1_MBR) == want_mbr[i];
+    }
+    assert_check(ok, "fastest prescaler at or under max_clock_hz");
+
+    spi_profile_t slow = { .max_clock_hz = SPI_MIN_CLOCK_HZ - 1, .mode = MODE_0, .word_bits = 8 };
+    spi_set_profile(BUS, SS_A, &slow, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "clock under kernel / 256 rejected");
+    spi_profile_t mode = { .max_clock_hz = 1000000, .mode = 4, .word_bits = 8 };
+    spi_set_profile(BUS, SS_A, &mode, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "mode 4 rejected");
+    spi_profile_t bits = { .max_clock_hz = 1000000, .mode = MODE_0, .word_bits = 3 };
+    spi_set_profile(BUS, SS_A, &bits, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "3-bit frames rejected");
+    bits.word_bits = 33;
+    spi_set_profile(BUS, SS_A, &bits, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "33-bit frames rejected");
+    spi_set_profile(7, SS_A, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "bad instance rejected");
+}
+
+// switching chip selects reprograms clock and mode; staying on one device leaves the registers alone
+static void test_profile_lazy_apply(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    static const spi_profile_t imu = { .max_clock_hz = 24000000, .mode = MODE_3, .word_bits = 8 };
+    static const spi_profile_t adc = { .max_clock_hz = 10000000, .mode = MODE_1, .word_bits = 8 };
+    spi_set_profile(BUS, SS_A, &imu, &err);
+    spi_set_profile(BUS, SS_B, &adc, &err);
+    assert_check(sim_spi[BUS].cfg1 == 0 && sim_spi[BUS].cfg2 == 0, "setting a profile writes nothing");
+
+    assert_check(transfer(SS_A, NULL, NULL, 2), "IMU transfer");
+    assert_check(cfg1_field(SPIx_CFG1_MBR) == 1 && cfg1_field(SPIx_CFG1_DSIZE) == 7, "IMU clock and frame size");
+    assert_check(cfg2_field(SPIx_CFG2_CPOL) == 1 && cfg2_field(SPIx_CFG2_CPHA) == 1, "IMU in mode 3");
+
+    // anything the driver rewrites would overwrite this marker
+    sim_spi[BUS].cfg1 = (sim_spi[BUS].cfg1 & ~SPIx_CFG1_MBR.msk) | (5U << SPIx_CFG1_MBR.pos);
+    assert_check(transfer(SS_A, NULL, NULL, 2), "second IMU transfer");
+    assert_check(cfg1_field(SPIx_CFG1_MBR) == 5, "same device again: no register writes");
+
+    assert_check(transfer(SS_B, NULL, NULL, 2), "ADC transfer");
+    assert_check(cfg1_field(SPIx_CFG1_MBR) == 2, "ADC clock applied on switch");
+    assert_check(cfg2_field(SPIx_CFG2_CPOL) == 0 && cfg2_field(SPIx_CFG2_CPHA) == 1, "ADC in mode 1");
+
+    spi_set_profile(BUS, SS_B, NULL, &err);
+    assert_check(err == TI_ERRC_NONE && transfer(SS_B, NULL, NULL, 2), "profile removed");
+    assert_check(cfg1_field(SPIx_CFG1_MBR) == 0 && cfg2_field(SPIx_CFG2_CPHA) == 0,
+                 "unprofiled device gets the spi_init configuration");
+}
+
+// frames wider than a byte move as halfwords, with TSIZE and the DMA item size following
+static void test_profile_wide_frames(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    static const spi_profile_t wide = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 16 };
+    static const spi_profile_t narrow = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 8 };
+    spi_set_profile(BUS, SS_A, &wide, &err);
+    spi_set_profile(BUS, SS_B, &narrow, &err);
+
+    _Alignas(4) uint8_t src[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    _Alignas(4) uint8_t dst[8] = { 0 };
+    assert_check(transfer(SS_A, src, dst, 8), "16-bit transfer");
+    assert_check((sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 4, "TSIZE counts frames");
+    assert_check(sim_dma[DMA1][DMA_STREAM_0].config.dest_data_size == DMA_DATA_SIZE_HALFWORD &&
+                 sim_dma[DMA1][DMA_STREAM_1].config.src_data_size == DMA_DATA_SIZE_HALFWORD,
+                 "streams moved to halfword items");
+    assert_check(memcmp(src, dst, 8) == 0, "data intact");
+
+    spi_transfer_async(BUS, SS_A, src, dst, 7, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG && !spi_async_busy(BUS), "odd length rejected for 16-bit frames");
+
+    assert_check(transfer(SS_B, src, dst, 7), "8-bit transfer after 16-bit");
+    assert_check(sim_dma[DMA1][DMA_STREAM_1].config.src_data_size == DMA_DATA_SIZE_BYTE, "streams back to bytes");
+}
+
+// SPI_MAX_PROFILES chip selects per instance, and re-setting one replaces it in place
+static void test_profile_capacity(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    static const spi_profile_t p = { .max_clock_hz = 1000000, .mode = MODE_0, .word_bits = 8 };
+    int ok = 1;
+    for (uint8_t i = 0; i < SPI_MAX_PROFILES; ++i) {
+        spi_set_profile(BUS, (uint8_t)(100 + i), &p, &err);
+        ok &= err == TI_ERRC_NONE;
+    }
+    assert_check(ok, "SPI_MAX_PROFILES profiles fit");
+    spi_set_profile(BUS, 100, &p, &err);
+    assert_check(err == TI_ERRC_NONE, "replacing an existing profile needs no slot");
+    spi_set_profile(BUS, 99, &p, &err);
+    assert_check(err == TI_ERRC_OVERFLOW, "one more chip select overflows");
+    spi_set_profile(BUS, 105, NULL, &err);
+    spi_set_profile(BUS, 99, &p, &err);
+    assert_check(err == TI_ERRC_NONE, "removing a profile frees its slot");
+}
+
+// bus time for one sweep of the sensor bus. "one config" runs every device at the slowest
+// device's clock, the best a single per-bus setting could do; spi_init's fixed MBR = 0b111 is
+// kernel / 256. Byte counts are what each driver reads per sample.
+typedef struct { const char* name; uint8_t ss_pin; spi_profile_t profile; uint16_t bytes; } sweep_dev_t;
+
+static const sweep_dev_t sweep[] = {
+    { "imu1",  40, { 24000000, MODE_0, 8 }, 15 },  // ICM-45686: accel + gyro + temp burst
+    { "imu2",  41, { 24000000, MODE_0, 8 }, 15 },
+    { "baro1", 42, { 20000000, MODE_0, 8 }, 4 },   // MS5611: ADC read
+    { "baro2", 43, { 20000000, MODE_0, 8 }, 4 },
+    { "mag",   44, { 10000000, MODE_0, 8 }, 8 },   // MMC5983MA: XYZ burst
+    { "temp1", 45, { 10000000, MODE_0, 8 }, 3 },
+    { "temp2", 46, { 10000000, MODE_0, 8 }, 3 },
+    { "adc",   47, { 10000000, MODE_1, 8 }, 4 },   // ADS124S08: RDATA + 3 bytes
+};
+#define SWEEP_DEVS ((int)(sizeof(sweep) / sizeof(sweep[0])))
+#define SWEEPS 100
+
+static uint64_t run_sweeps(bool per_device, uint32_t common_hz) {
+    sim_spi_bus_ns[BUS] = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_profile_t profiles[SWEEP_DEVS];
+    for (int d = 0; d < SWEEP_DEVS; ++d) {
+        profiles[d] = sweep[d].profile;
+        if (!per_device) profiles[d].max_clock_hz = common_hz;
+        spi_set_profile(BUS, sweep[d].ss_pin, &profiles[d], &err);
+    }
+    bool ok = true;
+    for (int s = 0; s < SWEEPS; ++s) {
+        for (int d = 0; d < SWEEP_DEVS; ++d) ok &= transfer(sweep[d].ss_pin, NULL, NULL, sweep[d].bytes);
+    }
+    return ok ? sim_spi_bus_ns[BUS] / SWEEPS : 0;
+}
+
+static void test_bench_sweep_bus_time(void) {
+    setup();
+    uint32_t slowest = sweep[0].profile.max_clock_hz;
+    for (int d = 1; d < SWEEP_DEVS; ++d) {
+        if (sweep[d].profile.max_clock_hz < slowest) slowest = sweep[d].profile.max_clock_hz;
+    }
+    const uint64_t fixed_ns = run_sweeps(false, SPI_MIN_CLOCK_HZ);
+    const uint64_t common_ns = run_sweeps(false, slowest);
+    const uint64_t profiled_ns = run_sweeps(true, 0);
+    log_printf("      bus time per sweep: spi_init config %llu ns, one config %llu ns, per-device %llu ns\n",
+               (unsigned long long)fixed_ns, (unsigned long long)common_ns, (unsigned long long)profiled_ns);
+
+    assert_check(fixed_ns && common_ns && profiled_ns, "all sweeps ran");
+    assert_check(profiled_ns < common_ns && common_ns < fixed_ns, "per-device profiles shorten the sweep");
+    // IMUs and barometers move from 8 MHz to 16 MHz, so their share of the sweep halves
+    uint64_t fast_bits = 0, slow_bits = 0;
+    for (int d = 0; d < SWEEP_DEVS; ++d) {
+        if (sweep[d].profile.max_clock_hz >= 16000000) fast_bits += sweep[d].bytes * 8ULL;
+        else slow_bits += sweep[d].bytes * 8ULL;
+    }
+    assert_check(profiled_ns == fast_bits * 1000 / 16 + slow_bits * 1000 / 8, "sweep time matches the profiled clocks");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_profile_validation),
+        TEST_CASE(test_profile_lazy_apply),
+        TEST_CASE(test_profile_wide_frames),
+        TEST_CASE(test_profile_capacity),
+        TEST_CASE(test_bench_sweep_bus_time),
+    };
+
+    return run_test_suite("spi profile tests", "spiprofiletest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
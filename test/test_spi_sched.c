@@ -0,0 +1,375 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi_sched.h"
+
+// Per-bus SPI scheduler against the simulated SPI/DMA backend in test/sim. Time comes from a fake
+// clock the tests advance by each device's synthetic transaction latency, so deadlines,
+// utilisation and wait times are deterministic.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+static uint64_t fake_now = 0;
+uint64_t deadline_ticks(void) { return fake_now; }
+
+#define US(x) ((uint64_t)(x) * DEADLINE_TICKS_PER_US)
+
+#define BUS 3
+
+// sensor bus devices, with a setup cost plus per-byte cost standing in for each part's timing
+typedef struct {
+    spi_device_t dev;
+    uint32_t setup_us;
+    uint32_t byte_us;
+} sim_device_t;
+
+enum { IMU, TEMP, BARO, DEV_COUNT };
+static const sim_device_t devices[DEV_COUNT] = {
+    [IMU]  = { { BUS, 40 }, 2, 1 },
+    [TEMP] = { { BUS, 41 }, 10, 4 },
+    [BARO] = { { BUS, 42 }, 5, 2 },
+};
+
+// order in which callbacks ran, by job tag
+static int done_order[64];
+static bool done_success[64];
+static int done_count;
+
+// SS pin seen per byte while clocking, to check chip select follows the job
+static uint8_t byte_ss[256];
+static int byte_count;
+
+static void on_done(bool success, void* ctx) {
+    done_success[done_count] = success;
+    done_order[done_count++] = (int)(intptr_t)ctx;
+}
+
+static uint8_t record_device(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ctx;
+    if (byte_count < (int)sizeof(byte_ss)) byte_ss[byte_count++] = ss_pin;
+    return (uint8_t)(mosi ^ ss_pin);
+}
+
+static void setup(void) {
+    spi_dma_sim_setup(BUS);
+    fake_now = 0;
+    done_count = 0;
+    byte_count = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_sched_init(BUS, &err);
+    if (err != TI_ERRC_NONE) { fprintf(stderr, "[ERROR] spi_sched_init failed\n"); exit(1); }
+    sim_spi_attach(BUS, record_device, NULL);
+}
+
+static const sim_device_t* selected_device(void) {
+    for (int d = 0; d < DEV_COUNT; ++d) {
+        if (sim_pin_level[devices[d].dev.ss_pin] == 0) return &devices[d];
+    }
+    return NULL;
+}
+
+// lets the running job take its synthetic latency, then completes it
+static bool finish_running(void) {
+    const sim_device_t* d = selected_device();
+    if (!spi_async_busy(BUS) || d == NULL) return false;
+    const uint32_t len = sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk;
+    fake_now += US(d->setup_us + d->byte_us * len);
+    return sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+}
+
+static void drain(void) {
+    while (finish_running()) {}
+}
+
+static void make_job(spi_job_t* job, int dev, const void* src, void* dst, uint16_t len,
+                     uint8_t priority, int tag) {
+    *job = (spi_job_t){ .dev = &devices[dev].dev, .src = src, .dst = dst, .len = len,
+                        .priority = priority, .callback = on_done, .ctx = (void*)(intptr_t)tag };
+}
+
+// an idle bus starts a job straight away and chains the rest from the completion interrupt,
+// with chip select following each job
+static void test_sched_chains_jobs(void) {
+    setup();
+    uint8_t src[3][4] = { {1, 2, 3, 4}, {5, 6, 7, 8}, {9, 10, 11, 12} };
+    uint8_t dst[3][4];
+    spi_job_t jobs[3];
+    const int dev[3] = { IMU, BARO, TEMP };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (int i = 0; i < 3; ++i) {
+        make_job(&jobs[i], dev[i], src[i], dst[i], 4, 1, i);
+        spi_sched_submit(&jobs[i], &err);
+        assert_check(err == TI_ERRC_NONE, "job submitted");
+    }
+    assert_check(jobs[0].state == SPI_JOB_RUNNING && spi_async_busy(BUS), "first job started on submit");
+    assert_check(jobs[1].state == SPI_JOB_QUEUED && jobs[2].state == SPI_JOB_QUEUED, "others queued");
+
+    assert_check(finish_running(), "first job clocked");
+    assert_check(jobs[0].state == SPI_JOB_DONE && jobs[1].state == SPI_JOB_RUNNING,
+                 "next job started from the completion interrupt");
+    drain();
+
+    assert_check(done_count == 3 && done_order[0] == 0 && done_order[1] == 1 && done_order[2] == 2,
+                 "equal priorities run in submit order");
+    int cs_ok = byte_count == 12;
+    for (int i = 0; i < 12 && cs_ok; ++i) cs_ok = byte_ss[i] == devices[dev[i / 4]].dev.ss_pin;
+    assert_check(cs_ok, "each job's bytes clocked with its own chip select");
+    int data_ok = 1;
+    for (int i = 0; i < 3; ++i) {
+        for (int b = 0; b < 4; ++b) data_ok &= dst[i][b] == (uint8_t)(src[i][b] ^ devices[dev[i]].dev.ss_pin);
+    }
+    assert_check(data_ok, "each job's receive buffer filled");
+    for (int d = 0; d < DEV_COUNT; ++d) {
+        assert_check(sim_pin_level[devices[d].dev.ss_pin] == 1, "chip select released");
+    }
+}
+
+// a high priority job jumps every queued lower priority job, but doesn't interrupt the running one
+static void test_sched_priority_preempts_queue(void) {
+    setup();
+    uint8_t buf[5][8];
+    spi_job_t temp[3], imu;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (int i = 0; i < 3; ++i) {
+        make_job(&temp[i], TEMP, NULL, buf[i], 8, 1, 10 + i);
+        spi_sched_submit(&temp[i], &err);
+    }
+    make_job(&imu, IMU, NULL, buf[4], 8, 5, 1);
+    spi_sched_submit(&imu, &err);
+    assert_check(temp[0].state == SPI_JOB_RUNNING && imu.state == SPI_JOB_QUEUED,
+                 "running job keeps the bus");
+
+    drain();
+    assert_check(done_count == 4, "all jobs ran");
+    assert_check(done_order[0] == 10 && done_order[1] == 1 && done_order[2] == 11 && done_order[3] == 12,
+                 "IMU read runs right after the running temperature read");
+}
+
+// among equal priorities the earliest deadline goes first; jobs without one go last
+static void test_sched_deadline_order(void) {
+    setup();
+    uint8_t buf[4][2];
+    spi_job_t blocker, late, early, none;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    make_job(&blocker, BARO, NULL, buf[0], 2, 1, 0);
+    make_job(&none, BARO, NULL, buf[1], 2, 1, 3);
+    make_job(&late, BARO, NULL, buf[2], 2, 1, 2);
+    make_job(&early, BARO, NULL, buf[3], 2, 1, 1);
+    late.has_deadline = true;
+    late.deadline = (deadline_t){ .expires = US(1000) };
+    early.has_deadline = true;
+    early.deadline = (deadline_t){ .expires = US(500) };
+    spi_sched_submit(&blocker, &err);
+    spi_sched_submit(&none, &err);
+    spi_sched_submit(&late, &err);
+    spi_sched_submit(&early, &err);
+    drain();
+    assert_check(done_count == 4 && done_order[1] == 1 && done_order[2] == 2 && done_order[3] == 3,
+                 "earliest deadline first, then no deadline");
+}
+
+// a job whose deadline passes while it waits is dropped with a failed callback
+static void test_sched_deadline_expiry(void) {
+    setup();
+    uint8_t buf[3][16];
+    spi_job_t slow, stale, fresh;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    make_job(&slow, TEMP, NULL, buf[0], 16, 1, 0);      // 10 + 4 * 16 = 74 us
+    make_job(&stale, IMU, NULL, buf[1], 4, 1, 1);
+    make_job(&fresh, IMU, NULL, buf[2], 4, 1, 2);
+    stale.has_deadline = true;
+    stale.deadline = (deadline_t){ .expires = US(50) };
+    fresh.has_deadline = true;
+    fresh.deadline = (deadline_t){ .expires = US(100) };
+    spi_sched_submit(&slow, &err);
+    spi_sched_submit(&stale, &err);
+    spi_sched_submit(&fresh, &err);
+    drain();
+
+    assert_check(stale.state == SPI_JOB_EXPIRED && fresh.state == SPI_JOB_DONE, "only the late job expired");
+    assert_check(done_count == 3 && done_order[0] == 1 && done_order[1] == 0 && done_order[2] == 2,
+                 "expired job called back once the next job is on the wire");
+    assert_check(!done_success[0] && done_success[1] && done_success[2], "expired job reports failure");
+    assert_check(byte_count == 16 + 4, "expired job never touched the bus");
+
+    spi_sched_stats_t st;
+    spi_sched_get_stats(BUS, &st);
+    assert_check(st.expired == 1 && st.completed == 2 && st.failed == 0, "expiry counted");
+}
+
+// queue depth, high-water mark, wait time and cancel
+static void test_sched_depth_and_cancel(void) {
+    setup();
+    uint8_t buf[5][4];
+    spi_job_t jobs[5];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (int i = 0; i < 5; ++i) {
+        make_job(&jobs[i], BARO, NULL, buf[i], 4, 1, i);
+        spi_sched_submit(&jobs[i], &err);
+    }
+    spi_sched_stats_t st;
+    spi_sched_get_stats(BUS, &st);
+    assert_check(st.queue_depth == 4 && st.max_queue_depth == 4, "depth excludes the running job");
+
+    spi_sched_submit(&jobs[2], &err);
+    assert_check(err == TI_ERRC_BUSY, "resubmitting a queued job rejected");
+    assert_check(!spi_sched_cancel(&jobs[0]), "running job can't be cancelled");
+    assert_check(spi_sched_cancel(&jobs[3]) && jobs[3].state == SPI_JOB_CANCELLED, "queued job cancelled");
+    assert_check(!spi_sched_cancel(&jobs[3]), "second cancel finds nothing");
+
+    drain();
+    spi_sched_get_stats(BUS, &st);
+    assert_check(done_count == 4 && st.completed == 4, "cancelled job never ran or called back");
+    assert_check(st.queue_depth == 0 && st.max_queue_depth == 4, "queue drained, high-water kept");
+    assert_check(st.max_wait == US(3 * (5 + 2 * 4)), "last job waited for the three before it");
+
+    spi_sched_clear_stats(BUS);
+    spi_sched_get_stats(BUS, &st);
+    assert_check(st.max_queue_depth == 0 && st.completed == 0 && st.busy_ticks == 0, "stats cleared");
+
+    spi_sched_submit(&jobs[0], &err);
+    assert_check(err == TI_ERRC_NONE, "finished job can be submitted again");
+    drain();
+}
+
+// bad jobs, unscheduled buses, and a start failure skipping to the next job
+static void test_sched_errors(void) {
+    setup();
+    enum ti_errc_t err = TI_ERRC_NONE;
+    uint8_t buf[2][4];
+    spi_job_t job, next;
+    spi_sched_submit(NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "NULL job rejected");
+    make_job(&job, IMU, NULL, buf[0], 0, 1, 0);
+    spi_sched_submit(&job, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "zero length rejected");
+
+    static const spi_device_t other_bus = { 2, 10 };
+    job = (spi_job_t){ .dev = &other_bus, .dst = buf[0], .len = 4 };
+    spi_sched_submit(&job, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "bus without spi_sched_init rejected");
+    spi_sched_init(0, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "instance 0 rejected");
+
+    sim_dma_fail_start = true;
+    make_job(&job, IMU, NULL, buf[0], 4, 1, 0);
+    spi_sched_submit(&job, &err);
+    assert_check(err == TI_ERRC_NONE && job.state == SPI_JOB_FAILED, "start failure fails the job");
+    assert_check(done_count == 1 && !done_success[0], "failed job called back");
+    sim_dma_fail_start = false;
+
+    make_job(&job, IMU, NULL, buf[0], 4, 1, 1);
+    make_job(&next, BARO, NULL, buf[1], 4, 1, 2);
+    spi_sched_submit(&job, &err);
+    spi_sched_submit(&next, &err);
+    sim_spi_raise(BUS, SPIx_SR_OVR.msk);
+    assert_check(job.state == SPI_JOB_FAILED && next.state == SPI_JOB_RUNNING, "bus error fails the job, next starts");
+    drain();
+    spi_sched_stats_t st;
+    spi_sched_get_stats(BUS, &st);
+    assert_check(next.state == SPI_JOB_DONE && st.failed == 2 && st.completed == 1, "failures counted");
+}
+
+// synthetic sensor sweep: 1 kHz IMU reads with a 1 ms deadline, 200 Hz barometer reads and
+// 20 Hz temperature reads, all on one bus for 100 ms. The slow reads are phased to land just
+// before an IMU read so it has to jump the queue.
+#define SWEEP_MS 100
+
+static void test_sched_sensor_sweep(void) {
+    setup();
+    uint8_t imu_buf[14], baro_buf[6], temp_buf[24];
+    spi_job_t imu, baro, temp;
+    make_job(&imu, IMU, NULL, imu_buf, sizeof(imu_buf), 7, 0);
+    make_job(&baro, BARO, NULL, baro_buf, sizeof(baro_buf), 3, 1);
+    make_job(&temp, TEMP, NULL, temp_buf, sizeof(temp_buf), 1, 2);
+    imu.has_deadline = true;
+
+    uint32_t missed = 0, busy_expected = 0;
+    uint64_t busy_end = 0, imu_worst_wait = 0, imu_submitted_at = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (uint32_t t = 0; t < SWEEP_MS * 1000; ++t) {
+        fake_now = US(t);
+        if (spi_async_busy(BUS) && fake_now >= busy_end) {
+            sim_spi_run(BUS, SIM_RX_DMA_THEN_EOT);
+        }
+        if (t % 1000 == 0) {
+            imu.deadline = deadline_in_us(1000);
+            spi_sched_submit(&imu, &err);
+            if (err != TI_ERRC_NONE) missed++;
+            imu_submitted_at = fake_now;
+        }
+        if (t % 5000 == 990) spi_sched_submit(&baro, &err);
+        if (t % 50000 == 950) spi_sched_submit(&temp, &err);
+
+        if (imu.state == SPI_JOB_RUNNING && imu_submitted_at != UINT64_MAX) {
+            if (fake_now - imu_submitted_at > imu_worst_wait) imu_worst_wait = fake_now - imu_submitted_at;
+            imu_submitted_at = UINT64_MAX;
+        }
+        // a job that just started gets its latency
+        if (spi_async_busy(BUS) && busy_end <= fake_now) {
+            const sim_device_t* d = selected_device();
+            const uint32_t len = sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk;
+            busy_end = fake_now + US(d->setup_us + d->byte_us * len);
+            busy_expected += d->setup_us + d->byte_us * len;
+        }
+    }
+    fake_now = US(SWEEP_MS * 1000);
+
+    spi_sched_stats_t st;
+    spi_sched_get_stats(BUS, &st);
+    const uint32_t temp_us = 10 + 4 * sizeof(temp_buf);
+    log_printf("      %u jobs, utilisation %u%%, IMU worst wait %u us, max depth %u\n",
+               st.completed, st.utilisation_pct, (uint32_t)(imu_worst_wait / DEADLINE_TICKS_PER_US), st.max_queue_depth);
+
+    assert_check(missed == 0 && st.expired == 0 && st.failed == 0, "every IMU read met its deadline");
+    assert_check(st.completed == SWEEP_MS + SWEEP_MS / 5 + SWEEP_MS / 50, "every job ran");
+    assert_check(imu_worst_wait > 0 && imu_worst_wait <= US(temp_us), "IMU waits at most one temperature read");
+    assert_check(st.busy_ticks == US(busy_expected), "busy time matches the device latencies");
+    assert_check(st.utilisation_pct == busy_expected * 100 / (SWEEP_MS * 1000), "utilisation from busy time");
+    assert_check(st.max_queue_depth == 2 && st.queue_depth == 0, "queue depth tracked");
+}
+
+// a stats window longer than the 32-bit cycle counter's ~8.9 s period still adds up, and a
+// deadline further out than half that period isn't mistaken for one already passed
+static void test_sched_long_window(void) {
+    setup();
+    uint8_t buf[2][4];
+    spi_job_t slow, later;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    make_job(&slow, IMU, NULL, buf[0], 4, 1, 0);
+    make_job(&later, BARO, NULL, buf[1], 4, 1, 1);
+    later.has_deadline = true;
+    later.deadline = (deadline_t){ .expires = US(12000000) };
+    spi_sched_submit(&slow, &err);
+    spi_sched_submit(&later, &err);
+
+    fake_now = US(10000000); // the first job holds the bus for 10 s
+    sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+    assert_check(later.state == SPI_JOB_RUNNING, "deadline 12 s out still pending at 10 s");
+    drain();
+
+    fake_now = US(20000000);
+    spi_sched_stats_t st;
+    spi_sched_get_stats(BUS, &st);
+    assert_check(st.window_ticks == US(20000000), "20 s window counted");
+    assert_check(st.busy_ticks == US(10000000 + 5 + 2 * 4), "busy time past 2^32 ticks counted");
+    assert_check(st.max_wait == US(10000000) && st.utilisation_pct == 50, "wait and utilisation over the long window");
+    assert_check(st.completed == 2 && st.expired == 0, "both jobs ran");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_sched_chains_jobs),
+        TEST_CASE(test_sched_priority_preempts_queue),
+        TEST_CASE(test_sched_deadline_order),
+        TEST_CASE(test_sched_deadline_expiry),
+        TEST_CASE(test_sched_depth_and_cancel),
+        TEST_CASE(test_sched_errors),
+        TEST_CASE(test_sched_sensor_sweep),
+        TEST_CASE(test_sched_long_window),
+    };
+
+    return run_test_suite("spi scheduler tests", "spischedtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
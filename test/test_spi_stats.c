@@ -0,0 +1,272 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi.h"
+#include "app/utils/packets.h"
+
+// Per chip select SPI statistics (spi_get_stats and friends) against the simulated SPI/DMA backend
+// in test/sim, with deadline_ticks replaced by a clock the device model advances per byte, so a
+// transfer's latency is its length times cycles_per_byte.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+// packets.c links against these; only build_spi_stats_packet is exercised
+int adc_read_voltage(const struct adc_channel* channel, enum ti_errc_t* errc) { (void)channel; (void)errc; return 0; }
+void alloc_pack_stats(const alloc_stats_t *stats, enum heap_region_t region, uint8_t *buffer, size_t buffer_len,
+                      size_t *packed_len, enum ti_errc_t *errc) {
+    (void)stats; (void)region; (void)buffer; (void)buffer_len; *packed_len = 0; *errc = TI_ERRC_NONE;
+}
+void radio_transmit(radio_t *dev, const uint8_t *data, size_t len, enum ti_errc_t *errc) {
+    (void)dev; (void)data; (void)len; *errc = TI_ERRC_NONE;
+}
+void radio_receive(radio_t *dev, uint8_t *data, size_t max_len, size_t *actual_len, enum ti_errc_t *errc) {
+    (void)dev; (void)data; (void)max_len; *actual_len = 0; *errc = TI_ERRC_NONE;
+}
+
+#define BUS   3
+#define BUS_4 4
+#define SS    40
+#define SS2   41
+
+static uint32_t fake_now;
+static uint32_t cycles_per_byte;
+
+uint64_t deadline_ticks(void) { return fake_now; }
+
+static uint8_t timed_device(uint8_t ss_pin, uint8_t mosi, void* ctx) {
+    (void)ss_pin; (void)ctx;
+    fake_now += cycles_per_byte;
+    return mosi;
+}
+
+static const spi_profile_t byte_profile = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 8 };
+
+static void setup(void) {
+    spi_dma_sim_setup(BUS);
+    fake_now = 0;
+    cycles_per_byte = 100;
+    sim_spi_attach(BUS, timed_device, NULL);
+    sim_spi_attach(BUS_4, timed_device, NULL);
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_profile(BUS, SS, &byte_profile, &err);
+    spi_set_profile(BUS, SS2, &byte_profile, &err);
+    spi_set_profile(BUS_4, SS, &byte_profile, &err);
+    spi_clear_stats();
+}
+
+static int hist_total(const spi_dev_stats_t* st) {
+    uint32_t n = 0;
+    for (int i = 0; i < SPI_STATS_HIST_BINS; ++i) n += st->hist[i];
+    return (int)n;
+}
+
+// blocking transfers are counted against the chip select they drove, with SS-low time as latency
+static void test_sync_per_device(void) {
+    setup();
+    uint8_t buf[16] = {0};
+    enum ti_errc_t err = TI_ERRC_NONE;
+    for (int i = 0; i < 3; ++i) spi_write(BUS, SS, buf, 10, &err);
+    spi_read(BUS, SS2, buf, 4, 0xFF, &err);
+
+    spi_dev_stats_t st;
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.inst == BUS && st.ss_pin == SS, "first device found");
+    assert_check(st.transactions == 3 && st.bytes == 30 && st.errors == 0, "transactions and bytes counted");
+    assert_check(st.busy_cycles == 3000 && st.max_cycles == 1000, "busy time is SS-low time");
+    assert_check(st.hist[0] == 3 && hist_total(&st) == 3, "each transfer lands in one bin");
+
+    spi_get_device_stats(BUS, SS2, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.transactions == 1 && st.bytes == 4 && st.busy_cycles == 400,
+                 "second device counted separately");
+
+    const spi_iov_t iov[2] = { { .tx = buf, .rx = NULL, .len = 2 }, { .tx = NULL, .rx = buf, .len = 6 } };
+    spi_transfer_iov(BUS, SS2, iov, 2, 0xFF, &err);
+    spi_get_device_stats(BUS, SS2, &st, &err);
+    assert_check(st.transactions == 2 && st.bytes == 12, "an iov transfer is one transaction");
+
+    spi_write(BUS, SS, buf, 0, &err);
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(st.transactions == 3, "rejected transfers are not counted");
+}
+
+// packed FIFO mode transfers are counted the same way
+static void test_sync_packed(void) {
+    setup();
+    uint8_t buf[15] = {0};
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_packed(BUS, true, &err);
+    spi_read(BUS, SS, buf, sizeof(buf), 0xFF, &err);
+    spi_read(BUS, SS, buf, sizeof(buf), 0xFF, &err);
+    spi_set_packed(BUS, false, &err);
+
+    spi_dev_stats_t st;
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(st.transactions == 2 && st.bytes == 30 && st.busy_cycles == 3000, "packed reads counted");
+}
+
+// async transfers are timed from SS low to completion; failures count as errors without bytes
+static void test_async(void) {
+    setup();
+    uint8_t src[32] = {0}, dst[32];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_async(BUS, SS, src, dst, sizeof(src), NULL, NULL, &err);
+    fake_now += 500; // interrupt latency before the completion is handled
+    sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+
+    spi_dev_stats_t st;
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(st.transactions == 1 && st.bytes == 32 && st.errors == 0, "async transfer counted");
+    assert_check(st.busy_cycles == 3200 + 500 && st.max_cycles == 3700, "async time runs until completion");
+
+    spi_transfer_async(BUS, SS, src, dst, sizeof(src), NULL, NULL, &err);
+    fake_now += 50;
+    sim_spi_raise(BUS, SPIx_SR_OVR.msk);
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(st.transactions == 2 && st.errors == 1 && st.bytes == 32, "failed transfer counted as an error");
+    assert_check(st.busy_cycles == 3700 + 50, "failed transfer's time still counted");
+}
+
+// bins are log2 of the latency, 2^10 cycles and under in bin 0 and 2^22 and over in the last
+static void test_histogram_bins(void) {
+    setup();
+    static const struct { uint32_t cycles; int bin; } cases[] = {
+        { 1, 0 }, { 1023, 0 }, { 1024, 1 }, { 2047, 1 }, { 2048, 2 }, { 480000, 9 },
+        { (1U << 22) - 1, 12 }, { 1U << 22, 13 }, { 1U << 30, 13 },
+    };
+    const int n = (int)(sizeof(cases) / sizeof(cases[0]));
+    uint8_t b = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_dev_stats_t st;
+    int ok = 1;
+    for (int i = 0; i < n; ++i) {
+        spi_clear_stats();
+        cycles_per_byte = cases[i].cycles;
+        spi_read(BUS, SS, &b, 1, 0xFF, &err);
+        spi_get_device_stats(BUS, SS, &st, &err);
+        ok &= st.hist[cases[i].bin] == 1 && hist_total(&st) == 1;
+    }
+    assert_check(ok, "latencies land in their log2 bins");
+
+    spi_clear_stats();
+    fake_now = 0xFFFFFF00U;
+    cycles_per_byte = 0x200;
+    spi_read(BUS, SS, &b, 1, 0xFF, &err);
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(st.busy_cycles == 0x200 && st.hist[0] == 1, "clock wrap mid-transfer handled");
+}
+
+// bus totals sum its devices only; lookups of unknown devices fail cleanly
+static void test_bus_totals_and_lookup(void) {
+    setup();
+    uint8_t buf[8] = {0};
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_write(BUS, SS, buf, 8, &err);
+    cycles_per_byte = 300;
+    spi_write(BUS, SS2, buf, 4, &err);
+    spi_write(BUS_4, SS, buf, 2, &err);
+
+    spi_dev_stats_t st;
+    spi_get_bus_stats(BUS, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.inst == BUS && st.ss_pin == 0xFF, "bus totals tagged with the bus");
+    assert_check(st.transactions == 2 && st.bytes == 12 && st.busy_cycles == 800 + 1200, "bus totals sum its devices");
+    assert_check(st.max_cycles == 1200 && st.hist[1] == 1 && st.hist[0] == 1, "bus max and histogram merged");
+
+    spi_get_bus_stats(BUS_4, &st, &err);
+    assert_check(st.transactions == 1 && st.bytes == 2, "other bus kept apart");
+    spi_get_bus_stats(5, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.transactions == 0, "idle bus reports zero");
+
+    spi_get_device_stats(BUS, 99, &st, &err);
+    assert_check(err == TI_ERRC_NOT_FOUND, "unknown device not found");
+    spi_get_device_stats(0, SS, &st, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "bad instance rejected");
+}
+
+// spi_get_stats lists devices in first-seen order; clearing zeroes counts and keeps them listed
+static void test_list_and_clear(void) {
+    setup();
+    spi_dev_stats_t all[SPI_STATS_MAX_DEVICES];
+    uint8_t b = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    assert_check(spi_get_stats(all, SPI_STATS_MAX_DEVICES) == 0, "nothing listed before any transfer");
+    spi_read(BUS, SS, &b, 1, 0xFF, &err);
+    spi_read(BUS, SS2, &b, 1, 0xFF, &err);
+    spi_read(BUS, SS, &b, 1, 0xFF, &err);
+    spi_read(BUS_4, SS, &b, 1, 0xFF, &err);
+    const uint8_t n = spi_get_stats(all, SPI_STATS_MAX_DEVICES);
+    assert_check(n == 3, "every device seen listed once");
+    assert_check(all[0].inst == BUS && all[0].ss_pin == SS && all[1].ss_pin == SS2 && all[2].inst == BUS_4,
+                 "listed in first-seen order");
+    assert_check(all[0].transactions == 2 && all[1].transactions == 1, "entries carry their counters");
+    assert_check(spi_get_stats(all, 2) == 2 && spi_get_stats(NULL, 4) == 0, "output size respected");
+
+    spi_clear_stats();
+    spi_dev_stats_t st;
+    spi_get_device_stats(BUS, SS, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.transactions == 0 && hist_total(&st) == 0, "clear zeroes the counters");
+    assert_check(spi_get_stats(all, SPI_STATS_MAX_DEVICES) == 3, "clear keeps the devices");
+}
+
+// the packet carries one device's counters big-endian, with time in microseconds
+static void test_packet(void) {
+    spi_dev_stats_t st = {
+        .inst = BUS, .ss_pin = SS, .transactions = 0x01020304, .errors = 70000, .bytes = 0x0A0B0C0D,
+        .busy_cycles = 480ULL * 0x11223344ULL, .max_cycles = 480U * 1000U,
+    };
+    st.hist[0] = 7;
+    st.hist[13] = 0x12345;
+    uint8_t pkt[PACKET_SPI_STATS_SIZE];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    build_spi_stats_packet(&st, 5, 0xCAFEBABE, pkt, sizeof(pkt), &err);
+    assert_check(err == TI_ERRC_NONE && pkt[0] == 0x4A && pkt[8] == PACKET_SPI_STATS_TYPE, "header and type");
+    assert_check(pkt[9] == 5 && pkt[10] == BUS && pkt[11] == SS, "device count and identity");
+    assert_check(pkt[12] == 0xCA && pkt[15] == 0xBE && pkt[16] == 0x01 && pkt[19] == 0x04, "time and transactions");
+    assert_check(pkt[20] == 0xFF && pkt[21] == 0xFF && pkt[22] == 0x0A && pkt[25] == 0x0D, "errors saturate, bytes");
+    assert_check(pkt[26] == 0x11 && pkt[29] == 0x44 && pkt[32] == 0x03 && pkt[33] == 0xE8, "busy and max in us");
+    assert_check(pkt[34] == 0 && pkt[35] == 7 && pkt[60] == 0xFF && pkt[61] == 0xFF, "histogram bins saturate");
+
+    build_spi_stats_packet(&st, 5, 0, pkt, sizeof(pkt) - 1, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "short buffer rejected");
+}
+
+// once the table is full new devices go unrecorded and the known ones keep counting
+static void test_table_full(void) {
+    setup();
+    uint8_t b = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_dev_stats_t all[SPI_STATS_MAX_DEVICES];
+    spi_read(BUS_4, SS, &b, 1, 0xFF, &err);
+    uint8_t pin = 100; // profiles dropped after use, as an instance only holds SPI_MAX_PROFILES
+    while (spi_get_stats(all, SPI_STATS_MAX_DEVICES) < SPI_STATS_MAX_DEVICES) {
+        spi_set_profile(BUS_4, pin, &byte_profile, &err);
+        spi_read(BUS_4, pin, &b, 1, 0xFF, &err);
+        spi_set_profile(BUS_4, pin++, NULL, &err);
+    }
+    spi_set_profile(BUS_4, pin, &byte_profile, &err);
+    spi_read(BUS_4, pin, &b, 1, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE, "transfers still run with the table full");
+
+    spi_dev_stats_t st;
+    spi_get_device_stats(BUS_4, pin, &st, &err);
+    assert_check(err == TI_ERRC_NOT_FOUND, "device past the table not recorded");
+    spi_read(BUS_4, SS, &b, 1, 0xFF, &err);
+    spi_get_device_stats(BUS_4, SS, &st, &err);
+    assert_check(err == TI_ERRC_NONE && st.transactions == 2, "known devices keep counting");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_sync_per_device),
+        TEST_CASE(test_sync_packed),
+        TEST_CASE(test_async),
+        TEST_CASE(test_histogram_bins),
+        TEST_CASE(test_bus_totals_and_lookup),
+        TEST_CASE(test_list_and_clear),
+        TEST_CASE(test_packet),
+        TEST_CASE(test_table_full),
+    };
+
+    return run_test_suite("SPI statistics tests", "spistatstest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
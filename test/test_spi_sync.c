@@ -0,0 +1,169 @@
+#include "host_test.h"
+#include "sim/spi_dma_sim.h"
+#include "peripheral/spi.h"
+
+// Blocking spi_write / spi_read / spi_transfer_iov against the polled SPI model in test/sim. Its
+// logging device records every byte it sees on MOSI, so each test checks the exact byte stream
+// and chip select framing the flight hardware would get.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define BUS 2
+#define SS  30
+
+static void setup(void) {
+    spi_dma_sim_log_setup(BUS);
+}
+
+static int bytes_are(const uint8_t* got, uint32_t n, uint8_t value) {
+    for (uint32_t i = 0; i < n; ++i) if (got[i] != value) return 0;
+    return 1;
+}
+
+// spi_write puts exactly the source bytes on the wire under one chip select
+static void test_write_stream(void) {
+    setup();
+    uint8_t src[300];
+    for (int i = 0; i < 300; ++i) src[i] = (uint8_t)(i ^ 0x5A);
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_write(BUS, SS, src, sizeof(src), &err);
+    assert_check(err == TI_ERRC_NONE, "300-byte write accepted");
+    assert_check(sim_mosi_log_len == 300 && memcmp(sim_mosi_log, src, 300) == 0, "device saw the source bytes");
+    assert_check(sim_pin_falls[SS] == 1 && sim_pin_level[SS] == 1, "one chip select assertion, released after");
+    assert_check(!(sim_spi[BUS].sr & (SPIx_SR_OVR.msk | SPIx_SR_UDR.msk)), "no overrun or underrun");
+}
+
+// spi_read clocks out the fill byte and keeps what the device answers
+static void test_read_fill(void) {
+    setup();
+    static uint8_t dst[1000];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_read(BUS, SS, dst, sizeof(dst), 0x00, &err);
+    assert_check(err == TI_ERRC_NONE, "1000-byte read accepted");
+    assert_check(sim_mosi_log_len == 1000 && bytes_are(sim_mosi_log, 1000, 0x00), "fill byte 0x00 on MOSI");
+    int ok = 1;
+    for (uint32_t i = 0; i < 1000; ++i) ok &= dst[i] == (uint8_t)(i * 3 + 1);
+    assert_check(ok, "device answers landed in order");
+
+    sim_mosi_log_len = 0;
+    spi_read(BUS, SS, dst, 4, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && bytes_are(sim_mosi_log, 4, 0xFF), "fill byte 0xFF on MOSI");
+    assert_check(sim_pin_falls[SS] == 2, "one assertion per call");
+}
+
+// several pieces go out back to back under one assertion, each received byte landing in its piece
+static void test_iov_header_payload_read(void) {
+    setup();
+    const uint8_t header[3] = { 0x66, 0x01, 0x02 };
+    uint8_t payload[400];
+    for (int i = 0; i < 400; ++i) payload[i] = (uint8_t)i;
+    uint8_t status[2] = { 0 }, reply[5] = { 0 };
+    const spi_iov_t iov[4] = {
+        { .tx = header, .rx = status, .len = 2 },
+        { .tx = header + 2, .len = 1 },
+        { .tx = payload, .len = sizeof(payload) },
+        { .rx = reply, .len = sizeof(reply) },
+    };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_iov(BUS, SS, iov, 4, 0xA5, &err);
+    assert_check(err == TI_ERRC_NONE, "iov transfer accepted");
+    assert_check((sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 408, "TSIZE covers every piece");
+    assert_check(sim_mosi_log_len == 408 && sim_pin_falls[SS] == 1, "one assertion for the whole transfer");
+    assert_check(memcmp(sim_mosi_log, header, 3) == 0 && memcmp(sim_mosi_log + 3, payload, 400) == 0,
+                 "header then payload on MOSI, no gaps");
+    assert_check(bytes_are(sim_mosi_log + 403, 5, 0xA5), "fill byte for the read piece");
+    assert_check(status[0] == 1 && status[1] == 4, "first piece's answers in its rx buffer");
+    int ok = 1;
+    for (uint32_t i = 0; i < 5; ++i) ok &= reply[i] == (uint8_t)((403 + i) * 3 + 1);
+    assert_check(ok, "read piece got the bytes clocked under it");
+}
+
+// the longest transfer TSIZE can express, and lengths it can't
+static void test_length_limits(void) {
+    setup();
+    static uint8_t big[0xFFFF];
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_read(BUS, SS, big, 0xFFFF, 0xFF, &err);
+    assert_check(err == TI_ERRC_NONE && sim_mosi_log_len == 0xFFFF, "65535-byte read");
+
+    const spi_iov_t too_long[2] = { { .rx = big, .len = 0xFFFF }, { .rx = big, .len = 1 } };
+    spi_transfer_iov(BUS, SS, too_long, 2, 0xFF, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "pieces over 65535 bytes in total rejected");
+    const spi_iov_t empty[2] = { { .rx = big, .len = 0 }, { .tx = big, .len = 0 } };
+    spi_transfer_iov(BUS, SS, empty, 2, 0xFF, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "empty transfer rejected");
+    spi_transfer_iov(BUS, SS, NULL, 1, 0xFF, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "NULL iov rejected");
+    spi_write(BUS, SS, NULL, 4, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "spi_write needs a source");
+    spi_read(BUS, SS, NULL, 4, 0xFF, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "spi_read needs a destination");
+    spi_write(7, SS, big, 4, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "bad instance rejected");
+    assert_check(sim_pin_falls[SS] == 1, "rejected calls never touch chip select");
+}
+
+// spi_transfer_sync keeps working, and now tolerates a NULL dst (temperature.c writes that way)
+static void test_transfer_sync_compat(void) {
+    setup();
+    uint8_t tx[3] = { 0x01, 0x02, 0x03 }, rx[3] = { 0 };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_transfer_sync(BUS, SS, tx, rx, 3, &err);
+    assert_check(err == TI_ERRC_NONE && memcmp(sim_mosi_log, tx, 3) == 0, "full-duplex bytes on MOSI");
+    assert_check(rx[0] == 1 && rx[1] == 4 && rx[2] == 7, "answers in rx");
+    spi_transfer_sync(BUS, SS, tx, NULL, 3, &err);
+    assert_check(err == TI_ERRC_NONE && sim_mosi_log_len == 6, "NULL dst discards");
+}
+
+// with 16-bit frames each piece moves as halfwords and the fill byte fills both halves
+static void test_iov_wide_frames(void) {
+    setup();
+    static const spi_profile_t wide = { .max_clock_hz = 8000000, .mode = MODE_0, .word_bits = 16 };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_set_profile(BUS, SS, &wide, &err);
+    _Alignas(2) const uint8_t cmd[2] = { 0x12, 0x34 };
+    _Alignas(2) uint8_t rx[4] = { 0 };
+    const spi_iov_t iov[2] = { { .tx = cmd, .len = 2 }, { .rx = rx, .len = 4 } };
+    spi_transfer_iov(BUS, SS, iov, 2, 0x00, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_spi[BUS].cr2 & SPIx_CR2_TSIZE.msk) == 3, "three 16-bit frames");
+    assert_check(sim_mosi_log_len == 6 && sim_mosi_log[0] == 0x12 && sim_mosi_log[1] == 0x34 && bytes_are(sim_mosi_log + 2, 4, 0x00),
+                 "command then fill on MOSI");
+    assert_check(rx[0] == 7 && rx[3] == 16, "reply bytes in order");
+
+    const spi_iov_t odd[1] = { { .tx = cmd, .len = 1 } };
+    spi_transfer_iov(BUS, SS, odd, 1, 0x00, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "half a frame rejected");
+}
+
+// a DMA transfer in flight owns the bus
+static void test_busy_with_async(void) {
+    setup();
+    periph_dma_config_t tx_cfg = { .instance = DMA1, .stream = DMA_STREAM_2 };
+    periph_dma_config_t rx_cfg = { .instance = DMA1, .stream = DMA_STREAM_3 };
+    enum ti_errc_t err = TI_ERRC_NONE;
+    spi_dma_init(BUS, &tx_cfg, &rx_cfg, &err);
+    spi_transfer_async(BUS, SS, NULL, NULL, 8, NULL, NULL, &err);
+    uint8_t b = 0;
+    spi_write(BUS, SS, &b, 1, &err);
+    assert_check(err == TI_ERRC_BUSY, "blocking write refused during async transfer");
+    sim_spi_run(BUS, SIM_EOT_THEN_RX_DMA);
+    spi_write(BUS, SS, &b, 1, &err);
+    assert_check(err == TI_ERRC_NONE && sim_mosi_log_len == 9, "allowed once it completes");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_write_stream),
+        TEST_CASE(test_read_fill),
+        TEST_CASE(test_iov_header_payload_read),
+        TEST_CASE(test_length_limits),
+        TEST_CASE(test_transfer_sync_compat),
+        TEST_CASE(test_iov_wide_frames),
+        TEST_CASE(test_busy_with_async),
+    };
+
+    return run_test_suite("spi blocking transfer tests", "spisynctest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
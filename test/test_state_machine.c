@@ -0,0 +1,240 @@
+#include "host_test.h"
+
+#include "app/state_machine.h"
+#include "app/utils/extern_flash.h"
+#include "app/utils/packets.h"
+#include "app/utils/sensor_status.h"
+#include "app/utils/state_comm.h"
+#include "peripheral/errc.h"
+
+// Host test for the state lifecycle: links the real state machine and state implementations
+// against counting stubs for every driver, then runs simulated control ticks.
+
+#define SIM_TICKS 1000
+
+#define STANDBY_IDX 1
+#define FILL_IDX 2
+#define HOLD_IDX 3
+#define ARMED_IDX 4
+#define FIRE_IDX 5
+#define SAFE_IDX 6
+
+// driver init call counters
+static int radio_init_calls = 0;
+static int imu_init_calls = 0;
+static int spi_set_profile_calls = 0;
+static int gnss_init_calls = 0;
+static int barometer_init_calls = 0;
+static int temperature_init_calls = 0;
+static int magnetometer_init_calls = 0;
+static int adc_init_calls = 0;
+static int qspi_init_calls = 0;
+static int log_state_calls = 0;
+static int log_service_calls = 0;
+static enum ti_errc_t dma_init_errc = TI_ERRC_NONE;
+static const char* logged_msgs[16];
+static int logged_count = 0;
+
+// next set-mode command delivered over the (stubbed) uplink, or -1 for none
+static int pending_mode = -1;
+static uint8_t pending_mode_arg = 0;
+
+/**************************************************************************************************
+ * @section Driver stubs
+ **************************************************************************************************/
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)func; (void)file; (void)line;
+    if (logged_count < 16) logged_msgs[logged_count++] = msg;
+}
+enum ti_errc_t ti_log_init(void) { return TI_ERRC_NONE; }
+
+void radio_init(radio_t *dev, const radio_spi_dev *spi_config, const radio_config_t *config, enum ti_errc_t *errc) {
+    (void)dev; (void)spi_config; (void)config;
+    radio_init_calls++;
+    *errc = TI_ERRC_NONE;
+}
+enum ti_errc_t imu_init(struct imu_spi_dev* dev) { (void)dev; imu_init_calls++; return TI_ERRC_NONE; }
+void spi_set_profile(uint8_t inst, uint8_t ss_pin, const spi_profile_t *profile, enum ti_errc_t *errc) {
+    (void)inst; (void)ss_pin; (void)profile; spi_set_profile_calls++; *errc = TI_ERRC_NONE;
+}
+void gnss_init(gnss_t *dev, enum ti_errc_t *errc) { (void)dev; gnss_init_calls++; *errc = TI_ERRC_NONE; }
+void barometer_init(barometer_t *dev, enum ti_errc_t *errc) { (void)dev; barometer_init_calls++; *errc = TI_ERRC_NONE; }
+void temperature_init(temperature_t *dev, enum ti_errc_t *errc) { (void)dev; temperature_init_calls++; *errc = TI_ERRC_NONE; }
+enum ti_errc_t magnetometer_init(struct magnetometer_spi_dev* dev) { (void)dev; magnetometer_init_calls++; return TI_ERRC_NONE; }
+void adc_init(struct adc_spi_dev* device, enum ti_errc_t* errc) { (void)device; adc_init_calls++; *errc = TI_ERRC_NONE; }
+void qspi_init() { qspi_init_calls++; }
+void qspi_enable_quad(enum ti_errc_t *errc) { *errc = TI_ERRC_NONE; }
+bool qspi_memory_mapped(void) { return false; }
+void* dma_init(enum ti_errc_t *errc) { *errc = dma_init_errc; return NULL; }
+
+void log_state(enum states_t state, enum ti_errc_t* errc) { (void)state; log_state_calls++; *errc = TI_ERRC_NONE; }
+void log_service(enum ti_errc_t* errc) { log_service_calls++; *errc = TI_ERRC_NONE; }
+bool check_saved_state() { return false; }
+bool extern_flash_recover(enum ti_errc_t* errc) { *errc = TI_ERRC_NONE; return false; }
+enum states_t get_prev_state(enum ti_errc_t* errc) { *errc = TI_ERRC_NONE; return INIT_STATE; }
+
+void tal_set_mode(int pin, int mode) { (void)pin; (void)mode; }
+void tal_set_pin(int pin, int value) { (void)pin; (void)value; }
+void systick_delay(uint32_t delay) { (void)delay; }
+
+void sensor_status_init(sensor_status_t *status) { memset(status, 0, sizeof(*status)); }
+bool sensor_status_all_done(const sensor_status_t *status) { (void)status; return true; }
+bool sensor_status_has_error(const sensor_status_t *status) { (void)status; return false; }
+
+void gnss_start_read(gnss_t *dev, gnss_pvt_t *result, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; memset(result, 0, sizeof(*result)); *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+void imu_start_read(struct imu_spi_dev *dev, struct imu_result *result, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; memset(result, 0, sizeof(*result)); *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+void barometer_start_read(barometer_t *dev, barometer_result_t *result, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; memset(result, 0, sizeof(*result)); *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+void temperature_start_read(temperature_t *dev, temperature_result_t *result, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; memset(result, 0, sizeof(*result)); *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+void magnetometer_start_read(struct magnetometer_spi_dev *dev, struct magnetometer_result_t *result, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; memset(result, 0, sizeof(*result)); *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+void adc_start_read(struct adc_spi_dev *dev, const struct adc_channel *channels, uint8_t channel_count, bool *done_flag, bool *error_flag, enum ti_errc_t *errc) {
+    (void)dev; (void)channels; (void)channel_count; *done_flag = true; *error_flag = false; *errc = TI_ERRC_NONE;
+}
+
+void build_gnss_packet(const gnss_pvt_t *pvt, uint8_t *buffer, size_t buffer_len, enum ti_errc_t *errc) {
+    (void)pvt; (void)buffer; (void)buffer_len; *errc = TI_ERRC_NONE;
+}
+void build_sensor_packet(const struct imu_result *imu1, const struct imu_result *imu2,
+                         const barometer_result_t *baro1, const barometer_result_t *baro2,
+                         const struct magnetometer_result_t *mag1, const struct magnetometer_result_t *mag2,
+                         const temperature_result_t *temp1, const temperature_result_t *temp2,
+                         uint8_t *buffer, size_t buffer_len, enum ti_errc_t *errc) {
+    (void)imu1; (void)imu2; (void)baro1; (void)baro2; (void)mag1; (void)mag2; (void)temp1; (void)temp2;
+    (void)buffer; (void)buffer_len; *errc = TI_ERRC_NONE;
+}
+void build_adc_packet(const struct adc_channel *channels, uint8_t channel_count, uint8_t packet_index,
+                      uint8_t *buffer, size_t buffer_len, enum ti_errc_t *errc) {
+    (void)channels; (void)channel_count; (void)packet_index; (void)buffer; (void)buffer_len; *errc = TI_ERRC_NONE;
+}
+void build_state_packet(const uint8_t *valves, uint16_t valve_count, const uint16_t *servos, uint16_t servo_count,
+                        uint8_t *buffer, size_t buffer_len, enum ti_errc_t *errc) {
+    (void)valves; (void)valve_count; (void)servos; (void)servo_count; (void)buffer; (void)buffer_len; *errc = TI_ERRC_NONE;
+}
+void build_comm_packet(uint16_t ping_id, uint8_t system_mode, uint32_t processor_time_ms, uint16_t last_command_id,
+                       uint8_t last_command_status, const uint8_t *message_tags, uint8_t message_count,
+                       uint8_t *buffer, size_t buffer_len, size_t *packet_len, enum ti_errc_t *errc) {
+    (void)ping_id; (void)system_mode; (void)processor_time_ms; (void)last_command_id; (void)last_command_status;
+    (void)message_tags; (void)message_count; (void)buffer; (void)buffer_len;
+    *packet_len = 0;
+    *errc = TI_ERRC_NONE;
+}
+void append_comm_heap_stats(const alloc_stats_t *stats, enum heap_region_t region, uint8_t *buffer, size_t buffer_len,
+                            size_t *packet_len, enum ti_errc_t *errc) {
+    (void)stats; (void)region; (void)buffer; (void)buffer_len; (void)packet_len; *errc = TI_ERRC_NONE;
+}
+void alloc_get_stats(alloc_stats_t *stats) { memset(stats, 0, sizeof(*stats)); }
+uint8_t spi_get_stats(spi_dev_stats_t *out, uint8_t max) { (void)out; (void)max; return 0; }
+void build_spi_stats_packet(const spi_dev_stats_t *stats, uint8_t device_count, uint32_t processor_time_ms,
+                            uint8_t *buffer, size_t buffer_len, enum ti_errc_t *errc) {
+    (void)stats; (void)device_count; (void)processor_time_ms; (void)buffer; (void)buffer_len; *errc = TI_ERRC_NONE;
+}
+void send_packet_radio_flash(radio_t *radio, const uint8_t *packet, size_t packet_len, enum ti_errc_t *errc) {
+    (void)radio; (void)packet; (void)packet_len; *errc = TI_ERRC_NONE;
+}
+
+// delivers pending_mode as a valid set-mode command exactly once
+void receive_uplink_comm_packet(radio_t *radio, uint8_t *rx_buffer, size_t rx_buffer_len, comm_packet_t *out, enum ti_errc_t *errc) {
+    (void)radio; (void)rx_buffer; (void)rx_buffer_len;
+    memset(out, 0, sizeof(*out));
+    *errc = TI_ERRC_NONE;
+    if (pending_mode < 0) return;
+
+    pending_mode_arg = (uint8_t)pending_mode;
+    pending_mode = -1;
+    out->packet_present = true;
+    out->command_valid = true;
+    out->command_type = COMMAND_TYPE_STATIC;
+    out->command_tag = COMMAND_TAG_SET_SYS_MODE;
+    out->command_args = &pending_mode_arg;
+    out->command_args_len = 1;
+}
+
+/**************************************************************************************************
+ * @section Tests
+ **************************************************************************************************/
+
+// idle on the pad: init -> standby, then 1000 ticks of standby
+static void test_standby_idle(void) {
+    setup_states();
+    int last = 0;
+    for (int tick = 0; tick < SIM_TICKS; ++tick) {
+        last = step_state_machine();
+    }
+    assert_check(last == STANDBY_IDX, "machine settles in standby");
+    assert_check(qspi_init_calls == 1, "init state entered once");
+    assert_check(radio_init_calls == 1, "radio brought up once across 1000 ticks");
+    assert_check(log_state_calls == 2, "one state log per transition");
+    assert_check(log_service_calls == SIM_TICKS, "data log serviced every tick");
+}
+
+// full sequence standby -> fill -> hold -> armed -> fire -> safe, then park in safe
+static void test_fire_sequence(void) {
+    setup_states();
+    int last = 0;
+    for (int tick = 0; tick < SIM_TICKS; ++tick) {
+        if (tick == 10) pending_mode = FILL_IDX;
+        if (tick == 20) pending_mode = ARMED_IDX;
+        if (tick == 30) pending_mode = FIRE_IDX;
+        last = step_state_machine();
+    }
+    assert_check(last == SAFE_IDX, "machine ends in safe");
+    assert_check(radio_init_calls == 5, "radio init once per radio state entered");
+    assert_check(gnss_init_calls == 1, "gnss init once (fire)");
+    assert_check(imu_init_calls == 2, "imu init once per imu (fire)");
+    assert_check(spi_set_profile_calls == 2, "SPI profile set once per imu (fire)");
+    assert_check(temperature_init_calls == 2, "temperature init once per sensor (fire)");
+    assert_check(magnetometer_init_calls == 2, "magnetometer init once per sensor (fire)");
+    assert_check(adc_init_calls == 2, "adc init once each in hold and fire");
+    assert_check(barometer_init_calls == 6, "barometer init twice each in hold, fire and safe");
+    assert_check(log_state_calls == 6, "one state log per logged state entered");
+}
+
+// requesting the state we're already in must not re-run its on_enter
+static void test_self_transition_not_reentered(void) {
+    setup_states();
+    for (int tick = 0; tick < SIM_TICKS; ++tick) {
+        if (tick == 10) pending_mode = FILL_IDX;
+        else if (tick > 10) pending_mode = HOLD_IDX;
+        step_state_machine();
+    }
+    assert_check(adc_init_calls == 1, "hold entered once despite repeated hold requests");
+    assert_check(barometer_init_calls == 2, "barometers brought up once");
+}
+
+// a DMA stream that never stops is logged, and the boot carries on to standby
+static void test_dma_init_failure_logged(void) {
+    dma_init_errc = TI_ERRC_TIMEOUT;
+    setup_states();
+    int last = 0;
+    for (int tick = 0; tick < 10; ++tick) {
+        last = step_state_machine();
+    }
+    bool logged = false;
+    for (int i = 0; i < logged_count; ++i) {
+        logged |= strcmp(logged_msgs[i], "Failed to initialize DMA") == 0;
+    }
+    assert_check(logged, "dma_init failure logged");
+    assert_check(last == STANDBY_IDX && qspi_init_calls == 1, "init carries on past it");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_standby_idle),
+        TEST_CASE(test_fire_sequence),
+        TEST_CASE(test_self_transition_not_reentered),
+        TEST_CASE(test_dma_init_failure_logged),
+    };
+
+    return run_test_suite("state machine unit tests", "statemachinetest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
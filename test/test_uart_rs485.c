@@ -0,0 +1,127 @@
+#include "host_test.h"
+#include "internal/mmio.h"
+#include "peripheral/uart.h"
+
+// RS485 driver enable programming in uart_init against the fake USART register blocks in
+// test/sim. The GPIO stubs remember what each pin was last switched to.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+#define PIN_COUNT 140
+
+static int pin_mode[PIN_COUNT];
+static int pin_af[PIN_COUNT];
+
+void tal_set_mode(int pin, int mode) { pin_mode[pin] = mode; }
+void tal_alternate_mode(int pin, int value) { pin_af[pin] = value; }
+bool tal_enable_clock(int pin) { (void)pin; return true; }
+
+#define DEAT(cr1) (((cr1) >> 21) & 0x1FU)
+#define DEDT(cr1) (((cr1) >> 16) & 0x1FU)
+
+static void on_async(bool success, void* ctx) { (void)success; (void)ctx; }
+
+static void reset(void) {
+    memset((void*)sim_usart, 0, sizeof(sim_usart));
+    memset((void*)sim_dmac, 0, sizeof(sim_dmac));
+    memset(pin_mode, -1, sizeof(pin_mode));
+    memset(pin_af, -1, sizeof(pin_af));
+}
+
+static void init(uart_channel_t channel, uart_rs485_config_t rs485, enum ti_errc_t* err) {
+    uart_config_t config = {
+        .channel = channel, .parity = UART_PARITY_DISABLED, .data_length = UART_DATALENGTH_8,
+        .clk_freq = 100000000, .baud_rate = 115200, .rs485 = rs485,
+    };
+    dma_callback_t callback = on_async;
+    periph_dma_config_t tx = {
+        .instance = DMA1, .stream = DMA_STREAM_1, .direction = MEM_TO_PERIPH,
+        .src_data_size = DMA_DATA_SIZE_BYTE, .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = DMA_PRIORITY_HIGH,
+    };
+    periph_dma_config_t rx = tx;
+    rx.stream = DMA_STREAM_0;
+    rx.direction = PERIPH_TO_MEM;
+    uart_init(&config, &callback, &tx, &rx, err);
+}
+
+// DEM, polarity and both times land in CR3/CR1, DE goes to its alternate function
+static void test_registers(void) {
+    reset();
+    enum ti_errc_t err;
+    init(UART2, (uart_rs485_config_t){.enabled = true, .de_pin = 38, .assertion_time = 16,
+                                      .deassertion_time = 8}, &err);
+    assert_check(err == TI_ERRC_NONE, "rs485 init succeeded");
+    const uint32_t cr1 = sim_usart[UART2].cr1;
+    const uint32_t cr3 = sim_usart[UART2].cr3;
+    assert_check(cr3 & USARTx_CR3_DEM.msk, "driver enable mode on");
+    assert_check(!(cr3 & USARTx_CR3_DEP.msk), "DE active high");
+    assert_check(DEAT(cr1) == 16 && DEDT(cr1) == 8, "assertion and deassertion times programmed");
+    assert_check(cr1 & USARTx_CR1_UE.msk, "USART enabled after the timing is in");
+    assert_check(pin_mode[38] == 2 && pin_af[38] == 7, "PA1 switched to USART2_DE");
+}
+
+// active-low DE on a UARTx channel, times at both ends of their range
+static void test_polarity_and_limits(void) {
+    reset();
+    enum ti_errc_t err;
+    init(UART7, (uart_rs485_config_t){.enabled = true, .de_pin = 59, .de_active_low = true,
+                                      .assertion_time = UART_RS485_MAX_DE_TIME}, &err);
+    assert_check(err == TI_ERRC_NONE, "UART7 rs485 init succeeded");
+    assert_check((sim_usart[UART7].cr3 & USARTx_CR3_DEM.msk) && (sim_usart[UART7].cr3 & USARTx_CR3_DEP.msk),
+                 "driver enable on, active low");
+    assert_check(DEAT(sim_usart[UART7].cr1) == UART_RS485_MAX_DE_TIME && DEDT(sim_usart[UART7].cr1) == 0,
+                 "longest assertion, no deassertion delay");
+    assert_check(pin_af[59] == 7, "PE9 switched to UART7_DE");
+}
+
+// out-of-range times and pins that cannot carry DE are refused before the USART is enabled
+static void test_invalid(void) {
+    reset();
+    enum ti_errc_t err;
+    init(UART2, (uart_rs485_config_t){.enabled = true, .de_pin = 38, .assertion_time = 32}, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "assertion time past 31 refused");
+    assert_check(sim_usart[UART2].cr1 == 0 && sim_usart[UART2].cr3 == 0, "no register touched");
+
+    init(UART2, (uart_rs485_config_t){.enabled = true, .de_pin = 38, .deassertion_time = 200}, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "deassertion time past 31 refused");
+
+    init(UART2, (uart_rs485_config_t){.enabled = true, .de_pin = 43}, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "PA4 cannot carry USART2_DE");
+    assert_check(!(sim_usart[UART2].cr1 & USARTx_CR1_UE.msk) && !(sim_usart[UART2].cr3 & USARTx_CR3_DEM.msk),
+                 "USART left disabled without driver enable");
+}
+
+// without rs485 DE stays off, and re-initializing drops a previous RS485 setup
+static void test_disabled(void) {
+    reset();
+    enum ti_errc_t err;
+    init(UART3, (uart_rs485_config_t){0}, &err);
+    assert_check(err == TI_ERRC_NONE, "plain init succeeded");
+    assert_check(!(sim_usart[UART3].cr3 & USARTx_CR3_DEM.msk), "driver enable mode off");
+    assert_check(DEAT(sim_usart[UART3].cr1) == 0 && DEDT(sim_usart[UART3].cr1) == 0, "no DE timing");
+    assert_check(pin_mode[74] == -1 && pin_mode[82] == -1, "DE-capable pins left alone");
+
+    init(UART3, (uart_rs485_config_t){.enabled = true, .de_pin = 82, .assertion_time = 4,
+                                      .deassertion_time = 4}, &err);
+    assert_check(err == TI_ERRC_NONE && (sim_usart[UART3].cr3 & USARTx_CR3_DEM.msk), "rs485 on");
+    init(UART3, (uart_rs485_config_t){.enabled = true, .de_pin = 82, .assertion_time = 2,
+                                      .deassertion_time = 9}, &err);
+    assert_check(DEAT(sim_usart[UART3].cr1) == 2 && DEDT(sim_usart[UART3].cr1) == 9, "new times replace the old");
+    init(UART3, (uart_rs485_config_t){0}, &err);
+    assert_check(err == TI_ERRC_NONE && !(sim_usart[UART3].cr3 & USARTx_CR3_DEM.msk), "rs485 off again");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_registers),
+        TEST_CASE(test_polarity_and_limits),
+        TEST_CASE(test_invalid),
+        TEST_CASE(test_disabled),
+    };
+
+    return run_test_suite("uart rs485 unit tests", "uartrs485test_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
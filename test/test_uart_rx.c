@@ -0,0 +1,345 @@
+#include "host_test.h"
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "internal/deadline.h"
+#include "peripheral/uart.h"
+
+// UART receive ring against the fake USART and DMA register blocks in test/sim. The helpers
+// below play the line and the RX DMA stream: bytes land in the ring at NDTR's position, NDTR
+// counts down and reloads on a wrap, and the USART raises IDLE when the line goes quiet.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+void tal_set_mode(int pin, int mode) { (void)pin; (void)mode; }
+void tal_alternate_mode(int pin, int value) { (void)pin; (void)value; }
+bool tal_enable_clock(int pin) { (void)pin; return true; }
+
+// Blocking-read deadlines run on this clock, which moves 1us every time it is read
+static uint64_t fake_ticks;
+uint64_t deadline_ticks(void) { return fake_ticks += DEADLINE_TICKS_PER_US; }
+
+#define TC (1U << 5)
+#define TE (1U << 3)
+#define RX_STREAM DMA_STREAM_0
+#define TX_STREAM DMA_STREAM_1
+
+static const uint8_t flag_shift[4] = {0, 6, 16, 22};
+
+static void (*const usart_handlers[9])(void) = {
+    [1] = usart1_irq_handler, [2] = usart2_irq_handler, [3] = usart3_irq_handler,
+    [4] = uart4_irq_handler,  [5] = uart5_irq_handler,  [6] = usart6_irq_handler,
+    [7] = uart7_irq_handler,  [8] = uart8_irq_handler,
+};
+
+static uint8_t ring[64] __attribute__((aligned(64)));
+static uart_channel_t line_channel;
+static uint32_t async_calls;
+
+static void on_async(bool success, void* ctx) {
+    (void)success; (void)ctx;
+    async_calls++;
+}
+
+// DMA1 stream 0 raising @p flags, entering its interrupt and applying the flag clears
+static void dma_event(uint32_t flags) {
+    sim_dmac[1].lisr |= flags << flag_shift[RX_STREAM];
+    if (flags & TE) sim_dmac[1].s[RX_STREAM].cr &= ~DMAx_S0CR_EN.msk;
+    dma_str0_irq_handler();
+    sim_dmac[1].lisr &= ~sim_dmac[1].lifcr;
+    sim_dmac[1].lifcr = 0;
+}
+
+// ISR flags going up, the USART's interrupt if one of them is enabled, then ICR clearing them
+static void usart_event(uint32_t flags) {
+    volatile sim_usart_regs_t* u = &sim_usart[line_channel];
+    u->isr |= flags;
+    const bool idle = (flags & USARTx_ISR_IDLE.msk) && (u->cr1 & USARTx_CR1_IDLEIE.msk);
+    const bool error = (flags & ~USARTx_ISR_IDLE.msk) && (u->cr3 & USARTx_CR3_EIE.msk);
+    if (idle || error) usart_handlers[line_channel]();
+    u->isr &= ~u->icr;
+    u->icr = 0;
+}
+
+// bytes arriving while DMAR is set: each goes where NDTR points, and NDTR reloads after the last
+static void line_rx(const uint8_t* data, uint32_t len) {
+    volatile uint32_t* ndtr = &sim_dmac[1].s[RX_STREAM].ndtr;
+    const uint32_t size = sizeof(ring);
+    for (uint32_t i = 0; i < len; i++) {
+        if (!(sim_usart[line_channel].cr3 & USARTx_CR3_DMAR.msk) ||
+            !(sim_dmac[1].s[RX_STREAM].cr & DMAx_S0CR_EN.msk)) return;
+        ring[size - *ndtr] = data[i];
+        if (--*ndtr == 0) {
+            *ndtr = size;
+            dma_event(TC);
+        }
+    }
+}
+
+static void line_frame(const uint8_t* data, uint32_t len) {
+    line_rx(data, len);
+    usart_event(USARTx_ISR_IDLE.msk);
+}
+
+static void setup(uart_channel_t channel) {
+    memset((void*)sim_usart, 0, sizeof(sim_usart));
+    memset((void*)sim_dmac, 0, sizeof(sim_dmac));
+    memset((void*)sim_dmamux1_ccr, 0, sizeof(sim_dmamux1_ccr));
+    memset((void*)sim_nvic_iser, 0, sizeof(sim_nvic_iser));
+    memset(ring, 0, sizeof(ring));
+    line_channel = channel;
+    async_calls = 0;
+    enum ti_errc_t err = TI_ERRC_NONE;
+    dma_init(&err);
+
+    uart_config_t config = {
+        .channel = channel, .parity = UART_PARITY_DISABLED, .data_length = UART_DATALENGTH_8,
+        .clk_freq = 100000000, .baud_rate = 115200,
+    };
+    dma_callback_t callback = on_async;
+    periph_dma_config_t tx = {
+        .instance = DMA1, .stream = TX_STREAM, .direction = MEM_TO_PERIPH,
+        .src_data_size = DMA_DATA_SIZE_BYTE, .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = DMA_PRIORITY_HIGH,
+    };
+    periph_dma_config_t rx = tx;
+    rx.stream = RX_STREAM;
+    rx.direction = PERIPH_TO_MEM;
+    uart_init(&config, &callback, &tx, &rx, &err);
+}
+
+// the ring's stream, USART and NVIC programming
+static void test_start_registers(void) {
+    setup(UART4);
+    enum ti_errc_t err;
+    sim_usart[UART4].isr = USARTx_ISR_IDLE.msk; // left over from before
+    uart_rx_ring_start(UART4, ring, sizeof(ring), &err);
+    assert_check(err == TI_ERRC_NONE, "ring started");
+
+    const uint32_t cr = sim_dmac[1].s[RX_STREAM].cr;
+    assert_check((cr & DMAx_S0CR_CIRC.msk) && (cr & DMAx_S0CR_EN.msk) && (cr & DMAx_S0CR_MINC.msk),
+                 "circular, running, memory increments");
+    assert_check(((cr & DMAx_S0CR_DIR.msk) >> DMAx_S0CR_DIR.pos) == 0, "peripheral to memory");
+    assert_check(sim_dmac[1].s[RX_STREAM].ndtr == sizeof(ring), "NDTR covers the ring");
+    assert_check(sim_dmac[1].s[RX_STREAM].par == (uint32_t)(uintptr_t)&sim_usart[UART4].rdr,
+                 "reads from UART4 RDR");
+    assert_check(sim_dmac[1].s[RX_STREAM].m0ar == (uint32_t)(uintptr_t)ring, "writes into the ring");
+    assert_check((sim_dmamux1_ccr[RX_STREAM] & 0xFFU) == 63, "UART4 RX request on the stream");
+    assert_check((sim_usart[UART4].cr3 & USARTx_CR3_DMAR.msk) && (sim_usart[UART4].cr3 & USARTx_CR3_EIE.msk) &&
+                 (sim_usart[UART4].cr1 & USARTx_CR1_IDLEIE.msk), "DMAR, EIE and IDLEIE set");
+    assert_check(sim_usart[UART4].icr & USARTx_ICR_IDLECF.msk, "stale idle flag cleared");
+    assert_check(sim_nvic_iser[52 / 32] & (1U << (52 % 32)), "UART4 interrupt enabled");
+    assert_check(uart_read_available(UART4) == 0, "nothing received yet");
+
+    uint8_t buf[8];
+    uart_read_async(UART4, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_BUSY, "async read refused while the ring runs");
+
+    uart_rx_ring_stop(UART4);
+    assert_check(!(sim_usart[UART4].cr3 & USARTx_CR3_DMAR.msk) && !(sim_usart[UART4].cr1 & USARTx_CR1_IDLEIE.msk) &&
+                 !(sim_dmac[1].s[RX_STREAM].cr & DMAx_S0CR_EN.msk), "stop turns it all off");
+    uart_read_async(UART4, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_NONE && !(sim_dmac[1].s[RX_STREAM].cr & DMAx_S0CR_CIRC.msk),
+                 "async read gets a one-shot stream back");
+    sim_dmac[1].s[RX_STREAM].ndtr = 0;
+    dma_event(TC);
+    assert_check(async_calls == 1, "with uart_init's callback");
+}
+
+static void test_start_invalid(void) {
+    setup(UART1);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART1, ring, 48, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "size not a power of two");
+    uart_rx_ring_start(UART1, ring, 1, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "size of 1");
+    uart_rx_ring_start(UART1, NULL, 64, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "NULL buffer");
+    uart_rx_ring_start(UART_CHANNEL_COUNT, ring, 64, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "channel out of range");
+    uart_rx_ring_start(UART3, ring, 64, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "channel without uart_init");
+
+    uart_rx_ring_start(UART1, ring, 64, &err);
+    assert_check(err == TI_ERRC_NONE, "USART1 starts");
+    uart_rx_ring_start(UART1, ring, 64, &err);
+    assert_check(err == TI_ERRC_BUSY, "second start refused");
+
+    uint8_t out[4];
+    uart_read_some(UART2, out, sizeof(out), NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "read from a channel without a ring");
+}
+
+// bytes appear as they land; idle lines split them into frames
+static void test_frames(void) {
+    setup(UART1);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART1, ring, sizeof(ring), &err);
+
+    line_rx((const uint8_t*)"hel", 3);
+    assert_check(uart_read_available(UART1) == 3, "bytes visible before the frame ends");
+    line_frame((const uint8_t*)"lo", 2);
+    line_frame((const uint8_t*)"world!", 6);
+    usart_event(USARTx_ISR_IDLE.msk); // idle again with nothing new
+    assert_check(uart_read_available(UART1) == 11, "both frames waiting");
+    uart_rx_stats_t stats;
+    uart_rx_get_stats(UART1, &stats);
+    assert_check(stats.frames == 2, "second idle line ends no frame");
+
+    uint8_t out[32];
+    bool end = true;
+    uint32_t n = uart_read_some(UART1, out, 2, &end, &err);
+    assert_check(n == 2 && !end && memcmp(out, "he", 2) == 0 && err == TI_ERRC_NONE, "partial frame");
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 3 && end && memcmp(out, "llo", 3) == 0, "rest of the first frame only");
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 6 && end && memcmp(out, "world!", 6) == 0, "second frame");
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 0 && !end && err == TI_ERRC_NONE, "empty ring reads nothing without blocking");
+
+    line_rx((const uint8_t*)"abc", 3);
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 3 && !end, "bytes of an unfinished frame");
+    usart_event(USARTx_ISR_IDLE.msk);
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 0, "its end carries no bytes");
+    line_frame((const uint8_t*)"xy", 2);
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 2 && end && memcmp(out, "xy", 2) == 0, "next frame stands alone");
+}
+
+// a frame straddling the end of the ring comes out in order, and the wrap is counted
+static void test_wrap(void) {
+    setup(UART4);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART4, ring, sizeof(ring), &err);
+
+    uint8_t data[200];
+    for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 7 + 1);
+    uint8_t out[64];
+    uint32_t at = 0;
+    bool ok = true;
+    // frames of 50 bytes cross the 64-byte ring's end every time
+    for (int f = 0; f < 4; f++) {
+        line_frame(data + f * 50, 50);
+        bool end = false;
+        uint32_t n = uart_read_some(UART4, out, sizeof(out), &end, &err);
+        ok = ok && n == 50 && end && err == TI_ERRC_NONE && memcmp(out, data + at, 50) == 0;
+        at += n;
+    }
+    assert_check(ok, "four frames across three wraps");
+
+    // reader polls right after the hardware wrapped, before the wrap interrupt ran
+    const uint32_t pos = sizeof(ring) - sim_dmac[1].s[RX_STREAM].ndtr; // 200 % 64
+    const uint32_t before = sizeof(ring) - pos;
+    for (uint32_t i = 0; i < before; i++) ring[pos + i] = data[i];
+    for (uint32_t i = 0; i < 6; i++) ring[i] = data[before + i];
+    sim_dmac[1].s[RX_STREAM].ndtr = sizeof(ring) - 6;
+    assert_check(pos == 8 && uart_read_available(UART4) == before + 6, "pending wrap accounted for");
+    dma_event(TC);
+    assert_check(uart_read_available(UART4) == before + 6, "late wrap interrupt doesn't count it twice");
+    uint32_t n = uart_read_some(UART4, out, sizeof(out), NULL, &err);
+    assert_check(n == before + 6 && memcmp(out, data, before + 6) == 0, "bytes across the late wrap");
+}
+
+// a reader that falls more than a ring behind loses the oldest bytes, and hears about it once
+static void test_overflow(void) {
+    setup(UART1);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART1, ring, sizeof(ring), &err);
+
+    uint8_t data[100];
+    for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)i;
+    line_frame(data, 20);
+    line_frame(data + 20, 80);
+    assert_check(uart_read_available(UART1) == 64, "at most a ring's worth waiting");
+
+    uint8_t out[64];
+    bool end = false;
+    uint32_t n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(err == TI_ERRC_OVERFLOW && n == 64 && end, "overflow reported with the surviving bytes");
+    assert_check(memcmp(out, data + 36, 64) == 0, "newest 64 bytes kept");
+    uart_rx_stats_t stats;
+    uart_rx_get_stats(UART1, &stats);
+    assert_check(stats.dropped == 36, "36 bytes dropped");
+
+    line_frame(data, 5);
+    n = uart_read_some(UART1, out, sizeof(out), &end, &err);
+    assert_check(n == 5 && end && err == TI_ERRC_NONE, "next frame reads clean");
+}
+
+// more unread frames than slots run together instead of losing bytes
+static void test_frame_slots(void) {
+    setup(UART1);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART1, ring, sizeof(ring), &err);
+    for (int f = 0; f < UART_RX_FRAME_SLOTS + 2; f++) {
+        uint8_t b = (uint8_t)f;
+        line_frame(&b, 1);
+    }
+    uint8_t out[64];
+    uint32_t total = 0;
+    int reads = 0;
+    bool end = false;
+    uint32_t n;
+    while ((n = uart_read_some(UART1, out, sizeof(out), &end, &err)) > 0) {
+        total += n;
+        reads++;
+    }
+    assert_check(total == UART_RX_FRAME_SLOTS + 2, "every byte delivered");
+    assert_check(reads == UART_RX_FRAME_SLOTS + 1, "last frames merged into one read");
+}
+
+// line errors are counted and cleared; a failing stream is reported
+static void test_errors(void) {
+    setup(UART4);
+    enum ti_errc_t err;
+    uart_rx_ring_start(UART4, ring, sizeof(ring), &err);
+    usart_event(USARTx_ISR_ORE.msk);
+    usart_event(USARTx_ISR_FE.msk | USARTx_ISR_IDLE.msk);
+    uart_rx_stats_t stats;
+    uart_rx_get_stats(UART4, &stats);
+    assert_check(stats.line_errors == 2 && sim_usart[UART4].isr == 0, "errors counted and cleared");
+
+    line_rx((const uint8_t*)"ab", 2);
+    dma_event(TE);
+    uint8_t out[8];
+    uint32_t n = uart_read_some(UART4, out, sizeof(out), NULL, &err);
+    assert_check(n == 2 && err == TI_ERRC_BUS, "bytes before the failure, then the error");
+}
+
+// blocking reads poll RXNE and give up instead of spinning forever
+static void test_read_blocking(void) {
+    setup(UART1);
+    enum ti_errc_t err;
+    sim_usart[UART1].isr = USARTx_ISR_RXNE.msk;
+    sim_usart[UART1].rdr = 0x5A;
+    uint8_t out[2] = {0};
+    uart_read_blocking(UART1, out, sizeof(out), &err);
+    assert_check(err == TI_ERRC_NONE && out[0] == 0x5A && out[1] == 0x5A, "reads while RXNE is up");
+
+    sim_usart[UART1].isr = 0;
+    const uint64_t before = fake_ticks;
+    uart_read_blocking(UART1, out, sizeof(out), &err);
+    const uint64_t waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(err == TI_ERRC_TIMEOUT, "silent line times out");
+    assert_check(waited_us >= UART_RX_TIMEOUT_US && waited_us <= UART_RX_TIMEOUT_US + 2,
+                 "after UART_RX_TIMEOUT_US, on the first byte");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_start_registers),
+        TEST_CASE(test_start_invalid),
+        TEST_CASE(test_frames),
+        TEST_CASE(test_wrap),
+        TEST_CASE(test_overflow),
+        TEST_CASE(test_frame_slots),
+        TEST_CASE(test_errors),
+        TEST_CASE(test_read_blocking),
+    };
+
+    return run_test_suite("uart rx ring unit tests", "uartrxtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -0,0 +1,395 @@
+#include "host_test.h"
+#include "internal/mmio.h"
+#include "internal/interrupt.h"
+#include "internal/deadline.h"
+#include "peripheral/uart.h"
+
+// UART transmit queue against the fake USART and DMA register blocks in test/sim. The line model
+// below runs in character times: the TX stream fills the USART's 16-byte TX FIFO, the shift
+// register sends one character per tick, and TC goes up once the FIFO and shift register are
+// both empty, entering the USART interrupt if TCIE is set.
+
+void ti_log_write(enum ti_errc_t errc, const char* msg, const char* func, const char* file, uint32_t line) {
+    (void)errc; (void)msg; (void)func; (void)file; (void)line;
+}
+
+void tal_set_mode(int pin, int mode) { (void)pin; (void)mode; }
+void tal_alternate_mode(int pin, int value) { (void)pin; (void)value; }
+bool tal_enable_clock(int pin) { (void)pin; return true; }
+
+// Blocking-write deadlines run on this clock, which moves 1us every time it is read
+static uint64_t fake_ticks;
+uint64_t deadline_ticks(void) { return fake_ticks += DEADLINE_TICKS_PER_US; }
+
+#define TC (1U << 5)
+#define TE (1U << 3)
+#define RX_STREAM DMA_STREAM_0
+#define TX_STREAM DMA_STREAM_1
+#define CHANNEL UART2
+#define USART_FIFO_DEPTH 16
+#define BAUD 115200U
+#define CHAR_NS (10ULL * 1000000000ULL / BAUD) // start + 8 data + stop
+
+static uint8_t queue_buf[256];
+
+static struct {
+    uint8_t fifo[USART_FIFO_DEPTH];
+    uint32_t fifo_len;
+    bool shifting;        // a character is on the wire this tick
+    bool dma_running;     // the model has picked up the stream's current transfer
+    uint32_t dma_base;    // offset of M0AR into queue_buf
+    uint32_t dma_items;   // NDTR the transfer started with
+    uint8_t wire[16384];
+    uint32_t wire_len;
+    uint64_t now_ns;
+    uint64_t busy_ns;     // time the line spent sending
+} line;
+
+static struct { int calls; bool success; void* ctx; } done_rec;
+
+static void on_done(bool success, void* ctx) {
+    done_rec.calls++;
+    done_rec.success = success;
+    done_rec.ctx = ctx;
+}
+
+static void on_async(bool success, void* ctx) { (void)success; (void)ctx; }
+
+// DMA1 stream 1 raising @p flags, entering its interrupt and applying the flag clears
+static void dma_event(uint32_t flags) {
+    sim_dmac[1].lisr |= flags << 6;
+    dma_str1_irq_handler();
+    sim_dmac[1].lisr &= ~sim_dmac[1].lifcr;
+    sim_dmac[1].lifcr = 0;
+}
+
+static void usart_irq(void) {
+    usart2_irq_handler();
+    sim_usart[CHANNEL].isr &= ~sim_usart[CHANNEL].icr;
+    sim_usart[CHANNEL].icr = 0;
+}
+
+// the TX stream moving bytes into the FIFO while DMAT is set and there is room
+static void dma_fill(void) {
+    volatile sim_usart_regs_t* u = &sim_usart[CHANNEL];
+    while ((u->cr3 & USARTx_CR3_DMAT.msk) && (sim_dmac[1].s[TX_STREAM].cr & DMAx_S0CR_EN.msk) &&
+           line.fifo_len < USART_FIFO_DEPTH) {
+        volatile uint32_t* ndtr = &sim_dmac[1].s[TX_STREAM].ndtr;
+        if (!line.dma_running) {
+            line.dma_running = true;
+            line.dma_base = sim_dmac[1].s[TX_STREAM].m0ar - (uint32_t)(uintptr_t)queue_buf;
+            line.dma_items = *ndtr;
+        }
+        line.fifo[line.fifo_len++] = queue_buf[line.dma_base + line.dma_items - *ndtr];
+        u->isr &= ~USARTx_ISR_TC.msk; // a write to TDR clears TC
+        if (--*ndtr == 0) {
+            sim_dmac[1].s[TX_STREAM].cr &= ~DMAx_S0CR_EN.msk;
+            line.dma_running = false;
+            dma_event(TC);
+        }
+    }
+}
+
+// one character time on the line
+static void line_tick(void) {
+    dma_fill();
+    if (line.fifo_len > 0) {
+        line.wire[line.wire_len++ % sizeof(line.wire)] = line.fifo[0];
+        memmove(line.fifo, line.fifo + 1, --line.fifo_len);
+        line.shifting = true;
+        line.busy_ns += CHAR_NS;
+    } else if (line.shifting) {
+        line.shifting = false;
+        sim_usart[CHANNEL].isr |= USARTx_ISR_TC.msk;
+        if (sim_usart[CHANNEL].cr1 & USARTx_CR1_TCIE.msk) usart_irq();
+    }
+    line.now_ns += CHAR_NS;
+    dma_fill();
+}
+
+static bool line_drain(uint32_t max_ticks) {
+    for (uint32_t i = 0; i < max_ticks; i++) {
+        if (!line.shifting && line.fifo_len == 0 && uart_tx_pending(CHANNEL) == 0 &&
+            !(sim_usart[CHANNEL].cr1 & USARTx_CR1_TCIE.msk)) {
+            return true;
+        }
+        line_tick();
+    }
+    return false;
+}
+
+static void setup(void) {
+    memset((void*)sim_usart, 0, sizeof(sim_usart));
+    memset((void*)sim_dmac, 0, sizeof(sim_dmac));
+    memset((void*)sim_dmamux1_ccr, 0, sizeof(sim_dmamux1_ccr));
+    memset((void*)sim_nvic_iser, 0, sizeof(sim_nvic_iser));
+    memset(&line, 0, sizeof(line));
+    memset(&done_rec, 0, sizeof(done_rec));
+    sim_usart[CHANNEL].isr = USARTx_ISR_TC.msk; // TC resets to 1
+    enum ti_errc_t err = TI_ERRC_NONE;
+    dma_init(&err);
+
+    uart_config_t config = {
+        .channel = CHANNEL, .parity = UART_PARITY_DISABLED, .data_length = UART_DATALENGTH_8,
+        .clk_freq = 100000000, .baud_rate = BAUD,
+    };
+    dma_callback_t callback = on_async;
+    periph_dma_config_t tx = {
+        .instance = DMA1, .stream = TX_STREAM, .direction = MEM_TO_PERIPH,
+        .src_data_size = DMA_DATA_SIZE_BYTE, .dest_data_size = DMA_DATA_SIZE_BYTE,
+        .priority = DMA_PRIORITY_HIGH,
+    };
+    periph_dma_config_t rx = tx;
+    rx.stream = RX_STREAM;
+    rx.direction = PERIPH_TO_MEM;
+    uart_init(&config, &callback, &tx, &rx, &err);
+}
+
+static void start_queue(void) {
+    enum ti_errc_t err;
+    uart_tx_queue_start(CHANNEL, queue_buf, sizeof(queue_buf), on_done, &done_rec, &err);
+}
+
+// the queue's stream, USART and NVIC programming, and giving the stream back
+static void test_start_registers(void) {
+    setup();
+    enum ti_errc_t err;
+    uart_tx_queue_start(CHANNEL, queue_buf, sizeof(queue_buf), on_done, &done_rec, &err);
+    assert_check(err == TI_ERRC_NONE, "queue started");
+    assert_check(sim_usart[CHANNEL].cr3 & USARTx_CR3_DMAT.msk, "DMAT set");
+    assert_check(sim_usart[CHANNEL].cr1 & USARTx_CR1_FIFOEN.msk, "FIFO enabled by uart_init");
+    assert_check(!(sim_usart[CHANNEL].cr1 & USARTx_CR1_TCIE.msk), "TC interrupt not armed while empty");
+    assert_check(sim_nvic_iser[38 / 32] & (1U << (38 % 32)), "USART2 interrupt enabled");
+    assert_check((sim_dmamux1_ccr[TX_STREAM] & 0x7FU) == 44, "USART2 TX request on the stream");
+    assert_check(!(sim_dmac[1].s[TX_STREAM].cr & DMAx_S0CR_EN.msk), "stream idle until a write");
+
+    uint8_t buf[4] = {1, 2, 3, 4};
+    uart_write_async(CHANNEL, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_BUSY, "async write refused while the queue runs");
+    uart_write_blocking(CHANNEL, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_BUSY, "blocking write refused while the queue runs");
+    uart_tx_queue_start(CHANNEL, queue_buf, sizeof(queue_buf), on_done, &done_rec, &err);
+    assert_check(err == TI_ERRC_BUSY, "second start refused");
+
+    uart_tx_queue_stop(CHANNEL);
+    assert_check(!(sim_usart[CHANNEL].cr3 & USARTx_CR3_DMAT.msk), "stop clears DMAT");
+    uart_write_async(CHANNEL, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_NONE, "async write works again");
+}
+
+static void test_start_invalid(void) {
+    setup();
+    enum ti_errc_t err;
+    uart_tx_queue_start(CHANNEL, queue_buf, 100, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "size not a power of two");
+    uart_tx_queue_start(CHANNEL, NULL, 256, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "NULL buffer");
+    uart_tx_queue_start(UART5, queue_buf, 256, NULL, NULL, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "channel without uart_init");
+    uint8_t b = 0;
+    uart_write_queued(CHANNEL, &b, 1, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "write before start");
+    start_queue();
+    uart_write_queued(CHANNEL, &b, 0, &err);
+    assert_check(err == TI_ERRC_INVALID_ARG, "empty write");
+}
+
+// a write returns at once with the stream running, and completion comes once, after the last
+// character has left
+static void test_write_returns_at_once(void) {
+    setup();
+    start_queue();
+    uint8_t msg[40];
+    for (uint32_t i = 0; i < sizeof(msg); i++) msg[i] = (uint8_t)(0xA0 + i);
+    enum ti_errc_t err;
+    uart_write_queued(CHANNEL, msg, sizeof(msg), &err);
+    assert_check(err == TI_ERRC_NONE && line.now_ns == 0, "returned without line time passing");
+    assert_check((sim_dmac[1].s[TX_STREAM].cr & DMAx_S0CR_EN.msk) && sim_dmac[1].s[TX_STREAM].ndtr == 40,
+                 "one DMA transfer for the whole write");
+    assert_check(uart_tx_pending(CHANNEL) == 40, "40 bytes pending");
+
+    for (int i = 0; i < 30; i++) line_tick();
+    assert_check(done_rec.calls == 0, "no completion while characters are still going out");
+    assert_check(line_drain(100), "line drains");
+    assert_check(line.wire_len == 40 && memcmp(line.wire, msg, 40) == 0, "every byte on the wire in order");
+    assert_check(done_rec.calls == 1 && done_rec.success && done_rec.ctx == &done_rec, "completion once");
+    assert_check(line.now_ns == 41 * CHAR_NS, "completion right after the last stop bit");
+
+    uart_tx_stats_t stats;
+    uart_tx_get_stats(CHANNEL, &stats);
+    assert_check(stats.bytes_queued == 40 && stats.bytes_sent == 40 && stats.dma_transfers == 1 &&
+                 stats.completions == 1, "counters");
+}
+
+// writes made while the queue drains join it; a run across the queue's end takes two transfers
+static void test_back_to_back(void) {
+    setup();
+    start_queue();
+    uint8_t data[600];
+    for (uint32_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 13);
+    enum ti_errc_t err;
+    uint32_t sent = 0;
+    bool ok = true;
+    while (sent < sizeof(data)) {
+        const uint32_t n = (sizeof(data) - sent < 50) ? sizeof(data) - sent : 50;
+        if (sizeof(queue_buf) - uart_tx_pending(CHANNEL) >= n) {
+            uart_write_queued(CHANNEL, data + sent, n, &err);
+            ok = ok && err == TI_ERRC_NONE;
+            sent += n;
+        }
+        line_tick();
+    }
+    assert_check(ok, "every write accepted");
+    assert_check(line_drain(1000), "line drains");
+    assert_check(line.wire_len == sizeof(data) && memcmp(line.wire, data, sizeof(data)) == 0,
+                 "bytes of every write, in order");
+    assert_check(done_rec.calls == 1, "one completion for the whole stream");
+
+    uart_tx_stats_t stats;
+    uart_tx_get_stats(CHANNEL, &stats);
+    assert_check(stats.bytes_sent == sizeof(data) && stats.peak_depth <= sizeof(queue_buf), "counters");
+    assert_check(stats.dma_transfers >= 3, "runs split at the queue's end");
+}
+
+// a write that doesn't fit is refused whole
+static void test_overflow(void) {
+    setup();
+    start_queue();
+    uint8_t data[200] = {0};
+    enum ti_errc_t err;
+    uart_write_queued(CHANNEL, data, 200, &err);
+    uart_write_queued(CHANNEL, data, 57, &err);
+    assert_check(err == TI_ERRC_OVERFLOW && uart_tx_pending(CHANNEL) == 200, "write refused, nothing queued");
+    uart_write_queued(CHANNEL, data, 56, &err);
+    assert_check(err == TI_ERRC_NONE && uart_tx_pending(CHANNEL) == 256, "exact fit accepted");
+    uart_tx_stats_t stats;
+    uart_tx_get_stats(CHANNEL, &stats);
+    assert_check(stats.overflows == 1 && stats.peak_depth == 256, "overflow and depth counted");
+    assert_check(line_drain(1000) && line.wire_len == 256 && done_rec.calls == 1, "queue still drains");
+}
+
+// a failed stream drops what was queued and reports it at completion
+static void test_dma_error(void) {
+    setup();
+    start_queue();
+    uint8_t data[32] = {0};
+    enum ti_errc_t err;
+    uart_write_queued(CHANNEL, data, sizeof(data), &err);
+    sim_dmac[1].s[TX_STREAM].cr &= ~DMAx_S0CR_EN.msk;
+    dma_event(TE);
+    assert_check(uart_tx_pending(CHANNEL) == 0, "queued bytes dropped");
+    assert_check(sim_usart[CHANNEL].cr1 & USARTx_CR1_TCIE.msk, "completion armed");
+    line.shifting = true; // the last character that made it out
+    line_tick();
+    assert_check(done_rec.calls == 1 && !done_rec.success, "completion reports the failure");
+
+    uart_write_queued(CHANNEL, data, 8, &err);
+    assert_check(line_drain(100) && done_rec.calls == 2 && done_rec.success, "next write succeeds");
+}
+
+// blocking writes give up after UART_TX_TIMEOUT_US on a FIFO that never empties or a byte that
+// never leaves the line
+static void test_write_blocking_timeout(void) {
+    setup();
+    enum ti_errc_t err;
+    uint8_t buf[2] = {0xA5, 0x5A};
+
+    sim_usart[CHANNEL].isr = 0; // TX FIFO full
+    uint64_t before = fake_ticks;
+    uart_write_blocking(CHANNEL, buf, sizeof(buf), &err);
+    uint64_t waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(err == TI_ERRC_TIMEOUT, "full FIFO times out");
+    assert_check(waited_us >= UART_TX_TIMEOUT_US && waited_us <= UART_TX_TIMEOUT_US + 2,
+                 "after UART_TX_TIMEOUT_US, on the first byte");
+
+    sim_usart[CHANNEL].isr = USARTx_ISR_TXE.msk; // room, but TC never comes
+    before = fake_ticks;
+    uart_write_blocking(CHANNEL, buf, sizeof(buf), &err);
+    waited_us = (fake_ticks - before) / DEADLINE_TICKS_PER_US;
+    assert_check(err == TI_ERRC_TIMEOUT && sim_usart[CHANNEL].tdr == 0xA5, "stuck TC times out after one byte");
+    assert_check(waited_us >= UART_TX_TIMEOUT_US && waited_us <= UART_TX_TIMEOUT_US + 2,
+                 "TXE and TC share the byte's budget");
+
+    sim_usart[CHANNEL].isr = USARTx_ISR_TXE.msk | USARTx_ISR_TC.msk;
+    before = fake_ticks;
+    uart_write_blocking(CHANNEL, buf, sizeof(buf), &err);
+    assert_check(err == TI_ERRC_NONE && sim_usart[CHANNEL].tdr == 0x5A, "ready line writes both bytes");
+    assert_check(fake_ticks - before == sizeof(buf) * DEADLINE_TICKS_PER_US,
+                 "one clock read per byte while the flags are already up");
+}
+
+// how much of the line the queue keeps busy, and what a write costs the caller
+static void test_benchmark(void) {
+    log_printf("  uart_write_queued at %u baud, 256-byte queue\n", BAUD);
+
+    // saturated: the writer tops the queue up in 64-byte writes whenever there is room
+    setup();
+    start_queue();
+    uint8_t packet[64];
+    for (uint32_t i = 0; i < sizeof(packet); i++) packet[i] = (uint8_t)i;
+    enum ti_errc_t err;
+    uint64_t host_ns = 0;
+    uint32_t writes = 0;
+    for (uint32_t sent = 0; sent < 16384; line_tick()) {
+        if (sizeof(queue_buf) - uart_tx_pending(CHANNEL) >= sizeof(packet)) {
+            const uint64_t t0 = host_now_ns();
+            uart_write_queued(CHANNEL, packet, sizeof(packet), &err);
+            host_ns += host_now_ns() - t0;
+            writes++;
+            sent += sizeof(packet);
+        }
+    }
+    line_drain(1000);
+    const uint64_t total_ns = line.now_ns - CHAR_NS; // less the tick TC takes to show
+    const double saturated = 100.0 * (double)line.busy_ns / (double)total_ns;
+    uart_tx_stats_t stats;
+    uart_tx_get_stats(CHANNEL, &stats);
+    log_printf("  saturated: %u bytes in %llu ns, line busy %.2f%%, %u DMA transfers, %u completion(s)\n",
+               stats.bytes_sent, (unsigned long long)total_ns, saturated, stats.dma_transfers,
+               stats.completions);
+    log_printf("  %u writes, %llu host ns per write\n", writes, (unsigned long long)(host_ns / writes));
+    log_printf("  uart_write_blocking holds the caller %llu ns per 64-byte write (TC wait per byte)\n",
+               (unsigned long long)(sizeof(packet) * CHAR_NS));
+    assert_check(saturated > 99.9, "queue keeps the line busy");
+    assert_check(stats.completions == 1, "one completion for the whole burst");
+
+    // periodic: a 48-byte packet every 5 ms, about 83% of the line
+    uart_tx_queue_stop(CHANNEL);
+    setup();
+    start_queue();
+    const uint64_t period_ns = 5000000;
+    uint64_t next = 0;
+    uint32_t packets = 0;
+    while (packets < 200) {
+        if (line.now_ns >= next) {
+            uart_write_queued(CHANNEL, packet, 48, &err);
+            packets++;
+            next += period_ns;
+        }
+        line_tick();
+    }
+    line_drain(1000);
+    const double offered = 100.0 * 48.0 * (double)CHAR_NS / (double)period_ns;
+    const double carried = 100.0 * (double)line.busy_ns / (double)(200 * period_ns);
+    uart_tx_get_stats(CHANNEL, &stats);
+    log_printf("  periodic: offered %.1f%%, carried %.1f%%, %u completions, peak depth %u bytes\n",
+               offered, carried, stats.completions, stats.peak_depth);
+    assert_check(stats.bytes_sent == 200 * 48 && stats.overflows == 0, "every packet sent");
+    assert_check(stats.completions == 200, "a completion per packet when the line idles between them");
+}
+
+int main(void) {
+    TestCase tests[] = {
+        TEST_CASE(test_start_registers),
+        TEST_CASE(test_start_invalid),
+        TEST_CASE(test_write_returns_at_once),
+        TEST_CASE(test_back_to_back),
+        TEST_CASE(test_overflow),
+        TEST_CASE(test_dma_error),
+        TEST_CASE(test_write_blocking_timeout),
+        TEST_CASE(test_benchmark),
+    };
+
+    return run_test_suite("uart tx queue unit tests", "uarttxtest_output.txt",
+                          tests, (int)(sizeof(tests) / sizeof(tests[0])));
+}
@@ -4,7 +4,7 @@
 #include <stdio.h>
 
 void test_uart(){
-	uart_config_t config;
+	uart_config_t config = {0};
 	uart_channel_t channel = UART4;
 	uart_parity_t parity = UART_PARITY_DISABLED;
 	uart_datalength_t data_length = UART_DATALENGTH_8;
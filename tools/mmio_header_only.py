@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""Fold generated mmio.c definitions into mmio.h as static const objects.
+
+The register map generator (from port.svd) emits `extern const` declarations in
+mmio.h and their definitions in mmio.c. Across translation units the compiler
+cannot see the definitions, so every WRITE_FIELD/READ_FIELD loads the register
+address and the field mask/position from flash. This tool replaces each extern
+declaration with a `static const` definition carrying the same initializer, so
+masks, shifts and constant-indexed register addresses fold to immediates.
+Run it on a freshly generated pair, then delete mmio.c.
+"""
+
+from __future__ import annotations
+
+import argparse
+import re
+from pathlib import Path
+
+DEF_START = re.compile(r"^(const |rw_reg|ro_reg|field)")
+DEF_NAME = re.compile(r"(\w+)\s*(\[\d*\])*\s*=")
+EXTERN_DECL = re.compile(r"^extern\s+(.*?)\s*;\s*(/\*\*.*\*/)?\s*$")
+DECL_NAME = re.compile(r"(\w+)\s*(\[\d*\])*$")
+TRAILING_DOC = re.compile(r"\s*/\*\*.*\*/\s*$")
+
+
+def parse_definitions(source: str) -> dict[str, list[str]]:
+    """Returns the definition lines of every top-level register/field object, keyed by name."""
+    defs: dict[str, list[str]] = {}
+    lines = [TRAILING_DOC.sub("", line) for line in source.splitlines()]
+    i = 0
+    while i < len(lines):
+        if not DEF_START.match(lines[i]):
+            i += 1
+            continue
+        block = [lines[i]]
+        while not block[-1].rstrip().endswith(";"):
+            i += 1
+            block.append(lines[i])
+        match = DEF_NAME.search(block[0])
+        if not match:
+            raise ValueError(f"cannot parse definition: {block[0]}")
+        defs[match.group(1)] = block
+        i += 1
+    return defs
+
+
+def flush_single(out: list[str], pending: list[tuple[str, str]]) -> None:
+    """Emits a run of one-line definitions with their doc comments aligned."""
+    if not pending:
+        return
+    width = max(len(code) for code, _ in pending)
+    for code, comment in pending:
+        out.append(f"{code.ljust(width)} {comment}".rstrip() if comment else code)
+    pending.clear()
+
+
+def convert(header: str, defs: dict[str, list[str]]) -> str:
+    out: list[str] = []
+    pending: list[tuple[str, str]] = []
+    used = set()
+    for line in header.splitlines():
+        match = EXTERN_DECL.match(line)
+        if not match:
+            flush_single(out, pending)
+            out.append(line)
+            continue
+        name_match = DECL_NAME.search(match.group(1))
+        name = name_match.group(1) if name_match else None
+        if name not in defs:
+            raise KeyError(f"no definition for {name}")
+        used.add(name)
+        block = defs[name]
+        comment = match.group(2) or ""
+        if len(block) == 1:
+            pending.append(("static " + block[0].strip(), comment))
+        else:
+            flush_single(out, pending)
+            if out and out[-1].strip():
+                out.append("")
+            if comment:
+                out.append(comment)
+            out.append("static " + block[0])
+            out.extend(block[1:])
+    flush_single(out, pending)
+    missing = set(defs) - used
+    if missing:
+        raise KeyError(f"definitions without declarations: {sorted(missing)[:5]}")
+    return "\n".join(out) + "\n"
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("header", type=Path, help="generated mmio.h")
+    parser.add_argument("source", type=Path, help="generated mmio.c")
+    args = parser.parse_args()
+
+    defs = parse_definitions(args.source.read_text())
+    args.header.write_text(convert(args.header.read_text(), defs))
+    print(f"Inlined {len(defs)} definitions into {args.header}")
+
+
+if __name__ == "__main__":
+    main()